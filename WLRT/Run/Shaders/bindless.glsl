@@ -0,0 +1,44 @@
+#ifndef BINDLESS_GLSL
+#define BINDLESS_GLSL
+
+#ifdef BINDLESS
+layout(set = 1, binding = 0, std430) readonly buffer Vertices
+{
+	vec4 vertices[];
+} vertexBuffers[];
+
+layout(set = 1, binding = 0, std430) readonly buffer Indices
+{
+	uint indices[];
+} indexBuffers[];
+
+#define VertexRef uvec2
+#define IndexRef  uvec2
+
+vec3 LoadVertex(VertexRef vertices, IndexRef indices, uint index)
+{
+	nonuniformEXT uint vertexSlot = vertices.x;
+	nonuniformEXT uint indexSlot  = indices.x;
+	return vertexBuffers[vertexSlot].vertices[indexBuffers[indexSlot].indices[index]].xyz;
+}
+#else
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer Vertices
+{
+	vec4 vertices[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer Indices
+{
+	uint indices[];
+};
+
+#define VertexRef Vertices
+#define IndexRef  Indices
+
+vec3 LoadVertex(VertexRef vertices, IndexRef indices, uint index)
+{
+	return vertices.vertices[indices.indices[index]].xyz;
+}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,13 @@
+#ifndef PAYLOAD_GLSL
+#define PAYLOAD_GLSL
+
+struct HitInfo
+{
+	vec3  position;
+	float hit;
+	vec3  normal;
+	float material;
+	vec3  albedo;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef SAMPLING_GLSL
+#define SAMPLING_GLSL
+
+const vec3 SunDirection = normalize(vec3(0.4, 0.8, 0.3));
+const vec3 SunColor     = vec3(2.0);
+
+uint Pcg(inout uint state)
+{
+	state     = state * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+float Random(inout uint state)
+{
+	return float(Pcg(state)) / 4294967296.0;
+}
+
+vec3 CosineHemisphere(vec3 normal, inout uint state)
+{
+	float phi       = 6.28318530718 * Random(state);
+	float r2        = Random(state);
+	float r         = sqrt(r2);
+	vec3  tangent   = normalize(cross(normal, abs(normal.x) > 0.5 ? vec3(0, 1, 0) : vec3(1, 0, 0)));
+	vec3  bitangent = cross(normal, tangent);
+	return normalize(tangent * (r * cos(phi)) + bitangent * (r * sin(phi)) + normal * sqrt(max(0.0, 1.0 - r2)));
+}
+
+#endif
\ No newline at end of file
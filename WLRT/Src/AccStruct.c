@@ -1,8 +1,12 @@
+#include "Bvh.h"
 #include "Vk.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
 void VkWriteTLASInstance(void* buffer, VkAccStruct* accStruct, uint32_t index, const VkTransformMatrixKHR* transform, uint32_t customIndex, uint8_t mask, uint32_t sbtOffset, VkGeometryInstanceFlagsKHR flags)
 {
 	if (!buffer || !accStruct || !accStruct->vk) return;
@@ -37,7 +41,8 @@ bool VkSetupAccStructBuilder(VkAccStructBuilder* builder)
 		.queryCount         = 1,
 		.pipelineStatistics = 0
 	};
-	if (!VkValidate(vk, vkCreateQueryPool(vk->device, &createInfo, vk->allocation, &builder->queryPool))) return false;
+	builder->queryPool = NULL;
+	if (vk->rayTracingSupported && !VkValidate(vk, vkCreateQueryPool(vk->device, &createInfo, vk->allocation, &builder->queryPool))) return false;
 	builder->type                  = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
 	builder->flags                 = 0;
 	builder->buildSize             = 0;
@@ -53,6 +58,7 @@ bool VkSetupAccStructBuilder(VkAccStructBuilder* builder)
 	builder->geometries            = NULL;
 	builder->primitiveCounts       = NULL;
 	builder->ranges                = NULL;
+	builder->hostGeometries        = NULL;
 	return true;
 }
 
@@ -64,6 +70,7 @@ void VkCleanupAccStructBuilder(VkAccStructBuilder* builder)
 	free(builder->geometries);
 	free(builder->primitiveCounts);
 	free(builder->ranges);
+	free(builder->hostGeometries);
 	vmaDestroyBuffer(vk->allocator, builder->scratchBuffer, builder->scratchBufferA);
 	vkDestroyQueryPool(vk->device, builder->queryPool, vk->allocation);
 	builder->queryPool             = NULL;
@@ -74,6 +81,7 @@ void VkCleanupAccStructBuilder(VkAccStructBuilder* builder)
 	builder->geometries            = NULL;
 	builder->primitiveCounts       = NULL;
 	builder->ranges                = NULL;
+	builder->hostGeometries        = NULL;
 }
 
 void VkCleanupAccStruct(VkAccStruct* accStruct)
@@ -83,9 +91,13 @@ void VkCleanupAccStruct(VkAccStruct* accStruct)
 
 	vmaDestroyBuffer(vk->allocator, accStruct->buffer, accStruct->allocation);
 	vkDestroyAccelerationStructureKHR(vk->device, accStruct->handle, vk->allocation);
-	accStruct->handle     = NULL;
-	accStruct->buffer     = NULL;
-	accStruct->allocation = NULL;
+	accStruct->handle            = NULL;
+	accStruct->buffer            = NULL;
+	accStruct->allocation        = NULL;
+	accStruct->bvhNodeCount      = 0;
+	accStruct->bvhTriangleCount  = 0;
+	accStruct->bvhDepth          = 0;
+	accStruct->bvhTriangleOffset = 0;
 }
 
 static bool VkAccStructBuilderEnsureGeometries(VkData* vk, VkAccStructBuilder* builder, uint32_t geometryIndex)
@@ -104,11 +116,13 @@ static bool VkAccStructBuilderEnsureGeometries(VkData* vk, VkAccStructBuilder* b
 		VkAccelerationStructureGeometryKHR*       newGeometry        = (VkAccelerationStructureGeometryKHR*) malloc(newCapacity * sizeof(VkAccelerationStructureGeometryKHR));
 		uint32_t*                                 newPrimitiveCounts = (uint32_t*) malloc(newCapacity * sizeof(uint32_t));
 		VkAccelerationStructureBuildRangeInfoKHR* newRanges          = (VkAccelerationStructureBuildRangeInfoKHR*) malloc(newCapacity * sizeof(VkAccelerationStructureBuildRangeInfoKHR));
-		if (!newGeometry || !newPrimitiveCounts || !newRanges)
+		VkAccStructHostGeometry*                  newHostGeometries  = (VkAccStructHostGeometry*) malloc(newCapacity * sizeof(VkAccStructHostGeometry));
+		if (!newGeometry || !newPrimitiveCounts || !newRanges || !newHostGeometries)
 		{
 			free(newGeometry);
 			free(newPrimitiveCounts);
 			free(newRanges);
+			free(newHostGeometries);
 			VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate acceleration structure builder buffers");
 			return false;
 		}
@@ -142,10 +156,21 @@ static bool VkAccStructBuilderEnsureGeometries(VkData* vk, VkAccStructBuilder* b
 		{
 			memset(newRanges, 0, newCapacity * sizeof(VkAccelerationStructureBuildRangeInfoKHR));
 		}
+		if (builder->hostGeometries)
+		{
+			memcpy(newHostGeometries, builder->hostGeometries, builder->geometryCapacity * sizeof(VkAccStructHostGeometry));
+			memset(newHostGeometries + builder->geometryCapacity, 0, (newCapacity - builder->geometryCapacity) * sizeof(VkAccStructHostGeometry));
+			free(builder->hostGeometries);
+		}
+		else
+		{
+			memset(newHostGeometries, 0, newCapacity * sizeof(VkAccStructHostGeometry));
+		}
 		builder->geometryCapacity = newCapacity;
 		builder->geometries       = newGeometry;
 		builder->primitiveCounts  = newPrimitiveCounts;
 		builder->ranges           = newRanges;
+		builder->hostGeometries   = newHostGeometries;
 	}
 	return true;
 }
@@ -201,6 +226,18 @@ bool VkAccStructBuilderSetTriangles(VkAccStructBuilder* builder, uint32_t geomet
 	return true;
 }
 
+bool VkAccStructBuilderSetHostTriangles(VkAccStructBuilder* builder, uint32_t geometryIndex, const void* vertexData, const void* indexData)
+{
+	if (!builder || !builder->vk) return false;
+	VkData* vk = builder->vk;
+	if (!VkAccStructBuilderEnsureGeometries(vk, builder, geometryIndex)) return false;
+
+	VkAccStructHostGeometry* hostGeometry = builder->hostGeometries + geometryIndex;
+	hostGeometry->vertexData              = vertexData;
+	hostGeometry->indexData               = indexData;
+	return true;
+}
+
 bool VkAccStructBuilderPrepare(VkAccStructBuilder* builder, VkAccelerationStructureTypeKHR type, VkBuildAccelerationStructureFlagsKHR flags, uint32_t geometryCount, uint32_t firstGeometry)
 {
 	if (!builder) return false;
@@ -467,4 +504,138 @@ bool VkAccStructBuilderCompact(VkAccStructBuilder* builder, VkAccStruct* accStru
 		return false;
 	}
 	return true;
+}
+
+static uint32_t VkAccStructReadIndex(const VkAccelerationStructureGeometryTrianglesDataKHR* triangles, const void* indexData, uint32_t index)
+{
+	switch (triangles->indexType)
+	{
+	case VK_INDEX_TYPE_UINT16: return ((const uint16_t*) indexData)[index];
+	case VK_INDEX_TYPE_UINT32: return ((const uint32_t*) indexData)[index];
+	default: return index;
+	}
+}
+
+static bool VkAccStructGatherTriangles(VkAccStructBuilder* builder, BvhTriangle* triangles)
+{
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < builder->geometryCount; ++i)
+	{
+		uint32_t                                               geometryIndex = builder->firstGeometry + i;
+		const VkAccelerationStructureGeometryTrianglesDataKHR* data          = &builder->geometries[geometryIndex].geometry.triangles;
+		const VkAccStructHostGeometry*                         hostGeometry  = builder->hostGeometries + geometryIndex;
+		const uint8_t*                                         vertices      = (const uint8_t*) hostGeometry->vertexData;
+		for (uint32_t j = 0; j < builder->primitiveCounts[geometryIndex]; ++j)
+		{
+			const float* points[3];
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				uint32_t index = VkAccStructReadIndex(data, hostGeometry->indexData, j * 3 + k);
+				if (index > data->maxVertex)
+					return false;
+				points[k] = (const float*) (vertices + (size_t) index * data->vertexStride);
+			}
+
+			BvhTriangle* triangle = triangles + count++;
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				triangle->v0[k] = points[0][k];
+				triangle->e1[k] = points[1][k] - points[0][k];
+				triangle->e2[k] = points[2][k] - points[0][k];
+			}
+			triangle->primitive = j;
+			triangle->geometry  = i;
+			triangle->pad       = 0;
+		}
+	}
+	return true;
+}
+
+bool VkAccStructBuilderBuildBvh(VkAccStructBuilder* builder, VkAccStruct* accStruct)
+{
+	if (!builder || !builder->vk || !accStruct) return false;
+	VkData* vk = builder->vk;
+
+	double   startTime     = glfwGetTime();
+	uint32_t triangleCount = 0;
+	for (uint32_t i = builder->firstGeometry; i < builder->firstGeometry + builder->geometryCount; ++i)
+	{
+		const VkAccelerationStructureGeometryKHR* geometry = builder->geometries + i;
+		VkFormat                                  format   = geometry->geometry.triangles.vertexFormat;
+		if (geometry->geometryType != VK_GEOMETRY_TYPE_TRIANGLES_KHR ||
+			(format != VK_FORMAT_R32G32B32_SFLOAT && format != VK_FORMAT_R32G32B32A32_SFLOAT) ||
+			!builder->hostGeometries[i].vertexData ||
+			(geometry->geometry.triangles.indexType != VK_INDEX_TYPE_NONE_KHR && !builder->hostGeometries[i].indexData))
+		{
+			VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Software acceleration structures need float host triangle data");
+			return false;
+		}
+		triangleCount += builder->primitiveCounts[i];
+	}
+
+	BvhTriangle* triangles = (BvhTriangle*) malloc(triangleCount * sizeof(BvhTriangle));
+	if (!triangles)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate software acceleration structure triangles");
+		return false;
+	}
+	if (!VkAccStructGatherTriangles(builder, triangles))
+	{
+		free(triangles);
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Software acceleration structure index exceeds max vertex");
+		return false;
+	}
+
+	BvhData bvh;
+	memset(&bvh, 0, sizeof(bvh));
+	bool built = BvhBuild(&bvh, triangles, triangleCount, NULL);
+	free(triangles);
+	if (!built)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to build software acceleration structure");
+		return false;
+	}
+
+	VkDeviceSize alignment      = vk->deviceProps.properties.limits.minStorageBufferOffsetAlignment;
+	VkDeviceSize triangleOffset = (bvh.nodeCount * sizeof(BvhNode) + alignment - 1) / alignment * alignment;
+	VkDeviceSize size           = triangleOffset + bvh.triangleCount * sizeof(BvhTriangle);
+
+	VkBufferCreateInfo bCreateInfo = {
+		.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext                 = NULL,
+		.flags                 = 0,
+		.size                  = size,
+		.usage                 = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		.sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices   = NULL
+	};
+	VmaAllocationCreateInfo bAllocInfo = {
+		.flags          = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+		.usage          = VMA_MEMORY_USAGE_CPU_TO_GPU,
+		.requiredFlags  = 0,
+		.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		.memoryTypeBits = 0,
+		.pool           = NULL,
+		.pUserData      = NULL,
+		.priority       = 0.0f
+	};
+	VmaAllocationInfo allocationInfo;
+	if (!VkValidate(vk, vmaCreateBuffer(vk->allocator, &bCreateInfo, &bAllocInfo, &accStruct->buffer, &accStruct->allocation, &allocationInfo)))
+	{
+		BvhCleanup(&bvh);
+		return false;
+	}
+	memcpy(allocationInfo.pMappedData, bvh.nodes, bvh.nodeCount * sizeof(BvhNode));
+	memcpy((uint8_t*) allocationInfo.pMappedData + triangleOffset, bvh.triangles, bvh.triangleCount * sizeof(BvhTriangle));
+	vmaFlushAllocation(vk->allocator, accStruct->allocation, 0, VK_WHOLE_SIZE);
+
+	accStruct->handle            = NULL;
+	accStruct->bvhNodeCount      = bvh.nodeCount;
+	accStruct->bvhTriangleCount  = bvh.triangleCount;
+	accStruct->bvhDepth          = bvh.depth;
+	accStruct->bvhTriangleOffset = triangleOffset;
+	accStruct->bvhBuildTime      = glfwGetTime() - startTime;
+	BvhCleanup(&bvh);
+	return true;
 }
\ No newline at end of file
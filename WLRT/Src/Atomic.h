@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+	#include <intrin.h>
+
+static inline uint32_t AtomicLoad32(volatile uint32_t* ptr) { return (uint32_t) _InterlockedOr((volatile long*) ptr, 0); }
+static inline void     AtomicStore32(volatile uint32_t* ptr, uint32_t value) { _InterlockedExchange((volatile long*) ptr, (long) value); }
+static inline uint32_t AtomicAdd32(volatile uint32_t* ptr, uint32_t value) { return (uint32_t) _InterlockedExchangeAdd((volatile long*) ptr, (long) value) + value; }
+static inline uint32_t AtomicExchange32(volatile uint32_t* ptr, uint32_t value) { return (uint32_t) _InterlockedExchange((volatile long*) ptr, (long) value); }
+static inline bool     AtomicCompareExchange32(volatile uint32_t* ptr, uint32_t expected, uint32_t desired) { return (uint32_t) _InterlockedCompareExchange((volatile long*) ptr, (long) desired, (long) expected) == expected; }
+
+static inline uint64_t AtomicLoad64(volatile uint64_t* ptr) { return (uint64_t) _InterlockedOr64((volatile __int64*) ptr, 0); }
+static inline void     AtomicStore64(volatile uint64_t* ptr, uint64_t value) { _InterlockedExchange64((volatile __int64*) ptr, (__int64) value); }
+static inline uint64_t AtomicAdd64(volatile uint64_t* ptr, uint64_t value) { return (uint64_t) _InterlockedExchangeAdd64((volatile __int64*) ptr, (__int64) value) + value; }
+static inline uint64_t AtomicExchange64(volatile uint64_t* ptr, uint64_t value) { return (uint64_t) _InterlockedExchange64((volatile __int64*) ptr, (__int64) value); }
+static inline bool     AtomicCompareExchange64(volatile uint64_t* ptr, uint64_t expected, uint64_t desired) { return (uint64_t) _InterlockedCompareExchange64((volatile __int64*) ptr, (__int64) desired, (__int64) expected) == expected; }
+#else
+static inline uint32_t AtomicLoad32(volatile uint32_t* ptr) { return __atomic_load_n(ptr, __ATOMIC_ACQUIRE); }
+static inline void     AtomicStore32(volatile uint32_t* ptr, uint32_t value) { __atomic_store_n(ptr, value, __ATOMIC_RELEASE); }
+static inline uint32_t AtomicAdd32(volatile uint32_t* ptr, uint32_t value) { return __atomic_add_fetch(ptr, value, __ATOMIC_ACQ_REL); }
+static inline uint32_t AtomicExchange32(volatile uint32_t* ptr, uint32_t value) { return __atomic_exchange_n(ptr, value, __ATOMIC_ACQ_REL); }
+static inline bool     AtomicCompareExchange32(volatile uint32_t* ptr, uint32_t expected, uint32_t desired) { return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE); }
+
+static inline uint64_t AtomicLoad64(volatile uint64_t* ptr) { return __atomic_load_n(ptr, __ATOMIC_ACQUIRE); }
+static inline void     AtomicStore64(volatile uint64_t* ptr, uint64_t value) { __atomic_store_n(ptr, value, __ATOMIC_RELEASE); }
+static inline uint64_t AtomicAdd64(volatile uint64_t* ptr, uint64_t value) { return __atomic_add_fetch(ptr, value, __ATOMIC_ACQ_REL); }
+static inline uint64_t AtomicExchange64(volatile uint64_t* ptr, uint64_t value) { return __atomic_exchange_n(ptr, value, __ATOMIC_ACQ_REL); }
+static inline bool     AtomicCompareExchange64(volatile uint64_t* ptr, uint64_t expected, uint64_t desired) { return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE); }
+#endif
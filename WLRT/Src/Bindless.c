@@ -0,0 +1,270 @@
+#include "Vk.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const VkDescriptorType s_BindlessTypes[VK_BINDLESS_KIND_COUNT] = {
+	VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+	VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR
+};
+static const uint32_t s_BindlessDefaultCapacities[VK_BINDLESS_KIND_COUNT] = { 16384, 16384, 1024 };
+
+static uint64_t VkBindlessCompletedSequence(VkData* vk)
+{
+	uint64_t completed = vk->framesSubmitted;
+	for (uint32_t i = 0; i < vk->framesCapacity; ++i)
+	{
+		const VkFrameData* frame = vk->frames + i;
+		if (frame->sequence == 0 || frame->sequence > completed)
+			continue;
+
+		uint64_t value = 0;
+		if (!VkValidate(vk, vkGetSemaphoreCounterValue(vk->device, frame->semaphore, &value)) ||
+			value < frame->value)
+			completed = frame->sequence - 1;
+	}
+	return completed;
+}
+
+static void VkCollectBindlessSlots(VkBindlessSlots* slots, uint64_t completed)
+{
+	uint32_t collected = 0;
+	while (collected < slots->retiredCount && slots->retired[collected].sequence <= completed)
+		slots->freeSlots[slots->freeCount++] = slots->retired[collected++].index;
+	if (collected == 0)
+		return;
+	slots->retiredCount -= collected;
+	memmove(slots->retired, slots->retired + collected, slots->retiredCount * sizeof(VkBindlessRetiredSlot));
+}
+
+static uint32_t VkBindlessAllocate(VkData* vk, VkBindlessKind kind)
+{
+	VkBindlessSlots* slots = vk->bindless.slots + kind;
+	if (!vk->bindless.set || slots->capacity == 0)
+		return VK_BINDLESS_INVALID;
+
+	if (slots->freeCount > 0)
+		return slots->freeSlots[--slots->freeCount];
+	if (slots->used < slots->capacity)
+		return slots->used++;
+	VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Bindless registry is out of slots");
+	return VK_BINDLESS_INVALID;
+}
+
+static uint32_t VkBindlessWrite(VkData* vk, VkBindlessKind kind, const void* pNext, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo)
+{
+	uint32_t index = VkBindlessAllocate(vk, kind);
+	if (index == VK_BINDLESS_INVALID)
+		return VK_BINDLESS_INVALID;
+
+	VkWriteDescriptorSet write = {
+		.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.pNext            = pNext,
+		.dstSet           = vk->bindless.set,
+		.dstBinding       = (uint32_t) kind,
+		.dstArrayElement  = index,
+		.descriptorCount  = 1,
+		.descriptorType   = s_BindlessTypes[kind],
+		.pImageInfo       = imageInfo,
+		.pBufferInfo      = bufferInfo,
+		.pTexelBufferView = NULL
+	};
+	vkUpdateDescriptorSets(vk->device, 1, &write, 0, NULL);
+	return index;
+}
+
+bool VkSetupBindless(VkData* vk)
+{
+	if (!vk) return false;
+
+	VkBindlessData* bindless = &vk->bindless;
+	bindless->setLayout      = NULL;
+	bindless->pool           = NULL;
+	bindless->set            = NULL;
+	memset(bindless->slots, 0, sizeof(bindless->slots));
+	if (!vk->bindlessSupported)
+		return true;
+
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProps = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES,
+		.pNext = NULL
+	};
+	VkPhysicalDeviceProperties2 props = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+		.pNext = &indexingProps
+	};
+	vkGetPhysicalDeviceProperties2(vk->physicalDevice, &props);
+	uint32_t limits[VK_BINDLESS_KIND_COUNT] = {
+		indexingProps.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+		indexingProps.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		vk->bindlessAccStructSupported ? vk->deviceAccStructureProps.maxPerStageDescriptorUpdateAfterBindAccelerationStructures : 0
+	};
+
+	VkDescriptorSetLayoutBinding bindings[VK_BINDLESS_KIND_COUNT];
+	VkDescriptorBindingFlags     bindingFlags[VK_BINDLESS_KIND_COUNT];
+	VkDescriptorPoolSize         poolSizes[VK_BINDLESS_KIND_COUNT];
+	uint32_t                     bindingCount = 0;
+	for (uint32_t i = 0; i < VK_BINDLESS_KIND_COUNT; ++i)
+	{
+		uint32_t capacity = bindless->capacities[i] > 0 ? bindless->capacities[i] : s_BindlessDefaultCapacities[i];
+		if (capacity > limits[i])
+			capacity = limits[i];
+		if (capacity == 0)
+			continue;
+
+		VkBindlessSlots* slots = bindless->slots + i;
+		slots->capacity        = capacity;
+		slots->freeSlots       = (uint32_t*) malloc(capacity * sizeof(uint32_t));
+		slots->retired         = (VkBindlessRetiredSlot*) malloc(capacity * sizeof(VkBindlessRetiredSlot));
+		if (!slots->freeSlots || !slots->retired)
+		{
+			VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate bindless slots");
+			VkCleanupBindless(vk);
+			return false;
+		}
+
+		bindings[bindingCount] = (VkDescriptorSetLayoutBinding) {
+			.binding            = i,
+			.descriptorType     = s_BindlessTypes[i],
+			.descriptorCount    = capacity,
+			.stageFlags         = VK_SHADER_STAGE_ALL,
+			.pImmutableSamplers = NULL
+		};
+		poolSizes[bindingCount] = (VkDescriptorPoolSize) {
+			.type            = s_BindlessTypes[i],
+			.descriptorCount = capacity
+		};
+		bindingFlags[bindingCount++] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+	}
+
+	bindless->setLayout = VkAcquireDescriptorSetLayout(vk, bindings, bindingFlags, bindingCount);
+	if (!bindless->setLayout)
+	{
+		VkCleanupBindless(vk);
+		return false;
+	}
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {
+		.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext         = NULL,
+		.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+		.maxSets       = 1,
+		.poolSizeCount = bindingCount,
+		.pPoolSizes    = poolSizes
+	};
+	if (!VkValidate(vk, vkCreateDescriptorPool(vk->device, &poolCreateInfo, vk->allocation, &bindless->pool)))
+	{
+		VkCleanupBindless(vk);
+		return false;
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {
+		.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext              = NULL,
+		.descriptorPool     = bindless->pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts        = &bindless->setLayout
+	};
+	if (!VkValidate(vk, vkAllocateDescriptorSets(vk->device, &allocInfo, &bindless->set)))
+	{
+		VkCleanupBindless(vk);
+		return false;
+	}
+	return true;
+}
+
+void VkCleanupBindless(VkData* vk)
+{
+	if (!vk) return;
+
+	VkBindlessData* bindless = &vk->bindless;
+	vkDestroyDescriptorPool(vk->device, bindless->pool, vk->allocation);
+	VkReleaseDescriptorSetLayout(vk, bindless->setLayout);
+	for (uint32_t i = 0; i < VK_BINDLESS_KIND_COUNT; ++i)
+	{
+		free(bindless->slots[i].freeSlots);
+		free(bindless->slots[i].retired);
+	}
+	bindless->setLayout = NULL;
+	bindless->pool      = NULL;
+	bindless->set       = NULL;
+	memset(bindless->slots, 0, sizeof(bindless->slots));
+}
+
+void VkUpdateBindless(VkData* vk)
+{
+	if (!vk) return;
+
+	uint64_t completed = 0;
+	bool     queried   = false;
+	for (uint32_t i = 0; i < VK_BINDLESS_KIND_COUNT; ++i)
+	{
+		VkBindlessSlots* slots = vk->bindless.slots + i;
+		if (slots->retiredCount == 0)
+			continue;
+		if (!queried)
+		{
+			completed = VkBindlessCompletedSequence(vk);
+			queried   = true;
+		}
+		VkCollectBindlessSlots(slots, completed);
+	}
+}
+
+uint32_t VkBindlessRegisterBuffer(VkData* vk, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	if (!vk || !buffer) return VK_BINDLESS_INVALID;
+
+	VkDescriptorBufferInfo bufferInfo = {
+		.buffer = buffer,
+		.offset = offset,
+		.range  = range
+	};
+	return VkBindlessWrite(vk, VK_BINDLESS_KIND_BUFFER, NULL, NULL, &bufferInfo);
+}
+
+uint32_t VkBindlessRegisterImage(VkData* vk, VkImageView view, VkImageLayout layout)
+{
+	if (!vk || !view) return VK_BINDLESS_INVALID;
+
+	VkDescriptorImageInfo imageInfo = {
+		.sampler     = NULL,
+		.imageView   = view,
+		.imageLayout = layout
+	};
+	return VkBindlessWrite(vk, VK_BINDLESS_KIND_IMAGE, NULL, &imageInfo, NULL);
+}
+
+uint32_t VkBindlessRegisterAccStruct(VkData* vk, VkAccelerationStructureKHR accStruct)
+{
+	if (!vk || !accStruct) return VK_BINDLESS_INVALID;
+
+	VkWriteDescriptorSetAccelerationStructureKHR asWrite = {
+		.sType                      = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
+		.pNext                      = NULL,
+		.accelerationStructureCount = 1,
+		.pAccelerationStructures    = &accStruct
+	};
+	return VkBindlessWrite(vk, VK_BINDLESS_KIND_ACC_STRUCT, &asWrite, NULL, NULL);
+}
+
+void VkBindlessRelease(VkData* vk, VkBindlessKind kind, uint32_t index)
+{
+	if (!vk || kind >= VK_BINDLESS_KIND_COUNT || index == VK_BINDLESS_INVALID) return;
+
+	VkBindlessSlots* slots = vk->bindless.slots + kind;
+	if (index >= slots->used || slots->retiredCount >= slots->capacity)
+		return;
+
+	VkBindlessRetiredSlot* retired = slots->retired + slots->retiredCount++;
+	retired->sequence              = vk->framesSubmitted + (vk->inFrame ? 1 : 0);
+	retired->index                 = index;
+}
+
+void VkCmdBindBindless(VkCommandBuffer buffer, VkData* vk, VkPipelineBindPoint bindPoint, VkPipelineLayout layout)
+{
+	if (!vk->bindless.set) return;
+
+	vkCmdBindDescriptorSets(buffer, bindPoint, layout, VK_BINDLESS_SET, 1, &vk->bindless.set, 0, NULL);
+}
\ No newline at end of file
@@ -0,0 +1,350 @@
+#include "Bvh.h"
+#include "Atomic.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BVH_BINS           16
+#define BVH_MAX_LEAF       4
+#define BVH_TRAVERSAL_COST 1.0f
+#define BVH_TASK_MIN       1024
+#define BVH_TASKS_PER_JOB  8
+
+typedef struct BvhBounds
+{
+	float min[3];
+	float max[3];
+} BvhBounds;
+
+typedef struct BvhBin
+{
+	BvhBounds bounds;
+	uint32_t  count;
+} BvhBin;
+
+typedef struct BvhBuildData
+{
+	BvhData*          bvh;
+	BvhBounds*        bounds;
+	float*            centroids;
+	uint32_t*         indices;
+	volatile uint32_t nodeCount;
+	volatile uint32_t depth;
+	volatile uint32_t failed;
+} BvhBuildData;
+
+typedef struct BvhBuildEntry
+{
+	uint32_t node;
+	uint32_t depth;
+} BvhBuildEntry;
+
+typedef struct BvhBuildTask
+{
+	BvhBuildData* build;
+	uint32_t      node;
+	uint32_t      depth;
+} BvhBuildTask;
+
+static void BvhBoundsReset(BvhBounds* bounds)
+{
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		bounds->min[i] = FLT_MAX;
+		bounds->max[i] = -FLT_MAX;
+	}
+}
+
+static void BvhBoundsGrowPoint(BvhBounds* bounds, const float* point)
+{
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		bounds->min[i] = point[i] < bounds->min[i] ? point[i] : bounds->min[i];
+		bounds->max[i] = point[i] > bounds->max[i] ? point[i] : bounds->max[i];
+	}
+}
+
+static void BvhBoundsGrow(BvhBounds* bounds, const BvhBounds* other)
+{
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		bounds->min[i] = other->min[i] < bounds->min[i] ? other->min[i] : bounds->min[i];
+		bounds->max[i] = other->max[i] > bounds->max[i] ? other->max[i] : bounds->max[i];
+	}
+}
+
+static float BvhBoundsArea(const BvhBounds* bounds)
+{
+	if (bounds->min[0] > bounds->max[0])
+		return 0.0f;
+	float dx = bounds->max[0] - bounds->min[0];
+	float dy = bounds->max[1] - bounds->min[1];
+	float dz = bounds->max[2] - bounds->min[2];
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static void BvhSetNode(BvhBuildData* build, uint32_t nodeIndex, uint32_t first, uint32_t count)
+{
+	BvhNode*  node = build->bvh->nodes + nodeIndex;
+	BvhBounds bounds;
+	BvhBoundsReset(&bounds);
+	for (uint32_t i = first; i < first + count; ++i)
+		BvhBoundsGrow(&bounds, build->bounds + build->indices[i]);
+	memcpy(node->min, bounds.min, sizeof(node->min));
+	memcpy(node->max, bounds.max, sizeof(node->max));
+	node->first = first;
+	node->count = count;
+}
+
+static uint32_t BvhBinIndex(float centroid, float min, float scale)
+{
+	uint32_t bin = (uint32_t) ((centroid - min) * scale);
+	return bin < BVH_BINS ? bin : BVH_BINS - 1;
+}
+
+static bool BvhSubdivide(BvhBuildData* build, uint32_t nodeIndex)
+{
+	BvhData* bvh   = build->bvh;
+	BvhNode* node  = bvh->nodes + nodeIndex;
+	uint32_t first = node->first;
+	uint32_t count = node->count;
+	if (count <= 1)
+		return false;
+
+	BvhBounds centroidBounds;
+	BvhBoundsReset(&centroidBounds);
+	for (uint32_t i = first; i < first + count; ++i)
+		BvhBoundsGrowPoint(&centroidBounds, build->centroids + build->indices[i] * 3);
+
+	int32_t  bestAxis  = -1;
+	uint32_t bestSplit = 0;
+	float    bestCost  = FLT_MAX;
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		if (extent <= 0.0f)
+			continue;
+
+		BvhBin bins[BVH_BINS];
+		for (uint32_t i = 0; i < BVH_BINS; ++i)
+		{
+			BvhBoundsReset(&bins[i].bounds);
+			bins[i].count = 0;
+		}
+		float scale = BVH_BINS / extent;
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			uint32_t triangle = build->indices[i];
+			BvhBin*  bin      = bins + BvhBinIndex(build->centroids[triangle * 3 + axis], centroidBounds.min[axis], scale);
+			BvhBoundsGrow(&bin->bounds, build->bounds + triangle);
+			++bin->count;
+		}
+
+		float     leftAreas[BVH_BINS - 1];
+		uint32_t  leftCounts[BVH_BINS - 1];
+		BvhBounds left;
+		uint32_t  leftCount = 0;
+		BvhBoundsReset(&left);
+		for (uint32_t i = 0; i < BVH_BINS - 1; ++i)
+		{
+			BvhBoundsGrow(&left, &bins[i].bounds);
+			leftCount    += bins[i].count;
+			leftAreas[i]  = BvhBoundsArea(&left);
+			leftCounts[i] = leftCount;
+		}
+		BvhBounds right;
+		uint32_t  rightCount = 0;
+		BvhBoundsReset(&right);
+		for (uint32_t i = BVH_BINS - 1; i > 0; --i)
+		{
+			BvhBoundsGrow(&right, &bins[i].bounds);
+			rightCount += bins[i].count;
+			if (leftCounts[i - 1] == 0 || rightCount == 0)
+				continue;
+			float cost = leftCounts[i - 1] * leftAreas[i - 1] + rightCount * BvhBoundsArea(&right);
+			if (cost < bestCost)
+			{
+				bestAxis  = (int32_t) axis;
+				bestSplit = i;
+				bestCost  = cost;
+			}
+		}
+	}
+	if (bestAxis < 0)
+		return false;
+
+	BvhBounds nodeBounds;
+	memcpy(nodeBounds.min, node->min, sizeof(nodeBounds.min));
+	memcpy(nodeBounds.max, node->max, sizeof(nodeBounds.max));
+	float nodeArea = BvhBoundsArea(&nodeBounds);
+	if (count <= BVH_MAX_LEAF && bestCost + BVH_TRAVERSAL_COST * nodeArea >= count * nodeArea)
+		return false;
+
+	float    scale = BVH_BINS / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+	uint32_t i     = first;
+	uint32_t j     = first + count;
+	while (i < j)
+	{
+		if (BvhBinIndex(build->centroids[build->indices[i] * 3 + bestAxis], centroidBounds.min[bestAxis], scale) < bestSplit)
+		{
+			++i;
+		}
+		else
+		{
+			uint32_t index    = build->indices[i];
+			build->indices[i] = build->indices[--j];
+			build->indices[j] = index;
+		}
+	}
+
+	uint32_t children = AtomicAdd32(&build->nodeCount, 2) - 2;
+	BvhSetNode(build, children, first, i - first);
+	BvhSetNode(build, children + 1, i, first + count - i);
+	node->first = children;
+	node->count = 0;
+	return true;
+}
+
+static void BvhUpdateDepth(BvhBuildData* build, uint32_t depth)
+{
+	uint32_t current = AtomicLoad32(&build->depth);
+	while (depth > current && !AtomicCompareExchange32(&build->depth, current, depth))
+		current = AtomicLoad32(&build->depth);
+}
+
+static bool BvhBuildNodes(BvhBuildData* build, uint32_t root, uint32_t rootDepth, uint32_t taskSize, BvhBuildTask* tasks, uint32_t* taskCount)
+{
+	BvhData*       bvh       = build->bvh;
+	BvhBuildEntry* stack     = (BvhBuildEntry*) malloc((bvh->nodes[root].count + 1) * sizeof(BvhBuildEntry));
+	uint32_t       stackSize = 0;
+	uint32_t       maxDepth  = rootDepth;
+	if (!stack)
+		return false;
+
+	stack[stackSize++] = (BvhBuildEntry) { root, rootDepth };
+	while (stackSize > 0)
+	{
+		BvhBuildEntry entry = stack[--stackSize];
+		uint32_t      count = bvh->nodes[entry.node].count;
+		if (tasks && count <= taskSize && count >= BVH_TASK_MIN)
+		{
+			tasks[(*taskCount)++] = (BvhBuildTask) { build, entry.node, entry.depth };
+			continue;
+		}
+		maxDepth = entry.depth > maxDepth ? entry.depth : maxDepth;
+		if (!BvhSubdivide(build, entry.node))
+			continue;
+		uint32_t children  = bvh->nodes[entry.node].first;
+		stack[stackSize++] = (BvhBuildEntry) { children + 1, entry.depth + 1 };
+		stack[stackSize++] = (BvhBuildEntry) { children, entry.depth + 1 };
+	}
+	free(stack);
+	BvhUpdateDepth(build, maxDepth);
+	return true;
+}
+
+static void BvhBuildJob(void* userData, uint32_t threadIndex)
+{
+	(void) threadIndex;
+	BvhBuildTask* task = (BvhBuildTask*) userData;
+	if (!BvhBuildNodes(task->build, task->node, task->depth, ~0U, NULL, NULL))
+		AtomicStore32(&task->build->failed, 1);
+}
+
+bool BvhBuild(BvhData* bvh, const BvhTriangle* triangles, uint32_t triangleCount, JobSystem* jobs)
+{
+	if (!bvh || !triangles || triangleCount == 0) return false;
+
+	uint32_t     nodeCapacity = triangleCount * 2;
+	uint32_t     taskCapacity = jobs ? triangleCount / BVH_TASK_MIN + 1 : 0;
+	BvhBuildData build        = {
+		       .bvh       = bvh,
+		       .bounds    = (BvhBounds*) malloc(triangleCount * sizeof(BvhBounds)),
+		       .centroids = (float*) malloc(triangleCount * 3 * sizeof(float)),
+		       .indices   = (uint32_t*) malloc(triangleCount * sizeof(uint32_t)),
+		       .nodeCount = 1,
+		       .depth     = 0,
+		       .failed    = 0
+	};
+	BvhBuildTask* tasks = taskCapacity > 0 ? (BvhBuildTask*) malloc(taskCapacity * sizeof(BvhBuildTask)) : NULL;
+	bvh->nodeCount      = 0;
+	bvh->nodes          = (BvhNode*) malloc(nodeCapacity * sizeof(BvhNode));
+	bvh->triangleCount  = triangleCount;
+	bvh->triangles      = (BvhTriangle*) malloc(triangleCount * sizeof(BvhTriangle));
+	bvh->depth          = 0;
+	if (!build.bounds || !build.centroids || !build.indices || (taskCapacity > 0 && !tasks) || !bvh->nodes || !bvh->triangles)
+	{
+		free(build.bounds);
+		free(build.centroids);
+		free(build.indices);
+		free(tasks);
+		BvhCleanup(bvh);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < triangleCount; ++i)
+	{
+		const BvhTriangle* triangle = triangles + i;
+		float              v1[3];
+		float              v2[3];
+		for (uint32_t j = 0; j < 3; ++j)
+		{
+			v1[j] = triangle->v0[j] + triangle->e1[j];
+			v2[j] = triangle->v0[j] + triangle->e2[j];
+		}
+		BvhBoundsReset(build.bounds + i);
+		BvhBoundsGrowPoint(build.bounds + i, triangle->v0);
+		BvhBoundsGrowPoint(build.bounds + i, v1);
+		BvhBoundsGrowPoint(build.bounds + i, v2);
+		for (uint32_t j = 0; j < 3; ++j)
+			build.centroids[i * 3 + j] = (triangle->v0[j] + v1[j] + v2[j]) / 3.0f;
+		build.indices[i] = i;
+	}
+
+	BvhSetNode(&build, 0, 0, triangleCount);
+	uint32_t taskCount = 0;
+	uint32_t taskSize  = triangleCount / (JobSystemThreadCount(jobs) * BVH_TASKS_PER_JOB);
+	bool     built     = BvhBuildNodes(&build, 0, 1, taskSize > BVH_TASK_MIN ? taskSize : BVH_TASK_MIN, tasks, &taskCount);
+	if (taskCount > 0)
+	{
+		JobCounter counter = { 0 };
+		for (uint32_t i = 0; i < taskCount; ++i)
+		{
+			if (!JobSystemSubmit(jobs, &BvhBuildJob, tasks + i, &counter))
+				BvhBuildJob(tasks + i, 0);
+		}
+		JobSystemWait(jobs, &counter);
+	}
+	free(tasks);
+	if (!built || build.failed)
+	{
+		free(build.bounds);
+		free(build.centroids);
+		free(build.indices);
+		BvhCleanup(bvh);
+		return false;
+	}
+	for (uint32_t i = 0; i < triangleCount; ++i)
+		bvh->triangles[i] = triangles[build.indices[i]];
+	bvh->nodeCount = build.nodeCount;
+	bvh->depth     = build.depth;
+
+	free(build.bounds);
+	free(build.centroids);
+	free(build.indices);
+	return true;
+}
+
+void BvhCleanup(BvhData* bvh)
+{
+	if (!bvh) return;
+
+	free(bvh->nodes);
+	free(bvh->triangles);
+	bvh->nodeCount     = 0;
+	bvh->nodes         = NULL;
+	bvh->triangleCount = 0;
+	bvh->triangles     = NULL;
+	bvh->depth         = 0;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct BvhNode
+{
+	float    min[3];
+	uint32_t first;
+	float    max[3];
+	uint32_t count;
+} BvhNode;
+
+typedef struct BvhTriangle
+{
+	float    v0[3];
+	uint32_t primitive;
+	float    e1[3];
+	uint32_t geometry;
+	float    e2[3];
+	uint32_t pad;
+} BvhTriangle;
+
+typedef struct BvhData
+{
+	uint32_t     nodeCount;
+	BvhNode*     nodes;
+	uint32_t     triangleCount;
+	BvhTriangle* triangles;
+	uint32_t     depth;
+} BvhData;
+
+bool BvhBuild(BvhData* bvh, const BvhTriangle* triangles, uint32_t triangleCount, JobSystem* jobs);
+void BvhCleanup(BvhData* bvh);
\ No newline at end of file
@@ -0,0 +1,811 @@
+#include "CpuTracer.h"
+#include "Atomic.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+
+	#define CPU_TRACER_WIDTH 8
+	#define CPU_TRACER_SIMD  "AVX2"
+
+typedef __m256 CpuVec;
+
+static inline CpuVec   CpuVecSet(float value) { return _mm256_set1_ps(value); }
+static inline CpuVec   CpuVecLoad(const float* values) { return _mm256_loadu_ps(values); }
+static inline void     CpuVecStore(float* values, CpuVec a) { _mm256_storeu_ps(values, a); }
+static inline CpuVec   CpuVecAdd(CpuVec a, CpuVec b) { return _mm256_add_ps(a, b); }
+static inline CpuVec   CpuVecSub(CpuVec a, CpuVec b) { return _mm256_sub_ps(a, b); }
+static inline CpuVec   CpuVecMul(CpuVec a, CpuVec b) { return _mm256_mul_ps(a, b); }
+static inline CpuVec   CpuVecDiv(CpuVec a, CpuVec b) { return _mm256_div_ps(a, b); }
+static inline CpuVec   CpuVecMin(CpuVec a, CpuVec b) { return _mm256_min_ps(a, b); }
+static inline CpuVec   CpuVecMax(CpuVec a, CpuVec b) { return _mm256_max_ps(a, b); }
+static inline CpuVec   CpuVecLess(CpuVec a, CpuVec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline CpuVec   CpuVecLessEqual(CpuVec a, CpuVec b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline CpuVec   CpuVecAnd(CpuVec a, CpuVec b) { return _mm256_and_ps(a, b); }
+static inline CpuVec   CpuVecSelect(CpuVec mask, CpuVec a, CpuVec b) { return _mm256_blendv_ps(b, a, mask); }
+static inline uint32_t CpuVecMask(CpuVec mask) { return (uint32_t) _mm256_movemask_ps(mask); }
+static inline CpuVec   CpuVecLanes(uint32_t bits)
+{
+	__m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int) bits), lanes), lanes));
+}
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+
+	#define CPU_TRACER_WIDTH 4
+	#define CPU_TRACER_SIMD  "SSE2"
+
+typedef __m128 CpuVec;
+
+static inline CpuVec   CpuVecSet(float value) { return _mm_set1_ps(value); }
+static inline CpuVec   CpuVecLoad(const float* values) { return _mm_loadu_ps(values); }
+static inline void     CpuVecStore(float* values, CpuVec a) { _mm_storeu_ps(values, a); }
+static inline CpuVec   CpuVecAdd(CpuVec a, CpuVec b) { return _mm_add_ps(a, b); }
+static inline CpuVec   CpuVecSub(CpuVec a, CpuVec b) { return _mm_sub_ps(a, b); }
+static inline CpuVec   CpuVecMul(CpuVec a, CpuVec b) { return _mm_mul_ps(a, b); }
+static inline CpuVec   CpuVecDiv(CpuVec a, CpuVec b) { return _mm_div_ps(a, b); }
+static inline CpuVec   CpuVecMin(CpuVec a, CpuVec b) { return _mm_min_ps(a, b); }
+static inline CpuVec   CpuVecMax(CpuVec a, CpuVec b) { return _mm_max_ps(a, b); }
+static inline CpuVec   CpuVecLess(CpuVec a, CpuVec b) { return _mm_cmplt_ps(a, b); }
+static inline CpuVec   CpuVecLessEqual(CpuVec a, CpuVec b) { return _mm_cmple_ps(a, b); }
+static inline CpuVec   CpuVecAnd(CpuVec a, CpuVec b) { return _mm_and_ps(a, b); }
+static inline CpuVec   CpuVecSelect(CpuVec mask, CpuVec a, CpuVec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+static inline uint32_t CpuVecMask(CpuVec mask) { return (uint32_t) _mm_movemask_ps(mask); }
+static inline CpuVec   CpuVecLanes(uint32_t bits)
+{
+	__m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+	return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int) bits), lanes), lanes));
+}
+#else
+	#define CPU_TRACER_WIDTH 4
+	#define CPU_TRACER_SIMD  "scalar"
+
+typedef struct CpuVec
+{
+	float lanes[CPU_TRACER_WIDTH];
+} CpuVec;
+
+	#define CPU_VEC_LANES(expr)                         \
+		CpuVec result;                                  \
+		for (uint32_t i = 0; i < CPU_TRACER_WIDTH; ++i) \
+			result.lanes[i] = (expr);                   \
+		return result;
+
+static inline CpuVec CpuVecSet(float value) { CPU_VEC_LANES(value) }
+static inline CpuVec CpuVecLoad(const float* values) { CPU_VEC_LANES(values[i]) }
+static inline void   CpuVecStore(float* values, CpuVec a) { memcpy(values, a.lanes, sizeof(a.lanes)); }
+static inline CpuVec CpuVecAdd(CpuVec a, CpuVec b) { CPU_VEC_LANES(a.lanes[i] + b.lanes[i]) }
+static inline CpuVec CpuVecSub(CpuVec a, CpuVec b) { CPU_VEC_LANES(a.lanes[i] - b.lanes[i]) }
+static inline CpuVec CpuVecMul(CpuVec a, CpuVec b) { CPU_VEC_LANES(a.lanes[i] * b.lanes[i]) }
+static inline CpuVec CpuVecDiv(CpuVec a, CpuVec b) { CPU_VEC_LANES(a.lanes[i] / b.lanes[i]) }
+static inline CpuVec CpuVecMin(CpuVec a, CpuVec b) { CPU_VEC_LANES(a.lanes[i] < b.lanes[i] ? a.lanes[i] : b.lanes[i]) }
+static inline CpuVec CpuVecMax(CpuVec a, CpuVec b) { CPU_VEC_LANES(a.lanes[i] > b.lanes[i] ? a.lanes[i] : b.lanes[i]) }
+static inline CpuVec CpuVecLess(CpuVec a, CpuVec b) { CPU_VEC_LANES(a.lanes[i] < b.lanes[i] ? 1.0f : 0.0f) }
+static inline CpuVec CpuVecLessEqual(CpuVec a, CpuVec b) { CPU_VEC_LANES(a.lanes[i] <= b.lanes[i] ? 1.0f : 0.0f) }
+static inline CpuVec CpuVecAnd(CpuVec a, CpuVec b) { CPU_VEC_LANES(a.lanes[i] != 0.0f && b.lanes[i] != 0.0f ? 1.0f : 0.0f) }
+static inline CpuVec CpuVecSelect(CpuVec mask, CpuVec a, CpuVec b) { CPU_VEC_LANES(mask.lanes[i] != 0.0f ? a.lanes[i] : b.lanes[i]) }
+static inline CpuVec CpuVecLanes(uint32_t bits) { CPU_VEC_LANES((bits & (1U << i)) != 0 ? 1.0f : 0.0f) }
+
+static inline uint32_t CpuVecMask(CpuVec mask)
+{
+	uint32_t bits = 0;
+	for (uint32_t i = 0; i < CPU_TRACER_WIDTH; ++i)
+		bits |= mask.lanes[i] != 0.0f ? 1U << i : 0U;
+	return bits;
+}
+#endif
+
+#define CPU_TRACER_TILE   8
+#define CPU_TRACER_STACK  512
+#define CPU_TRACER_NO_HIT 1e30f
+#define CPU_TRACER_LANES  ((1U << CPU_TRACER_WIDTH) - 1)
+
+struct CpuTracerNode
+{
+	float    bounds[2][3][CPU_TRACER_WIDTH];
+	uint32_t child[CPU_TRACER_WIDTH];
+	uint32_t count[CPU_TRACER_WIDTH];
+	uint32_t childCount;
+};
+
+typedef struct CpuTracerHit
+{
+	float    t;
+	float    u;
+	float    v;
+	uint32_t triangle;
+} CpuTracerHit;
+
+typedef struct CpuTracerEntry
+{
+	uint32_t node;
+	float    t;
+} CpuTracerEntry;
+
+typedef struct CpuTracerCollapseEntry
+{
+	uint32_t node;
+	uint32_t source;
+} CpuTracerCollapseEntry;
+
+static const float s_SunDirection[3] = { 0.42399915f, 0.84799830f, 0.31799936f };
+static const float s_SunColor[3]     = { 2.0f, 2.0f, 2.0f };
+
+static float CpuTracerDot(const float* a, const float* b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void CpuTracerCross(const float* a, const float* b, float* result)
+{
+	result[0] = a[1] * b[2] - a[2] * b[1];
+	result[1] = a[2] * b[0] - a[0] * b[2];
+	result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static void CpuTracerNormalize(float* a)
+{
+	float scale = 1.0f / sqrtf(CpuTracerDot(a, a));
+	for (uint32_t i = 0; i < 3; ++i)
+		a[i] *= scale;
+}
+
+static uint32_t CpuTracerPcg(uint32_t* state)
+{
+	*state        = *state * 747796405U + 2891336453U;
+	uint32_t word = ((*state >> ((*state >> 28U) + 4U)) ^ *state) * 277803737U;
+	return (word >> 22U) ^ word;
+}
+
+static float CpuTracerRandom(uint32_t* state)
+{
+	return (float) CpuTracerPcg(state) / 4294967296.0f;
+}
+
+static void CpuTracerCosineHemisphere(const float* normal, uint32_t* state, float* direction)
+{
+	float phi       = 6.28318530718f * CpuTracerRandom(state);
+	float r2        = CpuTracerRandom(state);
+	float r         = sqrtf(r2);
+	float axis[3]   = { fabsf(normal[0]) > 0.5f ? 0.0f : 1.0f, fabsf(normal[0]) > 0.5f ? 1.0f : 0.0f, 0.0f };
+	float tangent[3];
+	float bitangent[3];
+	CpuTracerCross(normal, axis, tangent);
+	CpuTracerNormalize(tangent);
+	CpuTracerCross(normal, tangent, bitangent);
+	float z = sqrtf(fmaxf(0.0f, 1.0f - r2));
+	for (uint32_t i = 0; i < 3; ++i)
+		direction[i] = tangent[i] * (r * cosf(phi)) + bitangent[i] * (r * sinf(phi)) + normal[i] * z;
+	CpuTracerNormalize(direction);
+}
+
+static float CpuTracerBoundsArea(const BvhNode* node)
+{
+	float dx = node->max[0] - node->min[0];
+	float dy = node->max[1] - node->min[1];
+	float dz = node->max[2] - node->min[2];
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static bool CpuTracerCollapse(CpuTracerData* tracer)
+{
+	const BvhData* bvh = tracer->bvh;
+
+	CpuTracerCollapseEntry* queue = (CpuTracerCollapseEntry*) malloc(bvh->nodeCount * sizeof(CpuTracerCollapseEntry));
+	tracer->nodes                 = (CpuTracerNode*) malloc(bvh->nodeCount * sizeof(CpuTracerNode));
+	tracer->nodeCount             = 1;
+	if (!queue || !tracer->nodes)
+	{
+		free(queue);
+		return false;
+	}
+
+	uint32_t head = 0;
+	uint32_t tail = 0;
+	queue[tail++] = (CpuTracerCollapseEntry) { 0, 0 };
+	while (head < tail)
+	{
+		CpuTracerCollapseEntry entry  = queue[head++];
+		CpuTracerNode*         node   = tracer->nodes + entry.node;
+		const BvhNode*         source = bvh->nodes + entry.source;
+
+		uint32_t slots[CPU_TRACER_WIDTH];
+		uint32_t slotCount = 0;
+		if (source->count > 0)
+		{
+			slots[slotCount++] = entry.source;
+		}
+		else
+		{
+			slots[slotCount++] = source->first;
+			slots[slotCount++] = source->first + 1;
+		}
+		while (slotCount < CPU_TRACER_WIDTH)
+		{
+			uint32_t best     = CPU_TRACER_WIDTH;
+			float    bestArea = -1.0f;
+			for (uint32_t i = 0; i < slotCount; ++i)
+			{
+				const BvhNode* slot = bvh->nodes + slots[i];
+				float          area = CpuTracerBoundsArea(slot);
+				if (slot->count == 0 && area > bestArea)
+				{
+					best     = i;
+					bestArea = area;
+				}
+			}
+			if (best == CPU_TRACER_WIDTH)
+				break;
+			uint32_t first     = bvh->nodes[slots[best]].first;
+			slots[best]        = first;
+			slots[slotCount++] = first + 1;
+		}
+
+		node->childCount = slotCount;
+		for (uint32_t i = 0; i < CPU_TRACER_WIDTH; ++i)
+		{
+			const BvhNode* slot = i < slotCount ? bvh->nodes + slots[i] : NULL;
+			for (uint32_t j = 0; j < 3; ++j)
+			{
+				node->bounds[0][j][i] = slot ? slot->min[j] : FLT_MAX;
+				node->bounds[1][j][i] = slot ? slot->max[j] : -FLT_MAX;
+			}
+			node->count[i] = slot ? slot->count : 0;
+			node->child[i] = slot && slot->count > 0 ? slot->first : 0;
+			if (!slot || slot->count > 0)
+				continue;
+			node->child[i] = tracer->nodeCount++;
+			queue[tail++]  = (CpuTracerCollapseEntry) { node->child[i], slots[i] };
+		}
+	}
+	free(queue);
+	return true;
+}
+
+static bool CpuTracerIntersect(const BvhTriangle* triangle, uint32_t index, const float* origin, const float* direction, CpuTracerHit* hit)
+{
+	float p[3];
+	CpuTracerCross(direction, triangle->e2, p);
+	float det = CpuTracerDot(triangle->e1, p);
+	if (fabsf(det) < 1e-12f)
+		return false;
+	float inverseDet = 1.0f / det;
+	float s[3]       = { origin[0] - triangle->v0[0], origin[1] - triangle->v0[1], origin[2] - triangle->v0[2] };
+	float u          = CpuTracerDot(s, p) * inverseDet;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+	float q[3];
+	CpuTracerCross(s, triangle->e1, q);
+	float v = CpuTracerDot(direction, q) * inverseDet;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+	float t = CpuTracerDot(triangle->e2, q) * inverseDet;
+	if (t <= 1e-4f || t >= hit->t)
+		return false;
+	hit->t        = t;
+	hit->u        = u;
+	hit->v        = v;
+	hit->triangle = index;
+	return true;
+}
+
+static uint32_t CpuTracerPushChildren(CpuTracerEntry* stack, uint32_t stackSize, CpuTracerEntry* children, uint32_t childCount)
+{
+	for (uint32_t i = 1; i < childCount; ++i)
+	{
+		CpuTracerEntry child = children[i];
+		uint32_t       j     = i;
+		for (; j > 0 && children[j - 1].t < child.t; --j)
+			children[j] = children[j - 1];
+		children[j] = child;
+	}
+	for (uint32_t i = 0; i < childCount && stackSize < CPU_TRACER_STACK; ++i)
+		stack[stackSize++] = children[i];
+	return stackSize;
+}
+
+static bool CpuTracerTrace(const CpuTracerData* tracer, const float* origin, const float* direction, bool anyHit, CpuTracerHit* hit)
+{
+	const BvhTriangle* triangles = tracer->bvh->triangles;
+
+	CpuVec   origins[3];
+	CpuVec   inverses[3];
+	uint32_t near[3];
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		float inverse = 1.0f / (fabsf(direction[i]) < 1e-20f ? 1e-20f : direction[i]);
+		origins[i]    = CpuVecSet(origin[i]);
+		inverses[i]   = CpuVecSet(inverse);
+		near[i]       = inverse < 0.0f ? 1 : 0;
+	}
+	hit->t        = CPU_TRACER_NO_HIT;
+	hit->u        = 0.0f;
+	hit->v        = 0.0f;
+	hit->triangle = 0;
+
+	CpuTracerEntry stack[CPU_TRACER_STACK];
+	uint32_t       stackSize = 0;
+	stack[stackSize++]       = (CpuTracerEntry) { 0, 0.0f };
+	while (stackSize > 0)
+	{
+		CpuTracerEntry entry = stack[--stackSize];
+		if (entry.t >= hit->t)
+			continue;
+
+		const CpuTracerNode* node  = tracer->nodes + entry.node;
+		CpuVec               tNear = CpuVecSet(1e-4f);
+		CpuVec               tFar  = CpuVecSet(hit->t);
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			tNear = CpuVecMax(tNear, CpuVecMul(CpuVecSub(CpuVecLoad(node->bounds[near[i]][i]), origins[i]), inverses[i]));
+			tFar  = CpuVecMin(tFar, CpuVecMul(CpuVecSub(CpuVecLoad(node->bounds[1 - near[i]][i]), origins[i]), inverses[i]));
+		}
+		uint32_t mask = CpuVecMask(CpuVecLessEqual(tNear, tFar)) & ((1U << node->childCount) - 1);
+		if (!mask)
+			continue;
+
+		float distances[CPU_TRACER_WIDTH];
+		CpuVecStore(distances, tNear);
+
+		CpuTracerEntry children[CPU_TRACER_WIDTH];
+		uint32_t       childCount = 0;
+		for (uint32_t i = 0; i < node->childCount; ++i)
+		{
+			if (!(mask & (1U << i)))
+				continue;
+			if (node->count[i] == 0)
+			{
+				children[childCount++] = (CpuTracerEntry) { node->child[i], distances[i] };
+				continue;
+			}
+			for (uint32_t j = node->child[i]; j < node->child[i] + node->count[i]; ++j)
+			{
+				if (CpuTracerIntersect(triangles + j, j, origin, direction, hit) && anyHit)
+					return true;
+			}
+		}
+		stackSize = CpuTracerPushChildren(stack, stackSize, children, childCount);
+	}
+	return hit->t < CPU_TRACER_NO_HIT;
+}
+
+static void CpuTracerIntersectPacket(const BvhTriangle* triangle, uint32_t index, const CpuVec* origins, const CpuVec* directions, uint32_t active, CpuVec* t, CpuVec* u, CpuVec* v, uint32_t* hits)
+{
+	CpuVec e1[3] = { CpuVecSet(triangle->e1[0]), CpuVecSet(triangle->e1[1]), CpuVecSet(triangle->e1[2]) };
+	CpuVec e2[3] = { CpuVecSet(triangle->e2[0]), CpuVecSet(triangle->e2[1]), CpuVecSet(triangle->e2[2]) };
+	CpuVec s[3]  = { CpuVecSub(origins[0], CpuVecSet(triangle->v0[0])), CpuVecSub(origins[1], CpuVecSet(triangle->v0[1])), CpuVecSub(origins[2], CpuVecSet(triangle->v0[2])) };
+
+	CpuVec p[3] = {
+		CpuVecSub(CpuVecMul(directions[1], e2[2]), CpuVecMul(directions[2], e2[1])),
+		CpuVecSub(CpuVecMul(directions[2], e2[0]), CpuVecMul(directions[0], e2[2])),
+		CpuVecSub(CpuVecMul(directions[0], e2[1]), CpuVecMul(directions[1], e2[0]))
+	};
+	CpuVec q[3] = {
+		CpuVecSub(CpuVecMul(s[1], e1[2]), CpuVecMul(s[2], e1[1])),
+		CpuVecSub(CpuVecMul(s[2], e1[0]), CpuVecMul(s[0], e1[2])),
+		CpuVecSub(CpuVecMul(s[0], e1[1]), CpuVecMul(s[1], e1[0]))
+	};
+	CpuVec det        = CpuVecAdd(CpuVecAdd(CpuVecMul(e1[0], p[0]), CpuVecMul(e1[1], p[1])), CpuVecMul(e1[2], p[2]));
+	CpuVec inverseDet = CpuVecDiv(CpuVecSet(1.0f), det);
+	CpuVec hitU       = CpuVecMul(CpuVecAdd(CpuVecAdd(CpuVecMul(s[0], p[0]), CpuVecMul(s[1], p[1])), CpuVecMul(s[2], p[2])), inverseDet);
+	CpuVec hitV       = CpuVecMul(CpuVecAdd(CpuVecAdd(CpuVecMul(directions[0], q[0]), CpuVecMul(directions[1], q[1])), CpuVecMul(directions[2], q[2])), inverseDet);
+	CpuVec hitT       = CpuVecMul(CpuVecAdd(CpuVecAdd(CpuVecMul(e2[0], q[0]), CpuVecMul(e2[1], q[1])), CpuVecMul(e2[2], q[2])), inverseDet);
+
+	CpuVec zero = CpuVecSet(0.0f);
+	CpuVec one  = CpuVecSet(1.0f);
+	CpuVec mask = CpuVecLessEqual(CpuVecSet(1e-12f), CpuVecMax(det, CpuVecSub(zero, det)));
+	mask        = CpuVecAnd(mask, CpuVecAnd(CpuVecLessEqual(zero, hitU), CpuVecLessEqual(hitU, one)));
+	mask        = CpuVecAnd(mask, CpuVecAnd(CpuVecLessEqual(zero, hitV), CpuVecLessEqual(CpuVecAdd(hitU, hitV), one)));
+	mask        = CpuVecAnd(mask, CpuVecAnd(CpuVecLess(CpuVecSet(1e-4f), hitT), CpuVecLess(hitT, *t)));
+	mask        = CpuVecAnd(mask, CpuVecLanes(active));
+
+	uint32_t bits = CpuVecMask(mask);
+	if (!bits)
+		return;
+	for (uint32_t i = 0; i < CPU_TRACER_WIDTH; ++i)
+	{
+		if (bits & (1U << i))
+			hits[i] = index;
+	}
+	*t = CpuVecSelect(mask, hitT, *t);
+	*u = CpuVecSelect(mask, hitU, *u);
+	*v = CpuVecSelect(mask, hitV, *v);
+}
+
+static uint32_t CpuTracerTracePacket(const CpuTracerData* tracer, const float (*origin)[CPU_TRACER_WIDTH], const float (*direction)[CPU_TRACER_WIDTH], uint32_t active, CpuTracerHit* hits)
+{
+	const BvhTriangle* triangles = tracer->bvh->triangles;
+
+	CpuVec origins[3];
+	CpuVec directions[3];
+	CpuVec inverses[3];
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		float inverse[CPU_TRACER_WIDTH];
+		for (uint32_t j = 0; j < CPU_TRACER_WIDTH; ++j)
+			inverse[j] = 1.0f / (fabsf(direction[i][j]) < 1e-20f ? 1e-20f : direction[i][j]);
+		origins[i]    = CpuVecLoad(origin[i]);
+		directions[i] = CpuVecLoad(direction[i]);
+		inverses[i]   = CpuVecLoad(inverse);
+	}
+	CpuVec   t = CpuVecSet(CPU_TRACER_NO_HIT);
+	CpuVec   u = CpuVecSet(0.0f);
+	CpuVec   v = CpuVecSet(0.0f);
+	uint32_t triangleHits[CPU_TRACER_WIDTH];
+	memset(triangleHits, 0, sizeof(triangleHits));
+
+	CpuTracerEntry stack[CPU_TRACER_STACK];
+	uint32_t       stackSize = 0;
+	stack[stackSize++]       = (CpuTracerEntry) { 0, 0.0f };
+	while (stackSize > 0)
+	{
+		const CpuTracerNode* node = tracer->nodes + stack[--stackSize].node;
+
+		CpuTracerEntry children[CPU_TRACER_WIDTH];
+		uint32_t       childCount = 0;
+		for (uint32_t i = 0; i < node->childCount; ++i)
+		{
+			CpuVec tNear = CpuVecSet(1e-4f);
+			CpuVec tFar  = t;
+			for (uint32_t j = 0; j < 3; ++j)
+			{
+				CpuVec t0 = CpuVecMul(CpuVecSub(CpuVecSet(node->bounds[0][j][i]), origins[j]), inverses[j]);
+				CpuVec t1 = CpuVecMul(CpuVecSub(CpuVecSet(node->bounds[1][j][i]), origins[j]), inverses[j]);
+				tNear     = CpuVecMax(tNear, CpuVecMin(t0, t1));
+				tFar      = CpuVecMin(tFar, CpuVecMax(t0, t1));
+			}
+			uint32_t mask = CpuVecMask(CpuVecLessEqual(tNear, tFar)) & active;
+			if (!mask)
+				continue;
+			if (node->count[i] > 0)
+			{
+				for (uint32_t j = node->child[i]; j < node->child[i] + node->count[i]; ++j)
+					CpuTracerIntersectPacket(triangles + j, j, origins, directions, mask, &t, &u, &v, triangleHits);
+				continue;
+			}
+
+			float distances[CPU_TRACER_WIDTH];
+			float distance = CPU_TRACER_NO_HIT;
+			CpuVecStore(distances, tNear);
+			for (uint32_t j = 0; j < CPU_TRACER_WIDTH; ++j)
+			{
+				if ((mask & (1U << j)) && distances[j] < distance)
+					distance = distances[j];
+			}
+			children[childCount++] = (CpuTracerEntry) { node->child[i], distance };
+		}
+		stackSize = CpuTracerPushChildren(stack, stackSize, children, childCount);
+	}
+
+	float hitT[CPU_TRACER_WIDTH];
+	float hitU[CPU_TRACER_WIDTH];
+	float hitV[CPU_TRACER_WIDTH];
+	CpuVecStore(hitT, t);
+	CpuVecStore(hitU, u);
+	CpuVecStore(hitV, v);
+	for (uint32_t i = 0; i < CPU_TRACER_WIDTH; ++i)
+		hits[i] = (CpuTracerHit) { hitT[i], hitU[i], hitV[i], triangleHits[i] };
+	return CpuVecMask(CpuVecLess(t, CpuVecSet(CPU_TRACER_NO_HIT))) & active;
+}
+
+static void CpuTracerCameraRay(const CpuTracerData* tracer, uint32_t x, uint32_t y, uint32_t* state, float* origin, float* direction)
+{
+	*state = (y * tracer->width + x) ^ tracer->seed;
+	CpuTracerPcg(state);
+
+	float u = ((float) x + CpuTracerRandom(state)) / (float) tracer->width * 2.0f - 1.0f;
+	float v = ((float) y + CpuTracerRandom(state)) / (float) tracer->height * 2.0f - 1.0f;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		origin[i]    = tracer->origin[i];
+		direction[i] = tracer->forward[i] + u * tracer->right[i] - v * tracer->up[i];
+	}
+	CpuTracerNormalize(direction);
+}
+
+static uint32_t CpuTracerShade(const CpuTracerData* tracer, uint32_t* state, float* origin, float* direction, CpuTracerHit hit, bool found, float* radiance)
+{
+	float    throughput[3] = { 1.0f, 1.0f, 1.0f };
+	uint32_t rays          = 0;
+	radiance[0]            = 0.0f;
+	radiance[1]            = 0.0f;
+	radiance[2]            = 0.0f;
+	for (uint32_t bounce = 0; bounce <= tracer->maxBounces; ++bounce)
+	{
+		if (bounce > 0)
+			found = CpuTracerTrace(tracer, origin, direction, false, &hit);
+		++rays;
+		if (!found)
+		{
+			for (uint32_t i = 0; i < 3; ++i)
+				radiance[i] += throughput[i] * tracer->background[i];
+			break;
+		}
+
+		const BvhTriangle* triangle = tracer->bvh->triangles + hit.triangle;
+		float              normal[3];
+		float              albedo[3] = { 0.7f, 0.7f, 0.7f };
+		CpuTracerCross(triangle->e1, triangle->e2, normal);
+		CpuTracerNormalize(normal);
+		if (triangle->primitive == 0)
+		{
+			albedo[0] = 1.0f - hit.u - hit.v;
+			albedo[1] = hit.u;
+			albedo[2] = hit.v;
+		}
+		float side = CpuTracerDot(normal, direction) < 0.0f ? 1.0f : -1.0f;
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			normal[i]     *= side;
+			throughput[i] *= albedo[i];
+			origin[i]      = origin[i] + direction[i] * hit.t + normal[i] * 1e-4f;
+		}
+
+		float sunCosine = CpuTracerDot(normal, s_SunDirection);
+		if (sunCosine > 0.0f)
+		{
+			CpuTracerHit shadow;
+			++rays;
+			if (!CpuTracerTrace(tracer, origin, s_SunDirection, true, &shadow))
+			{
+				for (uint32_t i = 0; i < 3; ++i)
+					radiance[i] += throughput[i] * s_SunColor[i] * sunCosine;
+			}
+		}
+		CpuTracerCosineHemisphere(normal, state, direction);
+	}
+	return rays;
+}
+
+static void CpuTracerResolve(CpuTracerData* tracer, uint32_t x, uint32_t y, const float* radiance)
+{
+	size_t   pixel  = (size_t) y * tracer->width + x;
+	float*   accum  = tracer->accum + pixel * 4;
+	uint8_t* output = tracer->output + pixel * 4;
+	if (tracer->sampleCount == 0)
+		memset(accum, 0, 4 * sizeof(float));
+	for (uint32_t i = 0; i < 3; ++i)
+		accum[i] += radiance[i];
+	accum[3] += 1.0f;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		float value = powf(accum[i] / accum[3], 1.0f / 2.2f);
+		output[i]   = (uint8_t) (fminf(fmaxf(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+	output[3] = 255;
+}
+
+static void CpuTracerTileJob(void* userData, uint32_t threadIndex)
+{
+	(void) threadIndex;
+	CpuTracerTile* tile   = (CpuTracerTile*) userData;
+	CpuTracerData* tracer = tile->tracer;
+
+	uint64_t rays  = 0;
+	uint32_t maxX  = tile->x + CPU_TRACER_TILE < tracer->width ? tile->x + CPU_TRACER_TILE : tracer->width;
+	uint32_t maxY  = tile->y + CPU_TRACER_TILE < tracer->height ? tile->y + CPU_TRACER_TILE : tracer->height;
+	float    radiance[3];
+	for (uint32_t y = tile->y; y < maxY; ++y)
+	{
+		for (uint32_t x = tile->x; x < maxX; x += CPU_TRACER_WIDTH)
+		{
+			uint32_t     lanes = maxX - x < CPU_TRACER_WIDTH ? maxX - x : CPU_TRACER_WIDTH;
+			uint32_t     states[CPU_TRACER_WIDTH];
+			float        origins[3][CPU_TRACER_WIDTH];
+			float        directions[3][CPU_TRACER_WIDTH];
+			CpuTracerHit hits[CPU_TRACER_WIDTH];
+			uint32_t     found = 0;
+			for (uint32_t i = 0; i < CPU_TRACER_WIDTH; ++i)
+			{
+				float origin[3];
+				float direction[3];
+				CpuTracerCameraRay(tracer, x + (i < lanes ? i : 0), y, states + i, origin, direction);
+				for (uint32_t j = 0; j < 3; ++j)
+				{
+					origins[j][i]    = origin[j];
+					directions[j][i] = direction[j];
+				}
+			}
+			if (tracer->packets)
+				found = CpuTracerTracePacket(tracer, origins, directions, CPU_TRACER_LANES >> (CPU_TRACER_WIDTH - lanes), hits);
+
+			for (uint32_t i = 0; i < lanes; ++i)
+			{
+				float origin[3]    = { origins[0][i], origins[1][i], origins[2][i] };
+				float direction[3] = { directions[0][i], directions[1][i], directions[2][i] };
+				bool  hit          = tracer->packets ? (found & (1U << i)) != 0 : CpuTracerTrace(tracer, origin, direction, false, hits + i);
+				rays              += CpuTracerShade(tracer, states + i, origin, direction, hits[i], hit, radiance);
+				CpuTracerResolve(tracer, x + i, y, radiance);
+			}
+		}
+	}
+	AtomicAdd64(&tracer->raysTraced, rays);
+}
+
+bool CpuTracerSetup(CpuTracerData* tracer)
+{
+	if (!tracer || !tracer->bvh || !tracer->bvh->nodeCount || tracer->width == 0 || tracer->height == 0) return false;
+
+	if (tracer->maxBounces == 0)
+		tracer->maxBounces = 4;
+	tracer->nodeCount    = 0;
+	tracer->nodes        = NULL;
+	tracer->tileCount    = ((tracer->width + CPU_TRACER_TILE - 1) / CPU_TRACER_TILE) * ((tracer->height + CPU_TRACER_TILE - 1) / CPU_TRACER_TILE);
+	tracer->tiles        = (CpuTracerTile*) malloc(tracer->tileCount * sizeof(CpuTracerTile));
+	tracer->accum        = (float*) malloc((size_t) tracer->width * tracer->height * 4 * sizeof(float));
+	tracer->output       = (uint8_t*) malloc((size_t) tracer->width * tracer->height * 4 * sizeof(uint8_t));
+	tracer->sampleCount  = 0;
+	tracer->raysTraced   = 0;
+	tracer->traceTime    = 0.0;
+	tracer->collapseTime = 0.0;
+	if (!tracer->tiles || !tracer->accum || !tracer->output || tracer->bvh->depth * (CPU_TRACER_WIDTH - 1) + 1 > CPU_TRACER_STACK)
+	{
+		CpuTracerCleanup(tracer);
+		return false;
+	}
+
+	double start = CpuTracerTime();
+	if (!CpuTracerCollapse(tracer))
+	{
+		CpuTracerCleanup(tracer);
+		return false;
+	}
+	tracer->collapseTime = CpuTracerTime() - start;
+
+	uint32_t tile = 0;
+	for (uint32_t y = 0; y < tracer->height; y += CPU_TRACER_TILE)
+	{
+		for (uint32_t x = 0; x < tracer->width; x += CPU_TRACER_TILE)
+			tracer->tiles[tile++] = (CpuTracerTile) { tracer, x, y };
+	}
+	return true;
+}
+
+void CpuTracerCleanup(CpuTracerData* tracer)
+{
+	if (!tracer) return;
+
+	free(tracer->nodes);
+	free(tracer->tiles);
+	free(tracer->accum);
+	free(tracer->output);
+	tracer->nodeCount = 0;
+	tracer->nodes     = NULL;
+	tracer->tileCount = 0;
+	tracer->tiles     = NULL;
+	tracer->accum     = NULL;
+	tracer->output    = NULL;
+}
+
+const char* CpuTracerSimdName()
+{
+	return CPU_TRACER_SIMD;
+}
+
+uint32_t CpuTracerSimdWidth()
+{
+	return CPU_TRACER_WIDTH;
+}
+
+double CpuTracerTime()
+{
+	struct timespec time;
+	timespec_get(&time, TIME_UTC);
+	return (double) time.tv_sec + (double) time.tv_nsec * 1e-9;
+}
+
+void CpuTracerReset(CpuTracerData* tracer)
+{
+	if (!tracer) return;
+
+	tracer->sampleCount = 0;
+	tracer->raysTraced  = 0;
+	tracer->traceTime   = 0.0;
+}
+
+void CpuTracerRender(CpuTracerData* tracer, const SceneCamera* camera, const float* background)
+{
+	if (!tracer || !tracer->nodes || !camera || !background) return;
+
+	float yaw     = camera->yaw * 0.017453292f;
+	float pitch   = camera->pitch * 0.017453292f;
+	float cy      = cosf(yaw);
+	float sy      = sinf(yaw);
+	float cp      = cosf(pitch);
+	float sp      = sinf(pitch);
+	float tanHalf = tanf(camera->fov * 0.5f * 0.017453292f);
+	float aspect  = (float) tracer->width / (float) tracer->height;
+
+	float right[3] = { cy, 0.0f, sy };
+	float up[3]    = { -sy * sp, cp, cy * sp };
+	tracer->forward[0] = cp * sy;
+	tracer->forward[1] = sp;
+	tracer->forward[2] = -cp * cy;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		tracer->origin[i]     = camera->position[i];
+		tracer->right[i]      = right[i] * tanHalf * aspect;
+		tracer->up[i]         = up[i] * tanHalf;
+		tracer->background[i] = background[i];
+	}
+	tracer->seed = tracer->sampleCount * 0x9E3779B9U;
+
+	double     start   = CpuTracerTime();
+	JobCounter counter = { 0 };
+	for (uint32_t i = 0; i < tracer->tileCount; ++i)
+	{
+		if (!JobSystemSubmit(tracer->jobs, &CpuTracerTileJob, tracer->tiles + i, &counter))
+			CpuTracerTileJob(tracer->tiles + i, 0);
+	}
+	JobSystemWait(tracer->jobs, &counter);
+	tracer->traceTime += CpuTracerTime() - start;
+	++tracer->sampleCount;
+}
+
+uint32_t CpuTracerValidatePackets(const CpuTracerData* tracer, uint32_t packetCount)
+{
+	if (!tracer || !tracer->nodes) return packetCount * CPU_TRACER_WIDTH;
+
+	const BvhTriangle* triangles  = tracer->bvh->triangles;
+	uint32_t           mismatches = 0;
+	uint32_t           state      = tracer->seed ^ 0x68E31DA4U;
+	for (uint32_t packet = 0; packet < packetCount; ++packet)
+	{
+		uint32_t     active = CpuTracerPcg(&state) & CPU_TRACER_LANES;
+		float        origins[3][CPU_TRACER_WIDTH];
+		float        directions[3][CPU_TRACER_WIDTH];
+		CpuTracerHit hits[CPU_TRACER_WIDTH];
+		for (uint32_t i = 0; i < CPU_TRACER_WIDTH; ++i)
+		{
+			uint32_t x = CpuTracerPcg(&state) % tracer->width;
+			uint32_t y = CpuTracerPcg(&state) % tracer->height;
+			uint32_t rayState;
+			float    origin[3];
+			float    direction[3];
+			CpuTracerCameraRay(tracer, x, y, &rayState, origin, direction);
+			for (uint32_t j = 0; j < 3; ++j)
+			{
+				origins[j][i]    = origin[j];
+				directions[j][i] = direction[j];
+			}
+		}
+		uint32_t found = CpuTracerTracePacket(tracer, origins, directions, active, hits);
+
+		for (uint32_t i = 0; i < CPU_TRACER_WIDTH; ++i)
+		{
+			float        origin[3]    = { origins[0][i], origins[1][i], origins[2][i] };
+			float        direction[3] = { directions[0][i], directions[1][i], directions[2][i] };
+			CpuTracerHit expected;
+			CpuTracerHit check = { CPU_TRACER_NO_HIT, 0.0f, 0.0f, 0 };
+			bool         lane  = (active & (1U << i)) != 0;
+			bool         hit   = lane && CpuTracerTrace(tracer, origin, direction, false, &expected);
+			if (hit != ((found & (1U << i)) != 0) || (!lane && hits[i].t < CPU_TRACER_NO_HIT))
+				++mismatches;
+			else if (hit && (fabsf(expected.t - hits[i].t) > 1e-4f * fmaxf(1.0f, expected.t) ||
+							 !CpuTracerIntersect(triangles + hits[i].triangle, hits[i].triangle, origin, direction, &check) ||
+							 fabsf(check.t - hits[i].t) > 1e-4f * fmaxf(1.0f, check.t)))
+				++mismatches;
+		}
+	}
+	return mismatches;
+}
+
+bool CpuTracerWriteImage(CpuTracerData* tracer, const char* filepath)
+{
+	if (!tracer || !tracer->output || !filepath) return false;
+
+	FILE* file = fopen(filepath, "wb");
+	if (!file)
+		return false;
+
+	bool written = fprintf(file, "P6\n%u %u\n255\n", tracer->width, tracer->height) > 0;
+	for (size_t i = 0; written && i < (size_t) tracer->width * tracer->height; ++i)
+		written = fwrite(tracer->output + i * 4, sizeof(uint8_t), 3, file) == 3;
+	return fclose(file) == 0 && written;
+}
\ No newline at end of file
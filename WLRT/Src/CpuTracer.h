@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Bvh.h"
+#include "JobSystem.h"
+#include "Scene.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct CpuTracerNode CpuTracerNode;
+
+typedef struct CpuTracerTile
+{
+	struct CpuTracerData* tracer;
+	uint32_t              x;
+	uint32_t              y;
+} CpuTracerTile;
+
+typedef struct CpuTracerData
+{
+	JobSystem*     jobs;
+	const BvhData* bvh;
+	uint32_t       width;
+	uint32_t       height;
+	uint32_t       maxBounces;
+	bool           packets;
+
+	uint32_t       nodeCount;
+	CpuTracerNode* nodes;
+	uint32_t       tileCount;
+	CpuTracerTile* tiles;
+	float*         accum;
+	uint8_t*       output;
+
+	float    origin[3];
+	float    forward[3];
+	float    right[3];
+	float    up[3];
+	float    background[3];
+	uint32_t seed;
+	uint32_t sampleCount;
+
+	volatile uint64_t raysTraced;
+	double            traceTime;
+	double            collapseTime;
+} CpuTracerData;
+
+bool CpuTracerSetup(CpuTracerData* tracer);
+void CpuTracerCleanup(CpuTracerData* tracer);
+
+const char* CpuTracerSimdName();
+uint32_t    CpuTracerSimdWidth();
+double      CpuTracerTime();
+
+void     CpuTracerReset(CpuTracerData* tracer);
+void     CpuTracerRender(CpuTracerData* tracer, const SceneCamera* camera, const float* background);
+uint32_t CpuTracerValidatePackets(const CpuTracerData* tracer, uint32_t packetCount);
+bool     CpuTracerWriteImage(CpuTracerData* tracer, const char* filepath);
\ No newline at end of file
@@ -1,37 +1,343 @@
+#if !defined(_WIN32)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "FileWatcher.h"
+#include "Atomic.h"
 
 #include <stdlib.h>
 #include <string.h>
 
-#include <Windows.h>
+#if defined(_WIN32)
+	#include <Windows.h>
+#else
+	#include <errno.h>
+	#include <sys/epoll.h>
+	#include <sys/eventfd.h>
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+
+#define FW_DEBOUNCE_MILLISECONDS 100
+#define FW_EVENT_CAPACITY        256
+#define FW_PENDING_CAPACITY      64
+#define FW_ALL_DIRECTORIES       (~0ULL)
+
+#if defined(_WIN32)
+typedef struct FileWatcherRequest
+{
+	uint64_t key;
+	FSPath   path;
+} FileWatcherRequest;
+#endif
+
+struct FileWatcherBackend
+{
+#if defined(_WIN32)
+	Mutex*              mutex;
+	HANDLE              wake;
+	uint64_t            nextKey;
+	size_t              requestLen;
+	size_t              requestCap;
+	FileWatcherRequest* requests;
+#else
+	int inotify;
+	int epoll;
+	int wake;
+#endif
+
+	uint32_t         pendingCount;
+	FileWatcherEvent pending[FW_PENDING_CAPACITY];
+};
 
 static FileWatcherData* s_FileWatcher;
 
+static uint64_t FWHashName(const char* name, size_t length)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash ^= (uint8_t) name[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash != 0 ? hash : 1;
+}
+
+static void FWFlushPending(FileWatcherData* watcher)
+{
+	struct FileWatcherBackend* backend = watcher->backend;
+
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < backend->pendingCount; ++i)
+	{
+		if (!SPSCQueuePush(&watcher->events, backend->pending + i))
+			backend->pending[kept++] = backend->pending[i];
+	}
+	backend->pendingCount = kept;
+}
+
+static void FWQueuePending(FileWatcherData* watcher, uint64_t directory, uint64_t nameHash)
+{
+	struct FileWatcherBackend* backend = watcher->backend;
+	for (uint32_t i = 0; i < backend->pendingCount; ++i)
+	{
+		if (backend->pending[i].directory == directory && backend->pending[i].nameHash == nameHash)
+			return;
+	}
+	if (backend->pendingCount >= FW_PENDING_CAPACITY)
+		FWFlushPending(watcher);
+	if (backend->pendingCount >= FW_PENDING_CAPACITY)
+		return;
+	backend->pending[backend->pendingCount++] = (FileWatcherEvent) {
+		.directory = directory,
+		.nameHash  = nameHash
+	};
+}
+
+#if defined(_WIN32)
+static void FWProcessRequests(FileWatcherData* watcher, HANDLE* handles, uint64_t* keys, DWORD* handleCount)
+{
+	struct FileWatcherBackend* backend = watcher->backend;
+	MutexLock(backend->mutex);
+	for (size_t i = 0; i < backend->requestLen; ++i)
+	{
+		FileWatcherRequest* request = backend->requests + i;
+		if (request->path.buf)
+		{
+			if (*handleCount < MAXIMUM_WAIT_OBJECTS)
+			{
+				HANDLE handle = FindFirstChangeNotificationA(request->path.buf, FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+				if (handle != INVALID_HANDLE_VALUE)
+				{
+					handles[*handleCount] = handle;
+					keys[*handleCount]    = request->key;
+					++*handleCount;
+				}
+			}
+			FSDestroyPath(&request->path);
+			continue;
+		}
+
+		for (DWORD j = 1; j < *handleCount; ++j)
+		{
+			if (keys[j] != request->key)
+				continue;
+			FindCloseChangeNotification(handles[j]);
+			--*handleCount;
+			handles[j] = handles[*handleCount];
+			keys[j]    = keys[*handleCount];
+			break;
+		}
+	}
+	backend->requestLen = 0;
+	MutexUnlock(backend->mutex);
+}
+
+static bool FWPushRequest(FileWatcherData* watcher, uint64_t key, const FSPath* path)
+{
+	struct FileWatcherBackend* backend = watcher->backend;
+	MutexLock(backend->mutex);
+	if (backend->requestLen >= backend->requestCap)
+	{
+		size_t              newCap      = backend->requestCap > 0 ? backend->requestCap << 1 : 8;
+		FileWatcherRequest* newRequests = (FileWatcherRequest*) realloc(backend->requests, newCap * sizeof(FileWatcherRequest));
+		if (!newRequests)
+		{
+			MutexUnlock(backend->mutex);
+			return false;
+		}
+		backend->requestCap = newCap;
+		backend->requests   = newRequests;
+	}
+	FileWatcherRequest* request = backend->requests + backend->requestLen++;
+	request->key                = key;
+	request->path               = path ? FSCreatePath(path->buf, path->len) : FSCreatePath(NULL, 0);
+	MutexUnlock(backend->mutex);
+	SetEvent(backend->wake);
+	return true;
+}
+#endif
+
+static void FWThreadMain(void* userData)
+{
+	FileWatcherData*           watcher = (FileWatcherData*) userData;
+	struct FileWatcherBackend* backend = watcher->backend;
+
+#if defined(_WIN32)
+	HANDLE   handles[MAXIMUM_WAIT_OBJECTS];
+	uint64_t keys[MAXIMUM_WAIT_OBJECTS];
+	DWORD    handleCount = 1;
+	handles[0]           = backend->wake;
+	keys[0]              = 0;
+	while (!AtomicLoad32(&watcher->stop))
+	{
+		DWORD result = WaitForMultipleObjects(handleCount, handles, FALSE, backend->pendingCount > 0 ? watcher->debounceMilliseconds : INFINITE);
+		if (result == WAIT_TIMEOUT)
+		{
+			FWFlushPending(watcher);
+		}
+		else if (result == WAIT_OBJECT_0)
+		{
+			FWProcessRequests(watcher, handles, keys, &handleCount);
+		}
+		else if (result > WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + handleCount)
+		{
+			DWORD index = result - WAIT_OBJECT_0;
+			FWQueuePending(watcher, keys[index], 0);
+			FindNextChangeNotification(handles[index]);
+		}
+		else
+		{
+			break;
+		}
+	}
+	for (DWORD i = 1; i < handleCount; ++i)
+		FindCloseChangeNotification(handles[i]);
+#else
+	_Alignas(struct inotify_event) char buffer[4096];
+	while (!AtomicLoad32(&watcher->stop))
+	{
+		struct epoll_event event;
+		int                count = epoll_wait(backend->epoll, &event, 1, backend->pendingCount > 0 ? (int) watcher->debounceMilliseconds : -1);
+		if (count < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (count == 0)
+		{
+			FWFlushPending(watcher);
+			continue;
+		}
+		if (event.data.fd != backend->inotify)
+			continue;
+
+		ssize_t length = read(backend->inotify, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const struct inotify_event* info = (const struct inotify_event*) (buffer + offset);
+			if (info->mask & IN_Q_OVERFLOW)
+				FWQueuePending(watcher, FW_ALL_DIRECTORIES, 0);
+			else if (info->len > 0)
+				FWQueuePending(watcher, (uint64_t) info->wd, FWHashName(info->name, strlen(info->name)));
+			offset += sizeof(struct inotify_event) + info->len;
+		}
+	}
+#endif
+}
+
+static bool FWSetupBackend(FileWatcherData* watcher)
+{
+	struct FileWatcherBackend* backend = (struct FileWatcherBackend*) malloc(sizeof(struct FileWatcherBackend));
+	if (!backend)
+		return false;
+	backend->pendingCount = 0;
+	watcher->backend      = backend;
+
+#if defined(_WIN32)
+	backend->nextKey    = 0;
+	backend->requestLen = 0;
+	backend->requestCap = 0;
+	backend->requests   = NULL;
+	backend->mutex      = MutexCreate();
+	backend->wake       = CreateEventA(NULL, FALSE, FALSE, NULL);
+	return backend->mutex && backend->wake;
+#else
+	backend->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	backend->epoll   = epoll_create1(EPOLL_CLOEXEC);
+	backend->wake    = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (backend->inotify < 0 || backend->epoll < 0 || backend->wake < 0)
+		return false;
+
+	struct epoll_event inotifyEvent = { .events = EPOLLIN, .data = { .fd = backend->inotify } };
+	struct epoll_event wakeEvent    = { .events = EPOLLIN, .data = { .fd = backend->wake } };
+	return epoll_ctl(backend->epoll, EPOLL_CTL_ADD, backend->inotify, &inotifyEvent) == 0 &&
+		epoll_ctl(backend->epoll, EPOLL_CTL_ADD, backend->wake, &wakeEvent) == 0;
+#endif
+}
+
+static void FWCleanupBackend(FileWatcherData* watcher)
+{
+	struct FileWatcherBackend* backend = watcher->backend;
+	if (!backend)
+		return;
+
+#if defined(_WIN32)
+	for (size_t i = 0; i < backend->requestLen; ++i)
+		FSDestroyPath(&backend->requests[i].path);
+	free(backend->requests);
+	if (backend->mutex)
+		MutexDestroy(backend->mutex);
+	if (backend->wake)
+		CloseHandle(backend->wake);
+#else
+	if (backend->inotify >= 0)
+		close(backend->inotify);
+	if (backend->epoll >= 0)
+		close(backend->epoll);
+	if (backend->wake >= 0)
+		close(backend->wake);
+#endif
+	free(backend);
+	watcher->backend = NULL;
+}
+
+static void FWWakeBackend(FileWatcherData* watcher)
+{
+#if defined(_WIN32)
+	SetEvent(watcher->backend->wake);
+#else
+	uint64_t value = 1;
+	if (write(watcher->backend->wake, &value, sizeof(value)) < 0)
+		return;
+#endif
+}
+
+static bool FWAddBackendDirectory(FileWatcherData* watcher, const FSPath* directory, uint64_t* key)
+{
+#if defined(_WIN32)
+	*key = ++watcher->backend->nextKey;
+	return FWPushRequest(watcher, *key, directory);
+#else
+	int wd = inotify_add_watch(watcher->backend->inotify, directory->buf, IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+	if (wd < 0)
+		return false;
+	*key = (uint64_t) wd;
+	return true;
+#endif
+}
+
+static void FWRemoveBackendDirectory(FileWatcherData* watcher, uint64_t key)
+{
+#if defined(_WIN32)
+	FWPushRequest(watcher, key, NULL);
+#else
+	inotify_rm_watch(watcher->backend->inotify, (int) key);
+#endif
+}
+
 bool FWSetup()
 {
 	s_FileWatcher = (FileWatcherData*) malloc(sizeof(FileWatcherData));
 	if (!s_FileWatcher)
 		return false;
-	s_FileWatcher->watchLen = 0;
-	s_FileWatcher->watchCap = 32;
-	s_FileWatcher->watches  = (FileWatcherWatchData*) malloc(32 * sizeof(FileWatcherWatchData));
-	if (!s_FileWatcher->watches)
+	memset(s_FileWatcher, 0, sizeof(FileWatcherData));
+	s_FileWatcher->debounceMilliseconds = FW_DEBOUNCE_MILLISECONDS;
+
+	if (!SPSCQueueSetup(&s_FileWatcher->events, sizeof(FileWatcherEvent), FW_EVENT_CAPACITY) ||
+		!FWSetupBackend(s_FileWatcher))
 	{
 		FWCleanup();
 		return false;
 	}
 
-	s_FileWatcher->cachedDirectoryLen = 0;
-	s_FileWatcher->cachedDirectoryCap = 32;
-	s_FileWatcher->cachedDirectories  = (FSPath*) malloc(32 * sizeof(FSPath));
-	if (!s_FileWatcher->cachedDirectories)
+	s_FileWatcher->thread = ThreadCreate(&FWThreadMain, s_FileWatcher);
+	if (!s_FileWatcher->thread)
 	{
 		FWCleanup();
 		return false;
 	}
-	memset(s_FileWatcher->watches, 0, s_FileWatcher->watchCap * sizeof(FileWatcherWatchData));
-	memset(s_FileWatcher->cachedDirectories, 0, s_FileWatcher->cachedDirectoryCap * sizeof(FSPath));
-	s_FileWatcher->curId = 0;
 	return true;
 }
 
@@ -40,159 +346,180 @@ void FWCleanup()
 	if (!s_FileWatcher)
 		return;
 
+	if (s_FileWatcher->thread)
+	{
+		AtomicStore32(&s_FileWatcher->stop, 1);
+		FWWakeBackend(s_FileWatcher);
+		ThreadJoin(s_FileWatcher->thread);
+	}
+	FWCleanupBackend(s_FileWatcher);
+	SPSCQueueCleanup(&s_FileWatcher->events);
+
 	for (size_t i = 0; i < s_FileWatcher->watchLen; ++i)
 		FSDestroyPath(&s_FileWatcher->watches[i].file);
 	free(s_FileWatcher->watches);
-	for (size_t i = 0; i < s_FileWatcher->cachedDirectoryLen; ++i)
-		FSDestroyPath(s_FileWatcher->cachedDirectories + i);
-	free(s_FileWatcher->cachedDirectories);
+	for (size_t i = 0; i < s_FileWatcher->directoryLen; ++i)
+		FSDestroyPath(&s_FileWatcher->directories[i].path);
+	free(s_FileWatcher->directories);
 	free(s_FileWatcher);
 	s_FileWatcher = NULL;
 }
 
 void FWUpdate()
 {
-	if (!s_FileWatcher)
+	if (!s_FileWatcher || SPSCQueueSize(&s_FileWatcher->events) == 0)
 		return;
 
-	uint8_t* buffer = (uint8_t*) malloc(32768 * sizeof(uint8_t));
-	if (!buffer)
-		return;
-
-	FSPath tempPath = {
-		.buf = (char*) malloc(32768 * sizeof(char)),
-		.cap = 32768,
-		.len = 0
-	};
-	for (size_t i = 0; i < s_FileWatcher->cachedDirectoryLen; ++i)
-	{
-		FSPath* path    = s_FileWatcher->cachedDirectories + i;
-		HANDLE  dHandle = CreateFileA(path->buf, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
-		DWORD   written = 0;
-		bool    res     = ReadDirectoryChangesW(dHandle, buffer, 32768 * sizeof(uint8_t), false, FILE_NOTIFY_CHANGE_LAST_WRITE, &written, NULL, NULL);
-		CloseHandle(dHandle);
-		if (!res)
-			continue;
+	FileWatcherEvent event;
+	while (SPSCQueuePop(&s_FileWatcher->events, &event))
+	{
+		for (size_t i = 0; i < s_FileWatcher->watchLen; ++i)
+		{
+			FileWatcherWatchData* watch = s_FileWatcher->watches + i;
+			if ((event.directory != FW_ALL_DIRECTORIES && event.directory != watch->directory) ||
+				(event.nameHash != 0 && event.nameHash != watch->nameHash))
+				continue;
 
-		size_t                   offset = 0;
-		FILE_NOTIFY_INFORMATION* info;
-		do {
-			info = (FILE_NOTIFY_INFORMATION*) (buffer + offset);
-			switch (info->Action)
-			{
-			case FILE_ACTION_MODIFIED:
-			{
-				tempPath.len = wcstombs(tempPath.buf, info->FileName, tempPath.cap);
-				for (size_t j = 0; j < s_FileWatcher->watchLen; ++j)
-				{
-					FileWatcherWatchData* watch = s_FileWatcher->watches + j;
-					if (FSPathEquals(&tempPath, &watch->file))
-						watch->callback(&watch->file, watch->userData);
-				}
-				break;
-			}
-			}
-			offset += info->NextEntryOffset;
+			uint64_t writeTime = FSLastWriteTime(&watch->file);
+			if (event.nameHash == 0 && writeTime == watch->lastWriteTime)
+				continue;
+			watch->lastWriteTime = writeTime;
+			watch->modified      = true;
 		}
-		while (info->NextEntryOffset);
 	}
-	FSDestroyPath(&tempPath);
-	free(buffer);
+
+	for (size_t i = 0; i < s_FileWatcher->watchLen; ++i)
+	{
+		FileWatcherWatchData* watch = s_FileWatcher->watches + i;
+		if (!watch->modified)
+			continue;
+		watch->modified = false;
+		watch->callback(&watch->file, watch->userData);
+	}
 }
 
 static bool FWEnsureWatchCap(size_t requiredSize)
 {
-	if (!s_FileWatcher)
-		return false;
-
 	if (requiredSize <= s_FileWatcher->watchCap)
 		return true;
 
-	size_t newCapacity = requiredSize;
-	newCapacity       |= newCapacity >> 1;
-	newCapacity       |= newCapacity >> 2;
-	newCapacity       |= newCapacity >> 4;
-	newCapacity       |= newCapacity >> 8;
-	newCapacity       |= newCapacity >> 16;
-	newCapacity       |= newCapacity >> 32;
-	++newCapacity;
-
-	FileWatcherWatchData* newWatches = (FileWatcherWatchData*) malloc(newCapacity * sizeof(FileWatcherWatchData));
+	size_t newCap = s_FileWatcher->watchCap > 0 ? s_FileWatcher->watchCap : 8;
+	while (newCap < requiredSize)
+		newCap <<= 1;
+	FileWatcherWatchData* newWatches = (FileWatcherWatchData*) realloc(s_FileWatcher->watches, newCap * sizeof(FileWatcherWatchData));
 	if (!newWatches)
 		return false;
-	memcpy(newWatches, s_FileWatcher->watches, s_FileWatcher->watchCap);
-	memset(newWatches + s_FileWatcher->watchCap, 0, (newCapacity - s_FileWatcher->watchCap) * sizeof(FileWatcherWatchData));
-	free(s_FileWatcher->watches);
-	s_FileWatcher->watchCap = newCapacity;
+	s_FileWatcher->watchCap = newCap;
 	s_FileWatcher->watches  = newWatches;
 	return true;
 }
 
-static bool FWEnsureCachedDirectoryCap(size_t requiredSize)
+static bool FWEnsureDirectoryCap(size_t requiredSize)
 {
-	if (!s_FileWatcher)
-		return false;
-
-	if (requiredSize <= s_FileWatcher->cachedDirectoryCap)
+	if (requiredSize <= s_FileWatcher->directoryCap)
 		return true;
 
-	size_t newCapacity = requiredSize;
-	newCapacity       |= newCapacity >> 1;
-	newCapacity       |= newCapacity >> 2;
-	newCapacity       |= newCapacity >> 4;
-	newCapacity       |= newCapacity >> 8;
-	newCapacity       |= newCapacity >> 16;
-	newCapacity       |= newCapacity >> 32;
-	++newCapacity;
-
-	FSPath* newCachedDirectories = (FSPath*) malloc(newCapacity * sizeof(FSPath));
-	if (!newCachedDirectories)
+	size_t newCap = s_FileWatcher->directoryCap > 0 ? s_FileWatcher->directoryCap : 8;
+	while (newCap < requiredSize)
+		newCap <<= 1;
+	FileWatcherDirectoryData* newDirectories = (FileWatcherDirectoryData*) realloc(s_FileWatcher->directories, newCap * sizeof(FileWatcherDirectoryData));
+	if (!newDirectories)
 		return false;
-	memcpy(newCachedDirectories, s_FileWatcher->cachedDirectories, s_FileWatcher->cachedDirectoryCap);
-	memset(newCachedDirectories + s_FileWatcher->cachedDirectoryCap, 0, (newCapacity - s_FileWatcher->cachedDirectoryCap) * sizeof(FSPath));
-	free(s_FileWatcher->cachedDirectories);
-	s_FileWatcher->cachedDirectoryCap = newCapacity;
-	s_FileWatcher->cachedDirectories  = newCachedDirectories;
+	s_FileWatcher->directoryCap = newCap;
+	s_FileWatcher->directories  = newDirectories;
 	return true;
 }
 
-uint64_t FWWatchFile(const FSPath* file, FileWatcherCallbackFn callback, void* userData)
+static FileWatcherDirectoryData* FWAcquireDirectory(const FSPath* stem)
 {
-	if (!s_FileWatcher ||
-		!FWEnsureWatchCap(s_FileWatcher->watchLen + 1))
-		return 0;
-
-	FileWatcherWatchData* watch = s_FileWatcher->watches + s_FileWatcher->watchLen;
-	++s_FileWatcher->watchLen;
-	watch->id       = ++s_FileWatcher->curId;
-	watch->file     = FSCreatePath(file->buf, file->len);
-	watch->callback = callback;
-	watch->userData = userData;
+	for (size_t i = 0; i < s_FileWatcher->directoryLen; ++i)
+	{
+		FileWatcherDirectoryData* directory = s_FileWatcher->directories + i;
+		if (FSPathEquals(&directory->path, stem))
+		{
+			++directory->watchCount;
+			return directory;
+		}
+	}
 
-	FSPath stem  = FSPathGetStem(file);
-	bool   found = false;
-	for (size_t i = 0; i < s_FileWatcher->cachedDirectoryLen; ++i)
+	uint64_t key = 0;
+	if (!FWEnsureDirectoryCap(s_FileWatcher->directoryLen + 1) ||
+		!FWAddBackendDirectory(s_FileWatcher, stem, &key))
+		return NULL;
+	for (size_t i = 0; i < s_FileWatcher->directoryLen; ++i)
 	{
-		FSPath* path = s_FileWatcher->cachedDirectories + i;
-		if (FSPathEquals(&stem, path))
+		FileWatcherDirectoryData* directory = s_FileWatcher->directories + i;
+		if (directory->key == key)
 		{
-			found = true;
-			break;
+			++directory->watchCount;
+			return directory;
 		}
 	}
-	if (!found)
+
+	FileWatcherDirectoryData* directory = s_FileWatcher->directories + s_FileWatcher->directoryLen;
+	directory->path                     = FSCreatePath(stem->buf, stem->len);
+	directory->key                      = key;
+	directory->watchCount               = 1;
+	if (!directory->path.buf)
+	{
+		FWRemoveBackendDirectory(s_FileWatcher, key);
+		return NULL;
+	}
+	++s_FileWatcher->directoryLen;
+	return directory;
+}
+
+static void FWReleaseDirectory(uint64_t key)
+{
+	for (size_t i = 0; i < s_FileWatcher->directoryLen; ++i)
 	{
-		do {
-			if (!FWEnsureCachedDirectoryCap(s_FileWatcher->cachedDirectoryLen + 1))
-				break;
+		FileWatcherDirectoryData* directory = s_FileWatcher->directories + i;
+		if (directory->key != key)
+			continue;
+		if (--directory->watchCount > 0)
+			return;
 
-			FSPath* path = s_FileWatcher->cachedDirectories + s_FileWatcher->cachedDirectoryLen;
-			++s_FileWatcher->cachedDirectoryLen;
-			*path = FSCreatePath(stem.buf, stem.len);
-		}
-		while (false);
+		FWRemoveBackendDirectory(s_FileWatcher, key);
+		FSDestroyPath(&directory->path);
+		--s_FileWatcher->directoryLen;
+		memmove(directory, directory + 1, (s_FileWatcher->directoryLen - i) * sizeof(FileWatcherDirectoryData));
+		return;
 	}
+}
+
+uint64_t FWWatchFile(const FSPath* file, FileWatcherCallbackFn callback, void* userData)
+{
+	if (!s_FileWatcher || !file || !file->buf || !callback ||
+		!FWEnsureWatchCap(s_FileWatcher->watchLen + 1))
+		return 0;
+
+	FSPath   stem     = FSPathGetStem(file);
+	uint64_t nameHash = FWHashName(file->buf + stem.len, file->len - stem.len);
+	if (!stem.buf || (stem.len == 0 && !FSPathConcat(&stem, ".")))
+	{
+		FSDestroyPath(&stem);
+		return 0;
+	}
+	FileWatcherDirectoryData* directory = FWAcquireDirectory(&stem);
 	FSDestroyPath(&stem);
+	if (!directory)
+		return 0;
+
+	FileWatcherWatchData* watch = s_FileWatcher->watches + s_FileWatcher->watchLen;
+	watch->file                 = FSCreatePath(file->buf, file->len);
+	if (!watch->file.buf)
+	{
+		FWReleaseDirectory(directory->key);
+		return 0;
+	}
+	++s_FileWatcher->watchLen;
+	watch->id            = ++s_FileWatcher->curId;
+	watch->callback      = callback;
+	watch->userData      = userData;
+	watch->directory     = directory->key;
+	watch->nameHash      = nameHash;
+	watch->lastWriteTime = FSLastWriteTime(file);
+	watch->modified      = false;
 	return watch->id;
 }
 
@@ -201,50 +528,17 @@ void FWUnwatchFile(uint64_t id)
 	if (!s_FileWatcher)
 		return;
 
-	size_t i = 0;
-	for (; i < s_FileWatcher->watchLen; ++i)
-	{
-		FileWatcherWatchData* watch = s_FileWatcher->watches + i;
-		if (watch->id == id)
-			break;
-	}
-	if (i >= s_FileWatcher->watchLen)
-		return;
-	FileWatcherWatchData* foundWatch = s_FileWatcher->watches + i;
-
-	FSPath stem = FSPathGetStem(&foundWatch->file);
-	FSDestroyPath(&foundWatch->file);
-	memmove(s_FileWatcher->watches + i - 1, s_FileWatcher->watches + i, (s_FileWatcher->watchLen - i) * sizeof(FileWatcherWatchData));
-	--s_FileWatcher->watchLen;
-	memset(s_FileWatcher->watches + s_FileWatcher->watchLen, 0, sizeof(FileWatcherWatchData));
-
-	bool found = false;
-	for (i = 0; i < s_FileWatcher->watchLen; ++i)
+	for (size_t i = 0; i < s_FileWatcher->watchLen; ++i)
 	{
 		FileWatcherWatchData* watch = s_FileWatcher->watches + i;
-		if (watch == foundWatch)
+		if (watch->id != id)
 			continue;
 
-		FSPath stem2 = FSPathGetStem(&watch->file);
-		if (FSPathEquals(&stem, &stem2))
-		{
-			FSDestroyPath(&stem2);
-			found = true;
-			break;
-		}
-		FSDestroyPath(&stem2);
-	}
-	if (!found)
-	{
-		i = 0;
-		for (; i < s_FileWatcher->cachedDirectoryLen; ++i)
-		{
-			if (FSPathEquals(&stem, s_FileWatcher->cachedDirectories + i))
-				break;
-		}
-		memmove(s_FileWatcher->cachedDirectories + i - 1, s_FileWatcher->cachedDirectories + i, (s_FileWatcher->cachedDirectoryLen - i) * sizeof(FSPath));
-		--s_FileWatcher->cachedDirectoryLen;
-		memset(s_FileWatcher->cachedDirectories + s_FileWatcher->cachedDirectoryLen, 0, sizeof(FSPath));
+		uint64_t directory = watch->directory;
+		FSDestroyPath(&watch->file);
+		--s_FileWatcher->watchLen;
+		memmove(watch, watch + 1, (s_FileWatcher->watchLen - i) * sizeof(FileWatcherWatchData));
+		FWReleaseDirectory(directory);
+		return;
 	}
-	FSDestroyPath(&stem);
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Filesystem.h"
+#include "SPSCQueue.h"
+#include "Thread.h"
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -8,25 +10,49 @@
 
 typedef void (*FileWatcherCallbackFn)(const FSPath* file, void* userData);
 
+typedef struct FileWatcherEvent
+{
+	uint64_t directory;
+	uint64_t nameHash;
+} FileWatcherEvent;
+
 typedef struct FileWatcherWatchData
 {
 	uint64_t              id;
 	FSPath                file;
 	FileWatcherCallbackFn callback;
 	void*                 userData;
+
+	uint64_t directory;
+	uint64_t nameHash;
+	uint64_t lastWriteTime;
+	bool     modified;
 } FileWatcherWatchData;
 
+typedef struct FileWatcherDirectoryData
+{
+	FSPath   path;
+	uint64_t key;
+	uint32_t watchCount;
+} FileWatcherDirectoryData;
+
 typedef struct FileWatcherData
 {
 	uint64_t curId;
+	uint32_t debounceMilliseconds;
 
 	size_t                watchLen;
 	size_t                watchCap;
 	FileWatcherWatchData* watches;
 
-	size_t  cachedDirectoryLen;
-	size_t  cachedDirectoryCap;
-	FSPath* cachedDirectories;
+	size_t                    directoryLen;
+	size_t                    directoryCap;
+	FileWatcherDirectoryData* directories;
+
+	SPSCQueue                  events;
+	Thread*                    thread;
+	volatile uint32_t          stop;
+	struct FileWatcherBackend* backend;
 } FileWatcherData;
 
 bool     FWSetup();
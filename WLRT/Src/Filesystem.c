@@ -1,8 +1,23 @@
+#if !defined(_WIN32)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "Filesystem.h"
 
 #include <stdlib.h>
+#include <string.h>
 
-#include <Windows.h>
+#if defined(_WIN32)
+	#include <Windows.h>
+#else
+	#include <dirent.h>
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <stdio.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
 
 FSPath FSCreatePath(const char* path, size_t length)
 {
@@ -67,7 +82,8 @@ bool FSPathAppend(FSPath* lhs, const FSPath* rhs)
 		return false;
 
 	size_t requiredSize = lhs->len + rhs->len + 1;
-	FSPathEnsureSize(lhs, requiredSize);
+	if (!FSPathEnsureSize(lhs, requiredSize))
+		return false;
 	lhs->buf[lhs->len] = '/';
 	memcpy(lhs->buf + lhs->len + 1, rhs->buf, rhs->len);
 	lhs->len               = requiredSize;
@@ -75,6 +91,21 @@ bool FSPathAppend(FSPath* lhs, const FSPath* rhs)
 	return true;
 }
 
+bool FSPathConcat(FSPath* lhs, const char* suffix)
+{
+	if (!lhs || !suffix)
+		return false;
+
+	size_t suffixLength = strlen(suffix);
+	size_t requiredSize = lhs->len + suffixLength;
+	if (!FSPathEnsureSize(lhs, requiredSize))
+		return false;
+	memcpy(lhs->buf + lhs->len, suffix, suffixLength);
+	lhs->len               = requiredSize;
+	lhs->buf[requiredSize] = '\0';
+	return true;
+}
+
 FSPath FSPathGetStem(const FSPath* path)
 {
 	if (!path)
@@ -88,9 +119,8 @@ FSPath FSPathGetStem(const FSPath* path)
 	}
 
 	size_t end = path->len;
-	while (end > 0 && path->buf[end] != '/')
+	while (end > 0 && path->buf[end - 1] != '/')
 		--end;
-	++end;
 	FSPath out = {
 		.buf = (char*) malloc((end + 1) * sizeof(char)),
 		.len = end,
@@ -124,6 +154,7 @@ uint64_t FSLastWriteTime(const FSPath* filepath)
 	if (!filepath)
 		return 0;
 
+#if defined(_WIN32)
 	FILETIME createTime, accessTime, writeTime;
 	HANDLE   fHandle = CreateFileA(filepath->buf, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
 	if (!GetFileTime(fHandle, &createTime, &accessTime, &writeTime))
@@ -133,6 +164,12 @@ uint64_t FSLastWriteTime(const FSPath* filepath)
 	}
 	CloseHandle(fHandle);
 	return writeTime.dwLowDateTime | ((uint64_t) writeTime.dwHighDateTime) << 32;
+#else
+	struct stat info;
+	if (stat(filepath->buf, &info) != 0)
+		return 0;
+	return (uint64_t) info.st_mtim.tv_sec * 1000000000ULL + (uint64_t) info.st_mtim.tv_nsec;
+#endif
 }
 
 void FSSetLastWriteTime(const FSPath* filepath, uint64_t time)
@@ -140,13 +177,21 @@ void FSSetLastWriteTime(const FSPath* filepath, uint64_t time)
 	if (!filepath)
 		return;
 
+#if defined(_WIN32)
 	FILETIME writeTime = {
-		.dwLowDateTime  = time & 0xFFFF'FFFF,
-		.dwHighDateTime = (time >> 32) & 0xFFFF'FFFF
+		.dwLowDateTime  = time & 0xFFFFFFFF,
+		.dwHighDateTime = (time >> 32) & 0xFFFFFFFF
 	};
 	HANDLE fHandle = CreateFileA(filepath->buf, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
 	SetFileTime(fHandle, NULL, NULL, &writeTime);
 	CloseHandle(fHandle);
+#else
+	struct timespec times[2] = {
+		{ .tv_sec = 0, .tv_nsec = UTIME_OMIT },
+		{ .tv_sec = (time_t) (time / 1000000000ULL), .tv_nsec = (long) (time % 1000000000ULL) }
+	};
+	utimensat(AT_FDCWD, filepath->buf, times, 0);
+#endif
 }
 
 bool FSCreateDirectories(const FSPath* directories)
@@ -168,6 +213,7 @@ bool FSCreateDirectories(const FSPath* directories)
 		stemPath.buf[offset] = '\0';
 		replaceBack          = true;
 
+#if defined(_WIN32)
 		if (!CreateDirectoryA(stemPath.buf, NULL))
 		{
 			if (GetLastError() != ERROR_ALREADY_EXISTS)
@@ -176,7 +222,218 @@ bool FSCreateDirectories(const FSPath* directories)
 				return false;
 			}
 		}
+#else
+		if (mkdir(stemPath.buf, 0755) != 0)
+		{
+			if (errno != EEXIST)
+			{
+				FSDestroyPath(&stemPath);
+				return false;
+			}
+		}
+#endif
 	}
 	FSDestroyPath(&stemPath);
 	return true;
+}
+
+bool FSReplaceFile(const FSPath* source, const FSPath* destination)
+{
+	if (!source || !destination)
+		return false;
+
+#if defined(_WIN32)
+	return MoveFileExA(source->buf, destination->buf, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return rename(source->buf, destination->buf) == 0;
+#endif
+}
+
+uint64_t FSFileSize(const FSPath* filepath)
+{
+	if (!filepath || !filepath->buf)
+		return 0;
+
+#if defined(_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(filepath->buf, GetFileExInfoStandard, &attributes))
+		return 0;
+	return attributes.nFileSizeLow | ((uint64_t) attributes.nFileSizeHigh) << 32;
+#else
+	struct stat info;
+	if (stat(filepath->buf, &info) != 0)
+		return 0;
+	return (uint64_t) info.st_size;
+#endif
+}
+
+FSPath FSExecutablePath()
+{
+#if defined(_WIN32)
+	char  buffer[MAX_PATH];
+	DWORD length = GetModuleFileNameA(NULL, buffer, MAX_PATH);
+	if (length == 0 || length >= MAX_PATH)
+		return FSCreatePath(NULL, 0);
+	for (DWORD i = 0; i < length; ++i)
+		if (buffer[i] == '\\')
+			buffer[i] = '/';
+	return FSCreatePath(buffer, length);
+#else
+	char    buffer[4096];
+	ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer));
+	if (length <= 0 || (size_t) length >= sizeof(buffer))
+		return FSCreatePath(NULL, 0);
+	return FSCreatePath(buffer, (size_t) length);
+#endif
+}
+
+bool FSIterateDirectory(const FSPath* directory, FSDirectoryCallbackFn callback, void* userData)
+{
+	if (!directory || !callback)
+		return false;
+
+#if defined(_WIN32)
+	FSPath pattern = FSCreatePath(directory->buf, directory->len);
+	if (!pattern.buf || !FSPathConcat(&pattern, "/*"))
+	{
+		FSDestroyPath(&pattern);
+		return false;
+	}
+	WIN32_FIND_DATAA findData;
+	HANDLE           fHandle = FindFirstFileA(pattern.buf, &findData);
+	FSDestroyPath(&pattern);
+	if (fHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	bool succeeded = true;
+	do
+	{
+		if (strcmp(findData.cFileName, ".") == 0 || strcmp(findData.cFileName, "..") == 0)
+			continue;
+		FSPath name     = FSCreatePath(findData.cFileName, ~0ULL);
+		FSPath filepath = FSCreatePath(directory->buf, directory->len);
+		if (!name.buf || !filepath.buf || !FSPathAppend(&filepath, &name))
+		{
+			FSDestroyPath(&name);
+			FSDestroyPath(&filepath);
+			succeeded = false;
+			break;
+		}
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			succeeded = FSIterateDirectory(&filepath, callback, userData) && succeeded;
+		else
+			callback(&filepath, userData);
+		FSDestroyPath(&name);
+		FSDestroyPath(&filepath);
+	}
+	while (FindNextFileA(fHandle, &findData));
+	FindClose(fHandle);
+	return succeeded;
+#else
+	DIR* dHandle = opendir(directory->buf);
+	if (!dHandle)
+		return false;
+
+	bool           succeeded = true;
+	struct dirent* entry;
+	while ((entry = readdir(dHandle)) != NULL)
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+		FSPath name     = FSCreatePath(entry->d_name, ~0ULL);
+		FSPath filepath = FSCreatePath(directory->buf, directory->len);
+		if (!name.buf || !filepath.buf || !FSPathAppend(&filepath, &name))
+		{
+			FSDestroyPath(&name);
+			FSDestroyPath(&filepath);
+			succeeded = false;
+			break;
+		}
+		struct stat info;
+		if (stat(filepath.buf, &info) == 0 && S_ISDIR(info.st_mode))
+			succeeded = FSIterateDirectory(&filepath, callback, userData) && succeeded;
+		else
+			callback(&filepath, userData);
+		FSDestroyPath(&name);
+		FSDestroyPath(&filepath);
+	}
+	closedir(dHandle);
+	return succeeded;
+#endif
+}
+
+bool FSMapFile(const FSPath* filepath, FSMappedFile* mapped)
+{
+	if (!filepath || !mapped)
+		return false;
+
+	mapped->data    = NULL;
+	mapped->size    = 0;
+	mapped->file    = NULL;
+	mapped->mapping = NULL;
+
+#if defined(_WIN32)
+	HANDLE fHandle = CreateFileA(filepath->buf, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fHandle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(fHandle);
+		return false;
+	}
+	HANDLE mHandle = CreateFileMappingA(fHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mHandle)
+	{
+		CloseHandle(fHandle);
+		return false;
+	}
+	const void* data = MapViewOfFile(mHandle, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mHandle);
+		CloseHandle(fHandle);
+		return false;
+	}
+	mapped->data    = data;
+	mapped->size    = (size_t) fileSize.QuadPart;
+	mapped->file    = fHandle;
+	mapped->mapping = mHandle;
+	return true;
+#else
+	int fd = open(filepath->buf, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+	void* data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+	mapped->data = data;
+	mapped->size = (size_t) info.st_size;
+	return true;
+#endif
+}
+
+void FSUnmapFile(FSMappedFile* mapped)
+{
+	if (!mapped || !mapped->data)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(mapped->data);
+	CloseHandle((HANDLE) mapped->mapping);
+	CloseHandle((HANDLE) mapped->file);
+#else
+	munmap((void*) mapped->data, mapped->size);
+#endif
+	mapped->data    = NULL;
+	mapped->size    = 0;
+	mapped->file    = NULL;
+	mapped->mapping = NULL;
 }
\ No newline at end of file
@@ -11,12 +11,30 @@ typedef struct FSPath
 	size_t cap;
 } FSPath;
 
+typedef struct FSMappedFile
+{
+	const void* data;
+	size_t      size;
+	void*       file;
+	void*       mapping;
+} FSMappedFile;
+
+typedef void (*FSDirectoryCallbackFn)(const FSPath* filepath, void* userData);
+
 FSPath FSCreatePath(const char* path, size_t length);
 void   FSDestroyPath(FSPath* path);
 bool   FSPathAppend(FSPath* lhs, const FSPath* rhs);
+bool   FSPathConcat(FSPath* lhs, const char* suffix);
 FSPath FSPathGetStem(const FSPath* path);
 bool   FSPathEquals(const FSPath* lhs, const FSPath* rhs);
 
 uint64_t FSLastWriteTime(const FSPath* filepath);
 void     FSSetLastWriteTime(const FSPath* filepath, uint64_t time);
-bool     FSCreateDirectories(const FSPath* directory);
\ No newline at end of file
+bool     FSCreateDirectories(const FSPath* directory);
+bool     FSReplaceFile(const FSPath* source, const FSPath* destination);
+uint64_t FSFileSize(const FSPath* filepath);
+FSPath   FSExecutablePath();
+bool     FSIterateDirectory(const FSPath* directory, FSDirectoryCallbackFn callback, void* userData);
+
+bool FSMapFile(const FSPath* filepath, FSMappedFile* mapped);
+void FSUnmapFile(FSMappedFile* mapped);
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "JobSystem.h"
+#include "Atomic.h"
+
+#include <stdlib.h>
+
+static bool JobQueueSetup(JobQueue* queue)
+{
+	queue->head     = 0;
+	queue->count    = 0;
+	queue->capacity = 64;
+	queue->jobs     = (Job*) malloc(queue->capacity * sizeof(Job));
+	return queue->jobs != NULL;
+}
+
+static void JobQueueCleanup(JobQueue* queue)
+{
+	free(queue->jobs);
+	queue->jobs     = NULL;
+	queue->head     = 0;
+	queue->count    = 0;
+	queue->capacity = 0;
+}
+
+static bool JobQueuePush(JobQueue* queue, const Job* job)
+{
+	if (queue->count == queue->capacity)
+	{
+		uint32_t newCapacity = queue->capacity * 2;
+		Job*     newJobs     = (Job*) malloc(newCapacity * sizeof(Job));
+		if (!newJobs)
+			return false;
+		for (uint32_t i = 0; i < queue->count; ++i)
+			newJobs[i] = queue->jobs[(queue->head + i) % queue->capacity];
+		free(queue->jobs);
+		queue->jobs     = newJobs;
+		queue->head     = 0;
+		queue->capacity = newCapacity;
+	}
+	queue->jobs[(queue->head + queue->count) % queue->capacity] = *job;
+	++queue->count;
+	return true;
+}
+
+static bool JobQueuePop(JobQueue* queue, Job* job)
+{
+	if (queue->count == 0)
+		return false;
+	*job        = queue->jobs[queue->head];
+	queue->head = (queue->head + 1) % queue->capacity;
+	--queue->count;
+	return true;
+}
+
+static void JobSystemRun(JobSystem* system, Job* job, uint32_t threadIndex)
+{
+	job->callback(job->userData, threadIndex);
+	if (job->counter && AtomicAdd32(&job->counter->pending, ~0U) == 0 && system)
+	{
+		MutexLock(system->mutex);
+		CondVarWakeAll(system->doneCond);
+		MutexUnlock(system->mutex);
+	}
+}
+
+static void JobWorkerMain(void* userData)
+{
+	JobWorker* worker = (JobWorker*) userData;
+	JobSystem* system = worker->system;
+
+	MutexLock(system->mutex);
+	while (true)
+	{
+		Job job;
+		if (!JobQueuePop(&system->foreground, &job) && !JobQueuePop(&system->background, &job))
+		{
+			if (system->stop)
+				break;
+			CondVarWait(system->workCond, system->mutex);
+			continue;
+		}
+		MutexUnlock(system->mutex);
+		JobSystemRun(system, &job, worker->index);
+		MutexLock(system->mutex);
+	}
+	MutexUnlock(system->mutex);
+}
+
+bool JobSystemSetup(JobSystem* system)
+{
+	if (!system) return false;
+
+	if (system->workerCount == 0)
+	{
+		uint32_t concurrency = ThreadHardwareConcurrency();
+		system->workerCount  = concurrency > 1 ? concurrency - 1 : 1;
+	}
+	bool foreground  = JobQueueSetup(&system->foreground);
+	bool background  = JobQueueSetup(&system->background);
+	system->stop     = false;
+	system->workers  = (JobWorker*) calloc(system->workerCount, sizeof(JobWorker));
+	system->mutex    = MutexCreate();
+	system->workCond = CondVarCreate();
+	system->doneCond = CondVarCreate();
+	if (!foreground || !background || !system->workers || !system->mutex || !system->workCond || !system->doneCond)
+	{
+		JobSystemCleanup(system);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < system->workerCount; ++i)
+	{
+		JobWorker* worker = system->workers + i;
+		worker->system    = system;
+		worker->index     = i;
+		worker->thread    = ThreadCreate(&JobWorkerMain, worker);
+		if (!worker->thread)
+		{
+			JobSystemCleanup(system);
+			return false;
+		}
+	}
+	return true;
+}
+
+void JobSystemCleanup(JobSystem* system)
+{
+	if (!system) return;
+
+	if (system->workers && system->mutex && system->workCond)
+	{
+		MutexLock(system->mutex);
+		system->stop = true;
+		CondVarWakeAll(system->workCond);
+		MutexUnlock(system->mutex);
+		for (uint32_t i = 0; i < system->workerCount; ++i)
+		{
+			if (system->workers[i].thread)
+				ThreadJoin(system->workers[i].thread);
+		}
+	}
+	free(system->workers);
+	CondVarDestroy(system->doneCond);
+	CondVarDestroy(system->workCond);
+	MutexDestroy(system->mutex);
+	JobQueueCleanup(&system->foreground);
+	JobQueueCleanup(&system->background);
+	system->workers  = NULL;
+	system->doneCond = NULL;
+	system->workCond = NULL;
+	system->mutex    = NULL;
+}
+
+uint32_t JobSystemThreadCount(JobSystem* system)
+{
+	return system ? system->workerCount + 1 : 1;
+}
+
+static bool JobSystemPush(JobSystem* system, JobQueue* queue, JobFn callback, void* userData, JobCounter* counter)
+{
+	if (!callback) return false;
+
+	Job job = {
+		.callback = callback,
+		.userData = userData,
+		.counter  = counter
+	};
+	if (counter)
+		AtomicAdd32(&counter->pending, 1);
+	if (!system)
+	{
+		JobSystemRun(system, &job, 0);
+		return true;
+	}
+
+	MutexLock(system->mutex);
+	if (!JobQueuePush(queue, &job))
+	{
+		MutexUnlock(system->mutex);
+		if (counter)
+			AtomicAdd32(&counter->pending, ~0U);
+		return false;
+	}
+	CondVarWakeOne(system->workCond);
+	MutexUnlock(system->mutex);
+	return true;
+}
+
+bool JobSystemSubmit(JobSystem* system, JobFn callback, void* userData, JobCounter* counter)
+{
+	return JobSystemPush(system, system ? &system->foreground : NULL, callback, userData, counter);
+}
+
+bool JobSystemSubmitBackground(JobSystem* system, JobFn callback, void* userData, JobCounter* counter)
+{
+	return JobSystemPush(system, system ? &system->background : NULL, callback, userData, counter);
+}
+
+void JobSystemWait(JobSystem* system, JobCounter* counter)
+{
+	if (!system || !counter) return;
+
+	MutexLock(system->mutex);
+	while (AtomicLoad32(&counter->pending) > 0)
+	{
+		Job job;
+		if (!JobQueuePop(&system->foreground, &job))
+		{
+			CondVarWait(system->doneCond, system->mutex);
+			continue;
+		}
+		MutexUnlock(system->mutex);
+		JobSystemRun(system, &job, system->workerCount);
+		MutexLock(system->mutex);
+	}
+	MutexUnlock(system->mutex);
+}
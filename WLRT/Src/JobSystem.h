@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Thread.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef void (*JobFn)(void* userData, uint32_t threadIndex);
+
+typedef struct JobCounter
+{
+	volatile uint32_t pending;
+} JobCounter;
+
+typedef struct Job
+{
+	JobFn       callback;
+	void*       userData;
+	JobCounter* counter;
+} Job;
+
+typedef struct JobQueue
+{
+	uint32_t head;
+	uint32_t count;
+	uint32_t capacity;
+	Job*     jobs;
+} JobQueue;
+
+typedef struct JobWorker
+{
+	struct JobSystem* system;
+	Thread*           thread;
+	uint32_t          index;
+} JobWorker;
+
+typedef struct JobSystem
+{
+	uint32_t   workerCount;
+	JobWorker* workers;
+
+	Mutex*   mutex;
+	CondVar* workCond;
+	CondVar* doneCond;
+	bool     stop;
+
+	JobQueue foreground;
+	JobQueue background;
+} JobSystem;
+
+bool     JobSystemSetup(JobSystem* system);
+void     JobSystemCleanup(JobSystem* system);
+uint32_t JobSystemThreadCount(JobSystem* system);
+bool     JobSystemSubmit(JobSystem* system, JobFn callback, void* userData, JobCounter* counter);
+bool     JobSystemSubmitBackground(JobSystem* system, JobFn callback, void* userData, JobCounter* counter);
+void     JobSystemWait(JobSystem* system, JobCounter* counter);
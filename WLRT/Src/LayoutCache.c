@@ -0,0 +1,432 @@
+#include "Vk.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct VkLayoutBinding
+{
+	uint32_t                     set;
+	VkDescriptorSetLayoutBinding binding;
+} VkLayoutBinding;
+
+static int VkLayoutCompareBindings(const void* lhs, const void* rhs)
+{
+	const VkLayoutBinding* a = (const VkLayoutBinding*) lhs;
+	const VkLayoutBinding* b = (const VkLayoutBinding*) rhs;
+	if (a->set != b->set)
+		return a->set < b->set ? -1 : 1;
+	return a->binding.binding < b->binding.binding ? -1 : (a->binding.binding > b->binding.binding ? 1 : 0);
+}
+
+static bool VkLayoutCacheReserve(void** entries, uint32_t count, uint32_t* capacity, size_t entrySize)
+{
+	if (count < *capacity)
+		return true;
+	uint32_t newCapacity = *capacity > 0 ? *capacity * 2 : 8;
+	void*    newEntries  = realloc(*entries, newCapacity * entrySize);
+	if (!newEntries)
+		return false;
+	*entries  = newEntries;
+	*capacity = newCapacity;
+	return true;
+}
+
+static void VkReleaseSetLayout(VkData* vk, VkDescriptorSetLayoutEntry* entry)
+{
+	VkLayoutCacheData* cache = &vk->layoutCache;
+	if (!entry || --entry->refs > 0)
+		return;
+
+	for (uint32_t i = 0; i < cache->setLayoutCount; ++i)
+	{
+		if (cache->setLayouts[i] != entry)
+			continue;
+		cache->setLayouts[i] = cache->setLayouts[--cache->setLayoutCount];
+		break;
+	}
+	vkDestroyDescriptorSetLayout(vk->device, entry->handle, vk->allocation);
+	free(entry->bindings);
+	free(entry->bindingFlags);
+	free(entry);
+}
+
+static VkDescriptorSetLayoutEntry* VkFindSetLayout(VkData* vk, VkDescriptorSetLayout setLayout)
+{
+	VkLayoutCacheData* cache = &vk->layoutCache;
+	for (uint32_t i = 0; setLayout && i < cache->setLayoutCount; ++i)
+	{
+		if (cache->setLayouts[i]->handle == setLayout)
+			return cache->setLayouts[i];
+	}
+	return NULL;
+}
+
+static VkDescriptorSetLayoutEntry* VkAcquireSetLayout(VkData* vk, const VkDescriptorSetLayoutBinding* bindings, const VkDescriptorBindingFlags* bindingFlags, uint32_t bindingCount)
+{
+	VkLayoutCacheData* cache = &vk->layoutCache;
+	uint64_t           hash  = VkShaderCacheHash(0xCBF29CE484222325ULL, &bindingCount, sizeof(bindingCount));
+	hash                     = VkShaderCacheHash(hash, bindings, bindingCount * sizeof(VkDescriptorSetLayoutBinding));
+	if (bindingFlags)
+		hash = VkShaderCacheHash(hash, bindingFlags, bindingCount * sizeof(VkDescriptorBindingFlags));
+	for (uint32_t i = 0; i < cache->setLayoutCount; ++i)
+	{
+		VkDescriptorSetLayoutEntry* entry = cache->setLayouts[i];
+		if (entry->hash != hash ||
+			entry->bindingCount != bindingCount ||
+			!entry->bindingFlags != !bindingFlags ||
+			memcmp(entry->bindings, bindings, bindingCount * sizeof(VkDescriptorSetLayoutBinding)) != 0 ||
+			(bindingFlags && memcmp(entry->bindingFlags, bindingFlags, bindingCount * sizeof(VkDescriptorBindingFlags)) != 0))
+			continue;
+		++entry->refs;
+		++cache->hits;
+		return entry;
+	}
+
+	VkDescriptorSetLayoutEntry* entry = (VkDescriptorSetLayoutEntry*) calloc(1, sizeof(VkDescriptorSetLayoutEntry));
+	if (entry)
+	{
+		entry->bindings     = (VkDescriptorSetLayoutBinding*) malloc((bindingCount > 0 ? bindingCount : 1) * sizeof(VkDescriptorSetLayoutBinding));
+		entry->bindingFlags = bindingFlags ? (VkDescriptorBindingFlags*) malloc((bindingCount > 0 ? bindingCount : 1) * sizeof(VkDescriptorBindingFlags)) : NULL;
+	}
+	if (!entry || !entry->bindings || (bindingFlags && !entry->bindingFlags) || !VkLayoutCacheReserve((void**) &cache->setLayouts, cache->setLayoutCount, &cache->setLayoutCapacity, sizeof(VkDescriptorSetLayoutEntry*)))
+	{
+		if (entry)
+		{
+			free(entry->bindings);
+			free(entry->bindingFlags);
+		}
+		free(entry);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate descriptor set layout entry");
+		return NULL;
+	}
+	memcpy(entry->bindings, bindings, bindingCount * sizeof(VkDescriptorSetLayoutBinding));
+	if (bindingFlags)
+		memcpy(entry->bindingFlags, bindingFlags, bindingCount * sizeof(VkDescriptorBindingFlags));
+	entry->hash         = hash;
+	entry->bindingCount = bindingCount;
+	entry->refs         = 1;
+
+	VkDescriptorSetLayoutCreateFlags flags = 0;
+	for (uint32_t i = 0; bindingFlags && i < bindingCount; ++i)
+	{
+		if (bindingFlags[i] & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT)
+			flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	}
+	VkDescriptorSetLayoutBindingFlagsCreateInfo flagsCreateInfo = {
+		.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+		.pNext         = NULL,
+		.bindingCount  = bindingCount,
+		.pBindingFlags = entry->bindingFlags
+	};
+	VkDescriptorSetLayoutCreateInfo createInfo = {
+		.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext        = bindingFlags ? &flagsCreateInfo : NULL,
+		.flags        = flags,
+		.bindingCount = bindingCount,
+		.pBindings    = entry->bindings
+	};
+	if (!VkValidate(vk, vkCreateDescriptorSetLayout(vk->device, &createInfo, vk->allocation, &entry->handle)))
+	{
+		free(entry->bindings);
+		free(entry->bindingFlags);
+		free(entry);
+		return NULL;
+	}
+	cache->setLayouts[cache->setLayoutCount++] = entry;
+	++cache->misses;
+	return entry;
+}
+
+static VkDescriptorSetLayoutEntry* VkAcquireBindlessSetLayout(VkData* vk, const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount)
+{
+	VkDescriptorSetLayoutEntry* entry = VkFindSetLayout(vk, vk->bindless.setLayout);
+	if (!entry)
+	{
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Shader uses the bindless descriptor set but bindless resources are unavailable");
+		return NULL;
+	}
+	for (uint32_t i = 0; i < bindingCount; ++i)
+	{
+		bool matches = false;
+		for (uint32_t j = 0; j < entry->bindingCount && !matches; ++j)
+			matches = entry->bindings[j].binding == bindings[i].binding && entry->bindings[j].descriptorType == bindings[i].descriptorType;
+		if (!matches)
+		{
+			VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Shader binding in the bindless descriptor set does not match the bindless registry");
+			return NULL;
+		}
+	}
+	++entry->refs;
+	++vk->layoutCache.hits;
+	return entry;
+}
+
+static VkPipelineLayoutEntry* VkAcquirePipelineLayout(VkData* vk, VkDescriptorSetLayoutEntry* const* setLayouts, uint32_t setLayoutCount, const VkPushConstantRange* pushConstantRange)
+{
+	VkLayoutCacheData* cache = &vk->layoutCache;
+	uint64_t           hash  = VkShaderCacheHash(0xCBF29CE484222325ULL, setLayouts, setLayoutCount * sizeof(VkDescriptorSetLayoutEntry*));
+	hash                     = VkShaderCacheHash(hash, pushConstantRange, sizeof(VkPushConstantRange));
+	for (uint32_t i = 0; i < cache->layoutCount; ++i)
+	{
+		VkPipelineLayoutEntry* entry = cache->layouts[i];
+		if (entry->hash != hash ||
+			entry->setLayoutCount != setLayoutCount ||
+			memcmp(entry->setLayouts, setLayouts, setLayoutCount * sizeof(VkDescriptorSetLayoutEntry*)) != 0 ||
+			memcmp(&entry->pushConstantRange, pushConstantRange, sizeof(VkPushConstantRange)) != 0)
+			continue;
+		for (uint32_t j = 0; j < setLayoutCount; ++j)
+			VkReleaseSetLayout(vk, setLayouts[j]);
+		++entry->refs;
+		++cache->hits;
+		return entry;
+	}
+
+	VkPipelineLayoutEntry* entry = (VkPipelineLayoutEntry*) calloc(1, sizeof(VkPipelineLayoutEntry));
+	if (!entry || !VkLayoutCacheReserve((void**) &cache->layouts, cache->layoutCount, &cache->layoutCapacity, sizeof(VkPipelineLayoutEntry*)))
+	{
+		free(entry);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate pipeline layout entry");
+		return NULL;
+	}
+	VkDescriptorSetLayout handles[VK_LAYOUT_MAX_SETS];
+	for (uint32_t i = 0; i < setLayoutCount; ++i)
+		handles[i] = setLayouts[i]->handle;
+	memcpy(entry->setLayouts, setLayouts, setLayoutCount * sizeof(VkDescriptorSetLayoutEntry*));
+	entry->hash              = hash;
+	entry->setLayoutCount    = setLayoutCount;
+	entry->pushConstantRange = *pushConstantRange;
+	entry->refs              = 1;
+
+	VkPipelineLayoutCreateInfo createInfo = {
+		.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.pNext                  = NULL,
+		.flags                  = 0,
+		.setLayoutCount         = setLayoutCount,
+		.pSetLayouts            = handles,
+		.pushConstantRangeCount = pushConstantRange->size > 0 ? 1 : 0,
+		.pPushConstantRanges    = pushConstantRange
+	};
+	if (!VkValidate(vk, vkCreatePipelineLayout(vk->device, &createInfo, vk->allocation, &entry->handle)))
+	{
+		free(entry);
+		return NULL;
+	}
+	cache->layouts[cache->layoutCount++] = entry;
+	++cache->misses;
+	return entry;
+}
+
+static bool VkMergeShaderBindings(VkData* vk, VkShaderData* const* shaders, uint32_t shaderCount, VkLayoutBinding* bindings, uint32_t* bindingCount, VkPushConstantRange* pushConstantRange)
+{
+	*bindingCount = 0;
+	for (uint32_t i = 0; i < shaderCount; ++i)
+	{
+		const VkShaderData* shader = shaders[i];
+		if (!shader || !shader->handle)
+			continue;
+
+		const VkShaderReflection* reflection = &shader->reflection;
+		if (reflection->pushConstantSize > 0)
+		{
+			pushConstantRange->stageFlags |= shader->stage;
+			if (reflection->pushConstantSize > pushConstantRange->size)
+				pushConstantRange->size = reflection->pushConstantSize;
+		}
+		for (uint32_t j = 0; j < reflection->bindingCount; ++j)
+		{
+			const VkShaderBinding* binding = reflection->bindings + j;
+			if (binding->set >= VK_LAYOUT_MAX_SETS)
+			{
+				VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Shader uses more descriptor sets than the layout cache supports");
+				return false;
+			}
+
+			VkLayoutBinding* merged = NULL;
+			for (uint32_t k = 0; k < *bindingCount && !merged; ++k)
+			{
+				if (bindings[k].set == binding->set && bindings[k].binding.binding == binding->binding)
+					merged = bindings + k;
+			}
+			if (!merged)
+			{
+				merged = bindings + (*bindingCount)++;
+				memset(merged, 0, sizeof(VkLayoutBinding));
+				merged->set                     = binding->set;
+				merged->binding.binding         = binding->binding;
+				merged->binding.descriptorType  = binding->type;
+				merged->binding.descriptorCount = binding->count;
+			}
+			else if (merged->binding.descriptorType != binding->type)
+			{
+				VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Shaders disagree on the type of a descriptor binding");
+				return false;
+			}
+			if (binding->count > merged->binding.descriptorCount)
+				merged->binding.descriptorCount = binding->count;
+			merged->binding.stageFlags |= shader->stage;
+		}
+	}
+	qsort(bindings, *bindingCount, sizeof(VkLayoutBinding), &VkLayoutCompareBindings);
+	return true;
+}
+
+bool VkSetupLayoutCache(VkData* vk)
+{
+	if (!vk) return false;
+
+	VkLayoutCacheData* cache = &vk->layoutCache;
+	cache->setLayoutCount    = 0;
+	cache->setLayoutCapacity = 0;
+	cache->setLayouts        = NULL;
+	cache->layoutCount       = 0;
+	cache->layoutCapacity    = 0;
+	cache->layouts           = NULL;
+	cache->hits              = 0;
+	cache->misses            = 0;
+	return true;
+}
+
+void VkCleanupLayoutCache(VkData* vk)
+{
+	if (!vk) return;
+
+	VkLayoutCacheData* cache = &vk->layoutCache;
+	for (uint32_t i = 0; i < cache->layoutCount; ++i)
+	{
+		vkDestroyPipelineLayout(vk->device, cache->layouts[i]->handle, vk->allocation);
+		free(cache->layouts[i]);
+	}
+	for (uint32_t i = 0; i < cache->setLayoutCount; ++i)
+	{
+		vkDestroyDescriptorSetLayout(vk->device, cache->setLayouts[i]->handle, vk->allocation);
+		free(cache->setLayouts[i]->bindings);
+		free(cache->setLayouts[i]->bindingFlags);
+		free(cache->setLayouts[i]);
+	}
+	free(cache->layouts);
+	free(cache->setLayouts);
+	cache->layouts           = NULL;
+	cache->layoutCount       = 0;
+	cache->layoutCapacity    = 0;
+	cache->setLayouts        = NULL;
+	cache->setLayoutCount    = 0;
+	cache->setLayoutCapacity = 0;
+}
+
+bool VkAcquireReflectedLayout(VkData* vk, VkShaderData* const* shaders, uint32_t shaderCount, VkReflectedLayout* layout)
+{
+	if (!vk || !shaders || !layout) return false;
+
+	memset(layout, 0, sizeof(VkReflectedLayout));
+	uint32_t maxBindings = 0;
+	for (uint32_t i = 0; i < shaderCount; ++i)
+	{
+		if (shaders[i] && shaders[i]->handle)
+			maxBindings += shaders[i]->reflection.bindingCount;
+	}
+	VkLayoutBinding* bindings = (VkLayoutBinding*) malloc((maxBindings > 0 ? maxBindings : 1) * sizeof(VkLayoutBinding));
+	if (!bindings)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate layout bindings");
+		return false;
+	}
+
+	uint32_t            bindingCount      = 0;
+	VkPushConstantRange pushConstantRange = { .stageFlags = 0, .offset = 0, .size = 0 };
+	if (!VkMergeShaderBindings(vk, shaders, shaderCount, bindings, &bindingCount, &pushConstantRange))
+	{
+		free(bindings);
+		return false;
+	}
+
+	VkDescriptorSetLayoutBinding* setBindings = (VkDescriptorSetLayoutBinding*) malloc((bindingCount > 0 ? bindingCount : 1) * sizeof(VkDescriptorSetLayoutBinding));
+	if (!setBindings)
+	{
+		free(bindings);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate layout bindings");
+		return false;
+	}
+	for (uint32_t i = 0; i < bindingCount; ++i)
+		setBindings[i] = bindings[i].binding;
+
+	VkDescriptorSetLayoutEntry* setLayouts[VK_LAYOUT_MAX_SETS];
+	uint32_t                    setLayoutCount = bindingCount > 0 ? bindings[bindingCount - 1].set + 1 : 0;
+	uint32_t                    first          = 0;
+	for (uint32_t set = 0; set < setLayoutCount; ++set)
+	{
+		uint32_t last = first;
+		while (last < bindingCount && bindings[last].set == set)
+		{
+			if (bindings[last].binding.binding < 64)
+				layout->bindingMasks[set] |= 1ULL << bindings[last].binding.binding;
+			++last;
+		}
+		if (set == VK_BINDLESS_SET)
+			setLayouts[set] = VkAcquireBindlessSetLayout(vk, setBindings + first, last - first);
+		else
+			setLayouts[set] = VkAcquireSetLayout(vk, setBindings + first, NULL, last - first);
+		if (!setLayouts[set])
+		{
+			for (uint32_t i = 0; i < set; ++i)
+				VkReleaseSetLayout(vk, setLayouts[i]);
+			free(setBindings);
+			free(bindings);
+			return false;
+		}
+		first = last;
+	}
+	free(setBindings);
+	free(bindings);
+
+	VkPipelineLayoutEntry* entry = VkAcquirePipelineLayout(vk, setLayouts, setLayoutCount, &pushConstantRange);
+	if (!entry)
+	{
+		for (uint32_t i = 0; i < setLayoutCount; ++i)
+			VkReleaseSetLayout(vk, setLayouts[i]);
+		return false;
+	}
+	layout->layout             = entry->handle;
+	layout->setLayoutCount     = setLayoutCount;
+	layout->pushConstantStages = pushConstantRange.stageFlags;
+	layout->pushConstantSize   = pushConstantRange.size;
+	for (uint32_t i = 0; i < setLayoutCount; ++i)
+		layout->setLayouts[i] = entry->setLayouts[i]->handle;
+	return true;
+}
+
+void VkReleasePipelineLayout(VkData* vk, VkPipelineLayout layout)
+{
+	if (!vk || !layout) return;
+
+	VkLayoutCacheData* cache = &vk->layoutCache;
+	for (uint32_t i = 0; i < cache->layoutCount; ++i)
+	{
+		VkPipelineLayoutEntry* entry = cache->layouts[i];
+		if (entry->handle != layout)
+			continue;
+		if (--entry->refs > 0)
+			return;
+
+		cache->layouts[i] = cache->layouts[--cache->layoutCount];
+		vkDestroyPipelineLayout(vk->device, entry->handle, vk->allocation);
+		for (uint32_t j = 0; j < entry->setLayoutCount; ++j)
+			VkReleaseSetLayout(vk, entry->setLayouts[j]);
+		free(entry);
+		return;
+	}
+}
+
+VkDescriptorSetLayout VkAcquireDescriptorSetLayout(VkData* vk, const VkDescriptorSetLayoutBinding* bindings, const VkDescriptorBindingFlags* bindingFlags, uint32_t bindingCount)
+{
+	if (!vk || (!bindings && bindingCount > 0)) return NULL;
+
+	VkDescriptorSetLayoutEntry* entry = VkAcquireSetLayout(vk, bindings, bindingFlags, bindingCount);
+	return entry ? entry->handle : NULL;
+}
+
+void VkReleaseDescriptorSetLayout(VkData* vk, VkDescriptorSetLayout setLayout)
+{
+	if (!vk || !setLayout) return;
+
+	VkReleaseSetLayout(vk, VkFindSetLayout(vk, setLayout));
+}
\ No newline at end of file
@@ -1,5 +1,9 @@
+#include "Atomic.h"
+#include "CpuTracer.h"
 #include "Exit.h"
 #include "FileWatcher.h"
+#include "JobSystem.h"
+#include "Scene.h"
 #include "Vk.h"
 #include "VkFuncs/VkFuncs.h"
 #include "Window.h"
@@ -8,6 +12,7 @@
 #include <GLFW/glfw3.h>
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,35 +27,60 @@ static void VKErrCB(int code, const char* msg)
 	printf("VK ERROR (%d %s): %s\n", code, VkGetErrorString(code), msg);
 }
 
-static bool CreateBLAS(VkAccStructBuilder* builder, VkAccStruct* blas)
+typedef struct AppVertex
 {
-	typedef struct Vertex
-	{
-		float x, y, z, w;
-	} Vertex;
+	float x, y, z, w;
+} AppVertex;
 
-	typedef uint32_t Index;
+static const AppVertex s_Vertices[] = {
+	{0.5f,   0.2f, 0.0f,  0.0f},
+	{ 0.2f,  0.8f, 0.0f,  0.0f},
+	{ 0.8f,  0.8f, 0.0f,  0.0f},
+	{ -2.0f, 0.0f, -3.0f, 0.0f},
+	{ 3.0f,  0.0f, -3.0f, 0.0f},
+	{ 3.0f,  0.0f, 3.0f,  0.0f},
+	{ -2.0f, 0.0f, 3.0f,  0.0f}
+};
+static const uint32_t s_Indices[] = { 0, 1, 2, 3, 4, 5, 3, 5, 6 };
 
-	VkData* vk = builder->vk;
+typedef struct AppGeometry
+{
+	VkBuffer        vertexBuffer;
+	VmaAllocation   vertexBufferA;
+	VkBuffer        indexBuffer;
+	VmaAllocation   indexBufferA;
+	VkDeviceAddress addresses[2];
+	uint32_t        bindless[2];
+	VkDeviceAddress references[2];
+} AppGeometry;
 
-	Vertex vertices[] = {
-		{0.5f,  0.2f, 0.0f, 0.0f},
-		{ 0.2f, 0.8f, 0.0f, 0.0f},
-		{ 0.8f, 0.8f, 0.0f, 0.0f}
-	};
-	Index indices[] = { 0, 1, 2 };
+static void CleanupGeometry(VkData* vk, AppGeometry* geometry)
+{
+	if (!vk || !geometry) return;
+
+	VkBindlessRelease(vk, VK_BINDLESS_KIND_BUFFER, geometry->bindless[0]);
+	VkBindlessRelease(vk, VK_BINDLESS_KIND_BUFFER, geometry->bindless[1]);
+	vmaDestroyBuffer(vk->allocator, geometry->vertexBuffer, geometry->vertexBufferA);
+	vmaDestroyBuffer(vk->allocator, geometry->indexBuffer, geometry->indexBufferA);
+	memset(geometry, 0, sizeof(*geometry));
+}
+
+static bool CreateBLAS(VkAccStructBuilder* builder, VkAccStruct* blas, AppGeometry* geometry)
+{
+	VkData* vk = builder->vk;
 
-	VkBuffer      vertexBuffer  = NULL;
-	VkBuffer      indexBuffer   = NULL;
-	VmaAllocation vertexBufferA = NULL;
-	VmaAllocation indexBufferA  = NULL;
+	VkBuffer           vertexBuffer  = NULL;
+	VkBuffer           indexBuffer   = NULL;
+	VmaAllocation      vertexBufferA = NULL;
+	VmaAllocation      indexBufferA  = NULL;
+	VkBufferUsageFlags inputUsage    = vk->rayTracingSupported ? VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR : 0;
 
 	VkBufferCreateInfo vbCreateInfo = {
 		.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
 		.pNext                 = NULL,
 		.flags                 = 0,
-		.size                  = sizeof(vertices),
-		.usage                 = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		.size                  = sizeof(s_Vertices),
+		.usage                 = inputUsage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
 		.sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
 		.queueFamilyIndexCount = 0,
 		.pQueueFamilyIndices   = NULL
@@ -69,8 +99,8 @@ static bool CreateBLAS(VkAccStructBuilder* builder, VkAccStruct* blas)
 		.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
 		.pNext                 = NULL,
 		.flags                 = 0,
-		.size                  = sizeof(indices),
-		.usage                 = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		.size                  = sizeof(s_Indices),
+		.usage                 = inputUsage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
 		.sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
 		.queueFamilyIndexCount = 0,
 		.pQueueFamilyIndices   = NULL
@@ -104,8 +134,8 @@ static bool CreateBLAS(VkAccStructBuilder* builder, VkAccStruct* blas)
 		vmaDestroyBuffer(vk->allocator, indexBuffer, indexBufferA);
 		return false;
 	}
-	memcpy(vertexData, vertices, sizeof(vertices));
-	memcpy(indexData, indices, sizeof(indices));
+	memcpy(vertexData, s_Vertices, sizeof(s_Vertices));
+	memcpy(indexData, s_Indices, sizeof(s_Indices));
 	vmaUnmapMemory(vk->allocator, vertexBufferA);
 	vmaUnmapMemory(vk->allocator, indexBufferA);
 
@@ -120,22 +150,43 @@ static bool CreateBLAS(VkAccStructBuilder* builder, VkAccStruct* blas)
 		.buffer = indexBuffer
 	};
 
+	geometry->vertexBuffer  = vertexBuffer;
+	geometry->vertexBufferA = vertexBufferA;
+	geometry->indexBuffer   = indexBuffer;
+	geometry->indexBufferA  = indexBufferA;
+	geometry->addresses[0]  = vkGetBufferDeviceAddress(vk->device, &vbAddressInfo);
+	geometry->addresses[1]  = vkGetBufferDeviceAddress(vk->device, &ibAddressInfo);
+	geometry->bindless[0]   = VkBindlessRegisterBuffer(vk, vertexBuffer, 0, VK_WHOLE_SIZE);
+	geometry->bindless[1]   = VkBindlessRegisterBuffer(vk, indexBuffer, 0, VK_WHOLE_SIZE);
+	geometry->references[0] = vk->bindlessSupported ? geometry->bindless[0] : geometry->addresses[0];
+	geometry->references[1] = vk->bindlessSupported ? geometry->bindless[1] : geometry->addresses[1];
+
 	VkAccStruct uncompressed;
 	memset(&uncompressed, 0, sizeof(uncompressed));
-	if (!VkAccStructBuilderSetTriangles(builder, 0, vkGetBufferDeviceAddress(vk->device, &vbAddressInfo), VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(Vertex), sizeof(vertices) / sizeof(*vertices), vkGetBufferDeviceAddress(vk->device, &ibAddressInfo), VK_INDEX_TYPE_UINT32, sizeof(indices) / sizeof(*indices)) ||
-		!VkAccStructBuilderPrepare(builder, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR, 1, 0) ||
+	if (!VkAccStructBuilderSetTriangles(builder, 0, geometry->addresses[0], VK_FORMAT_R32G32B32A32_SFLOAT, sizeof(AppVertex), sizeof(s_Vertices) / sizeof(*s_Vertices) - 1, geometry->addresses[1], VK_INDEX_TYPE_UINT32, sizeof(s_Indices) / sizeof(*s_Indices) / 3) ||
+		!VkAccStructBuilderSetHostTriangles(builder, 0, s_Vertices, s_Indices) ||
+		!VkAccStructBuilderPrepare(builder, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR, 1, 0))
+	{
+		CleanupGeometry(vk, geometry);
+		return false;
+	}
+	if (!vk->rayTracingSupported)
+	{
+		if (VkAccStructBuilderBuildBvh(builder, blas))
+			return true;
+		CleanupGeometry(vk, geometry);
+		return false;
+	}
+	if ((vk->bindlessSupported && (geometry->bindless[0] == VK_BINDLESS_INVALID || geometry->bindless[1] == VK_BINDLESS_INVALID)) ||
 		!VkAccStructBuilderBuild(builder, &uncompressed) ||
 		!VkAccStructBuilderCompact(builder, &uncompressed, blas))
 	{
 		VkCleanupAccStruct(&uncompressed);
-		vmaDestroyBuffer(vk->allocator, vertexBuffer, vertexBufferA);
-		vmaDestroyBuffer(vk->allocator, indexBuffer, indexBufferA);
+		CleanupGeometry(vk, geometry);
 		return false;
 	}
 
 	VkCleanupAccStruct(&uncompressed);
-	vmaDestroyBuffer(vk->allocator, vertexBuffer, vertexBufferA);
-	vmaDestroyBuffer(vk->allocator, indexBuffer, indexBufferA);
 	return true;
 }
 
@@ -198,14 +249,20 @@ static bool CreateTLAS(VkAccStructBuilder* builder, VkAccStruct* blas, VkAccStru
 	return true;
 }
 
-static bool CreateAS(VkAccStruct* blas, VkAccStruct* tlas)
+static bool CreateAS(VkAccStruct* blas, VkAccStruct* tlas, AppGeometry* geometry)
 {
 	VkAccStructBuilder builder;
 	memset(&builder, 0, sizeof(builder));
 	builder.vk = blas->vk;
 	if (!VkSetupAccStructBuilder(&builder)) return false;
 
-	if (!CreateBLAS(&builder, blas))
+	if (!blas->vk->rayTracingSupported)
+	{
+		bool built = CreateBLAS(&builder, tlas, geometry);
+		VkCleanupAccStructBuilder(&builder);
+		return built;
+	}
+	if (!CreateBLAS(&builder, blas, geometry))
 	{
 		VkCleanupAccStructBuilder(&builder);
 		return false;
@@ -214,6 +271,7 @@ static bool CreateAS(VkAccStruct* blas, VkAccStruct* tlas)
 	if (!CreateTLAS(&builder, blas, tlas))
 	{
 		VkCleanupAccStruct(blas);
+		CleanupGeometry(blas->vk, geometry);
 		VkCleanupAccStructBuilder(&builder);
 		return false;
 	}
@@ -234,29 +292,996 @@ static void FWOnExit(void* data)
 	FWCleanup();
 }
 
+typedef enum AppRaygenVariant
+{
+	APP_RAYGEN_VARIANT_PLAIN  = 0,
+	APP_RAYGEN_VARIANT_SER    = 1,
+	APP_RAYGEN_VARIANT_SORTED = 2,
+	APP_RAYGEN_VARIANT_COUNT  = 3,
+	APP_RAYGEN_VARIANT_AUTO   = 3
+} AppRaygenVariant;
+
+typedef struct AppOptions
+{
+	VkPresentModeKHR    presentMode;
+	uint32_t            framesInFlight;
+	double              targetFrameTime;
+	bool                submitThread;
+	bool                pipelinedUpdate;
+	uint32_t            recordThreads;
+	bool                pipelineLibraries;
+	bool                asyncPipelines;
+	uint32_t            maxBounces;
+	uint32_t            maxSamples;
+	uint32_t            samplesPerFrame;
+	bool                reorder;
+	bool                prewarm;
+	AppRaygenVariant    raygenVariant;
+	VkPathTracerMode    mode;
+	VkPathTracerBackend extendBackend;
+	VkPathTracerBackend shadowBackend;
+	bool                softwareTracing;
+	uint32_t            cpuReference;
+	uint32_t            cpuBenchmark;
+	uint32_t            cpuValidate;
+	bool                cpuPackets;
+	const char*         cpuOutput;
+	uint32_t            shaderRecipes;
+	bool                shaderReport;
+} AppOptions;
+
+static const char* MatchOption(const char* arg, const char* name)
+{
+	size_t nameLen = strlen(name);
+	if (strncmp(arg, name, nameLen) != 0 || arg[nameLen] != '=')
+		return NULL;
+	return arg + nameLen + 1;
+}
+
+static bool ParsePresentMode(const char* str, VkPresentModeKHR* presentMode)
+{
+	if (strcmp(str, "immediate") == 0)
+		*presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+	else if (strcmp(str, "mailbox") == 0)
+		*presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+	else if (strcmp(str, "fifo") == 0)
+		*presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	else if (strcmp(str, "fifo-relaxed") == 0)
+		*presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+	else
+		return false;
+	return true;
+}
+
+static const char* PresentModeName(VkPresentModeKHR presentMode)
+{
+	switch (presentMode)
+	{
+	case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+	case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+	case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo-relaxed";
+	default: return "unknown";
+	}
+}
+
+static const char* RaygenVariantName(AppRaygenVariant variant)
+{
+	switch (variant)
+	{
+	case APP_RAYGEN_VARIANT_PLAIN: return "plain";
+	case APP_RAYGEN_VARIANT_SER: return "ser";
+	case APP_RAYGEN_VARIANT_SORTED: return "sorted";
+	default: return "auto";
+	}
+}
+
+static bool ParseRaygenVariant(const char* str, AppRaygenVariant* variant)
+{
+	for (uint32_t i = 0; i <= APP_RAYGEN_VARIANT_AUTO; ++i)
+	{
+		if (strcmp(str, RaygenVariantName((AppRaygenVariant) i)) == 0)
+		{
+			*variant = (AppRaygenVariant) i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static const char* PathTracerModeName(VkPathTracerMode mode)
+{
+	switch (mode)
+	{
+	case VK_PATH_TRACER_MODE_MEGAKERNEL: return "megakernel";
+	case VK_PATH_TRACER_MODE_WAVEFRONT: return "wavefront";
+	default: return "unknown";
+	}
+}
+
+static bool ParsePathTracerMode(const char* str, VkPathTracerMode* mode)
+{
+	for (uint32_t i = 0; i < VK_PATH_TRACER_MODE_COUNT; ++i)
+	{
+		if (strcmp(str, PathTracerModeName((VkPathTracerMode) i)) == 0)
+		{
+			*mode = (VkPathTracerMode) i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static const char* PathTracerBackendName(VkPathTracerBackend backend)
+{
+	switch (backend)
+	{
+	case VK_PATH_TRACER_BACKEND_PIPELINE: return "pipeline";
+	case VK_PATH_TRACER_BACKEND_QUERY: return "query";
+	default: return "unknown";
+	}
+}
+
+static bool ParsePathTracerBackend(const char* str, VkPathTracerBackend* backend)
+{
+	for (uint32_t i = 0; i < VK_PATH_TRACER_BACKEND_COUNT; ++i)
+	{
+		if (strcmp(str, PathTracerBackendName((VkPathTracerBackend) i)) == 0)
+		{
+			*backend = (VkPathTracerBackend) i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool ParseToggle(const char* str, bool* toggle)
+{
+	if (strcmp(str, "on") == 0)
+		*toggle = true;
+	else if (strcmp(str, "off") == 0)
+		*toggle = false;
+	else
+		return false;
+	return true;
+}
+
+static bool ParseShaderRecipes(const char* str, uint32_t* recipes)
+{
+	*recipes = 0;
+	if (strcmp(str, "none") == 0)
+		return true;
+	while (*str)
+	{
+		const char* end    = strchr(str, ',');
+		size_t      length = end ? (size_t) (end - str) : strlen(str);
+		uint32_t    recipe = 0;
+		for (; recipe < SHADERC_RECIPE_COUNT; ++recipe)
+		{
+			const char* name = ShaderCRecipeName((ShaderCRecipe) recipe);
+			if (strlen(name) == length && strncmp(str, name, length) == 0)
+				break;
+		}
+		if (recipe == SHADERC_RECIPE_COUNT)
+			return false;
+		*recipes |= 1U << recipe;
+		str      += end ? length + 1 : length;
+	}
+	return true;
+}
+
+static bool ParseOptions(AppOptions* options, int argc, char** argv)
+{
+	options->presentMode       = VK_PRESENT_MODE_MAILBOX_KHR;
+	options->framesInFlight    = 2;
+	options->targetFrameTime   = 0.0;
+	options->submitThread      = true;
+	options->pipelinedUpdate   = true;
+	options->recordThreads     = 0;
+	options->pipelineLibraries = true;
+	options->asyncPipelines    = true;
+	options->maxBounces        = 4;
+	options->maxSamples        = 0;
+	options->samplesPerFrame   = 1;
+	options->reorder           = true;
+	options->prewarm           = true;
+	options->raygenVariant     = APP_RAYGEN_VARIANT_AUTO;
+	options->mode              = VK_PATH_TRACER_MODE_MEGAKERNEL;
+	options->extendBackend     = VK_PATH_TRACER_BACKEND_PIPELINE;
+	options->shadowBackend     = VK_PATH_TRACER_BACKEND_PIPELINE;
+	options->softwareTracing   = false;
+	options->cpuReference      = 0;
+	options->cpuBenchmark      = 0;
+	options->cpuValidate       = 0;
+	options->cpuPackets        = true;
+	options->cpuOutput         = "reference.ppm";
+	options->shaderRecipes     = 0;
+	options->shaderReport      = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg   = argv[i];
+		const char* value = NULL;
+		if ((value = MatchOption(arg, "--present-mode")) != NULL)
+		{
+			if (!ParsePresentMode(value, &options->presentMode))
+			{
+				printf("Unknown present mode '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--frames-in-flight")) != NULL)
+		{
+			options->framesInFlight = (uint32_t) strtoul(value, NULL, 10);
+			if (options->framesInFlight == 0)
+			{
+				printf("Frames in flight must be at least 1\n");
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--target-fps")) != NULL)
+		{
+			double fps               = strtod(value, NULL);
+			options->targetFrameTime = fps > 0.0 ? 1.0 / fps : 0.0;
+		}
+		else if ((value = MatchOption(arg, "--submit-thread")) != NULL)
+		{
+			if (!ParseToggle(value, &options->submitThread))
+			{
+				printf("Expected on or off for --submit-thread, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--pipelined-update")) != NULL)
+		{
+			if (!ParseToggle(value, &options->pipelinedUpdate))
+			{
+				printf("Expected on or off for --pipelined-update, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--record-threads")) != NULL)
+		{
+			options->recordThreads = (uint32_t) strtoul(value, NULL, 10);
+		}
+		else if ((value = MatchOption(arg, "--pipeline-libraries")) != NULL)
+		{
+			if (!ParseToggle(value, &options->pipelineLibraries))
+			{
+				printf("Expected on or off for --pipeline-libraries, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--async-pipelines")) != NULL)
+		{
+			if (!ParseToggle(value, &options->asyncPipelines))
+			{
+				printf("Expected on or off for --async-pipelines, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--bounces")) != NULL)
+		{
+			options->maxBounces = (uint32_t) strtoul(value, NULL, 10);
+			if (options->maxBounces == 0)
+			{
+				printf("Bounces must be at least 1\n");
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--max-samples")) != NULL)
+		{
+			options->maxSamples = (uint32_t) strtoul(value, NULL, 10);
+		}
+		else if ((value = MatchOption(arg, "--samples-per-frame")) != NULL)
+		{
+			options->samplesPerFrame = (uint32_t) strtoul(value, NULL, 10);
+			if (options->samplesPerFrame == 0)
+			{
+				printf("Samples per frame must be at least 1\n");
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--reorder")) != NULL)
+		{
+			if (!ParseToggle(value, &options->reorder))
+			{
+				printf("Expected on or off for --reorder, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--prewarm")) != NULL)
+		{
+			if (!ParseToggle(value, &options->prewarm))
+			{
+				printf("Expected on or off for --prewarm, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--raygen")) != NULL)
+		{
+			if (!ParseRaygenVariant(value, &options->raygenVariant))
+			{
+				printf("Expected auto, plain, ser or sorted for --raygen, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--mode")) != NULL)
+		{
+			if (!ParsePathTracerMode(value, &options->mode))
+			{
+				printf("Expected megakernel or wavefront for --mode, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--extend")) != NULL)
+		{
+			if (!ParsePathTracerBackend(value, &options->extendBackend))
+			{
+				printf("Expected pipeline or query for --extend, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--shadow")) != NULL)
+		{
+			if (!ParsePathTracerBackend(value, &options->shadowBackend))
+			{
+				printf("Expected pipeline or query for --shadow, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--software-tracing")) != NULL)
+		{
+			if (!ParseToggle(value, &options->softwareTracing))
+			{
+				printf("Expected on or off for --software-tracing, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--cpu-reference")) != NULL)
+		{
+			options->cpuReference = (uint32_t) strtoul(value, NULL, 10);
+		}
+		else if ((value = MatchOption(arg, "--cpu-benchmark")) != NULL)
+		{
+			options->cpuBenchmark = (uint32_t) strtoul(value, NULL, 10);
+		}
+		else if ((value = MatchOption(arg, "--cpu-validate")) != NULL)
+		{
+			options->cpuValidate = (uint32_t) strtoul(value, NULL, 10);
+		}
+		else if ((value = MatchOption(arg, "--cpu-packets")) != NULL)
+		{
+			if (!ParseToggle(value, &options->cpuPackets))
+			{
+				printf("Expected on or off for --cpu-packets, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--cpu-output")) != NULL)
+		{
+			options->cpuOutput = value;
+		}
+		else if ((value = MatchOption(arg, "--shader-recipes")) != NULL)
+		{
+			if (!ParseShaderRecipes(value, &options->shaderRecipes))
+			{
+				printf("Expected none or a comma separated list of strip, dce and fold for --shader-recipes, got '%s'\n", value);
+				return false;
+			}
+		}
+		else if ((value = MatchOption(arg, "--shader-report")) != NULL)
+		{
+			if (!ParseToggle(value, &options->shaderReport))
+			{
+				printf("Expected on or off for --shader-report, got '%s'\n", value);
+				return false;
+			}
+		}
+		else
+		{
+			printf("Unknown option '%s'\n", arg);
+			return false;
+		}
+	}
+	return true;
+}
+
+static const char* const s_StageNames[VK_PATH_TRACER_STAGE_COUNT] = { "megakernel", "sort", "generate", "extend", "shade", "shadow", "resolve", "blit" };
+
+static const char* const s_SERDefines[]      = { "USE_SER" };
+static const char* const s_SortDefines[]     = { "SORT_HITS" };
+static const char* const s_BindlessDefines[] = { "BINDLESS" };
+
+typedef struct AppShaderDesc
+{
+	const char*        filepath;
+	uint32_t           defineCount;
+	const char* const* defines;
+	AppRaygenVariant   variant;
+} AppShaderDesc;
+
+static const AppShaderDesc s_Shaders[] = {
+	{.filepath = "Shaders/shader.rgen", .defineCount = 0, .defines = NULL, .variant = APP_RAYGEN_VARIANT_PLAIN},
+	{ .filepath = "Shaders/shader.rmiss", .defineCount = 0, .defines = NULL, .variant = APP_RAYGEN_VARIANT_COUNT},
+	{ .filepath = "Shaders/shader.rchit", .defineCount = 1, .defines = s_BindlessDefines, .variant = APP_RAYGEN_VARIANT_COUNT},
+	{ .filepath = "Shaders/shader.rgen", .defineCount = 1, .defines = s_SERDefines, .variant = APP_RAYGEN_VARIANT_SER},
+	{ .filepath = "Shaders/shader.rgen", .defineCount = 1, .defines = s_SortDefines, .variant = APP_RAYGEN_VARIANT_SORTED},
+	{ .filepath = "Shaders/wavefront_extend.rgen", .defineCount = 0, .defines = NULL, .variant = APP_RAYGEN_VARIANT_COUNT},
+	{ .filepath = "Shaders/wavefront_shadow.rgen", .defineCount = 0, .defines = NULL, .variant = APP_RAYGEN_VARIANT_COUNT}
+};
+
+typedef struct AppSpecialization
+{
+	uint32_t maxBounces;
+	uint32_t samplesPerFrame;
+	VkBool32 reorder;
+} AppSpecialization;
+
+static const VkSpecializationMapEntry s_SpecializationEntries[] = {
+	{.constantID = 0, .offset = offsetof(AppSpecialization, maxBounces), .size = sizeof(uint32_t)},
+	{ .constantID = 1, .offset = offsetof(AppSpecialization, samplesPerFrame), .size = sizeof(uint32_t)},
+	{ .constantID = 2, .offset = offsetof(AppSpecialization, reorder), .size = sizeof(VkBool32)}
+};
+
+static const AppSpecialization s_ProductionSpecializations[] = {
+	{.maxBounces = 4, .samplesPerFrame = 1, .reorder = VK_TRUE},
+	{ .maxBounces = 8, .samplesPerFrame = 1, .reorder = VK_TRUE},
+	{ .maxBounces = 2, .samplesPerFrame = 4, .reorder = VK_TRUE}
+};
+
+typedef struct AppVariantStats
+{
+	uint64_t samples;
+	uint64_t rays;
+	double   time;
+} AppVariantStats;
+
+typedef struct AppBackendStats
+{
+	double   time;
+	uint64_t frames;
+} AppBackendStats;
+
 typedef struct AppData
 {
-	VkData*          vk;
-	WindowData*      window;
-	VkSwapchainData* vkSwapchain;
+	VkData*             vk;
+	VkSubmitThreadData* submitThread;
+	WindowData*         window;
+	VkSwapchainData*    vkSwapchain;
 
 	size_t       accStructCount;
 	VkAccStruct* accStructs;
+	AppGeometry  geometry;
 
 	size_t        shaderCount;
 	VkShaderData* shaders;
 
-	VkRayTracingPipelineData* rtPipeline;
+	VkShaderGroup              rtGroups[3];
+	VkPipelineVariantCacheData rtVariants;
+	VkRayTracingPipelineData*  rtPipeline;
+	VkShaderData*              wavefrontRaygens[2];
+	VkShaderGroup              wavefrontGroups[2][3];
+	VkRayTracingPipelineData*  wavefrontPipelines[2];
+	VkPathTracerData*          pathTracer;
+
+	VkShaderData*      raygenVariants[APP_RAYGEN_VARIANT_COUNT];
+	AppRaygenVariant   activeVariant;
+	AppRaygenVariant   pendingVariant;
+	VkPipelineVariant* pendingPipeline;
+	AppSpecialization  specialization;
+	uint32_t           preset;
+	AppVariantStats    variantStats[APP_RAYGEN_VARIANT_COUNT];
+	AppVariantStats    wavefrontStats;
+	AppVariantStats    softwareStats;
+	AppBackendStats    extendStats[VK_PATH_TRACER_BACKEND_COUNT];
+	AppBackendStats    shadowStats[VK_PATH_TRACER_BACKEND_COUNT];
+
+	SceneData* scene;
+	JobSystem* jobs;
+	JobSystem* recordJobs;
 } AppData;
 
+typedef struct AppStageTimings
+{
+	double   update;
+	double   stall;
+	double   overlap;
+	double   record;
+	double   passes;
+	uint32_t passCount;
+	uint32_t count;
+} AppStageTimings;
+
+typedef struct AppRecordJob
+{
+	VkData*           vk;
+	const SceneState* state;
+	VkSwapchainData*  swapchain;
+	VkPathTracerData* pathTracer;
+	uint32_t          tracePass;
+	uint32_t          passIndex;
+	double            time;
+	bool              succeeded;
+} AppRecordJob;
+
+static void RecordSwapchainPass(void* userData, uint32_t threadIndex)
+{
+	AppRecordJob*     job       = (AppRecordJob*) userData;
+	const SceneState* state     = job->state;
+	VkSwapchainData*  swapchain = job->swapchain;
+	double            start     = glfwGetTime();
+
+	VkCommandBuffer buffer = VkBeginFramePass(job->vk, threadIndex, job->passIndex);
+	if (!buffer)
+		return;
+
+	if (job->pathTracer && job->pathTracer->active)
+	{
+		VkCmdPathTracePass(buffer, job->pathTracer, swapchain, job->tracePass);
+		job->succeeded = VkEndFramePass(job->vk, job->passIndex, buffer);
+		job->time      = glfwGetTime() - start;
+		return;
+	}
+
+	VkRenderingAttachmentInfo colorAttachment = {
+		.sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+		.pNext              = NULL,
+		.imageView          = swapchain->views[swapchain->imageIndex],
+		.imageLayout        = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		.resolveMode        = VK_RESOLVE_MODE_NONE,
+		.resolveImageView   = NULL,
+		.resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.loadOp             = VK_ATTACHMENT_LOAD_OP_CLEAR,
+		.storeOp            = VK_ATTACHMENT_STORE_OP_STORE,
+		.clearValue.color   = {state->background[0], state->background[1], state->background[2], state->background[3]}
+	};
+	VkRenderingInfo renderingInfo = {
+		.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO,
+		.pNext                = NULL,
+		.flags                = 0,
+		.renderArea.offset    = {0, 0},
+		.renderArea.extent    = swapchain->extent,
+		.layerCount           = 1,
+		.viewMask             = 0,
+		.colorAttachmentCount = 1,
+		.pColorAttachments    = &colorAttachment,
+		.pDepthAttachment     = NULL,
+		.pStencilAttachment   = NULL
+	};
+	vkCmdBeginRendering(buffer, &renderingInfo);
+
+	vkCmdEndRendering(buffer);
+
+	job->succeeded = VkEndFramePass(job->vk, job->passIndex, buffer);
+	job->time      = glfwGetTime() - start;
+}
+
+static void AppReportPipelineBuild(VkRayTracingPipelineData* rtPipeline, bool relinked)
+{
+	if (relinked)
+		printf("Relinked %u libraries in %8.3f ms (full build %8.3f ms)\n", rtPipeline->relinkedLibraries, rtPipeline->relinkTime * 1000.0, rtPipeline->fullBuildTime * 1000.0);
+	else
+		printf("Built pipeline%s in %8.3f ms\n", rtPipeline->libraries ? " from libraries" : "", rtPipeline->fullBuildTime * 1000.0);
+
+	VkPipelineCacheStoreData* store = &rtPipeline->vk->pipelineCacheStore;
+	printf("Pipeline cache (%s, %zu bytes loaded): %llu/%llu pipeline hits, %llu/%llu stage hits, %8.3f ms creating\n",
+		   store->loadedSize > 0 ? "warm" : "cold",
+		   store->loadedSize,
+		   (unsigned long long) AtomicLoad64(&store->pipelineHits),
+		   (unsigned long long) AtomicLoad64(&store->pipelineCount),
+		   (unsigned long long) AtomicLoad64(&store->stageHits),
+		   (unsigned long long) AtomicLoad64(&store->stageCount),
+		   AtomicLoad64(&store->creationNanoseconds) * 1e-6);
+}
+
+static void AppReportShaderRecipes(const VkShaderData* shader)
+{
+	if (!shader->vk || !shader->handle)
+		return;
+
+	printf("%s", shader->filepath.buf);
+	for (uint32_t i = 0; i < shader->defineCount; ++i)
+		printf(" -D%s", shader->defines[i]);
+	if (!shader->compiled)
+	{
+		printf(": cached\n");
+		return;
+	}
+	printf("\n");
+	for (uint32_t i = 0; i < SHADERC_RECIPE_COUNT; ++i)
+	{
+		const VkShaderRecipeStats* stats = shader->recipeStats + i;
+		if (!stats->applied)
+			continue;
+		printf("  %-5s %7zu -> %7zu bytes (%+6.1f%%), module creation %8.3f -> %8.3f us, optimized in %8.3f ms\n",
+			   ShaderCRecipeName((ShaderCRecipe) i),
+			   stats->sizeBefore,
+			   stats->sizeAfter,
+			   stats->sizeBefore > 0 ? (stats->sizeAfter * 100.0 / stats->sizeBefore - 100.0) : 0.0,
+			   stats->createBefore * 1e6,
+			   stats->createAfter * 1e6,
+			   stats->optimizeTime * 1000.0);
+	}
+}
+
+static void AppReportShaderCompiler(AppData* appData)
+{
+	VkShaderCompilerData* compiler = &appData->vk->shaderCompiler;
+	double                work     = AtomicLoad64(&compiler->compileNanoseconds) * 1e-6;
+	double                wall     = compiler->batchTime * 1000.0;
+	printf("Shaders: %llu compiled, %llu cached, %llu failed on %u threads in %8.3f ms (%8.3f ms of compile work, %5.2fx)\n",
+		   (unsigned long long) AtomicLoad64(&compiler->compiled),
+		   (unsigned long long) AtomicLoad64(&compiler->cached),
+		   (unsigned long long) AtomicLoad64(&compiler->failed),
+		   JobSystemThreadCount(compiler->jobs),
+		   wall,
+		   work,
+		   wall > 0.0 ? work / wall : 0.0);
+
+	VkShaderCacheData* cache = &appData->vk->shaderCache;
+	printf("Shader cache %s: %u entries, %zu bytes loaded, %zu bytes saved, %u compactions, %u corrupt entries\n",
+		   cache->filepath,
+		   cache->entryCount,
+		   cache->loadedSize,
+		   cache->savedSize,
+		   cache->compactions,
+		   cache->corruptEntries);
+	printf("Shader pack %s: %u entries loaded in %8.3f ms, %llu precompiled, %llu stale%s\n",
+		   compiler->packFilepath,
+		   compiler->pack.entryCount,
+		   compiler->packLoadTime * 1000.0,
+		   (unsigned long long) AtomicLoad64(&compiler->precompiled),
+		   (unsigned long long) AtomicLoad64(&compiler->stale),
+		   compiler->pack.rejected ? ", discarded a corrupt pack" : "");
+
+	if (!appData->vk->shaderCompiler.report)
+		return;
+	for (size_t i = 0; i < appData->shaderCount; ++i)
+		AppReportShaderRecipes(appData->shaders + i);
+	VkPathTracerData*   pathTracer = appData->pathTracer;
+	const VkShaderData* shaders[]  = { &pathTracer->sortShader, &pathTracer->wavefrontShader, &pathTracer->queryShader, &pathTracer->bvhShader };
+	for (uint32_t i = 0; i < sizeof(shaders) / sizeof(*shaders); ++i)
+		AppReportShaderRecipes(shaders[i]);
+}
+
+static void AppReportLayouts(AppData* appData)
+{
+	VkLayoutCacheData* cache = &appData->vk->layoutCache;
+	printf("Layout cache: %u descriptor set layouts, %u pipeline layouts, %llu created, %llu requests shared\n",
+		   cache->setLayoutCount,
+		   cache->layoutCount,
+		   (unsigned long long) cache->misses,
+		   (unsigned long long) cache->hits);
+}
+
+static void AppReportStartup(double startupTime)
+{
+	FSPath   executable = FSExecutablePath();
+	uint64_t size       = FSFileSize(&executable);
+	FSDestroyPath(&executable);
+	printf("Startup took %8.3f ms %s shaderc, executable is %llu bytes\n", startupTime * 1000.0, ShaderCAvailable() ? "with" : "without", (unsigned long long) size);
+}
+
+static const char* AppTracerName(AppData* appData)
+{
+	if (appData->pathTracer->software)
+		return "software";
+	if (appData->pathTracer->wavefront)
+		return PathTracerModeName(VK_PATH_TRACER_MODE_WAVEFRONT);
+	return RaygenVariantName(appData->activeVariant);
+}
+
+static AppVariantStats* AppTracerStats(AppData* appData)
+{
+	if (appData->pathTracer->software)
+		return &appData->softwareStats;
+	if (appData->pathTracer->wavefront)
+		return &appData->wavefrontStats;
+	return appData->variantStats + appData->activeVariant;
+}
+
+static void AppReportPipelineSetup(VkRayTracingPipelineData* rtPipeline)
+{
+	if (VkRayTracingPipelineBuilding(rtPipeline))
+		printf("Building pipeline in the background\n");
+	else
+		AppReportPipelineBuild(rtPipeline, false);
+}
+
+static VkPipelineVariant* AppGetVariant(AppData* appData, AppRaygenVariant variant, const AppSpecialization* specialization)
+{
+	AppSpecialization key = *specialization;
+	key.reorder           = variant == APP_RAYGEN_VARIANT_SER && specialization->reorder;
+	return VkGetPipelineVariant(&appData->rtVariants, appData->raygenVariants[variant], &key);
+}
+
+static void AppApplyVariant(AppData* appData)
+{
+	VkPipelineVariant*       variant        = appData->pendingPipeline;
+	const AppSpecialization* specialization = (const AppSpecialization*) variant->data;
+	appData->pendingPipeline                = NULL;
+	if (!variant->pipeline->handle)
+	{
+		printf("Failed to build %s raygen variant, keeping the previous one\n", RaygenVariantName(appData->pendingVariant));
+		appData->pendingVariant = appData->activeVariant;
+		return;
+	}
+
+	appData->activeVariant               = appData->pendingVariant;
+	appData->rtPipeline                  = variant->pipeline;
+	appData->pathTracer->rtPipeline      = variant->pipeline;
+	appData->pathTracer->sortHits        = appData->activeVariant == APP_RAYGEN_VARIANT_SORTED;
+	appData->pathTracer->maxBounces      = specialization->maxBounces;
+	appData->pathTracer->samplesPerFrame = specialization->samplesPerFrame;
+	printf("Raygen variant: %s, %u bounces, %u samples per frame%s\n", RaygenVariantName(appData->activeVariant), specialization->maxBounces, specialization->samplesPerFrame, specialization->reorder ? ", reordered" : "");
+}
+
+static void AppSelectVariant(AppData* appData, AppRaygenVariant variant, const AppSpecialization* specialization)
+{
+	if (appData->pendingPipeline)
+		return;
+
+	uint64_t           misses          = appData->rtVariants.misses;
+	VkPipelineVariant* pipelineVariant = AppGetVariant(appData, variant, specialization);
+	if (!pipelineVariant || pipelineVariant->pipeline == appData->rtPipeline)
+		return;
+	if (appData->rtVariants.misses != misses)
+		AppReportPipelineSetup(pipelineVariant->pipeline);
+	else if (!pipelineVariant->pipeline->handle && !VkRayTracingPipelineBuilding(pipelineVariant->pipeline) && !VkRebuildRayTracingPipeline(pipelineVariant->pipeline, NULL))
+		return;
+
+	appData->pendingVariant  = variant;
+	appData->pendingPipeline = pipelineVariant;
+	if (!VkRayTracingPipelineBuilding(pipelineVariant->pipeline))
+		AppApplyVariant(appData);
+}
+
+static void AppPrewarmVariants(AppData* appData, const AppOptions* options)
+{
+	uint32_t created   = appData->rtVariants.variantCount;
+	uint64_t hits      = appData->rtVariants.hits;
+	uint32_t requested = 0;
+	for (uint32_t i = 0; i < APP_RAYGEN_VARIANT_COUNT; ++i)
+	{
+		if (!appData->raygenVariants[i])
+			continue;
+		for (uint32_t j = 0; j < sizeof(s_ProductionSpecializations) / sizeof(*s_ProductionSpecializations); ++j)
+		{
+			AppSpecialization specialization = s_ProductionSpecializations[j];
+			specialization.reorder           = options->reorder;
+			AppGetVariant(appData, (AppRaygenVariant) i, &specialization);
+			++requested;
+		}
+	}
+	printf("Prewarming %u pipeline variants, %u created, %llu deduplicated\n",
+		   requested,
+		   appData->rtVariants.variantCount - created,
+		   (unsigned long long) (appData->rtVariants.hits - hits));
+}
+
+static bool AppPipelineUsesShader(const VkRayTracingPipelineData* rtPipeline, const VkShaderData* shader)
+{
+	for (uint32_t i = 0; i < rtPipeline->groupCount; ++i)
+	{
+		const VkShaderGroup* group = rtPipeline->groups + i;
+		if (group->general == shader || group->closestHit == shader || group->anyHit == shader || group->intersection == shader)
+			return true;
+	}
+	return false;
+}
+
+static bool AppPipelinesBuilding(AppData* appData)
+{
+	return VkPipelineVariantsBuilding(&appData->rtVariants) ||
+		   VkRayTracingPipelineBuilding(appData->wavefrontPipelines[0]) ||
+		   VkRayTracingPipelineBuilding(appData->wavefrontPipelines[1]);
+}
+
+static void AppRebuildPipeline(VkRayTracingPipelineData* rtPipeline, const VkShaderData* const* changed, uint32_t changedCount)
+{
+	if (!rtPipeline)
+		return;
+
+	const VkShaderData* shader = NULL;
+	uint32_t            uses   = 0;
+	for (uint32_t i = 0; i < changedCount; ++i)
+	{
+		if (!AppPipelineUsesShader(rtPipeline, changed[i]))
+			continue;
+		shader = changed[i];
+		++uses;
+	}
+	if (uses == 0)
+		return;
+	if (VkRebuildRayTracingPipeline(rtPipeline, uses == 1 ? shader : NULL) && !VkRayTracingPipelineBuilding(rtPipeline))
+		AppReportPipelineBuild(rtPipeline, uses == 1 && rtPipeline->libraries != NULL);
+}
+
+static void AppSetupGroups(AppData* appData, VkShaderGroup* groups, VkShaderData* raygen)
+{
+	groups[0] = (VkShaderGroup) {
+		.kind         = VK_SHADER_GROUP_KIND_RAYGEN,
+		.general      = raygen,
+		.closestHit   = NULL,
+		.anyHit       = NULL,
+		.intersection = NULL,
+		.data         = NULL,
+		.dataSize     = 0
+	};
+	groups[1] = (VkShaderGroup) {
+		.kind         = VK_SHADER_GROUP_KIND_MISS,
+		.general      = appData->shaders + 1,
+		.closestHit   = NULL,
+		.anyHit       = NULL,
+		.intersection = NULL,
+		.data         = NULL,
+		.dataSize     = 0
+	};
+	groups[2] = (VkShaderGroup) {
+		.kind         = VK_SHADER_GROUP_KIND_HIT,
+		.general      = NULL,
+		.closestHit   = appData->shaders + 2,
+		.anyHit       = NULL,
+		.intersection = NULL,
+		.data         = appData->geometry.references,
+		.dataSize     = sizeof(appData->geometry.references)
+	};
+}
+
+static void AppInitPipeline(AppData* appData, const AppOptions* options, VkRayTracingPipelineData* rtPipeline, const VkShaderGroup* groups, VkShaderData* const* layoutShaders, uint32_t layoutShaderCount)
+{
+	rtPipeline->vk                  = appData->vk;
+	rtPipeline->groupCount          = 3;
+	rtPipeline->groups              = groups;
+	rtPipeline->layoutShaderCount   = layoutShaderCount;
+	rtPipeline->layoutShaders       = layoutShaders;
+	rtPipeline->maxRecursionDepth   = 1;
+	rtPipeline->maxPayloadSize      = 12 * sizeof(float);
+	rtPipeline->maxHitAttributeSize = 2 * sizeof(float);
+	rtPipeline->specialization      = NULL;
+	rtPipeline->useLibraries        = options->pipelineLibraries;
+	rtPipeline->jobs                = options->asyncPipelines ? appData->jobs : NULL;
+}
+
+static VkRayTracingPipelineData* AppCreatePipeline(AppData* appData, const AppOptions* options, const VkShaderGroup* groups, VkShaderData* const* layoutShaders, uint32_t layoutShaderCount)
+{
+	VkRayTracingPipelineData* rtPipeline = (VkRayTracingPipelineData*) calloc(1, sizeof(VkRayTracingPipelineData));
+	if (!rtPipeline)
+		return NULL;
+	AppInitPipeline(appData, options, rtPipeline, groups, layoutShaders, layoutShaderCount);
+	if (!VkSetupRayTracingPipeline(rtPipeline))
+	{
+		free(rtPipeline);
+		return NULL;
+	}
+	AppReportPipelineSetup(rtPipeline);
+	return rtPipeline;
+}
+
+static void AppReportVariants(AppData* appData)
+{
+	if (appData->rtVariants.variantCount > 0)
+		printf("Pipeline variants: %u created, %llu requests deduplicated\n", appData->rtVariants.variantCount, (unsigned long long) appData->rtVariants.hits);
+
+	const AppVariantStats* plain     = appData->variantStats + APP_RAYGEN_VARIANT_PLAIN;
+	double                 plainRate = plain->time > 0.0 ? plain->samples / plain->time : 0.0;
+	for (uint32_t i = 0; i < APP_RAYGEN_VARIANT_COUNT; ++i)
+	{
+		const AppVariantStats* stats = appData->variantStats + i;
+		if (stats->time <= 0.0)
+			continue;
+		double rate = stats->samples / stats->time;
+		printf("%10s raygen %8.3f Msamples/s %8.3f Mrays/s over %8.3f s", RaygenVariantName((AppRaygenVariant) i), rate * 1e-6, stats->rays * 1e-6 / stats->time, stats->time);
+		if (plainRate > 0.0)
+			printf(" %6.3fx vs plain", rate / plainRate);
+		printf("\n");
+	}
+	const AppVariantStats* modes[]     = { &appData->wavefrontStats, &appData->softwareStats };
+	const char*            modeNames[] = { PathTracerModeName(VK_PATH_TRACER_MODE_WAVEFRONT), "software" };
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		const AppVariantStats* stats = modes[i];
+		if (stats->time <= 0.0)
+			continue;
+		double rate = stats->samples / stats->time;
+		printf("%10s mode   %8.3f Msamples/s %8.3f Mrays/s over %8.3f s", modeNames[i], rate * 1e-6, stats->rays * 1e-6 / stats->time, stats->time);
+		if (plainRate > 0.0)
+			printf(" %6.3fx vs plain", rate / plainRate);
+		printf("\n");
+	}
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		const AppBackendStats* stats    = i == 0 ? appData->extendStats : appData->shadowStats;
+		const AppBackendStats* pipeline = stats + VK_PATH_TRACER_BACKEND_PIPELINE;
+		const AppBackendStats* query    = stats + VK_PATH_TRACER_BACKEND_QUERY;
+		if (pipeline->frames == 0 || query->frames == 0)
+			continue;
+		double pipelineTime = pipeline->time * 1000.0 / pipeline->frames;
+		double queryTime    = query->time * 1000.0 / query->frames;
+		printf("%10s %8.3f ms pipeline %8.3f ms query %6.3fx inline vs pipeline\n", s_StageNames[i == 0 ? VK_PATH_TRACER_STAGE_EXTEND : VK_PATH_TRACER_STAGE_SHADOW], pipelineTime, queryTime, queryTime > 0.0 ? pipelineTime / queryTime : 0.0);
+	}
+}
+
+static void AppReportPathTracer(AppData* appData)
+{
+	VkPathTracerData* pathTracer = appData->pathTracer;
+	if (pathTracer->timedFrames > 0)
+	{
+		VkPathTracerBackend extendBackend = pathTracer->queryExtend ? VK_PATH_TRACER_BACKEND_QUERY : VK_PATH_TRACER_BACKEND_PIPELINE;
+		VkPathTracerBackend shadowBackend = pathTracer->queryShadow ? VK_PATH_TRACER_BACKEND_QUERY : VK_PATH_TRACER_BACKEND_PIPELINE;
+		printf("%10s", "stages");
+		for (uint32_t i = 0; i < VK_PATH_TRACER_STAGE_COUNT; ++i)
+		{
+			if (pathTracer->stageTimes[i] <= 0.0)
+				continue;
+			printf(" %8.3f ms %s", pathTracer->stageTimes[i] * 1000.0 / pathTracer->timedFrames, s_StageNames[i]);
+			if (i == VK_PATH_TRACER_STAGE_EXTEND)
+				printf(" (%s)", PathTracerBackendName(extendBackend));
+			else if (i == VK_PATH_TRACER_STAGE_SHADOW)
+				printf(" (%s)", PathTracerBackendName(shadowBackend));
+		}
+		printf("\n");
+		if (pathTracer->wavefront)
+		{
+			appData->extendStats[extendBackend].time   += pathTracer->stageTimes[VK_PATH_TRACER_STAGE_EXTEND];
+			appData->extendStats[extendBackend].frames += pathTracer->timedFrames;
+			appData->shadowStats[shadowBackend].time   += pathTracer->stageTimes[VK_PATH_TRACER_STAGE_SHADOW];
+			appData->shadowStats[shadowBackend].frames += pathTracer->timedFrames;
+		}
+	}
+	if (pathTracer->queuePixels > 0)
+	{
+		uint64_t hits = 0;
+		for (uint32_t i = 0; i < VK_PATH_TRACER_MATERIALS; ++i)
+			hits += pathTracer->queueHits[i];
+		printf("%10s rays", "queues");
+		for (uint32_t i = 0; i <= pathTracer->maxBounces; ++i)
+			printf(" %5.1f%%", pathTracer->queueRays[i] * 100.0 / pathTracer->queuePixels);
+		printf(" shadows");
+		for (uint32_t i = 0; i <= pathTracer->maxBounces; ++i)
+			printf(" %5.1f%%", pathTracer->queueShadows[i] * 100.0 / pathTracer->queuePixels);
+		printf(" bins");
+		for (uint32_t i = 0; i < VK_PATH_TRACER_MATERIALS; ++i)
+			printf(" %5.1f%%", hits > 0 ? pathTracer->queueHits[i] * 100.0 / hits : 0.0);
+		printf("\n");
+	}
+	VkResetPathTracerStats(pathTracer);
+}
+
+static float AppKeyAxis(WindowData* window, int positive, int negative)
+{
+	return (float) WLRTWindowKeyDown(window, positive) - (float) WLRTWindowKeyDown(window, negative);
+}
+
+static void AppReadInput(WindowData* window, SceneInput* input)
+{
+	input->move[0] = AppKeyAxis(window, GLFW_KEY_D, GLFW_KEY_A);
+	input->move[1] = AppKeyAxis(window, GLFW_KEY_SPACE, GLFW_KEY_LEFT_SHIFT);
+	input->move[2] = AppKeyAxis(window, GLFW_KEY_W, GLFW_KEY_S);
+	input->turn[0] = AppKeyAxis(window, GLFW_KEY_RIGHT, GLFW_KEY_LEFT);
+	input->turn[1] = AppKeyAxis(window, GLFW_KEY_UP, GLFW_KEY_DOWN);
+}
+
 static void AppOnExit(void* data)
 {
 	AppData* appData = (AppData*) data;
+	SceneCleanup(appData->scene);
+	free(appData->scene);
+	JobSystemCleanup(appData->jobs);
+	free(appData->jobs);
+	VkCleanupSubmitThread(appData->submitThread);
+	free(appData->submitThread);
 	if (appData->vk)
 		vkDeviceWaitIdle(appData->vk->device);
 
-	VkCleanupRayTracingPipeline(appData->rtPipeline);
-	free(appData->rtPipeline);
+	VkCleanupPathTracer(appData->pathTracer);
+	free(appData->pathTracer);
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		VkCleanupRayTracingPipeline(appData->wavefrontPipelines[i]);
+		free(appData->wavefrontPipelines[i]);
+	}
+	VkCleanupPipelineVariants(&appData->rtVariants);
 	if (appData->shaders)
 	{
 		for (size_t i = 0; i < appData->shaderCount; ++i)
@@ -269,6 +1294,7 @@ static void AppOnExit(void* data)
 			VkCleanupAccStruct(appData->accStructs + i);
 		free(appData->accStructs);
 	}
+	CleanupGeometry(appData->vk, &appData->geometry);
 	VkCleanupSwapchain(appData->vkSwapchain);
 	free(appData->vkSwapchain);
 	WLRTDestroyWindow(appData->window);
@@ -278,10 +1304,216 @@ static void AppOnExit(void* data)
 	free(appData);
 }
 
+static void AppSetupRayTracing(AppData* appData, const AppOptions* options)
+{
+	appData->shaderCount = sizeof(s_Shaders) / sizeof(*s_Shaders);
+	appData->shaders     = (VkShaderData*) calloc(appData->shaderCount, sizeof(VkShaderData));
+	ExitAssert(appData->shaders != NULL, 1);
+
+	VkShaderData* shaders[sizeof(s_Shaders) / sizeof(*s_Shaders)];
+	const char*   filepaths[sizeof(s_Shaders) / sizeof(*s_Shaders)];
+	for (size_t i = 0; i < appData->shaderCount; ++i)
+	{
+		const AppShaderDesc* desc = s_Shaders + i;
+		bool                 used = desc->variant != APP_RAYGEN_VARIANT_SER || appData->vk->invocationReorderSupported;
+		shaders[i]                = appData->shaders + i;
+		filepaths[i]              = used ? desc->filepath : NULL;
+		shaders[i]->vk            = appData->vk;
+		shaders[i]->defineCount   = desc->defines != s_BindlessDefines || appData->vk->bindlessSupported ? desc->defineCount : 0;
+		shaders[i]->defines       = desc->defines;
+		if (used && desc->variant != APP_RAYGEN_VARIANT_COUNT)
+			appData->raygenVariants[desc->variant] = appData->shaders + i;
+	}
+	ExitAssert(VkSetupShaders(appData->vk, shaders, filepaths, (uint32_t) appData->shaderCount), 1);
+
+	AppRaygenVariant variant = options->raygenVariant;
+	if (variant == APP_RAYGEN_VARIANT_SER && !appData->raygenVariants[variant])
+		printf("Shader execution reordering is not supported, falling back to hit sorting\n");
+	if (variant == APP_RAYGEN_VARIANT_AUTO || !appData->raygenVariants[variant])
+		variant = appData->raygenVariants[APP_RAYGEN_VARIANT_SER] ? APP_RAYGEN_VARIANT_SER : APP_RAYGEN_VARIANT_SORTED;
+	appData->activeVariant  = variant;
+	appData->pendingVariant = variant;
+
+	AppSetupGroups(appData, appData->rtGroups, appData->raygenVariants[variant]);
+	AppInitPipeline(appData, options, &appData->rtVariants.base, appData->rtGroups, appData->raygenVariants, APP_RAYGEN_VARIANT_COUNT);
+	appData->rtVariants.mapEntryCount = sizeof(s_SpecializationEntries) / sizeof(*s_SpecializationEntries);
+	appData->rtVariants.mapEntries    = s_SpecializationEntries;
+	appData->rtVariants.dataSize      = sizeof(AppSpecialization);
+	ExitAssert(VkSetupPipelineVariants(&appData->rtVariants), 1);
+
+	appData->specialization = (AppSpecialization) {
+		.maxBounces      = options->maxBounces < VK_PATH_TRACER_MAX_BOUNCES ? options->maxBounces : VK_PATH_TRACER_MAX_BOUNCES,
+		.samplesPerFrame = options->samplesPerFrame,
+		.reorder         = options->reorder
+	};
+	appData->pendingPipeline = AppGetVariant(appData, variant, &appData->specialization);
+	ExitAssert(appData->pendingPipeline != NULL, 1);
+	appData->rtPipeline = appData->pendingPipeline->pipeline;
+	AppReportPipelineSetup(appData->rtPipeline);
+	if (options->prewarm)
+		AppPrewarmVariants(appData, options);
+	appData->wavefrontRaygens[0] = appData->shaders + 5;
+	appData->wavefrontRaygens[1] = appData->shaders + 6;
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		AppSetupGroups(appData, appData->wavefrontGroups[i], appData->wavefrontRaygens[i]);
+		appData->wavefrontPipelines[i] = AppCreatePipeline(appData, options, appData->wavefrontGroups[i], appData->wavefrontRaygens, 2);
+		ExitAssert(appData->wavefrontPipelines[i] != NULL, 1);
+	}
+}
+
+static bool AppBuildCpuBvh(BvhData* bvh, JobSystem* jobs)
+{
+	BvhTriangle triangles[sizeof(s_Indices) / sizeof(*s_Indices) / 3];
+	for (uint32_t i = 0; i < sizeof(triangles) / sizeof(*triangles); ++i)
+	{
+		float positions[3][3];
+		for (uint32_t j = 0; j < 3; ++j)
+		{
+			const AppVertex* vertex = s_Vertices + s_Indices[i * 3 + j];
+			positions[j][0]         = vertex->x;
+			positions[j][1]         = vertex->y;
+			positions[j][2]         = vertex->z;
+		}
+		BvhTriangle* triangle = triangles + i;
+		for (uint32_t j = 0; j < 3; ++j)
+		{
+			triangle->v0[j] = positions[0][j];
+			triangle->e1[j] = positions[1][j] - positions[0][j];
+			triangle->e2[j] = positions[2][j] - positions[0][j];
+		}
+		triangle->primitive = i;
+		triangle->geometry  = 0;
+		triangle->pad       = 0;
+	}
+	return BvhBuild(bvh, triangles, sizeof(triangles) / sizeof(*triangles), jobs);
+}
+
+static bool AppRunCpuTracerPass(const AppOptions* options, const SceneState* state, JobSystem* jobs, bool packets, uint32_t samples, CpuTracerData* tracer, double* buildTime, uint32_t* mismatches)
+{
+	BvhData bvh;
+	memset(&bvh, 0, sizeof(bvh));
+	double start = CpuTracerTime();
+	if (!AppBuildCpuBvh(&bvh, jobs))
+		return false;
+	*buildTime         = CpuTracerTime() - start;
+	tracer->jobs       = jobs;
+	tracer->bvh        = &bvh;
+	tracer->width      = 1280;
+	tracer->height     = 720;
+	tracer->maxBounces = options->maxBounces;
+	tracer->packets    = packets;
+	if (!CpuTracerSetup(tracer))
+	{
+		BvhCleanup(&bvh);
+		return false;
+	}
+	for (uint32_t i = 0; i < samples; ++i)
+		CpuTracerRender(tracer, &state->camera, state->background);
+	if (mismatches)
+		*mismatches = CpuTracerValidatePackets(tracer, options->cpuValidate);
+	tracer->bvh = NULL;
+	BvhCleanup(&bvh);
+	return true;
+}
+
+static double AppCpuTracerMrays(const CpuTracerData* tracer)
+{
+	return tracer->traceTime > 0.0 ? tracer->raysTraced * 1e-6 / tracer->traceTime : 0.0;
+}
+
+static bool AppBenchmarkCpuTracer(const AppOptions* options, const SceneState* state)
+{
+	uint32_t concurrency = ThreadHardwareConcurrency();
+	for (uint32_t threads = 1;; threads = threads * 2 < concurrency ? threads * 2 : concurrency)
+	{
+		JobSystem jobs;
+		memset(&jobs, 0, sizeof(jobs));
+		jobs.workerCount = threads - 1;
+		if (threads > 1 && !JobSystemSetup(&jobs))
+			return false;
+
+		CpuTracerData packets;
+		CpuTracerData single;
+		double        buildTime = 0.0;
+		memset(&packets, 0, sizeof(packets));
+		memset(&single, 0, sizeof(single));
+		bool ran = AppRunCpuTracerPass(options, state, threads > 1 ? &jobs : NULL, true, options->cpuBenchmark, &packets, &buildTime, NULL) &&
+				   AppRunCpuTracerPass(options, state, threads > 1 ? &jobs : NULL, false, options->cpuBenchmark, &single, &buildTime, NULL);
+		if (ran)
+			printf("%3u threads %8.3f ms build %8.3f Mrays/s packets %8.3f Mrays/s single %8.3f Mrays/s per thread\n", threads, buildTime * 1000.0, AppCpuTracerMrays(&packets), AppCpuTracerMrays(&single), AppCpuTracerMrays(&packets) / threads);
+		CpuTracerCleanup(&packets);
+		CpuTracerCleanup(&single);
+		if (threads > 1)
+			JobSystemCleanup(&jobs);
+		if (!ran)
+			return false;
+		if (threads >= concurrency)
+			return true;
+	}
+}
+
+static bool AppRenderCpuReference(const AppOptions* options, const SceneState* state)
+{
+	JobSystem jobs;
+	memset(&jobs, 0, sizeof(jobs));
+	if (!JobSystemSetup(&jobs))
+		return false;
+
+	CpuTracerData tracer;
+	double        buildTime = 0.0;
+	memset(&tracer, 0, sizeof(tracer));
+	bool ran   = AppRunCpuTracerPass(options, state, &jobs, options->cpuPackets, options->cpuReference, &tracer, &buildTime, NULL);
+	bool wrote = ran && CpuTracerWriteImage(&tracer, options->cpuOutput);
+	if (ran)
+		printf("Rendered %u spp reference in %8.3f s at %8.3f Mrays/s on %u threads, BVH built in %8.3f ms\n", tracer.sampleCount, tracer.traceTime, AppCpuTracerMrays(&tracer), JobSystemThreadCount(&jobs), buildTime * 1000.0);
+	if (wrote)
+		printf("Wrote reference image to %s\n", options->cpuOutput);
+	else
+		printf("Failed to render reference image to %s\n", options->cpuOutput);
+	CpuTracerCleanup(&tracer);
+	JobSystemCleanup(&jobs);
+	return wrote;
+}
+
+static bool AppValidateCpuTracer(const AppOptions* options, const SceneState* state)
+{
+	CpuTracerData tracer;
+	double        buildTime  = 0.0;
+	uint32_t      mismatches = 0;
+	memset(&tracer, 0, sizeof(tracer));
+	bool ran = AppRunCpuTracerPass(options, state, NULL, true, 1, &tracer, &buildTime, &mismatches);
+	if (ran)
+		printf("Validated %u packets against single rays with partially active lanes, %u mismatched lanes\n", options->cpuValidate, mismatches);
+	CpuTracerCleanup(&tracer);
+	return ran && mismatches == 0;
+}
+
+static int AppRunCpuTracer(const AppOptions* options)
+{
+	SceneData scene;
+	memset(&scene, 0, sizeof(scene));
+	scene.pipelined = false;
+	if (!SceneSetup(&scene))
+		return 1;
+
+	const SceneState* state = SceneAcquireState(&scene);
+	printf("CPU tracer: %s %u wide, %u hardware threads, %u bounces\n", CpuTracerSimdName(), CpuTracerSimdWidth(), ThreadHardwareConcurrency(), options->maxBounces);
+	bool succeeded = (options->cpuValidate == 0 || AppValidateCpuTracer(options, state)) &&
+					 (options->cpuBenchmark == 0 || AppBenchmarkCpuTracer(options, state)) &&
+					 (options->cpuReference == 0 || AppRenderCpuReference(options, state));
+	SceneCleanup(&scene);
+	return succeeded ? 0 : 1;
+}
+
 int main(int argc, char** argv)
 {
-	(void) argc;
-	(void) argv;
+	AppOptions options;
+	if (!ParseOptions(&options, argc, argv))
+		return 1;
+	if (options.cpuReference > 0 || options.cpuBenchmark > 0 || options.cpuValidate > 0)
+		return AppRunCpuTracer(&options);
+
 	ExitAssert(ExitSetup(), 1);
 	ExitAssert(FWSetup(), 1);
 	ExitRegister(&FWOnExit, NULL);
@@ -289,17 +1521,37 @@ int main(int argc, char** argv)
 	glfwSetErrorCallback(&GLFWErrCB);
 	ExitAssert(glfwInit(), 1);
 	ExitRegister(&GLFWOnExit, NULL);
+	double startupStart = glfwGetTime();
 
 	AppData* appData = (AppData*) calloc(1, sizeof(AppData));
 	ExitAssert(appData != NULL, 1);
 	ExitRegister(&AppOnExit, appData);
 
+	if (options.recordThreads != 1 || options.asyncPipelines)
+	{
+		appData->jobs = (JobSystem*) calloc(1, sizeof(JobSystem));
+		ExitAssert(appData->jobs != NULL, 1);
+		appData->jobs->workerCount = options.recordThreads > 1 ? options.recordThreads - 1 : 0;
+		ExitAssert(JobSystemSetup(appData->jobs), 1);
+	}
+	appData->recordJobs = options.recordThreads != 1 ? appData->jobs : NULL;
+
 	appData->vk = (VkData*) calloc(1, sizeof(VkData));
 	ExitAssert(appData->vk != NULL, 1);
-	appData->vk->framesInFlight = 2;
-	appData->vk->errorCallback  = &VKErrCB;
+	appData->vk->recordThreadCount      = JobSystemThreadCount(appData->recordJobs);
+	appData->vk->framesInFlight         = options.framesInFlight;
+	appData->vk->pacing.targetFrameTime = options.targetFrameTime;
+	appData->vk->errorCallback          = &VKErrCB;
+	appData->vk->forceSoftwareTracing   = options.softwareTracing;
+	appData->vk->shaderCompiler.jobs    = appData->jobs;
+	appData->vk->shaderCompiler.recipes = options.shaderRecipes;
+	appData->vk->shaderCompiler.report  = options.shaderReport;
 	ExitAssert(VkSetup(appData->vk), 1);
 	VkLoadFuncs(appData->vk->instance, appData->vk->device);
+	if (appData->vk->pipelineCacheStore.rejected)
+		printf("Discarded %s, it is corrupt or was written by a different device or driver\n", appData->vk->pipelineCacheStore.filepath);
+	if (appData->vk->shaderCache.rejected)
+		printf("Discarded %s, it is corrupt or was written by a different version\n", appData->vk->shaderCache.filepath);
 
 	appData->window = (WindowData*) calloc(1, sizeof(WindowData));
 	ExitAssert(appData->window != NULL, 1);
@@ -311,8 +1563,10 @@ int main(int argc, char** argv)
 
 	appData->vkSwapchain = (VkSwapchainData*) calloc(1, sizeof(VkSwapchainData));
 	ExitAssert(appData->vkSwapchain != NULL, 1);
-	appData->vkSwapchain->vk     = appData->vk;
-	appData->vkSwapchain->window = appData->window;
+	appData->vkSwapchain->vk                   = appData->vk;
+	appData->vkSwapchain->window               = appData->window;
+	appData->vkSwapchain->resizeDebounce       = 0.1;
+	appData->vkSwapchain->requestedPresentMode = options.presentMode;
 	ExitAssert(VkSetupSwapchain(appData->vkSwapchain), 1);
 
 	appData->accStructCount = 2;
@@ -320,20 +1574,60 @@ int main(int argc, char** argv)
 	ExitAssert(appData->accStructs != NULL, 1);
 	appData->accStructs[0].vk = appData->vk;
 	appData->accStructs[1].vk = appData->vk;
-	ExitAssert(CreateAS(appData->accStructs + 0, appData->accStructs + 1), 1);
+	ExitAssert(CreateAS(appData->accStructs + 0, appData->accStructs + 1, &appData->geometry), 1);
 
-	appData->shaderCount = 1;
-	appData->shaders     = (VkShaderData*) calloc(1, sizeof(VkShaderData));
-	ExitAssert(appData->shaders != NULL, 1);
-	appData->shaders->vk = appData->vk;
-	ExitAssert(VkSetupShader(appData->shaders + 0, "Shaders/shader.rgen"), 1);
+	if (appData->vk->rayTracingSupported)
+		AppSetupRayTracing(appData, &options);
+	else
+		printf("Ray tracing extensions unavailable, tracing a %u node software BVH built in %8.3f ms\n", appData->accStructs[1].bvhNodeCount, appData->accStructs[1].bvhBuildTime * 1000.0);
+
+	appData->pathTracer = (VkPathTracerData*) calloc(1, sizeof(VkPathTracerData));
+	ExitAssert(appData->pathTracer != NULL, 1);
+	appData->pathTracer->vk              = appData->vk;
+	appData->pathTracer->rtPipeline      = appData->rtPipeline;
+	appData->pathTracer->tlas            = appData->accStructs + 1;
+	appData->pathTracer->maxBounces      = options.maxBounces;
+	appData->pathTracer->maxSamples      = options.maxSamples;
+	appData->pathTracer->samplesPerFrame = options.samplesPerFrame;
+	appData->pathTracer->extendPipeline  = appData->wavefrontPipelines[0];
+	appData->pathTracer->shadowPipeline  = appData->wavefrontPipelines[1];
+	appData->pathTracer->mode            = options.mode;
+	appData->pathTracer->geometry        = appData->geometry.references;
+	appData->pathTracer->extendBackend   = options.extendBackend;
+	appData->pathTracer->shadowBackend   = options.shadowBackend;
+	ExitAssert(VkSetupPathTracer(appData->pathTracer), 1);
+	printf("Path tracer mode: %s\n", PathTracerModeName(options.mode));
+	if (appData->pathTracer->software)
+		printf("Path tracer backend: software BVH in compute\n");
+	else if (appData->pathTracer->queryPipeline)
+		printf("Path tracer backends: extend %s shadow %s\n", PathTracerBackendName(options.extendBackend), PathTracerBackendName(options.shadowBackend));
+	else
+		printf("Ray query unsupported, wavefront passes use the ray tracing pipeline\n");
+	if (options.mode == VK_PATH_TRACER_MODE_WAVEFRONT && !appData->pathTracer->software && !appData->vk->traceRaysIndirectSupported)
+		printf("Indirect trace rays unsupported, wavefront mode needs the query backend for extend and shadow and otherwise falls back to the megakernel\n");
+	if (appData->pendingPipeline && !VkRayTracingPipelineBuilding(appData->pendingPipeline->pipeline))
+		AppApplyVariant(appData);
+	AppReportShaderCompiler(appData);
+	AppReportLayouts(appData);
+
+	if (options.submitThread)
+	{
+		appData->submitThread = (VkSubmitThreadData*) calloc(1, sizeof(VkSubmitThreadData));
+		ExitAssert(appData->submitThread != NULL, 1);
+		appData->submitThread->vk = appData->vk;
+		ExitAssert(VkSetupSubmitThread(appData->submitThread), 1);
+	}
 
-	appData->rtPipeline = (VkRayTracingPipelineData*) calloc(1, sizeof(VkRayTracingPipelineData));
-	ExitAssert(appData->rtPipeline != NULL, 1);
-	appData->rtPipeline->vk = appData->vk;
-	ExitAssert(VkSetupRayTracingPipeline(appData->rtPipeline), 1);
+	appData->scene = (SceneData*) calloc(1, sizeof(SceneData));
+	ExitAssert(appData->scene != NULL, 1);
+	appData->scene->pipelined = options.pipelinedUpdate;
+	ExitAssert(SceneSetup(appData->scene), 1);
 
 	WLRTMakeWindowVisible(appData->window);
+	AppReportStartup(glfwGetTime() - startupStart);
+
+	AppStageTimings timings;
+	memset(&timings, 0, sizeof(timings));
 
 	double lastFrameTime = glfwGetTime();
 	double timer         = 0.0;
@@ -344,61 +1638,188 @@ int main(int argc, char** argv)
 		lastFrameTime    = frameTime;
 		if ((timer += deltaTime) > 0.5)
 		{
-			printf("%10.2f\n", 1.0 / deltaTime);
-			timer = 0.0;
+			VkFramePacingData* pacing  = &appData->vk->pacing;
+			double             latency = pacing->latencyCount > 0 ? pacing->latencySum / pacing->latencyCount : 0.0;
+			double             blocked = appData->submitThread ? AtomicExchange64(&appData->submitThread->blockedNanoseconds, 0) * 1e-6 / timer : 0.0;
+			double             scale   = timings.count > 0 ? 1000.0 / timings.count : 0.0;
+			printf("%10.2f fps %8.3f ms %s latency %8.3f ms wait %8.3f ms/s submit blocked\n", 1.0 / deltaTime, latency * 1000.0, pacing->latencyToPresent ? "present" : "gpu", pacing->waitTime * 1000.0, blocked);
+			printf("%10s %8.3f ms update %8.3f ms update stall %8.3f ms overlapped %8.3f ms record\n", appData->scene->pipelined ? "pipelined" : "serial", timings.update * scale, timings.stall * scale, timings.overlap * scale, timings.record * scale);
+			printf("%10u passes %8.3f ms serial pass recording on %u threads\n", timings.count > 0 ? timings.passCount / timings.count : 0, timings.passes * scale, JobSystemThreadCount(appData->recordJobs));
+			printf("%10s %8u spp %8.3f Msamples/s %8.3f Mrays/s\n", AppTracerName(appData), appData->pathTracer->sampleCount, appData->pathTracer->samplesTraced * 1e-6 / timer, appData->pathTracer->raysTraced * 1e-6 / timer);
+			AppReportPathTracer(appData);
+			if (appData->pathTracer->samplesTraced > 0)
+			{
+				AppVariantStats* stats = AppTracerStats(appData);
+				stats->samples        += appData->pathTracer->samplesTraced;
+				stats->rays           += appData->pathTracer->raysTraced;
+				stats->time           += timer;
+			}
+			appData->pathTracer->samplesTraced = 0;
+			appData->pathTracer->raysTraced    = 0;
+			pacing->latencySum   = 0.0;
+			pacing->latencyCount = 0;
+			timer                = 0.0;
+			memset(&timings, 0, sizeof(timings));
 		}
 
+		ExitAssert(VkWaitFrame(appData->vk), 2);
 		WLRTWindowPollEvents();
 		FWUpdate();
 
+		if (WLRTWindowKeyPressed(appData->window, GLFW_KEY_P))
+		{
+			VkPresentModeKHR modes[] = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+			uint32_t         next    = 0;
+			for (uint32_t i = 0; i < sizeof(modes) / sizeof(*modes); ++i)
+				if (modes[i] == appData->vkSwapchain->requestedPresentMode)
+					next = (i + 1) % (sizeof(modes) / sizeof(*modes));
+			VkSetSwapchainPresentMode(appData->vkSwapchain, modes[next]);
+			printf("Present mode: %s\n", PresentModeName(modes[next]));
+		}
+		if (WLRTWindowKeyPressed(appData->window, GLFW_KEY_F))
+		{
+			appData->vk->framesInFlight = appData->vk->framesInFlight % 3 + 1;
+			printf("Frames in flight: %u\n", appData->vk->framesInFlight);
+		}
+		if (WLRTWindowKeyPressed(appData->window, GLFW_KEY_R))
+			VkResetPathTracer(appData->pathTracer);
+		if (WLRTWindowKeyPressed(appData->window, GLFW_KEY_V) && appData->rtPipeline)
+		{
+			AppRaygenVariant next = appData->activeVariant;
+			do
+				next = (AppRaygenVariant) ((next + 1) % APP_RAYGEN_VARIANT_COUNT);
+			while (!appData->raygenVariants[next]);
+			AppSelectVariant(appData, next, &appData->specialization);
+		}
+		if (WLRTWindowKeyPressed(appData->window, GLFW_KEY_B) && appData->rtPipeline && !appData->pendingPipeline)
+		{
+			appData->preset                 = (appData->preset + 1) % (sizeof(s_ProductionSpecializations) / sizeof(*s_ProductionSpecializations));
+			appData->specialization         = s_ProductionSpecializations[appData->preset];
+			appData->specialization.reorder = options.reorder;
+			AppSelectVariant(appData, appData->activeVariant, &appData->specialization);
+		}
+		if (WLRTWindowKeyPressed(appData->window, GLFW_KEY_M))
+		{
+			appData->pathTracer->mode = (VkPathTracerMode) ((appData->pathTracer->mode + 1) % VK_PATH_TRACER_MODE_COUNT);
+			printf("Path tracer mode: %s\n", PathTracerModeName(appData->pathTracer->mode));
+		}
+		if (WLRTWindowKeyPressed(appData->window, GLFW_KEY_T) && appData->pathTracer->queryPipeline)
+		{
+			appData->pathTracer->extendBackend = (VkPathTracerBackend) ((appData->pathTracer->extendBackend + 1) % VK_PATH_TRACER_BACKEND_COUNT);
+			printf("Extend backend: %s\n", PathTracerBackendName(appData->pathTracer->extendBackend));
+		}
+		if (WLRTWindowKeyPressed(appData->window, GLFW_KEY_O) && appData->pathTracer->queryPipeline)
+		{
+			appData->pathTracer->shadowBackend = (VkPathTracerBackend) ((appData->pathTracer->shadowBackend + 1) % VK_PATH_TRACER_BACKEND_COUNT);
+			printf("Shadow backend: %s\n", PathTracerBackendName(appData->pathTracer->shadowBackend));
+		}
+
+		SceneInput input;
+		AppReadInput(appData->window, &input);
+
+		VkUpdatePipelineCache(appData->vk);
+		VkUpdateBindless(appData->vk);
+		for (uint32_t i = 0; i < appData->rtVariants.variantCount; ++i)
+		{
+			VkRayTracingPipelineData* rtPipeline = appData->rtVariants.variants[i]->pipeline;
+			if (VkUpdateRayTracingPipeline(rtPipeline))
+				AppReportPipelineBuild(rtPipeline, rtPipeline->libraries && rtPipeline->pendingChanged);
+		}
+		if (appData->pendingPipeline && !VkRayTracingPipelineBuilding(appData->pendingPipeline->pipeline))
+			AppApplyVariant(appData);
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			VkRayTracingPipelineData* rtPipeline = appData->wavefrontPipelines[i];
+			if (VkUpdateRayTracingPipeline(rtPipeline))
+				AppReportPipelineBuild(rtPipeline, rtPipeline->libraries && rtPipeline->pendingChanged);
+		}
+		const VkShaderData* changed[sizeof(s_Shaders) / sizeof(*s_Shaders)];
+		uint32_t            changedCount = 0;
+		bool                building     = AppPipelinesBuilding(appData);
 		for (size_t i = 0; i < appData->shaderCount; ++i)
 		{
 			VkShaderData* shader = appData->shaders + i;
-			if (shader->modified)
-				VkShaderRecompile(shader);
+			if (shader->modified && !shader->reloading)
+				VkShaderBeginReload(shader);
+			if (building || !VkShaderReloadReady(shader))
+				continue;
+			if (!VkShaderFinishReload(shader))
+			{
+				printf("Failed to reload %s, keeping the previous version\n", shader->filepath.buf);
+				continue;
+			}
+			printf("Reloaded %s\n", shader->filepath.buf);
+			changed[changedCount++] = shader;
 		}
+		if (changedCount > 0)
+			VkSaveShaderCache(appData->vk);
+		for (uint32_t i = 0; i < appData->rtVariants.variantCount; ++i)
+			AppRebuildPipeline(appData->rtVariants.variants[i]->pipeline, changed, changedCount);
+		AppRebuildPipeline(appData->wavefrontPipelines[0], changed, changedCount);
+		AppRebuildPipeline(appData->wavefrontPipelines[1], changed, changedCount);
+
+		const SceneState* state = SceneAcquireState(appData->scene);
+		timings.update += appData->scene->updateTime;
+		timings.stall  += appData->scene->stallTime;
+		if (appData->scene->pipelined && appData->scene->updateTime > appData->scene->stallTime)
+			timings.overlap += appData->scene->updateTime - appData->scene->stallTime;
+		++timings.count;
+		SceneRequestUpdate(appData->scene, deltaTime, &input);
+
+		double recordStart = glfwGetTime();
 
 		VkSwapchainData* swapchains[] = { appData->vkSwapchain };
 		ExitAssert(VkBeginFrame(appData->vk, swapchains, sizeof(swapchains) / sizeof(*swapchains)), 2);
 
 		VkFrameData* frame = VkGetCurrentFrame(appData->vk);
 
-		for (uint32_t i = 0; i < sizeof(swapchains) / sizeof(*swapchains); ++i)
-		{
-			VkSwapchainData* swapchain = swapchains[i];
-
-			VkRenderingAttachmentInfo colorAttachment = {
-				.sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-				.pNext              = NULL,
-				.imageView          = swapchain->views[swapchain->imageIndex],
-				.imageLayout        = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-				.resolveMode        = VK_RESOLVE_MODE_NONE,
-				.resolveImageView   = NULL,
-				.resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-				.loadOp             = VK_ATTACHMENT_LOAD_OP_CLEAR,
-				.storeOp            = VK_ATTACHMENT_STORE_OP_STORE,
-				.clearValue.color   = {186.0f / 255.0f, 218.0f / 255.0f, 85.0f / 255.0f, 1.0f}
-			};
-			VkRenderingInfo renderingInfo = {
-				.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO,
-				.pNext                = NULL,
-				.flags                = 0,
-				.renderArea.offset    = {0, 0},
-				.renderArea.extent    = swapchains[i]->extent,
-				.layerCount           = 1,
-				.viewMask             = 0,
-				.colorAttachmentCount = 1,
-				.pColorAttachments    = &colorAttachment,
-				.pDepthAttachment     = NULL,
-				.pStencilAttachment   = NULL
-			};
-			vkCmdBeginRendering(frame->buffer, &renderingInfo);
-
-			vkCmdEndRendering(frame->buffer);
+		VkPathTracerView view;
+		memcpy(view.position, state->camera.position, sizeof(view.position));
+		memcpy(view.background, state->background, sizeof(view.background));
+		view.yaw   = state->camera.yaw;
+		view.pitch = state->camera.pitch;
+		view.fov   = state->camera.fov;
+
+		appData->pathTracer->active = false;
+		if (frame->swapchainCount > 0)
+			ExitAssert(VkPreparePathTracer(appData->pathTracer, frame->swapchainDatas[0], &view), 2);
+
+		uint32_t tracePasses = VkPathTracerPassCount(appData->pathTracer);
+		uint32_t passCount   = frame->swapchainCount + (tracePasses > 1 ? tracePasses - 1 : 0);
+		ExitAssert(VkReserveFramePasses(appData->vk, passCount), 2);
+
+		AppRecordJob recordJobs[sizeof(swapchains) / sizeof(*swapchains) + VK_PATH_TRACER_MAX_BOUNCES + 2];
+		JobCounter   recordCounter = { .pending = 0 };
+		uint32_t     passIndex     = 0;
+		for (uint32_t i = 0; i < frame->swapchainCount; ++i)
+		{
+			uint32_t jobPasses = i == 0 && tracePasses > 0 ? tracePasses : 1;
+			for (uint32_t j = 0; j < jobPasses; ++j)
+			{
+				AppRecordJob* job = recordJobs + passIndex;
+				job->vk           = appData->vk;
+				job->state        = state;
+				job->swapchain    = frame->swapchainDatas[i];
+				job->pathTracer   = i == 0 ? appData->pathTracer : NULL;
+				job->tracePass    = j;
+				job->passIndex    = passIndex++;
+				job->time         = 0.0;
+				job->succeeded    = false;
+				ExitAssert(JobSystemSubmit(appData->recordJobs, &RecordSwapchainPass, job, &recordCounter), 2);
+			}
+		}
+		JobSystemWait(appData->recordJobs, &recordCounter);
+		for (uint32_t i = 0; i < passCount; ++i)
+		{
+			ExitAssert(recordJobs[i].succeeded, 2);
+			timings.passes += recordJobs[i].time;
 		}
+		timings.passCount += passCount;
 
 		ExitAssert(VkEndFrame(appData->vk), 2);
+		timings.record += glfwGetTime() - recordStart;
 	}
 
+	AppReportVariants(appData);
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,1651 @@
+#include "Bvh.h"
+#include "Vk.h"
+#include "VkFuncs/VkFuncs.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VK_PATH_TRACER_SORT_BUCKETS    16
+#define VK_PATH_TRACER_SORT_GROUP      256
+#define VK_PATH_TRACER_WAVEFRONT_GROUP 256
+#define VK_PATH_TRACER_QUEUE_STATS     8
+#define VK_PATH_TRACER_BVH_TILE        8
+#define VK_PATH_TRACER_BVH_STACK       64
+#define VK_PATH_TRACER_ARGS_EXTEND     0
+#define VK_PATH_TRACER_ARGS_SHADOW     6
+#define VK_PATH_TRACER_ARGS_MATERIALS  12
+#define VK_PATH_TRACER_ARGS            (VK_PATH_TRACER_ARGS_MATERIALS + 3 * VK_PATH_TRACER_MATERIALS)
+
+static const char* const s_BindlessDefines[] = { "BINDLESS" };
+
+typedef struct VkPathTracerSortConstants
+{
+	uint32_t pass;
+	uint32_t count;
+} VkPathTracerSortConstants;
+
+typedef struct VkPathTracerQueryConstants
+{
+	float           background[4];
+	VkDeviceAddress vertices;
+	VkDeviceAddress indices;
+	uint32_t        pass;
+	uint32_t        queue;
+} VkPathTracerQueryConstants;
+
+static void VkPathTracerDestroyQueues(VkPathTracerData* pathTracer)
+{
+	VkData* vk = pathTracer->vk;
+	for (uint32_t i = 0; i < VK_PATH_TRACER_QUEUE_COUNT; ++i)
+	{
+		vmaDestroyBuffer(vk->allocator, pathTracer->queueBuffers[i], pathTracer->queueAllocations[i]);
+		pathTracer->queueBuffers[i]     = NULL;
+		pathTracer->queueAllocations[i] = NULL;
+	}
+}
+
+static void VkPathTracerTakeImages(VkPathTracerData* pathTracer, VkRetiredPathTracerData* retired)
+{
+	VkBuffer*      buffers[]     = { &pathTracer->orderBuffer, &pathTracer->bucketBuffer, &pathTracer->keyBuffer };
+	VmaAllocation* allocations[] = { &pathTracer->orderAllocation, &pathTracer->bucketAllocation, &pathTracer->keyAllocation };
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		retired->buffers[i]           = *buffers[i];
+		retired->bufferAllocations[i] = *allocations[i];
+		*buffers[i]                   = NULL;
+		*allocations[i]               = NULL;
+	}
+	for (uint32_t i = 0; i < VK_PATH_TRACER_QUEUE_COUNT; ++i)
+	{
+		retired->buffers[3 + i]           = pathTracer->queueBuffers[i];
+		retired->bufferAllocations[3 + i] = pathTracer->queueAllocations[i];
+		pathTracer->queueBuffers[i]       = NULL;
+		pathTracer->queueAllocations[i]   = NULL;
+	}
+	retired->images[0]            = pathTracer->outputImage;
+	retired->imageAllocations[0]  = pathTracer->outputAllocation;
+	retired->views[0]             = pathTracer->outputView;
+	retired->images[1]            = pathTracer->accumImage;
+	retired->imageAllocations[1]  = pathTracer->accumAllocation;
+	retired->views[1]             = pathTracer->accumView;
+	pathTracer->outputView        = NULL;
+	pathTracer->accumView         = NULL;
+	pathTracer->outputImage       = NULL;
+	pathTracer->outputAllocation  = NULL;
+	pathTracer->accumImage        = NULL;
+	pathTracer->accumAllocation   = NULL;
+	pathTracer->sortValid         = false;
+	pathTracer->imagesInitialized = false;
+	pathTracer->extent            = (VkExtent2D) { 0, 0 };
+}
+
+static void VkDestroyRetiredPathTracer(VkData* vk, VkRetiredPathTracerData* retired)
+{
+	for (uint32_t i = 0; i < VK_PATH_TRACER_BUFFERS; ++i)
+		vmaDestroyBuffer(vk->allocator, retired->buffers[i], retired->bufferAllocations[i]);
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		vkDestroyImageView(vk->device, retired->views[i], vk->allocation);
+		vmaDestroyImage(vk->allocator, retired->images[i], retired->imageAllocations[i]);
+	}
+	vkDestroyDescriptorPool(vk->device, retired->descriptorPool, vk->allocation);
+	free(retired->frameValues);
+	memset(retired, 0, sizeof(VkRetiredPathTracerData));
+}
+
+static void VkPathTracerDestroyImages(VkPathTracerData* pathTracer)
+{
+	VkRetiredPathTracerData discarded;
+	memset(&discarded, 0, sizeof(discarded));
+	VkPathTracerTakeImages(pathTracer, &discarded);
+	VkDestroyRetiredPathTracer(pathTracer->vk, &discarded);
+}
+
+static bool VkRetiredPathTracerCompleted(VkData* vk, const VkRetiredPathTracerData* retired)
+{
+	if (retired->framesGeneration != vk->framesGeneration)
+		return true;
+
+	for (uint32_t i = 0; i < retired->frameCount; ++i)
+	{
+		uint64_t value = 0;
+		if (!VkValidate(vk, vkGetSemaphoreCounterValue(vk->device, vk->frames[i].semaphore, &value)) ||
+			value < retired->frameValues[i])
+			return false;
+	}
+	return true;
+}
+
+static void VkCollectRetiredPathTracer(VkPathTracerData* pathTracer, bool force)
+{
+	VkData* vk = pathTracer->vk;
+
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < pathTracer->retiredCount; ++i)
+	{
+		VkRetiredPathTracerData* retired = pathTracer->retired + i;
+		if (force || VkRetiredPathTracerCompleted(vk, retired))
+			VkDestroyRetiredPathTracer(vk, retired);
+		else
+			pathTracer->retired[kept++] = *retired;
+	}
+	pathTracer->retiredCount = kept;
+}
+
+static bool VkRetirePathTracerImages(VkPathTracerData* pathTracer)
+{
+	VkData* vk = pathTracer->vk;
+
+	if (pathTracer->retiredCount >= pathTracer->retiredCapacity)
+	{
+		uint32_t                 newCapacity = pathTracer->retiredCapacity ? pathTracer->retiredCapacity << 1 : 4;
+		VkRetiredPathTracerData* newRetired  = (VkRetiredPathTracerData*) malloc(newCapacity * sizeof(VkRetiredPathTracerData));
+		if (!newRetired)
+		{
+			VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate retired path tracer images");
+			return false;
+		}
+		if (pathTracer->retired)
+			memcpy(newRetired, pathTracer->retired, pathTracer->retiredCount * sizeof(VkRetiredPathTracerData));
+		free(pathTracer->retired);
+		pathTracer->retiredCapacity = newCapacity;
+		pathTracer->retired         = newRetired;
+	}
+
+	uint64_t* frameValues = (uint64_t*) malloc(vk->framesCapacity * sizeof(uint64_t));
+	if (vk->framesCapacity > 0 && !frameValues)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate retired path tracer frame values");
+		return false;
+	}
+	for (uint32_t i = 0; i < vk->framesCapacity; ++i)
+		frameValues[i] = vk->frames[i].value;
+
+	VkRetiredPathTracerData* retired = pathTracer->retired + pathTracer->retiredCount;
+	++pathTracer->retiredCount;
+	retired->framesGeneration = vk->framesGeneration;
+	retired->frameCount       = vk->framesCapacity;
+	retired->frameValues      = frameValues;
+	retired->descriptorPool   = pathTracer->descriptorPool;
+	VkPathTracerTakeImages(pathTracer, retired);
+
+	pathTracer->descriptorPool  = NULL;
+	pathTracer->descriptorSet   = NULL;
+	pathTracer->sortSet         = NULL;
+	pathTracer->wavefrontSet    = NULL;
+	pathTracer->wavefrontRaySet = NULL;
+	return true;
+}
+
+static bool VkPathTracerCreateImage(VkPathTracerData* pathTracer, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkImage* image, VmaAllocation* allocation, VkImageView* view)
+{
+	VkData* vk = pathTracer->vk;
+
+	VkImageCreateInfo createInfo = {
+		.sType                 = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.pNext                 = NULL,
+		.flags                 = 0,
+		.imageType             = VK_IMAGE_TYPE_2D,
+		.format                = format,
+		.extent                = { extent.width, extent.height, 1 },
+		.mipLevels             = 1,
+		.arrayLayers           = 1,
+		.samples               = VK_SAMPLE_COUNT_1_BIT,
+		.tiling                = VK_IMAGE_TILING_OPTIMAL,
+		.usage                 = usage,
+		.sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices   = NULL,
+		.initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED
+	};
+	VmaAllocationCreateInfo allocInfo = {
+		.flags          = 0,
+		.usage          = VMA_MEMORY_USAGE_GPU_ONLY,
+		.requiredFlags  = 0,
+		.preferredFlags = 0,
+		.memoryTypeBits = 0,
+		.pool           = NULL,
+		.pUserData      = NULL,
+		.priority       = 0.0f
+	};
+	if (!VkValidate(vk, vmaCreateImage(vk->allocator, &createInfo, &allocInfo, image, allocation, NULL)))
+		return false;
+
+	VkImageViewCreateInfo viewCreateInfo = {
+		.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.pNext                           = NULL,
+		.flags                           = 0,
+		.image                           = *image,
+		.viewType                        = VK_IMAGE_VIEW_TYPE_2D,
+		.format                          = format,
+		.components                      = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY },
+		.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+		.subresourceRange.baseMipLevel   = 0,
+		.subresourceRange.levelCount     = 1,
+		.subresourceRange.baseArrayLayer = 0,
+		.subresourceRange.layerCount     = 1
+	};
+	return VkValidate(vk, vkCreateImageView(vk->device, &viewCreateInfo, vk->allocation, view));
+}
+
+static bool VkPathTracerCreateBuffer(VkPathTracerData* pathTracer, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, VmaAllocation* allocation)
+{
+	VkData* vk = pathTracer->vk;
+
+	VkBufferCreateInfo createInfo = {
+		.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext                 = NULL,
+		.flags                 = 0,
+		.size                  = size,
+		.usage                 = usage,
+		.sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices   = NULL
+	};
+	VmaAllocationCreateInfo allocInfo = {
+		.flags          = 0,
+		.usage          = VMA_MEMORY_USAGE_GPU_ONLY,
+		.requiredFlags  = 0,
+		.preferredFlags = 0,
+		.memoryTypeBits = 0,
+		.pool           = NULL,
+		.pUserData      = NULL,
+		.priority       = 0.0f
+	};
+	return VkValidate(vk, vmaCreateBuffer(vk->allocator, &createInfo, &allocInfo, buffer, allocation, NULL));
+}
+
+static bool VkPathTracerCreateImages(VkPathTracerData* pathTracer, VkExtent2D extent)
+{
+	VkDeviceSize pixelBufferSize = (VkDeviceSize) extent.width * extent.height * sizeof(uint32_t);
+	if (!VkPathTracerCreateImage(pathTracer, extent, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, &pathTracer->accumImage, &pathTracer->accumAllocation, &pathTracer->accumView) ||
+		!VkPathTracerCreateImage(pathTracer, extent, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, &pathTracer->outputImage, &pathTracer->outputAllocation, &pathTracer->outputView) ||
+		!VkPathTracerCreateBuffer(pathTracer, pixelBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &pathTracer->keyBuffer, &pathTracer->keyAllocation) ||
+		!VkPathTracerCreateBuffer(pathTracer, 2 * VK_PATH_TRACER_SORT_BUCKETS * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &pathTracer->bucketBuffer, &pathTracer->bucketAllocation) ||
+		!VkPathTracerCreateBuffer(pathTracer, pixelBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &pathTracer->orderBuffer, &pathTracer->orderAllocation))
+	{
+		VkPathTracerDestroyImages(pathTracer);
+		return false;
+	}
+	pathTracer->extent = extent;
+	return true;
+}
+
+static bool VkPathTracerCreateQueues(VkPathTracerData* pathTracer)
+{
+	VkDeviceSize pixelCount = (VkDeviceSize) pathTracer->extent.width * pathTracer->extent.height;
+	VkDeviceSize sizes[VK_PATH_TRACER_QUEUE_COUNT];
+	sizes[VK_PATH_TRACER_QUEUE_RAYS]      = 2 * pixelCount * 12 * sizeof(uint32_t);
+	sizes[VK_PATH_TRACER_QUEUE_HITS]      = pixelCount * 20 * sizeof(uint32_t);
+	sizes[VK_PATH_TRACER_QUEUE_MATERIALS] = VK_PATH_TRACER_MATERIALS * pixelCount * sizeof(uint32_t);
+	sizes[VK_PATH_TRACER_QUEUE_SHADOWS]   = pixelCount * 12 * sizeof(uint32_t);
+	sizes[VK_PATH_TRACER_QUEUE_RADIANCE]  = pixelCount * 4 * sizeof(float);
+	sizes[VK_PATH_TRACER_QUEUE_COUNTERS]  = VK_PATH_TRACER_QUEUE_STATS * sizeof(uint32_t);
+	sizes[VK_PATH_TRACER_QUEUE_ARGS]      = VK_PATH_TRACER_ARGS * sizeof(uint32_t);
+	for (uint32_t i = 0; i < VK_PATH_TRACER_QUEUE_COUNT; ++i)
+	{
+		VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		if (i == VK_PATH_TRACER_QUEUE_COUNTERS)
+			usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		if (i == VK_PATH_TRACER_QUEUE_ARGS)
+			usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+		if (!VkPathTracerCreateBuffer(pathTracer, sizes[i], usage, pathTracer->queueBuffers + i, pathTracer->queueAllocations + i))
+		{
+			VkPathTracerDestroyQueues(pathTracer);
+			return false;
+		}
+	}
+	return true;
+}
+
+static void VkPathTracerDestroyCounters(VkPathTracerData* pathTracer)
+{
+	VkData* vk = pathTracer->vk;
+	if (pathTracer->counters)
+		vmaUnmapMemory(vk->allocator, pathTracer->counterAllocation);
+	if (pathTracer->stats)
+		vmaUnmapMemory(vk->allocator, pathTracer->statsAllocation);
+	vmaDestroyBuffer(vk->allocator, pathTracer->counterBuffer, pathTracer->counterAllocation);
+	vmaDestroyBuffer(vk->allocator, pathTracer->statsBuffer, pathTracer->statsAllocation);
+	vkDestroyQueryPool(vk->device, pathTracer->timestampPool, vk->allocation);
+	free(pathTracer->counterSamples);
+	free(pathTracer->statsBounces);
+	free(pathTracer->timestampCounts);
+	free(pathTracer->timestampStages);
+	pathTracer->counterBuffer     = NULL;
+	pathTracer->counterAllocation = NULL;
+	pathTracer->counters          = NULL;
+	pathTracer->counterSamples    = NULL;
+	pathTracer->statsBuffer       = NULL;
+	pathTracer->statsAllocation   = NULL;
+	pathTracer->stats             = NULL;
+	pathTracer->statsBounces      = NULL;
+	pathTracer->timestampPool     = NULL;
+	pathTracer->timestampCounts   = NULL;
+	pathTracer->timestampStages   = NULL;
+	pathTracer->counterCount      = 0;
+}
+
+static bool VkPathTracerCreateReadback(VkPathTracerData* pathTracer, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, VmaAllocation* allocation, uint32_t** data)
+{
+	VkData* vk = pathTracer->vk;
+
+	VkBufferCreateInfo createInfo = {
+		.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext                 = NULL,
+		.flags                 = 0,
+		.size                  = size,
+		.usage                 = usage,
+		.sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices   = NULL
+	};
+	VmaAllocationCreateInfo allocInfo = {
+		.flags          = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+		.usage          = VMA_MEMORY_USAGE_GPU_TO_CPU,
+		.requiredFlags  = 0,
+		.preferredFlags = 0,
+		.memoryTypeBits = 0,
+		.pool           = NULL,
+		.pUserData      = NULL,
+		.priority       = 0.0f
+	};
+	void* mapped = NULL;
+	if (!VkValidate(vk, vmaCreateBuffer(vk->allocator, &createInfo, &allocInfo, buffer, allocation, NULL)) ||
+		!VkValidate(vk, vmaMapMemory(vk->allocator, *allocation, &mapped)))
+		return false;
+	*data = (uint32_t*) mapped;
+	memset(*data, 0, size);
+	vmaFlushAllocation(vk->allocator, *allocation, 0, VK_WHOLE_SIZE);
+	return true;
+}
+
+static bool VkPathTracerCreateCounters(VkPathTracerData* pathTracer, uint32_t count)
+{
+	VkData* vk = pathTracer->vk;
+
+	VkQueryPoolCreateInfo createInfo = {
+		.sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.pNext              = NULL,
+		.flags              = 0,
+		.queryType          = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount         = count * VK_PATH_TRACER_TIMESTAMPS,
+		.pipelineStatistics = 0
+	};
+	pathTracer->counterSamples  = (uint64_t*) calloc(count, sizeof(uint64_t));
+	pathTracer->statsBounces    = (uint32_t*) calloc(count, sizeof(uint32_t));
+	pathTracer->timestampCounts = (uint32_t*) calloc(count, sizeof(uint32_t));
+	pathTracer->timestampStages = (uint8_t*) calloc(count * VK_PATH_TRACER_TIMESTAMPS, sizeof(uint8_t));
+	if (!pathTracer->counterSamples || !pathTracer->statsBounces || !pathTracer->timestampCounts || !pathTracer->timestampStages)
+	{
+		VkPathTracerDestroyCounters(pathTracer);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate path tracer counters");
+		return false;
+	}
+	VkDeviceSize statsSize = (VkDeviceSize) count * (VK_PATH_TRACER_MAX_BOUNCES + 1) * VK_PATH_TRACER_QUEUE_STATS * sizeof(uint32_t);
+	if (!VkPathTracerCreateReadback(pathTracer, count * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &pathTracer->counterBuffer, &pathTracer->counterAllocation, &pathTracer->counters) ||
+		!VkPathTracerCreateReadback(pathTracer, statsSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, &pathTracer->statsBuffer, &pathTracer->statsAllocation, &pathTracer->stats) ||
+		!VkValidate(vk, vkCreateQueryPool(vk->device, &createInfo, vk->allocation, &pathTracer->timestampPool)))
+	{
+		VkPathTracerDestroyCounters(pathTracer);
+		return false;
+	}
+	pathTracer->counterCount = count;
+	return true;
+}
+
+static void VkPathTracerCollectCounter(VkPathTracerData* pathTracer, uint32_t slot)
+{
+	if (slot >= pathTracer->counterCount) return;
+
+	VkData* vk = pathTracer->vk;
+	vmaInvalidateAllocation(vk->allocator, pathTracer->counterAllocation, slot * sizeof(uint32_t), sizeof(uint32_t));
+	pathTracer->raysTraced          += pathTracer->counters[slot];
+	pathTracer->samplesTraced       += pathTracer->counterSamples[slot];
+	pathTracer->counters[slot]       = 0;
+	vmaFlushAllocation(vk->allocator, pathTracer->counterAllocation, slot * sizeof(uint32_t), sizeof(uint32_t));
+
+	uint32_t bounces = pathTracer->statsBounces[slot];
+	if (bounces > 0)
+	{
+		VkDeviceSize statsOffset = (VkDeviceSize) slot * (VK_PATH_TRACER_MAX_BOUNCES + 1) * VK_PATH_TRACER_QUEUE_STATS;
+		vmaInvalidateAllocation(vk->allocator, pathTracer->statsAllocation, statsOffset * sizeof(uint32_t), bounces * VK_PATH_TRACER_QUEUE_STATS * sizeof(uint32_t));
+		pathTracer->queuePixels += pathTracer->counterSamples[slot];
+		for (uint32_t i = 0; i < bounces; ++i)
+		{
+			const uint32_t* stats   = pathTracer->stats + statsOffset + i * VK_PATH_TRACER_QUEUE_STATS;
+			uint32_t        rays    = stats[i & 1];
+			uint32_t        shadows = stats[2];
+			pathTracer->raysTraced      += rays + shadows;
+			pathTracer->queueRays[i]    += rays;
+			pathTracer->queueShadows[i] += shadows;
+			for (uint32_t j = 0; j < VK_PATH_TRACER_MATERIALS; ++j)
+				pathTracer->queueHits[j] += stats[4 + j];
+		}
+		pathTracer->statsBounces[slot] = 0;
+	}
+	pathTracer->counterSamples[slot] = 0;
+
+	uint32_t timestampCount = pathTracer->timestampCounts[slot];
+	if (timestampCount > 1)
+	{
+		uint64_t timestamps[VK_PATH_TRACER_TIMESTAMPS];
+		if (vkGetQueryPoolResults(vk->device, pathTracer->timestampPool, slot * VK_PATH_TRACER_TIMESTAMPS, timestampCount, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			const uint8_t* stages = pathTracer->timestampStages + slot * VK_PATH_TRACER_TIMESTAMPS;
+			for (uint32_t i = 1; i < timestampCount; ++i)
+				pathTracer->stageTimes[stages[i]] += (double) (timestamps[i] - timestamps[i - 1]) * pathTracer->timestampPeriod * 1e-9;
+			++pathTracer->timedFrames;
+		}
+	}
+	pathTracer->timestampCounts[slot] = 0;
+}
+
+static uint32_t VkPathTracerFilterWrites(VkWriteDescriptorSet* writes, uint32_t writeCount, VkDescriptorSet set, uint64_t bindingMask)
+{
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < writeCount; ++i)
+	{
+		if (writes[i].dstSet == set && (writes[i].dstBinding >= 64 || !(bindingMask & (1ULL << writes[i].dstBinding))))
+			continue;
+		writes[count++] = writes[i];
+	}
+	return count;
+}
+
+static void VkPathTracerWriteDescriptors(VkPathTracerData* pathTracer)
+{
+	VkData* vk = pathTracer->vk;
+
+	VkWriteDescriptorSetAccelerationStructureKHR tlasInfo = {
+		.sType                      = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
+		.pNext                      = NULL,
+		.accelerationStructureCount = 1,
+		.pAccelerationStructures    = &pathTracer->tlas->handle
+	};
+	VkDescriptorImageInfo accumInfo = {
+		.sampler     = NULL,
+		.imageView   = pathTracer->accumView,
+		.imageLayout = VK_IMAGE_LAYOUT_GENERAL
+	};
+	VkDescriptorImageInfo outputInfo = {
+		.sampler     = NULL,
+		.imageView   = pathTracer->outputView,
+		.imageLayout = VK_IMAGE_LAYOUT_GENERAL
+	};
+	VkDescriptorBufferInfo counterInfo = {
+		.buffer = pathTracer->counterBuffer,
+		.offset = 0,
+		.range  = VK_WHOLE_SIZE
+	};
+	VkDescriptorBufferInfo keyInfo = {
+		.buffer = pathTracer->keyBuffer,
+		.offset = 0,
+		.range  = VK_WHOLE_SIZE
+	};
+	VkDescriptorBufferInfo bucketInfo = {
+		.buffer = pathTracer->bucketBuffer,
+		.offset = 0,
+		.range  = VK_WHOLE_SIZE
+	};
+	VkDescriptorBufferInfo orderInfo = {
+		.buffer = pathTracer->orderBuffer,
+		.offset = 0,
+		.range  = VK_WHOLE_SIZE
+	};
+	VkWriteDescriptorSet writes[] = {
+		{
+			.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext            = &tlasInfo,
+			.dstSet           = pathTracer->descriptorSet,
+			.dstBinding       = 0,
+			.dstArrayElement  = 0,
+			.descriptorCount  = 1,
+			.descriptorType   = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR,
+			.pImageInfo       = NULL,
+			.pBufferInfo      = NULL,
+			.pTexelBufferView = NULL
+		},
+		{
+			.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext            = NULL,
+			.dstSet           = pathTracer->descriptorSet,
+			.dstBinding       = 1,
+			.dstArrayElement  = 0,
+			.descriptorCount  = 1,
+			.descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			.pImageInfo       = &accumInfo,
+			.pBufferInfo      = NULL,
+			.pTexelBufferView = NULL
+		},
+		{
+			.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext            = NULL,
+			.dstSet           = pathTracer->descriptorSet,
+			.dstBinding       = 2,
+			.dstArrayElement  = 0,
+			.descriptorCount  = 1,
+			.descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			.pImageInfo       = &outputInfo,
+			.pBufferInfo      = NULL,
+			.pTexelBufferView = NULL
+		},
+		{
+			.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext            = NULL,
+			.dstSet           = pathTracer->descriptorSet,
+			.dstBinding       = 3,
+			.dstArrayElement  = 0,
+			.descriptorCount  = 1,
+			.descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pImageInfo       = NULL,
+			.pBufferInfo      = &counterInfo,
+			.pTexelBufferView = NULL
+		},
+		{
+			.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext            = NULL,
+			.dstSet           = pathTracer->descriptorSet,
+			.dstBinding       = 4,
+			.dstArrayElement  = 0,
+			.descriptorCount  = 1,
+			.descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pImageInfo       = NULL,
+			.pBufferInfo      = &keyInfo,
+			.pTexelBufferView = NULL
+		},
+		{
+			.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext            = NULL,
+			.dstSet           = pathTracer->descriptorSet,
+			.dstBinding       = 5,
+			.dstArrayElement  = 0,
+			.descriptorCount  = 1,
+			.descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pImageInfo       = NULL,
+			.pBufferInfo      = &orderInfo,
+			.pTexelBufferView = NULL
+		},
+		{
+			.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext            = NULL,
+			.dstSet           = pathTracer->sortSet,
+			.dstBinding       = 0,
+			.dstArrayElement  = 0,
+			.descriptorCount  = 1,
+			.descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pImageInfo       = NULL,
+			.pBufferInfo      = &keyInfo,
+			.pTexelBufferView = NULL
+		},
+		{
+			.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext            = NULL,
+			.dstSet           = pathTracer->sortSet,
+			.dstBinding       = 1,
+			.dstArrayElement  = 0,
+			.descriptorCount  = 1,
+			.descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pImageInfo       = NULL,
+			.pBufferInfo      = &bucketInfo,
+			.pTexelBufferView = NULL
+		},
+		{
+			.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext            = NULL,
+			.dstSet           = pathTracer->sortSet,
+			.dstBinding       = 2,
+			.dstArrayElement  = 0,
+			.descriptorCount  = 1,
+			.descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pImageInfo       = NULL,
+			.pBufferInfo      = &orderInfo,
+			.pTexelBufferView = NULL
+		}
+	};
+	uint32_t writeCount = VkPathTracerFilterWrites(writes, sizeof(writes) / sizeof(*writes), pathTracer->descriptorSet, pathTracer->rtPipeline->bindingMask);
+	vkUpdateDescriptorSets(vk->device, writeCount, writes, 0, NULL);
+}
+
+static void VkPathTracerWriteWavefrontDescriptors(VkPathTracerData* pathTracer)
+{
+	VkData* vk = pathTracer->vk;
+
+	VkWriteDescriptorSetAccelerationStructureKHR tlasInfo = {
+		.sType                      = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
+		.pNext                      = NULL,
+		.accelerationStructureCount = 1,
+		.pAccelerationStructures    = &pathTracer->tlas->handle
+	};
+	VkDescriptorImageInfo imageInfos[2] = {
+		{.sampler = NULL, .imageView = pathTracer->accumView, .imageLayout = VK_IMAGE_LAYOUT_GENERAL},
+		{ .sampler = NULL, .imageView = pathTracer->outputView, .imageLayout = VK_IMAGE_LAYOUT_GENERAL}
+	};
+	VkDescriptorBufferInfo queueInfos[VK_PATH_TRACER_QUEUE_COUNT];
+	VkWriteDescriptorSet   writes[2 * (3 + VK_PATH_TRACER_QUEUE_COUNT)];
+	VkDescriptorSet        sets[2] = { pathTracer->wavefrontSet, pathTracer->wavefrontRaySet };
+	for (uint32_t i = 0; i < VK_PATH_TRACER_QUEUE_COUNT; ++i)
+	{
+		queueInfos[i] = (VkDescriptorBufferInfo) {
+			.buffer = pathTracer->queueBuffers[i],
+			.offset = 0,
+			.range  = VK_WHOLE_SIZE
+		};
+	}
+	for (uint32_t set = 0; set < 2; ++set)
+	{
+		VkWriteDescriptorSet* setWrites = writes + set * (3 + VK_PATH_TRACER_QUEUE_COUNT);
+		setWrites[0]                    = (VkWriteDescriptorSet) {
+								   .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+								   .pNext            = &tlasInfo,
+								   .dstSet           = sets[set],
+								   .dstBinding       = 0,
+								   .dstArrayElement  = 0,
+								   .descriptorCount  = 1,
+								   .descriptorType   = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR,
+								   .pImageInfo       = NULL,
+								   .pBufferInfo      = NULL,
+								   .pTexelBufferView = NULL
+		};
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			setWrites[1 + i] = (VkWriteDescriptorSet) {
+				.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext            = NULL,
+				.dstSet           = sets[set],
+				.dstBinding       = 1 + i,
+				.dstArrayElement  = 0,
+				.descriptorCount  = 1,
+				.descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.pImageInfo       = imageInfos + i,
+				.pBufferInfo      = NULL,
+				.pTexelBufferView = NULL
+			};
+		}
+		for (uint32_t i = 0; i < VK_PATH_TRACER_QUEUE_COUNT; ++i)
+		{
+			setWrites[3 + i] = (VkWriteDescriptorSet) {
+				.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext            = NULL,
+				.dstSet           = sets[set],
+				.dstBinding       = 3 + i,
+				.dstArrayElement  = 0,
+				.descriptorCount  = 1,
+				.descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pImageInfo       = NULL,
+				.pBufferInfo      = queueInfos + i,
+				.pTexelBufferView = NULL
+			};
+		}
+	}
+	uint32_t writeCount = VkPathTracerFilterWrites(writes, sizeof(writes) / sizeof(*writes), pathTracer->wavefrontSet, pathTracer->wavefrontBindingMask);
+	writeCount          = VkPathTracerFilterWrites(writes, writeCount, pathTracer->wavefrontRaySet, pathTracer->extendPipeline->bindingMask);
+	vkUpdateDescriptorSets(vk->device, writeCount, writes, 0, NULL);
+}
+
+static void VkPathTracerWriteBvhDescriptors(VkPathTracerData* pathTracer)
+{
+	VkData*      vk   = pathTracer->vk;
+	VkAccStruct* tlas = pathTracer->tlas;
+
+	VkDescriptorImageInfo imageInfos[] = {
+		{.sampler = NULL, .imageView = pathTracer->accumView, .imageLayout = VK_IMAGE_LAYOUT_GENERAL},
+		{ .sampler = NULL, .imageView = pathTracer->outputView, .imageLayout = VK_IMAGE_LAYOUT_GENERAL}
+	};
+	VkDescriptorBufferInfo bufferInfos[] = {
+		{.buffer = pathTracer->counterBuffer, .offset = 0, .range = VK_WHOLE_SIZE},
+		{ .buffer = tlas->buffer, .offset = 0, .range = tlas->bvhNodeCount * sizeof(BvhNode)},
+		{ .buffer = tlas->buffer, .offset = tlas->bvhTriangleOffset, .range = VK_WHOLE_SIZE}
+	};
+	VkWriteDescriptorSet writes[5];
+	for (uint32_t i = 0; i < 5; ++i)
+	{
+		writes[i] = (VkWriteDescriptorSet) {
+			.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext            = NULL,
+			.dstSet           = pathTracer->descriptorSet,
+			.dstBinding       = i,
+			.dstArrayElement  = 0,
+			.descriptorCount  = 1,
+			.descriptorType   = i < 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pImageInfo       = i < 2 ? imageInfos + i : NULL,
+			.pBufferInfo      = i < 2 ? NULL : bufferInfos + i - 2,
+			.pTexelBufferView = NULL
+		};
+	}
+	vkUpdateDescriptorSets(vk->device, sizeof(writes) / sizeof(*writes), writes, 0, NULL);
+}
+
+static void VkPathTracerSetupConstants(VkPathTracerData* pathTracer, uint32_t slot)
+{
+	const VkPathTracerView* view      = &pathTracer->view;
+	VkPathTracerConstants*  constants = &pathTracer->constants;
+
+	float yaw      = view->yaw * 0.017453292f;
+	float pitch    = view->pitch * 0.017453292f;
+	float cy       = cosf(yaw);
+	float sy       = sinf(yaw);
+	float cp       = cosf(pitch);
+	float sp       = sinf(pitch);
+	float tanHalf  = tanf(view->fov * 0.5f * 0.017453292f);
+	float aspect   = (float) pathTracer->extent.width / (float) pathTracer->extent.height;
+	float right[3] = { cy, 0.0f, sy };
+	float up[3]    = { -sy * sp, cp, cy * sp };
+
+	constants->origin[0]  = view->position[0];
+	constants->origin[1]  = view->position[1];
+	constants->origin[2]  = view->position[2];
+	constants->origin[3]  = 0.0f;
+	constants->forward[0] = cp * sy;
+	constants->forward[1] = sp;
+	constants->forward[2] = -cp * cy;
+	constants->forward[3] = 0.0f;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		constants->right[i] = right[i] * tanHalf * aspect;
+		constants->up[i]    = up[i] * tanHalf;
+	}
+	constants->right[3] = 0.0f;
+	constants->up[3]    = 0.0f;
+	memcpy(constants->background, view->background, sizeof(constants->background));
+	constants->sampleIndex = pathTracer->sampleCount;
+	constants->seed        = pathTracer->sampleCount * 0x9E3779B9U;
+	constants->maxBounces  = pathTracer->maxBounces;
+	constants->counterSlot = slot;
+	constants->sortValid   = pathTracer->sortHits && pathTracer->sortValid;
+}
+
+static bool VkPathTracerSetupShaders(VkPathTracerData* pathTracer, bool wavefront)
+{
+	bool          query       = wavefront && pathTracer->vk->rayQuerySupported && pathTracer->geometry;
+	VkShaderData* shaders[]   = { &pathTracer->sortShader, &pathTracer->wavefrontShader, &pathTracer->queryShader, &pathTracer->bvhShader };
+	const char*   filepaths[] = {
+		pathTracer->software ? NULL : "Shaders/sort.comp",
+		wavefront ? "Shaders/wavefront.comp" : NULL,
+		query ? "Shaders/wavefront_query.comp" : NULL,
+		pathTracer->software ? "Shaders/bvh.comp" : NULL
+	};
+	for (uint32_t i = 0; i < sizeof(shaders) / sizeof(*shaders); ++i)
+	{
+		shaders[i]->vk          = pathTracer->vk;
+		shaders[i]->defineCount = 0;
+		shaders[i]->defines     = NULL;
+	}
+	if (pathTracer->vk->bindlessSupported)
+	{
+		pathTracer->queryShader.defineCount = 1;
+		pathTracer->queryShader.defines     = s_BindlessDefines;
+	}
+	return VkSetupShaders(pathTracer->vk, shaders, filepaths, sizeof(shaders) / sizeof(*shaders));
+}
+
+static bool VkPathTracerCreateComputePipeline(VkPathTracerData* pathTracer, VkShaderData* shader, VkShaderData* const* layoutShaders, uint32_t layoutShaderCount, VkReflectedLayout* layout, VkPipeline* pipeline)
+{
+	VkData* vk = pathTracer->vk;
+	if (!VkAcquireReflectedLayout(vk, layoutShaders, layoutShaderCount, layout))
+		return false;
+
+	VkComputePipelineCreateInfo createInfo = {
+		.sType                     = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.pNext                     = NULL,
+		.flags                     = 0,
+		.stage.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+		.stage.pNext               = NULL,
+		.stage.flags               = 0,
+		.stage.stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+		.stage.module              = shader->handle,
+		.stage.pName               = "main",
+		.stage.pSpecializationInfo = NULL,
+		.layout                    = layout->layout,
+		.basePipelineHandle        = NULL,
+		.basePipelineIndex         = -1
+	};
+	return VkValidate(vk, vkCreateComputePipelines(vk->device, vk->pipelineCache, 1, &createInfo, vk->allocation, pipeline));
+}
+
+static bool VkPathTracerSetupSort(VkPathTracerData* pathTracer)
+{
+	VkReflectedLayout layout;
+	VkShaderData*     shader  = &pathTracer->sortShader;
+	bool              created = VkPathTracerCreateComputePipeline(pathTracer, shader, &shader, 1, &layout, &pathTracer->sortPipeline);
+	pathTracer->sortSetLayout = layout.setLayouts[0];
+	pathTracer->sortLayout    = layout.layout;
+	return created;
+}
+
+static void VkCmdPathTracerSort(VkCommandBuffer buffer, VkPathTracerData* pathTracer)
+{
+	VkMemoryBarrier2 barrier = {
+		.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.pNext         = NULL,
+		.srcStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		.dstStageMask  = VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+	};
+	VkDependencyInfo dependency = {
+		.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.pNext                    = NULL,
+		.dependencyFlags          = 0,
+		.memoryBarrierCount       = 1,
+		.pMemoryBarriers          = &barrier,
+		.bufferMemoryBarrierCount = 0,
+		.pBufferMemoryBarriers    = NULL,
+		.imageMemoryBarrierCount  = 0,
+		.pImageMemoryBarriers     = NULL
+	};
+	vkCmdPipelineBarrier2(buffer, &dependency);
+	vkCmdFillBuffer(buffer, pathTracer->bucketBuffer, 0, VK_WHOLE_SIZE, 0);
+
+	barrier.srcStageMask  = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	vkCmdPipelineBarrier2(buffer, &dependency);
+
+	VkPathTracerSortConstants constants = {
+		.pass  = 0,
+		.count = pathTracer->extent.width * pathTracer->extent.height
+	};
+	uint32_t groupCount = (constants.count + VK_PATH_TRACER_SORT_GROUP - 1) / VK_PATH_TRACER_SORT_GROUP;
+	vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pathTracer->sortPipeline);
+	vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pathTracer->sortLayout, 0, 1, &pathTracer->sortSet, 0, NULL);
+	barrier.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	for (uint32_t pass = 0; pass < 3; ++pass)
+	{
+		if (pass > 0)
+			vkCmdPipelineBarrier2(buffer, &dependency);
+		constants.pass = pass;
+		vkCmdPushConstants(buffer, pathTracer->sortLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(buffer, pass == 1 ? 1 : groupCount, 1, 1);
+	}
+}
+
+static bool VkPathTracerSetupWavefront(VkPathTracerData* pathTracer)
+{
+	VkReflectedLayout layout;
+	VkShaderData*     shaders[]      = { &pathTracer->wavefrontShader, &pathTracer->queryShader };
+	bool              created        = VkPathTracerCreateComputePipeline(pathTracer, shaders[0], shaders, 2, &layout, &pathTracer->wavefrontPipeline);
+	pathTracer->wavefrontSetLayout   = layout.setLayouts[0];
+	pathTracer->wavefrontBindingMask = layout.bindingMasks[0];
+	pathTracer->wavefrontBindless    = layout.setLayoutCount > VK_BINDLESS_SET;
+	pathTracer->wavefrontLayout      = layout.layout;
+	if (!created || !pathTracer->queryShader.handle)
+		return created;
+	created                 = VkPathTracerCreateComputePipeline(pathTracer, shaders[1], shaders, 2, &layout, &pathTracer->queryPipeline);
+	pathTracer->queryLayout = layout.layout;
+	return created;
+}
+
+static bool VkPathTracerSetupBvh(VkPathTracerData* pathTracer)
+{
+	VkData* vk = pathTracer->vk;
+	if (pathTracer->tlas->bvhDepth > VK_PATH_TRACER_BVH_STACK)
+	{
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Software acceleration structure is deeper than the traversal stack");
+		return false;
+	}
+
+	VkReflectedLayout layout;
+	VkShaderData*     shader  = &pathTracer->bvhShader;
+	bool              created = VkPathTracerCreateComputePipeline(pathTracer, shader, &shader, 1, &layout, &pathTracer->bvhPipeline);
+	pathTracer->bvhSetLayout  = layout.setLayouts[0];
+	pathTracer->bvhLayout     = layout.layout;
+	return created;
+}
+
+static VkPipelineStageFlags2 VkPathTracerShaderStages(VkPathTracerData* pathTracer)
+{
+	if (pathTracer->software)
+		return VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	return VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+}
+
+static void VkCmdPathTracerBarrier(VkCommandBuffer buffer, VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask)
+{
+	VkMemoryBarrier2 barrier = {
+		.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.pNext         = NULL,
+		.srcStageMask  = srcStageMask,
+		.srcAccessMask = srcAccessMask,
+		.dstStageMask  = dstStageMask,
+		.dstAccessMask = dstAccessMask
+	};
+	VkDependencyInfo dependency = {
+		.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.pNext                    = NULL,
+		.dependencyFlags          = 0,
+		.memoryBarrierCount       = 1,
+		.pMemoryBarriers          = &barrier,
+		.bufferMemoryBarrierCount = 0,
+		.pBufferMemoryBarriers    = NULL,
+		.imageMemoryBarrierCount  = 0,
+		.pImageMemoryBarriers     = NULL
+	};
+	vkCmdPipelineBarrier2(buffer, &dependency);
+}
+
+static void VkCmdPathTracerTimestamp(VkCommandBuffer buffer, VkPathTracerData* pathTracer, uint32_t* timestamp, VkPathTracerStage stage)
+{
+	if (*timestamp >= VK_PATH_TRACER_TIMESTAMPS)
+		return;
+
+	uint32_t query                     = pathTracer->frameSlot * VK_PATH_TRACER_TIMESTAMPS + *timestamp;
+	pathTracer->timestampStages[query] = (uint8_t) stage;
+	vkCmdWriteTimestamp2(buffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, pathTracer->timestampPool, query);
+	++*timestamp;
+}
+
+static uint32_t VkPathTracerTimestampCount(VkPathTracerData* pathTracer)
+{
+	uint32_t count = 2;
+	if (pathTracer->trace && pathTracer->wavefront)
+		count += 2 + 3 * (pathTracer->maxBounces + 1);
+	else if (pathTracer->trace)
+		count += pathTracer->sort ? 2 : 1;
+	return count < VK_PATH_TRACER_TIMESTAMPS ? count : VK_PATH_TRACER_TIMESTAMPS;
+}
+
+static void VkCmdPathTracerTraceRays(VkCommandBuffer buffer, VkPathTracerData* pathTracer, VkRayTracingPipelineData* rtPipeline, VkDescriptorSet set, const void* constants, uint32_t constantsSize, uint32_t indirectOffset)
+{
+	VkCmdBindRayTracingPipeline(buffer, rtPipeline);
+	vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rtPipeline->layout, 0, 1, &set, 0, NULL);
+	if (rtPipeline->bindless)
+		VkCmdBindBindless(buffer, pathTracer->vk, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rtPipeline->layout);
+	if (rtPipeline->pushConstantSize > 0)
+		vkCmdPushConstants(buffer, rtPipeline->layout, rtPipeline->pushConstantStages, 0, constantsSize < rtPipeline->pushConstantSize ? constantsSize : rtPipeline->pushConstantSize, constants);
+	if (pathTracer->wavefront)
+	{
+		VkBufferDeviceAddressInfo addressInfo = {
+			.sType  = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+			.pNext  = NULL,
+			.buffer = pathTracer->queueBuffers[VK_PATH_TRACER_QUEUE_ARGS]
+		};
+		vkCmdTraceRaysIndirectKHR(buffer,
+								  rtPipeline->regions + VK_SHADER_GROUP_KIND_RAYGEN,
+								  rtPipeline->regions + VK_SHADER_GROUP_KIND_MISS,
+								  rtPipeline->regions + VK_SHADER_GROUP_KIND_HIT,
+								  rtPipeline->regions + VK_SHADER_GROUP_KIND_CALLABLE,
+								  vkGetBufferDeviceAddress(pathTracer->vk->device, &addressInfo) + indirectOffset * sizeof(uint32_t));
+		return;
+	}
+	vkCmdTraceRaysKHR(buffer,
+					  rtPipeline->regions + VK_SHADER_GROUP_KIND_RAYGEN,
+					  rtPipeline->regions + VK_SHADER_GROUP_KIND_MISS,
+					  rtPipeline->regions + VK_SHADER_GROUP_KIND_HIT,
+					  rtPipeline->regions + VK_SHADER_GROUP_KIND_CALLABLE,
+					  pathTracer->extent.width,
+					  pathTracer->extent.height,
+					  1);
+}
+
+static void VkCmdPathTracerBindWavefront(VkCommandBuffer buffer, VkPathTracerData* pathTracer)
+{
+	vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pathTracer->wavefrontPipeline);
+	vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pathTracer->wavefrontLayout, 0, 1, &pathTracer->wavefrontSet, 0, NULL);
+}
+
+static void VkCmdPathTracerDispatch(VkCommandBuffer buffer, VkPathTracerData* pathTracer, const VkPathTracerWavefrontConstants* constants)
+{
+	uint32_t pixelCount = pathTracer->extent.width * pathTracer->extent.height;
+	vkCmdPushConstants(buffer, pathTracer->wavefrontLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(*constants), constants);
+	vkCmdDispatch(buffer, (pixelCount + VK_PATH_TRACER_WAVEFRONT_GROUP - 1) / VK_PATH_TRACER_WAVEFRONT_GROUP, 1, 1);
+}
+
+static void VkCmdPathTracerQuery(VkCommandBuffer buffer, VkPathTracerData* pathTracer, uint32_t pass, uint32_t queue)
+{
+	const float*               background = pathTracer->constants.background;
+	uint32_t                   args       = pass == 0 ? VK_PATH_TRACER_ARGS_EXTEND : VK_PATH_TRACER_ARGS_SHADOW;
+	VkPathTracerQueryConstants constants  = {
+		 .background = { background[0], background[1], background[2], background[3] },
+		 .vertices   = pathTracer->geometry[0],
+		 .indices    = pathTracer->geometry[1],
+		 .pass       = pass,
+		 .queue      = queue
+	};
+	vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pathTracer->queryPipeline);
+	vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pathTracer->queryLayout, 0, 1, &pathTracer->wavefrontSet, 0, NULL);
+	if (pathTracer->wavefrontBindless)
+		VkCmdBindBindless(buffer, pathTracer->vk, VK_PIPELINE_BIND_POINT_COMPUTE, pathTracer->queryLayout);
+	vkCmdPushConstants(buffer, pathTracer->queryLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatchIndirect(buffer, pathTracer->queueBuffers[VK_PATH_TRACER_QUEUE_ARGS], (args + 3) * sizeof(uint32_t));
+}
+
+static void VkCmdPathTracerArgs(VkCommandBuffer buffer, VkPathTracerData* pathTracer, const VkPathTracerWavefrontConstants* constants)
+{
+	VkPathTracerWavefrontConstants argsConstants = *constants;
+	argsConstants.pass                           = 3;
+	VkCmdPathTracerBarrier(buffer, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+	VkCmdPathTracerBindWavefront(buffer, pathTracer);
+	vkCmdPushConstants(buffer, pathTracer->wavefrontLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(argsConstants), &argsConstants);
+	vkCmdDispatch(buffer, 1, 1, 1);
+	VkCmdPathTracerBarrier(buffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+}
+
+static void VkCmdPathTracerBvh(VkCommandBuffer buffer, VkPathTracerData* pathTracer)
+{
+	vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pathTracer->bvhPipeline);
+	vkCmdBindDescriptorSets(buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pathTracer->bvhLayout, 0, 1, &pathTracer->descriptorSet, 0, NULL);
+	vkCmdPushConstants(buffer, pathTracer->bvhLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pathTracer->constants), &pathTracer->constants);
+	vkCmdDispatch(buffer, (pathTracer->extent.width + VK_PATH_TRACER_BVH_TILE - 1) / VK_PATH_TRACER_BVH_TILE, (pathTracer->extent.height + VK_PATH_TRACER_BVH_TILE - 1) / VK_PATH_TRACER_BVH_TILE, 1);
+}
+
+static void VkCmdPathTracerGenerate(VkCommandBuffer buffer, VkPathTracerData* pathTracer, uint32_t* timestamp)
+{
+	VkBuffer                       counters   = pathTracer->queueBuffers[VK_PATH_TRACER_QUEUE_COUNTERS];
+	uint32_t                       pixelCount = pathTracer->extent.width * pathTracer->extent.height;
+	VkAccessFlags2                 storage    = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	VkPipelineStageFlags2          shaders    = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	VkPathTracerWavefrontConstants constants  = {
+		 .view       = pathTracer->constants,
+		 .pass       = 0,
+		 .material   = 0,
+		 .bounce     = 0,
+		 .queue      = 0,
+		 .pixelCount = pixelCount
+	};
+
+	VkCmdPathTracerBarrier(buffer, shaders | VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+	vkCmdFillBuffer(buffer, counters, 0, sizeof(uint32_t), pixelCount);
+	vkCmdFillBuffer(buffer, counters, sizeof(uint32_t), VK_WHOLE_SIZE, 0);
+	VkCmdPathTracerBarrier(buffer, VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, shaders, storage);
+	VkCmdPathTracerBindWavefront(buffer, pathTracer);
+	VkCmdPathTracerDispatch(buffer, pathTracer, &constants);
+	VkCmdPathTracerTimestamp(buffer, pathTracer, timestamp, VK_PATH_TRACER_STAGE_GENERATE);
+}
+
+static void VkCmdPathTracerBounce(VkCommandBuffer buffer, VkPathTracerData* pathTracer, uint32_t bounce, uint32_t* timestamp)
+{
+	VkBuffer                       counters    = pathTracer->queueBuffers[VK_PATH_TRACER_QUEUE_COUNTERS];
+	VkDeviceSize                   statsSize   = VK_PATH_TRACER_QUEUE_STATS * sizeof(uint32_t);
+	VkDeviceSize                   statsOffset = (VkDeviceSize) pathTracer->frameSlot * (VK_PATH_TRACER_MAX_BOUNCES + 1) * statsSize;
+	VkAccessFlags2                 storage     = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	VkPipelineStageFlags2          shaders     = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	VkPathTracerWavefrontConstants constants   = {
+		  .view       = pathTracer->constants,
+		  .pass       = 0,
+		  .material   = 0,
+		  .bounce     = bounce,
+		  .queue      = bounce & 1,
+		  .pixelCount = pathTracer->extent.width * pathTracer->extent.height
+	};
+
+	VkCmdPathTracerBarrier(buffer, shaders | VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+	vkCmdFillBuffer(buffer, counters, (constants.queue ^ 1) * sizeof(uint32_t), sizeof(uint32_t), 0);
+	vkCmdFillBuffer(buffer, counters, 2 * sizeof(uint32_t), VK_WHOLE_SIZE, 0);
+	VkCmdPathTracerBarrier(buffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT, shaders, storage);
+	VkCmdPathTracerArgs(buffer, pathTracer, &constants);
+	if (pathTracer->queryExtend)
+		VkCmdPathTracerQuery(buffer, pathTracer, 0, constants.queue);
+	else
+		VkCmdPathTracerTraceRays(buffer, pathTracer, pathTracer->extendPipeline, pathTracer->wavefrontRaySet, &constants, sizeof(constants), VK_PATH_TRACER_ARGS_EXTEND);
+	VkCmdPathTracerTimestamp(buffer, pathTracer, timestamp, VK_PATH_TRACER_STAGE_EXTEND);
+
+	VkCmdPathTracerBarrier(buffer, shaders, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, storage);
+	VkCmdPathTracerArgs(buffer, pathTracer, &constants);
+	constants.pass = 1;
+	for (uint32_t material = 0; material < VK_PATH_TRACER_MATERIALS; ++material)
+	{
+		constants.material = material;
+		vkCmdPushConstants(buffer, pathTracer->wavefrontLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatchIndirect(buffer, pathTracer->queueBuffers[VK_PATH_TRACER_QUEUE_ARGS], (VK_PATH_TRACER_ARGS_MATERIALS + 3 * material) * sizeof(uint32_t));
+	}
+	VkCmdPathTracerTimestamp(buffer, pathTracer, timestamp, VK_PATH_TRACER_STAGE_SHADE);
+
+	VkCmdPathTracerBarrier(buffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, shaders, storage);
+	VkCmdPathTracerArgs(buffer, pathTracer, &constants);
+	if (pathTracer->queryShadow)
+		VkCmdPathTracerQuery(buffer, pathTracer, 1, constants.queue);
+	else
+		VkCmdPathTracerTraceRays(buffer, pathTracer, pathTracer->shadowPipeline, pathTracer->wavefrontRaySet, &constants, sizeof(constants), VK_PATH_TRACER_ARGS_SHADOW);
+	VkCmdPathTracerTimestamp(buffer, pathTracer, timestamp, VK_PATH_TRACER_STAGE_SHADOW);
+
+	VkBufferCopy region = {
+		.srcOffset = 0,
+		.dstOffset = statsOffset + bounce * statsSize,
+		.size      = statsSize
+	};
+	VkCmdPathTracerBarrier(buffer, shaders, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+	vkCmdCopyBuffer(buffer, counters, pathTracer->statsBuffer, 1, &region);
+}
+
+static void VkCmdPathTracerResolve(VkCommandBuffer buffer, VkPathTracerData* pathTracer, uint32_t* timestamp)
+{
+	VkAccessFlags2                 storage   = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	VkPipelineStageFlags2          shaders   = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	VkPathTracerWavefrontConstants constants = {
+		.view       = pathTracer->constants,
+		.pass       = 2,
+		.material   = 0,
+		.bounce     = pathTracer->maxBounces,
+		.queue      = pathTracer->maxBounces & 1,
+		.pixelCount = pathTracer->extent.width * pathTracer->extent.height
+	};
+
+	VkCmdPathTracerBarrier(buffer, shaders, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, storage);
+	VkCmdPathTracerBindWavefront(buffer, pathTracer);
+	VkCmdPathTracerDispatch(buffer, pathTracer, &constants);
+	VkCmdPathTracerTimestamp(buffer, pathTracer, timestamp, VK_PATH_TRACER_STAGE_RESOLVE);
+}
+
+static bool VkPathTracerCreateDescriptors(VkPathTracerData* pathTracer)
+{
+	VkData* vk        = pathTracer->vk;
+	bool    wavefront = !pathTracer->software && pathTracer->wavefrontSetLayout;
+
+	VkDescriptorPoolSize softwarePoolSizes[] = {
+		{.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 2},
+		{ .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 3}
+	};
+	VkDescriptorPoolSize poolSizes[] = {
+		{.type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, .descriptorCount = 3},
+		{ .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 6},
+		{ .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 6 + 2 * VK_PATH_TRACER_QUEUE_COUNT}
+	};
+	VkDescriptorPoolCreateInfo poolCreateInfo = {
+		.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext         = NULL,
+		.flags         = 0,
+		.maxSets       = pathTracer->software ? 1 : 4,
+		.poolSizeCount = pathTracer->software ? sizeof(softwarePoolSizes) / sizeof(*softwarePoolSizes) : sizeof(poolSizes) / sizeof(*poolSizes),
+		.pPoolSizes    = pathTracer->software ? softwarePoolSizes : poolSizes
+	};
+	if (!VkValidate(vk, vkCreateDescriptorPool(vk->device, &poolCreateInfo, vk->allocation, &pathTracer->descriptorPool)))
+		return false;
+
+	VkDescriptorSetLayout setLayouts[4];
+	uint32_t              setCount = 0;
+	if (pathTracer->software)
+	{
+		setLayouts[setCount++] = pathTracer->bvhSetLayout;
+	}
+	else
+	{
+		setLayouts[setCount++] = pathTracer->rtPipeline->setLayout;
+		setLayouts[setCount++] = pathTracer->sortSetLayout;
+		if (wavefront)
+		{
+			setLayouts[setCount++] = pathTracer->wavefrontSetLayout;
+			setLayouts[setCount++] = pathTracer->extendPipeline->setLayout;
+		}
+	}
+	VkDescriptorSet             sets[4];
+	VkDescriptorSetAllocateInfo setAllocInfo = {
+		.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext              = NULL,
+		.descriptorPool     = pathTracer->descriptorPool,
+		.descriptorSetCount = setCount,
+		.pSetLayouts        = setLayouts
+	};
+	if (!VkValidate(vk, vkAllocateDescriptorSets(vk->device, &setAllocInfo, sets)))
+		return false;
+	pathTracer->descriptorSet   = sets[0];
+	pathTracer->sortSet         = pathTracer->software ? NULL : sets[1];
+	pathTracer->wavefrontSet    = wavefront ? sets[2] : NULL;
+	pathTracer->wavefrontRaySet = wavefront ? sets[3] : NULL;
+	return true;
+}
+
+static bool VkPathTracerSetupSoftware(VkPathTracerData* pathTracer)
+{
+	if (!VkPathTracerSetupShaders(pathTracer, false) ||
+		!VkPathTracerSetupBvh(pathTracer) ||
+		!VkPathTracerCreateDescriptors(pathTracer))
+	{
+		VkCleanupPathTracer(pathTracer);
+		return false;
+	}
+	return true;
+}
+
+bool VkSetupPathTracer(VkPathTracerData* pathTracer)
+{
+	if (!pathTracer || !pathTracer->vk || !pathTracer->tlas || (!pathTracer->rtPipeline && !pathTracer->tlas->bvhNodeCount)) return false;
+
+	VkData* vk = pathTracer->vk;
+	if (pathTracer->maxBounces == 0)
+		pathTracer->maxBounces = 4;
+	if (pathTracer->maxBounces > VK_PATH_TRACER_MAX_BOUNCES)
+		pathTracer->maxBounces = VK_PATH_TRACER_MAX_BOUNCES;
+	if (pathTracer->samplesPerFrame == 0)
+		pathTracer->samplesPerFrame = 1;
+	pathTracer->extent            = (VkExtent2D) { 0, 0 };
+	pathTracer->accumImage        = NULL;
+	pathTracer->accumAllocation   = NULL;
+	pathTracer->accumView         = NULL;
+	pathTracer->outputImage       = NULL;
+	pathTracer->outputAllocation  = NULL;
+	pathTracer->outputView        = NULL;
+	pathTracer->imagesInitialized = false;
+	pathTracer->descriptorPool    = NULL;
+	pathTracer->descriptorSet     = NULL;
+	pathTracer->retiredCount      = 0;
+	pathTracer->retiredCapacity   = 0;
+	pathTracer->retired           = NULL;
+	pathTracer->framesGeneration  = 0;
+	pathTracer->counterCount      = 0;
+	pathTracer->counterBuffer     = NULL;
+	pathTracer->counterAllocation = NULL;
+	pathTracer->counters          = NULL;
+	pathTracer->counterSamples    = NULL;
+	pathTracer->wavefrontLayout   = NULL;
+	pathTracer->wavefrontPipeline = NULL;
+	pathTracer->wavefrontSet      = NULL;
+	pathTracer->wavefrontRaySet   = NULL;
+	pathTracer->queryLayout       = NULL;
+	pathTracer->queryPipeline     = NULL;
+	pathTracer->bvhSetLayout      = NULL;
+	pathTracer->bvhLayout         = NULL;
+	pathTracer->bvhPipeline       = NULL;
+	pathTracer->software          = !pathTracer->rtPipeline;
+	pathTracer->statsBuffer       = NULL;
+	pathTracer->statsAllocation   = NULL;
+	pathTracer->stats             = NULL;
+	pathTracer->statsBounces      = NULL;
+	pathTracer->timestampPool     = NULL;
+	pathTracer->timestampCounts   = NULL;
+	pathTracer->timestampStages   = NULL;
+	pathTracer->timestampPeriod   = vk->deviceProps.properties.limits.timestampPeriod;
+	pathTracer->viewPipelines[0]  = NULL;
+	pathTracer->viewPipelines[1]  = NULL;
+	pathTracer->viewMode          = VK_PATH_TRACER_MODE_MEGAKERNEL;
+	pathTracer->sortSetLayout     = NULL;
+	pathTracer->sortLayout        = NULL;
+	pathTracer->sortPipeline      = NULL;
+	pathTracer->sortSet           = NULL;
+	pathTracer->keyBuffer         = NULL;
+	pathTracer->keyAllocation     = NULL;
+	pathTracer->bucketBuffer      = NULL;
+	pathTracer->bucketAllocation  = NULL;
+	pathTracer->orderBuffer       = NULL;
+	pathTracer->orderAllocation   = NULL;
+	pathTracer->sortValid         = false;
+	pathTracer->sort              = false;
+	pathTracer->sampleCount       = 0;
+	pathTracer->frameSlot         = 0;
+	pathTracer->active            = false;
+	pathTracer->initialize        = false;
+	pathTracer->trace             = false;
+	pathTracer->wavefront         = false;
+	pathTracer->queryExtend       = false;
+	pathTracer->queryShadow       = false;
+	pathTracer->samplesTraced     = 0;
+	pathTracer->raysTraced        = 0;
+
+	pathTracer->wavefrontSetLayout   = NULL;
+	pathTracer->wavefrontBindingMask = 0;
+	pathTracer->wavefrontBindless    = false;
+	for (uint32_t i = 0; i < VK_PATH_TRACER_QUEUE_COUNT; ++i)
+	{
+		pathTracer->queueBuffers[i]     = NULL;
+		pathTracer->queueAllocations[i] = NULL;
+	}
+	memset(&pathTracer->view, 0, sizeof(pathTracer->view));
+	memset(&pathTracer->constants, 0, sizeof(pathTracer->constants));
+	memset(&pathTracer->sortShader, 0, sizeof(pathTracer->sortShader));
+	memset(&pathTracer->wavefrontShader, 0, sizeof(pathTracer->wavefrontShader));
+	memset(&pathTracer->queryShader, 0, sizeof(pathTracer->queryShader));
+	memset(&pathTracer->bvhShader, 0, sizeof(pathTracer->bvhShader));
+	VkResetPathTracerStats(pathTracer);
+	if (pathTracer->software)
+		return VkPathTracerSetupSoftware(pathTracer);
+
+	bool wavefront = pathTracer->extendPipeline && pathTracer->shadowPipeline;
+	if (!VkPathTracerSetupShaders(pathTracer, wavefront) ||
+		!VkPathTracerSetupSort(pathTracer) ||
+		(wavefront && !VkPathTracerSetupWavefront(pathTracer)) ||
+		!VkPathTracerCreateDescriptors(pathTracer))
+	{
+		VkCleanupPathTracer(pathTracer);
+		return false;
+	}
+	return true;
+}
+
+void VkCleanupPathTracer(VkPathTracerData* pathTracer)
+{
+	if (!pathTracer || !pathTracer->vk) return;
+
+	VkData* vk = pathTracer->vk;
+	VkCollectRetiredPathTracer(pathTracer, true);
+	free(pathTracer->retired);
+	VkPathTracerDestroyImages(pathTracer);
+	VkPathTracerDestroyCounters(pathTracer);
+	vkDestroyDescriptorPool(vk->device, pathTracer->descriptorPool, vk->allocation);
+	vkDestroyPipeline(vk->device, pathTracer->sortPipeline, vk->allocation);
+	VkReleasePipelineLayout(vk, pathTracer->sortLayout);
+	vkDestroyPipeline(vk->device, pathTracer->wavefrontPipeline, vk->allocation);
+	VkReleasePipelineLayout(vk, pathTracer->wavefrontLayout);
+	vkDestroyPipeline(vk->device, pathTracer->queryPipeline, vk->allocation);
+	VkReleasePipelineLayout(vk, pathTracer->queryLayout);
+	vkDestroyPipeline(vk->device, pathTracer->bvhPipeline, vk->allocation);
+	VkReleasePipelineLayout(vk, pathTracer->bvhLayout);
+	VkCleanupShader(&pathTracer->sortShader);
+	VkCleanupShader(&pathTracer->wavefrontShader);
+	VkCleanupShader(&pathTracer->queryShader);
+	VkCleanupShader(&pathTracer->bvhShader);
+	pathTracer->descriptorPool    = NULL;
+	pathTracer->descriptorSet     = NULL;
+	pathTracer->sortPipeline      = NULL;
+	pathTracer->sortLayout        = NULL;
+	pathTracer->sortSetLayout     = NULL;
+	pathTracer->sortSet           = NULL;
+	pathTracer->wavefrontPipeline = NULL;
+	pathTracer->wavefrontLayout   = NULL;
+	pathTracer->wavefrontSet      = NULL;
+	pathTracer->wavefrontRaySet   = NULL;
+	pathTracer->queryPipeline     = NULL;
+	pathTracer->queryLayout       = NULL;
+	pathTracer->bvhPipeline       = NULL;
+	pathTracer->bvhLayout         = NULL;
+	pathTracer->bvhSetLayout      = NULL;
+	pathTracer->retiredCount      = 0;
+	pathTracer->retiredCapacity   = 0;
+	pathTracer->retired           = NULL;
+	pathTracer->active            = false;
+
+	pathTracer->wavefrontSetLayout   = NULL;
+	pathTracer->wavefrontBindingMask = 0;
+	pathTracer->wavefrontBindless    = false;
+}
+
+bool VkPreparePathTracer(VkPathTracerData* pathTracer, VkSwapchainData* swapchain, const VkPathTracerView* view)
+{
+	if (!pathTracer || !swapchain || !view) return false;
+
+	VkData* vk              = pathTracer->vk;
+	pathTracer->active      = false;
+	pathTracer->trace       = false;
+	pathTracer->sort        = false;
+	pathTracer->wavefront   = pathTracer->mode == VK_PATH_TRACER_MODE_WAVEFRONT && pathTracer->wavefrontPipeline;
+	pathTracer->queryExtend = pathTracer->wavefront && pathTracer->extendBackend == VK_PATH_TRACER_BACKEND_QUERY && pathTracer->queryPipeline;
+	pathTracer->queryShadow = pathTracer->wavefront && pathTracer->shadowBackend == VK_PATH_TRACER_BACKEND_QUERY && pathTracer->queryPipeline;
+	if (!vk->traceRaysIndirectSupported && !(pathTracer->queryExtend && pathTracer->queryShadow))
+	{
+		pathTracer->wavefront   = false;
+		pathTracer->queryExtend = false;
+		pathTracer->queryShadow = false;
+	}
+
+	VkPipeline pipelines[2] = {
+		pathTracer->software ? pathTracer->bvhPipeline : pathTracer->wavefront ? pathTracer->extendPipeline->handle : pathTracer->rtPipeline->handle,
+		pathTracer->wavefront ? pathTracer->shadowPipeline->handle : NULL
+	};
+	if (!pipelines[0] || (pathTracer->wavefront && !pipelines[1]) || swapchain->extent.width == 0 || swapchain->extent.height == 0)
+		return true;
+
+	bool written = false;
+	if (pathTracer->framesGeneration != vk->framesGeneration || pathTracer->counterCount < vk->framesCapacity)
+	{
+		for (uint32_t i = 0; i < pathTracer->counterCount; ++i)
+			VkPathTracerCollectCounter(pathTracer, i);
+		VkPathTracerDestroyCounters(pathTracer);
+		if (!VkPathTracerCreateCounters(pathTracer, vk->framesCapacity))
+			return false;
+		pathTracer->framesGeneration = vk->framesGeneration;
+		written                      = true;
+	}
+	else
+	{
+		VkPathTracerCollectCounter(pathTracer, vk->currentFrame);
+	}
+
+	VkCollectRetiredPathTracer(pathTracer, false);
+	if (pathTracer->extent.width != swapchain->extent.width || pathTracer->extent.height != swapchain->extent.height)
+	{
+		if (!VkRetirePathTracerImages(pathTracer) ||
+			!VkPathTracerCreateDescriptors(pathTracer) ||
+			!VkPathTracerCreateImages(pathTracer, swapchain->extent))
+			return false;
+		pathTracer->sampleCount = 0;
+		written                 = true;
+	}
+	if (written && pathTracer->software)
+		VkPathTracerWriteBvhDescriptors(pathTracer);
+	else if (written)
+		VkPathTracerWriteDescriptors(pathTracer);
+	if (pathTracer->wavefront && !pathTracer->queueBuffers[0])
+	{
+		if (!VkPathTracerCreateQueues(pathTracer))
+			return false;
+		VkPathTracerWriteWavefrontDescriptors(pathTracer);
+	}
+
+	VkPathTracerMode mode = pathTracer->wavefront ? VK_PATH_TRACER_MODE_WAVEFRONT : VK_PATH_TRACER_MODE_MEGAKERNEL;
+	if (memcmp(pathTracer->viewPipelines, pipelines, sizeof(pipelines)) != 0 || pathTracer->viewMode != mode || memcmp(&pathTracer->view, view, sizeof(*view)) != 0)
+	{
+		pathTracer->view             = *view;
+		pathTracer->viewPipelines[0] = pipelines[0];
+		pathTracer->viewPipelines[1] = pipelines[1];
+		pathTracer->viewMode         = mode;
+		pathTracer->sampleCount      = 0;
+	}
+
+	pathTracer->frameSlot         = vk->currentFrame;
+	pathTracer->active            = true;
+	pathTracer->initialize        = !pathTracer->imagesInitialized;
+	pathTracer->imagesInitialized = true;
+	pathTracer->trace             = pathTracer->maxSamples == 0 || pathTracer->sampleCount < pathTracer->maxSamples;
+	pathTracer->sort              = pathTracer->trace && pathTracer->sortHits && !pathTracer->wavefront && !pathTracer->software;
+
+	pathTracer->timestampCounts[vk->currentFrame] = VkPathTracerTimestampCount(pathTracer);
+	if (!pathTracer->trace)
+		return true;
+
+	uint32_t samples = pathTracer->wavefront || pathTracer->software ? 1 : pathTracer->samplesPerFrame;
+	VkPathTracerSetupConstants(pathTracer, vk->currentFrame);
+	pathTracer->counterSamples[vk->currentFrame] += (uint64_t) pathTracer->extent.width * pathTracer->extent.height * samples;
+	pathTracer->sampleCount                      += samples;
+	pathTracer->sortValid                         = pathTracer->sort;
+	if (pathTracer->wavefront)
+		pathTracer->statsBounces[vk->currentFrame] = pathTracer->maxBounces + 1;
+	return true;
+}
+
+void VkResetPathTracer(VkPathTracerData* pathTracer)
+{
+	if (!pathTracer) return;
+
+	pathTracer->sampleCount = 0;
+}
+
+void VkResetPathTracerStats(VkPathTracerData* pathTracer)
+{
+	if (!pathTracer) return;
+
+	pathTracer->timedFrames = 0;
+	pathTracer->queuePixels = 0;
+	memset(pathTracer->stageTimes, 0, sizeof(pathTracer->stageTimes));
+	memset(pathTracer->queueRays, 0, sizeof(pathTracer->queueRays));
+	memset(pathTracer->queueShadows, 0, sizeof(pathTracer->queueShadows));
+	memset(pathTracer->queueHits, 0, sizeof(pathTracer->queueHits));
+}
+
+uint32_t VkPathTracerPassCount(VkPathTracerData* pathTracer)
+{
+	if (!pathTracer || !pathTracer->active) return 0;
+
+	return pathTracer->trace && pathTracer->wavefront ? pathTracer->maxBounces + 3 : 1;
+}
+
+static void VkCmdPathTracerBegin(VkCommandBuffer buffer, VkPathTracerData* pathTracer, uint32_t* timestamp)
+{
+	VkPipelineStageFlags2 shaders = VkPathTracerShaderStages(pathTracer);
+
+	VkImageMemoryBarrier2 imageBarriers[2];
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		VkImageMemoryBarrier2* barrier           = imageBarriers + i;
+		barrier->sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier->pNext                           = NULL;
+		barrier->srcStageMask                    = shaders | VK_PIPELINE_STAGE_2_BLIT_BIT;
+		barrier->srcAccessMask                   = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+		barrier->dstStageMask                    = shaders;
+		barrier->dstAccessMask                   = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+		barrier->oldLayout                       = pathTracer->initialize ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_GENERAL;
+		barrier->newLayout                       = VK_IMAGE_LAYOUT_GENERAL;
+		barrier->srcQueueFamilyIndex             = 0;
+		barrier->dstQueueFamilyIndex             = 0;
+		barrier->image                           = i == 0 ? pathTracer->accumImage : pathTracer->outputImage;
+		barrier->subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier->subresourceRange.baseMipLevel   = 0;
+		barrier->subresourceRange.levelCount     = 1;
+		barrier->subresourceRange.baseArrayLayer = 0;
+		barrier->subresourceRange.layerCount     = 1;
+	}
+	VkMemoryBarrier2 orderBarrier = {
+		.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.pNext         = NULL,
+		.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		.dstStageMask  = shaders,
+		.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+	};
+	VkDependencyInfo traceDependency = {
+		.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.pNext                    = NULL,
+		.dependencyFlags          = 0,
+		.memoryBarrierCount       = 1,
+		.pMemoryBarriers          = &orderBarrier,
+		.bufferMemoryBarrierCount = 0,
+		.pBufferMemoryBarriers    = NULL,
+		.imageMemoryBarrierCount  = 2,
+		.pImageMemoryBarriers     = imageBarriers
+	};
+	vkCmdResetQueryPool(buffer, pathTracer->timestampPool, pathTracer->frameSlot * VK_PATH_TRACER_TIMESTAMPS, VK_PATH_TRACER_TIMESTAMPS);
+	VkCmdPathTracerTimestamp(buffer, pathTracer, timestamp, VK_PATH_TRACER_STAGE_COUNT);
+	if (pathTracer->trace)
+		vkCmdPipelineBarrier2(buffer, &traceDependency);
+}
+
+static void VkCmdPathTracerEnd(VkCommandBuffer buffer, VkPathTracerData* pathTracer, VkSwapchainData* swapchain, uint32_t* timestamp)
+{
+	VkImage               target  = swapchain->images[swapchain->imageIndex];
+	VkPipelineStageFlags2 shaders = VkPathTracerShaderStages(pathTracer);
+
+	VkMemoryBarrier2 counterBarrier = {
+		.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.pNext         = NULL,
+		.srcStageMask  = shaders | VK_PIPELINE_STAGE_2_COPY_BIT,
+		.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.dstStageMask  = VK_PIPELINE_STAGE_2_HOST_BIT,
+		.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT
+	};
+	VkImageMemoryBarrier2 imageBarriers[2];
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		VkImageMemoryBarrier2* barrier           = imageBarriers + i;
+		barrier->sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier->pNext                           = NULL;
+		barrier->srcQueueFamilyIndex             = 0;
+		barrier->dstQueueFamilyIndex             = 0;
+		barrier->subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier->subresourceRange.baseMipLevel   = 0;
+		barrier->subresourceRange.levelCount     = 1;
+		barrier->subresourceRange.baseArrayLayer = 0;
+		barrier->subresourceRange.layerCount     = 1;
+	}
+	VkImageMemoryBarrier2* outputBarrier = imageBarriers + 0;
+	outputBarrier->srcStageMask          = shaders;
+	outputBarrier->srcAccessMask         = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	outputBarrier->dstStageMask          = VK_PIPELINE_STAGE_2_BLIT_BIT;
+	outputBarrier->dstAccessMask         = VK_ACCESS_2_TRANSFER_READ_BIT;
+	outputBarrier->oldLayout             = VK_IMAGE_LAYOUT_GENERAL;
+	outputBarrier->newLayout             = VK_IMAGE_LAYOUT_GENERAL;
+	outputBarrier->image                 = pathTracer->outputImage;
+	VkImageMemoryBarrier2* targetBarrier = imageBarriers + 1;
+	targetBarrier->srcStageMask          = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	targetBarrier->srcAccessMask         = VK_ACCESS_2_NONE;
+	targetBarrier->dstStageMask          = VK_PIPELINE_STAGE_2_BLIT_BIT;
+	targetBarrier->dstAccessMask         = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	targetBarrier->oldLayout             = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	targetBarrier->newLayout             = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	targetBarrier->image                 = target;
+	VkDependencyInfo blitDependency = {
+		.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.pNext                    = NULL,
+		.dependencyFlags          = 0,
+		.memoryBarrierCount       = 1,
+		.pMemoryBarriers          = &counterBarrier,
+		.bufferMemoryBarrierCount = 0,
+		.pBufferMemoryBarriers    = NULL,
+		.imageMemoryBarrierCount  = 2,
+		.pImageMemoryBarriers     = imageBarriers
+	};
+	vkCmdPipelineBarrier2(buffer, &blitDependency);
+
+	VkImageBlit region = {
+		.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+		.srcOffsets     = { { 0, 0, 0 }, { (int32_t) pathTracer->extent.width, (int32_t) pathTracer->extent.height, 1 } },
+		.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+		.dstOffsets     = { { 0, 0, 0 }, { (int32_t) swapchain->extent.width, (int32_t) swapchain->extent.height, 1 } }
+	};
+	vkCmdBlitImage(buffer, pathTracer->outputImage, VK_IMAGE_LAYOUT_GENERAL, target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_NEAREST);
+	VkCmdPathTracerTimestamp(buffer, pathTracer, timestamp, VK_PATH_TRACER_STAGE_BLIT);
+
+	targetBarrier->srcStageMask  = VK_PIPELINE_STAGE_2_BLIT_BIT;
+	targetBarrier->srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	targetBarrier->dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	targetBarrier->dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+	targetBarrier->oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	targetBarrier->newLayout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	VkDependencyInfo presentDependency = {
+		.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.pNext                    = NULL,
+		.dependencyFlags          = 0,
+		.memoryBarrierCount       = 0,
+		.pMemoryBarriers          = NULL,
+		.bufferMemoryBarrierCount = 0,
+		.pBufferMemoryBarriers    = NULL,
+		.imageMemoryBarrierCount  = 1,
+		.pImageMemoryBarriers     = targetBarrier
+	};
+	vkCmdPipelineBarrier2(buffer, &presentDependency);
+}
+
+void VkCmdPathTracePass(VkCommandBuffer buffer, VkPathTracerData* pathTracer, VkSwapchainData* swapchain, uint32_t pass)
+{
+	uint32_t passCount = VkPathTracerPassCount(pathTracer);
+	if (!buffer || pass >= passCount || !swapchain) return;
+
+	uint32_t timestamp = 0;
+	if (pass > 0)
+		timestamp = 2 + 3 * (pass - 1);
+	if (pass == 0)
+		VkCmdPathTracerBegin(buffer, pathTracer, &timestamp);
+	if (pathTracer->trace && pathTracer->wavefront)
+	{
+		if (pass == 0)
+			VkCmdPathTracerGenerate(buffer, pathTracer, &timestamp);
+		else if (pass + 1 < passCount)
+			VkCmdPathTracerBounce(buffer, pathTracer, pass - 1, &timestamp);
+		else
+			VkCmdPathTracerResolve(buffer, pathTracer, &timestamp);
+	}
+	else if (pathTracer->trace && pathTracer->software)
+	{
+		VkCmdPathTracerBvh(buffer, pathTracer);
+		VkCmdPathTracerTimestamp(buffer, pathTracer, &timestamp, VK_PATH_TRACER_STAGE_MEGAKERNEL);
+	}
+	else if (pathTracer->trace)
+	{
+		VkCmdPathTracerTraceRays(buffer, pathTracer, pathTracer->rtPipeline, pathTracer->descriptorSet, &pathTracer->constants, sizeof(pathTracer->constants), 0);
+		VkCmdPathTracerTimestamp(buffer, pathTracer, &timestamp, VK_PATH_TRACER_STAGE_MEGAKERNEL);
+	}
+	if (pathTracer->sort)
+	{
+		VkCmdPathTracerSort(buffer, pathTracer);
+		VkCmdPathTracerTimestamp(buffer, pathTracer, &timestamp, VK_PATH_TRACER_STAGE_SORT);
+	}
+	if (pass + 1 == passCount)
+		VkCmdPathTracerEnd(buffer, pathTracer, swapchain, &timestamp);
+}
+
+void VkCmdPathTrace(VkCommandBuffer buffer, VkPathTracerData* pathTracer, VkSwapchainData* swapchain)
+{
+	uint32_t passCount = VkPathTracerPassCount(pathTracer);
+	for (uint32_t pass = 0; pass < passCount; ++pass)
+		VkCmdPathTracePass(buffer, pathTracer, swapchain, pass);
+}
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include "Atomic.h"
+#include "Filesystem.h"
+#include "Vk.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#define VK_PIPELINE_CACHE_MAGIC   0x43504C57U
+#define VK_PIPELINE_CACHE_VERSION 1U
+
+typedef struct VkPipelineCacheFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t dataSize;
+	uint64_t checksum;
+} VkPipelineCacheFileHeader;
+
+static uint64_t VkPipelineCacheChecksum(const uint8_t* data, size_t dataSize)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < dataSize; ++i)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+static bool VkPipelineCacheCompatible(VkData* vk, const uint8_t* data, size_t dataSize)
+{
+	VkPipelineCacheHeaderVersionOne header;
+	if (dataSize < sizeof(header))
+		return false;
+	memcpy(&header, data, sizeof(header));
+
+	const VkPhysicalDeviceProperties* props = &vk->deviceProps.properties;
+	return header.headerSize >= sizeof(header) &&
+		   header.headerSize <= dataSize &&
+		   header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		   header.vendorID == props->vendorID &&
+		   header.deviceID == props->deviceID &&
+		   memcmp(header.pipelineCacheUUID, props->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+static uint8_t* VkReadPipelineCacheFile(VkData* vk, size_t* dataSize)
+{
+	VkPipelineCacheStoreData* store = &vk->pipelineCacheStore;
+
+	*dataSize       = 0;
+	FILE* cacheFile = fopen(store->filepath, "rb");
+	if (!cacheFile)
+		return NULL;
+
+	VkPipelineCacheFileHeader header;
+	fseek(cacheFile, 0, SEEK_END);
+	long fileSize = ftell(cacheFile);
+	fseek(cacheFile, 0, SEEK_SET);
+	if (fileSize < (long) sizeof(header) ||
+		fread(&header, sizeof(header), 1, cacheFile) != 1 ||
+		header.magic != VK_PIPELINE_CACHE_MAGIC ||
+		header.version != VK_PIPELINE_CACHE_VERSION ||
+		header.dataSize != (uint64_t) fileSize - sizeof(header))
+	{
+		fclose(cacheFile);
+		store->rejected = true;
+		return NULL;
+	}
+
+	uint8_t* data = (uint8_t*) malloc(header.dataSize * sizeof(uint8_t));
+	if (!data)
+	{
+		fclose(cacheFile);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate pipeline cache data");
+		return NULL;
+	}
+	if (fread(data, sizeof(uint8_t), header.dataSize, cacheFile) != header.dataSize ||
+		VkPipelineCacheChecksum(data, header.dataSize) != header.checksum ||
+		!VkPipelineCacheCompatible(vk, data, header.dataSize))
+	{
+		fclose(cacheFile);
+		free(data);
+		store->rejected = true;
+		return NULL;
+	}
+	fclose(cacheFile);
+	*dataSize = header.dataSize;
+	return data;
+}
+
+static uint8_t* VkGetPipelineCacheData(VkData* vk, VkPipelineCache cache, size_t offset, size_t* dataSize)
+{
+	*dataSize = 0;
+	if (!VkValidate(vk, vkGetPipelineCacheData(vk->device, cache, dataSize, NULL)))
+		return NULL;
+
+	uint8_t* data = (uint8_t*) malloc((offset + *dataSize) * sizeof(uint8_t));
+	if (!data)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate pipeline cache data");
+		return NULL;
+	}
+	VkResult allowed[] = { VK_INCOMPLETE };
+	if (!VkValidateAllowed(vk, vkGetPipelineCacheData(vk->device, cache, dataSize, data + offset), allowed, sizeof(allowed) / sizeof(*allowed)))
+	{
+		free(data);
+		return NULL;
+	}
+	return data;
+}
+
+bool VkSetupPipelineCache(VkData* vk)
+{
+	if (!vk) return false;
+
+	VkPipelineCacheStoreData* store = &vk->pipelineCacheStore;
+	if (!store->filepath)
+		store->filepath = "pipelines.cache";
+	if (store->saveInterval == 0.0)
+		store->saveInterval = 30.0;
+	store->lastSaveTime        = glfwGetTime();
+	store->loadedSize          = 0;
+	store->savedSize           = 0;
+	store->rejected            = false;
+	store->pipelineCount       = 0;
+	store->pipelineHits        = 0;
+	store->stageCount          = 0;
+	store->stageHits           = 0;
+	store->creationNanoseconds = 0;
+
+	size_t   dataSize = 0;
+	uint8_t* data     = VkReadPipelineCacheFile(vk, &dataSize);
+
+	VkPipelineCacheCreateInfo createInfo = {
+		.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.pNext           = NULL,
+		.flags           = 0,
+		.initialDataSize = dataSize,
+		.pInitialData    = data
+	};
+	if (!VkValidate(vk, vkCreatePipelineCache(vk->device, &createInfo, vk->allocation, &vk->pipelineCache)))
+	{
+		free(data);
+		return false;
+	}
+	free(data);
+	store->loadedSize = dataSize;
+	store->savedSize  = dataSize;
+	return true;
+}
+
+void VkCleanupPipelineCache(VkData* vk)
+{
+	if (!vk || !vk->pipelineCache) return;
+
+	VkSavePipelineCache(vk);
+	vkDestroyPipelineCache(vk->device, vk->pipelineCache, vk->allocation);
+	vk->pipelineCache = NULL;
+}
+
+bool VkSavePipelineCache(VkData* vk)
+{
+	if (!vk || !vk->pipelineCache) return false;
+
+	VkPipelineCacheStoreData* store = &vk->pipelineCacheStore;
+	store->lastSaveTime             = glfwGetTime();
+
+	VkPipelineCacheFileHeader header;
+	size_t                    dataSize = 0;
+	uint8_t*                  data     = VkGetPipelineCacheData(vk, vk->pipelineCache, sizeof(header), &dataSize);
+	if (!data)
+		return false;
+	header.magic    = VK_PIPELINE_CACHE_MAGIC;
+	header.version  = VK_PIPELINE_CACHE_VERSION;
+	header.dataSize = dataSize;
+	header.checksum = VkPipelineCacheChecksum(data + sizeof(header), dataSize);
+	memcpy(data, &header, sizeof(header));
+
+	FSPath tempPath  = FSCreatePath(store->filepath, ~0ULL);
+	FSPath cachePath = FSCreatePath(store->filepath, ~0ULL);
+	if (!tempPath.buf || !cachePath.buf || !FSPathConcat(&tempPath, ".tmp"))
+	{
+		FSDestroyPath(&tempPath);
+		FSDestroyPath(&cachePath);
+		free(data);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate pipeline cache path");
+		return false;
+	}
+
+	bool  written   = false;
+	FILE* cacheFile = fopen(tempPath.buf, "wb");
+	if (cacheFile)
+	{
+		written = fwrite(data, sizeof(uint8_t), sizeof(header) + dataSize, cacheFile) == sizeof(header) + dataSize;
+		written = fclose(cacheFile) == 0 && written;
+	}
+	free(data);
+	if (!written || !FSReplaceFile(&tempPath, &cachePath))
+	{
+		FSDestroyPath(&tempPath);
+		FSDestroyPath(&cachePath);
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Failed to write pipeline cache");
+		return false;
+	}
+	FSDestroyPath(&tempPath);
+	FSDestroyPath(&cachePath);
+	store->savedSize = dataSize;
+	return true;
+}
+
+void VkUpdatePipelineCache(VkData* vk)
+{
+	if (!vk || !vk->pipelineCache) return;
+
+	VkPipelineCacheStoreData* store = &vk->pipelineCacheStore;
+	if (store->saveInterval < 0.0 || glfwGetTime() - store->lastSaveTime < store->saveInterval)
+		return;
+
+	size_t dataSize = 0;
+	if (!VkValidate(vk, vkGetPipelineCacheData(vk->device, vk->pipelineCache, &dataSize, NULL)) || dataSize == store->savedSize)
+	{
+		store->lastSaveTime = glfwGetTime();
+		return;
+	}
+	VkSavePipelineCache(vk);
+}
+
+VkPipelineCache VkCreateLocalPipelineCache(VkData* vk)
+{
+	if (!vk || !vk->pipelineCache) return NULL;
+
+	size_t   dataSize = 0;
+	uint8_t* data     = VkGetPipelineCacheData(vk, vk->pipelineCache, 0, &dataSize);
+	if (!data)
+		return NULL;
+
+	VkPipelineCacheCreateInfo createInfo = {
+		.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.pNext           = NULL,
+		.flags           = 0,
+		.initialDataSize = dataSize,
+		.pInitialData    = data
+	};
+	VkPipelineCache cache = NULL;
+	if (!VkValidate(vk, vkCreatePipelineCache(vk->device, &createInfo, vk->allocation, &cache)))
+		cache = NULL;
+	free(data);
+	return cache;
+}
+
+bool VkMergeLocalPipelineCache(VkData* vk, VkPipelineCache cache)
+{
+	if (!vk || !cache) return false;
+
+	bool merged = VkValidate(vk, vkMergePipelineCaches(vk->device, vk->pipelineCache, 1, &cache));
+	vkDestroyPipelineCache(vk->device, cache, vk->allocation);
+	return merged;
+}
+
+void VkRecordPipelineFeedback(VkData* vk, const VkPipelineCreationFeedback* feedback, uint32_t stageCount, const VkPipelineCreationFeedback* stageFeedbacks)
+{
+	if (!vk || !feedback || !(feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT)) return;
+
+	VkPipelineCacheStoreData* store = &vk->pipelineCacheStore;
+	AtomicAdd64(&store->pipelineCount, 1);
+	AtomicAdd64(&store->creationNanoseconds, feedback->duration);
+	if (feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT)
+		AtomicAdd64(&store->pipelineHits, 1);
+	for (uint32_t i = 0; i < stageCount; ++i)
+	{
+		if (!(stageFeedbacks[i].flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT))
+			continue;
+		AtomicAdd64(&store->stageCount, 1);
+		if (stageFeedbacks[i].flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT)
+			AtomicAdd64(&store->stageHits, 1);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "Vk.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t VkPipelineVariantHash(const VkPipelineVariantCacheData* variants, const VkShaderData* raygen, const void* data)
+{
+	uint64_t hash = VkShaderCacheHash(0xCBF29CE484222325ULL, &raygen, sizeof(raygen));
+	return VkShaderCacheHash(hash, data, variants->dataSize);
+}
+
+static void VkDestroyPipelineVariant(VkPipelineVariant* variant)
+{
+	if (!variant)
+		return;
+	if (variant->pipeline)
+	{
+		VkCleanupRayTracingPipeline(variant->pipeline);
+		free(variant->pipeline);
+	}
+	free(variant->groups);
+	free(variant->data);
+	free(variant);
+}
+
+static VkPipelineVariant* VkCreatePipelineVariant(VkPipelineVariantCacheData* variants, uint64_t hash, VkShaderData* raygen, const void* data)
+{
+	VkData*                         vk      = variants->base.vk;
+	const VkRayTracingPipelineData* base    = &variants->base;
+	VkPipelineVariant*              variant = (VkPipelineVariant*) calloc(1, sizeof(VkPipelineVariant));
+	if (!variant)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate pipeline variant");
+		return NULL;
+	}
+	variant->hash     = hash;
+	variant->raygen   = raygen;
+	variant->data     = malloc(variants->dataSize > 0 ? variants->dataSize : 1);
+	variant->groups   = (VkShaderGroup*) malloc(base->groupCount * sizeof(VkShaderGroup));
+	variant->pipeline = (VkRayTracingPipelineData*) malloc(sizeof(VkRayTracingPipelineData));
+	if (!variant->data || !variant->groups || !variant->pipeline)
+	{
+		free(variant->pipeline);
+		variant->pipeline = NULL;
+		VkDestroyPipelineVariant(variant);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate pipeline variant");
+		return NULL;
+	}
+	memcpy(variant->data, data, variants->dataSize);
+	memcpy(variant->groups, base->groups, base->groupCount * sizeof(VkShaderGroup));
+	for (uint32_t i = 0; i < base->groupCount; ++i)
+	{
+		if (variant->groups[i].kind == VK_SHADER_GROUP_KIND_RAYGEN)
+			variant->groups[i].general = raygen;
+	}
+	variant->specialization = (VkSpecializationInfo) {
+		.mapEntryCount = variants->mapEntryCount,
+		.pMapEntries   = variants->mapEntries,
+		.dataSize      = variants->dataSize,
+		.pData         = variant->data
+	};
+
+	*variant->pipeline                = *base;
+	variant->pipeline->groups         = variant->groups;
+	variant->pipeline->specialization = variants->mapEntryCount > 0 ? &variant->specialization : NULL;
+	if (!VkSetupRayTracingPipeline(variant->pipeline))
+	{
+		free(variant->pipeline);
+		variant->pipeline = NULL;
+		VkDestroyPipelineVariant(variant);
+		return NULL;
+	}
+	return variant;
+}
+
+bool VkSetupPipelineVariants(VkPipelineVariantCacheData* variants)
+{
+	if (!variants || !variants->base.vk || !variants->base.groups) return false;
+
+	variants->variantCount    = 0;
+	variants->variantCapacity = 0;
+	variants->variants        = NULL;
+	variants->hits            = 0;
+	variants->misses          = 0;
+	return true;
+}
+
+void VkCleanupPipelineVariants(VkPipelineVariantCacheData* variants)
+{
+	if (!variants) return;
+
+	for (uint32_t i = 0; i < variants->variantCount; ++i)
+		VkDestroyPipelineVariant(variants->variants[i]);
+	free(variants->variants);
+	variants->variants        = NULL;
+	variants->variantCount    = 0;
+	variants->variantCapacity = 0;
+}
+
+VkPipelineVariant* VkGetPipelineVariant(VkPipelineVariantCacheData* variants, VkShaderData* raygen, const void* data)
+{
+	if (!variants || !variants->base.vk || !raygen || (variants->dataSize > 0 && !data)) return NULL;
+
+	uint64_t hash = VkPipelineVariantHash(variants, raygen, data);
+	for (uint32_t i = 0; i < variants->variantCount; ++i)
+	{
+		VkPipelineVariant* variant = variants->variants[i];
+		if (variant->hash != hash || variant->raygen != raygen || memcmp(variant->data, data, variants->dataSize) != 0)
+			continue;
+		++variant->requests;
+		++variants->hits;
+		return variant;
+	}
+
+	if (variants->variantCount >= variants->variantCapacity)
+	{
+		uint32_t            newCapacity = variants->variantCapacity > 0 ? variants->variantCapacity * 2 : 8;
+		VkPipelineVariant** newVariants = (VkPipelineVariant**) realloc(variants->variants, newCapacity * sizeof(VkPipelineVariant*));
+		if (!newVariants)
+		{
+			VkReportError(variants->base.vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate pipeline variants");
+			return NULL;
+		}
+		variants->variants        = newVariants;
+		variants->variantCapacity = newCapacity;
+	}
+
+	VkPipelineVariant* variant = VkCreatePipelineVariant(variants, hash, raygen, data);
+	if (!variant)
+		return NULL;
+	variant->requests                            = 1;
+	variants->variants[variants->variantCount++] = variant;
+	++variants->misses;
+	return variant;
+}
+
+bool VkPipelineVariantsBuilding(VkPipelineVariantCacheData* variants)
+{
+	if (!variants) return false;
+
+	for (uint32_t i = 0; i < variants->variantCount; ++i)
+	{
+		if (VkRayTracingPipelineBuilding(variants->variants[i]->pipeline))
+			return true;
+	}
+	return false;
+}
\ No newline at end of file
@@ -1,27 +1,786 @@
+#include "Atomic.h"
 #include "Vk.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+static uint64_t VkAlignUp(uint64_t value, uint64_t alignment)
+{
+	return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+static uint32_t VkRayTracingAddStage(VkPipelineShaderStageCreateInfo* stages, VkShaderData** shaders, uint32_t* stageCount, VkShaderData* shader, const VkSpecializationInfo* specialization)
+{
+	if (!shader)
+		return VK_SHADER_UNUSED_KHR;
+
+	for (uint32_t i = 0; i < *stageCount; ++i)
+	{
+		if (shaders[i] == shader)
+			return i;
+	}
+
+	uint32_t index = (*stageCount)++;
+	shaders[index] = shader;
+	stages[index]  = (VkPipelineShaderStageCreateInfo) {
+		 .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+		 .pNext               = NULL,
+		 .flags               = 0,
+		 .stage               = shader->stage,
+		 .module              = shader->handle,
+		 .pName               = "main",
+		 .pSpecializationInfo = specialization
+	};
+	return index;
+}
+
+static bool VkRayTracingReflectLayout(VkData* vk, const VkRayTracingPipelineData* rtPipeline, VkReflectedLayout* layout)
+{
+	uint32_t       shaderCount = 0;
+	VkShaderData** shaders     = (VkShaderData**) malloc((rtPipeline->groupCount * 4 + rtPipeline->layoutShaderCount) * sizeof(VkShaderData*));
+	if (!shaders)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate ray tracing layout shaders");
+		return false;
+	}
+	for (uint32_t i = 0; i < rtPipeline->groupCount; ++i)
+	{
+		const VkShaderGroup* group = rtPipeline->groups + i;
+		shaders[shaderCount++]     = group->general;
+		shaders[shaderCount++]     = group->closestHit;
+		shaders[shaderCount++]     = group->anyHit;
+		shaders[shaderCount++]     = group->intersection;
+	}
+	for (uint32_t i = 0; i < rtPipeline->layoutShaderCount; ++i)
+		shaders[shaderCount++] = rtPipeline->layoutShaders[i];
+
+	bool acquired = VkAcquireReflectedLayout(vk, shaders, shaderCount, layout);
+	free(shaders);
+	if (acquired && layout->setLayoutCount > VK_BINDLESS_SET + 1)
+	{
+		VkReleasePipelineLayout(vk, layout->layout);
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Ray tracing pipeline shaders must only use descriptor set 0 and the bindless set");
+		return false;
+	}
+	return acquired;
+}
+
+static bool VkRayTracingSetupLayout(VkData* vk, VkRayTracingPipelineData* rtPipeline)
+{
+	VkReflectedLayout layout;
+	if (!VkRayTracingReflectLayout(vk, rtPipeline, &layout))
+		return false;
+	rtPipeline->setLayout          = layout.setLayouts[0];
+	rtPipeline->layout             = layout.layout;
+	rtPipeline->bindingMask        = layout.bindingMasks[0];
+	rtPipeline->bindless           = layout.setLayoutCount > VK_BINDLESS_SET;
+	rtPipeline->pushConstantStages = layout.pushConstantStages;
+	rtPipeline->pushConstantSize   = layout.pushConstantSize;
+	return true;
+}
+
+static bool VkRayTracingLayoutMatches(VkData* vk, const VkRayTracingPipelineData* rtPipeline)
+{
+	VkReflectedLayout layout;
+	if (!VkRayTracingReflectLayout(vk, rtPipeline, &layout))
+		return false;
+	bool matches = layout.layout == rtPipeline->layout;
+	VkReleasePipelineLayout(vk, layout.layout);
+	if (!matches)
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Shader changes require a different pipeline layout, restart to apply them");
+	return matches;
+}
+
+static uint32_t VkRayTracingComputeStackSize(VkData* vk, VkRayTracingPipelineData* rtPipeline, const uint32_t* order, uint32_t maxRecursionDepth)
+{
+	VkDeviceSize raygenSize       = 0;
+	VkDeviceSize missSize         = 0;
+	VkDeviceSize closestHitSize   = 0;
+	VkDeviceSize anyHitSize       = 0;
+	VkDeviceSize intersectionSize = 0;
+	VkDeviceSize callableSize     = 0;
+	for (uint32_t i = 0; i < rtPipeline->groupCount; ++i)
+	{
+		const VkShaderGroup* group = rtPipeline->groups + order[i];
+		switch (group->kind)
+		{
+		case VK_SHADER_GROUP_KIND_RAYGEN:
+		{
+			VkDeviceSize size = vkGetRayTracingShaderGroupStackSizeKHR(vk->device, rtPipeline->handle, i, VK_SHADER_GROUP_SHADER_GENERAL_KHR);
+			raygenSize        = size > raygenSize ? size : raygenSize;
+			break;
+		}
+		case VK_SHADER_GROUP_KIND_MISS:
+		{
+			VkDeviceSize size = vkGetRayTracingShaderGroupStackSizeKHR(vk->device, rtPipeline->handle, i, VK_SHADER_GROUP_SHADER_GENERAL_KHR);
+			missSize          = size > missSize ? size : missSize;
+			break;
+		}
+		case VK_SHADER_GROUP_KIND_HIT:
+		{
+			if (group->closestHit)
+			{
+				VkDeviceSize size = vkGetRayTracingShaderGroupStackSizeKHR(vk->device, rtPipeline->handle, i, VK_SHADER_GROUP_SHADER_CLOSEST_HIT_KHR);
+				closestHitSize    = size > closestHitSize ? size : closestHitSize;
+			}
+			if (group->anyHit)
+			{
+				VkDeviceSize size = vkGetRayTracingShaderGroupStackSizeKHR(vk->device, rtPipeline->handle, i, VK_SHADER_GROUP_SHADER_ANY_HIT_KHR);
+				anyHitSize        = size > anyHitSize ? size : anyHitSize;
+			}
+			if (group->intersection)
+			{
+				VkDeviceSize size = vkGetRayTracingShaderGroupStackSizeKHR(vk->device, rtPipeline->handle, i, VK_SHADER_GROUP_SHADER_INTERSECTION_KHR);
+				intersectionSize  = size > intersectionSize ? size : intersectionSize;
+			}
+			break;
+		}
+		case VK_SHADER_GROUP_KIND_CALLABLE:
+		{
+			VkDeviceSize size = vkGetRayTracingShaderGroupStackSizeKHR(vk->device, rtPipeline->handle, i, VK_SHADER_GROUP_SHADER_GENERAL_KHR);
+			callableSize      = size > callableSize ? size : callableSize;
+			break;
+		}
+		default: break;
+		}
+	}
+
+	VkDeviceSize traceSize = closestHitSize > missSize ? closestHitSize : missSize;
+	VkDeviceSize firstSize = intersectionSize + anyHitSize > traceSize ? intersectionSize + anyHitSize : traceSize;
+	VkDeviceSize stackSize = raygenSize + (maxRecursionDepth > 0 ? firstSize : 0) + (maxRecursionDepth > 1 ? (maxRecursionDepth - 1) * traceSize : 0) + 2 * callableSize;
+	return (uint32_t) stackSize;
+}
+
+static bool VkRayTracingSetupSBT(VkData* vk, VkRayTracingPipelineData* rtPipeline, const uint32_t* order)
+{
+	const VkPhysicalDeviceRayTracingPipelinePropertiesKHR* props = &vk->deviceRayTracingPipelineProps;
+
+	uint32_t handleSize = props->shaderGroupHandleSize;
+	uint8_t* handles    = (uint8_t*) malloc((size_t) rtPipeline->groupCount * handleSize);
+	if (!handles)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate shader group handles");
+		return false;
+	}
+	if (!VkValidate(vk, vkGetRayTracingShaderGroupHandlesKHR(vk->device, rtPipeline->handle, 0, rtPipeline->groupCount, (size_t) rtPipeline->groupCount * handleSize, handles)))
+	{
+		free(handles);
+		return false;
+	}
+
+	uint32_t counts[VK_SHADER_GROUP_KIND_COUNT];
+	uint32_t dataSizes[VK_SHADER_GROUP_KIND_COUNT];
+	uint64_t offsets[VK_SHADER_GROUP_KIND_COUNT];
+	memset(counts, 0, sizeof(counts));
+	memset(dataSizes, 0, sizeof(dataSizes));
+	for (uint32_t i = 0; i < rtPipeline->groupCount; ++i)
+	{
+		const VkShaderGroup* group = rtPipeline->groups + i;
+		++counts[group->kind];
+		dataSizes[group->kind] = group->dataSize > dataSizes[group->kind] ? group->dataSize : dataSizes[group->kind];
+	}
+
+	uint64_t sbtSize = 0;
+	for (uint32_t i = 0; i < VK_SHADER_GROUP_KIND_COUNT; ++i)
+	{
+		VkStridedDeviceAddressRegionKHR* region = rtPipeline->regions + i;
+		region->deviceAddress                   = 0;
+		region->stride                          = 0;
+		region->size                            = 0;
+		offsets[i]                              = 0;
+		if (counts[i] == 0)
+			continue;
+
+		uint64_t stride = VkAlignUp(handleSize + dataSizes[i], props->shaderGroupHandleAlignment);
+		if (i == VK_SHADER_GROUP_KIND_RAYGEN)
+			stride = VkAlignUp(stride, props->shaderGroupBaseAlignment);
+		if (stride > props->maxShaderGroupStride)
+		{
+			free(handles);
+			VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Shader binding table record exceeds maxShaderGroupStride");
+			return false;
+		}
+		offsets[i]     = VkAlignUp(sbtSize, props->shaderGroupBaseAlignment);
+		region->stride = stride;
+		region->size   = i == VK_SHADER_GROUP_KIND_RAYGEN ? stride : stride * counts[i];
+		sbtSize        = offsets[i] + stride * counts[i];
+	}
+
+	VkBufferCreateInfo bCreateInfo = {
+		.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext                 = NULL,
+		.flags                 = 0,
+		.size                  = sbtSize,
+		.usage                 = VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		.sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices   = NULL
+	};
+	VmaAllocationCreateInfo bAllocInfo = {
+		.flags          = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+		.usage          = VMA_MEMORY_USAGE_CPU_TO_GPU,
+		.requiredFlags  = 0,
+		.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		.memoryTypeBits = 0,
+		.pool           = NULL,
+		.pUserData      = NULL,
+		.priority       = 0.0f
+	};
+	VmaAllocationInfo allocationInfo;
+	if (!VkValidate(vk, vmaCreateBufferWithAlignment(vk->allocator, &bCreateInfo, &bAllocInfo, props->shaderGroupBaseAlignment, &rtPipeline->sbtBuffer, &rtPipeline->sbtAllocation, &allocationInfo)))
+	{
+		free(handles);
+		return false;
+	}
+
+	uint32_t written[VK_SHADER_GROUP_KIND_COUNT];
+	memset(written, 0, sizeof(written));
+	memset(allocationInfo.pMappedData, 0, sbtSize);
+	for (uint32_t i = 0; i < rtPipeline->groupCount; ++i)
+	{
+		const VkShaderGroup* group  = rtPipeline->groups + order[i];
+		uint8_t*             record = (uint8_t*) allocationInfo.pMappedData + offsets[group->kind] + written[group->kind]++ * rtPipeline->regions[group->kind].stride;
+		memcpy(record, handles + (size_t) i * handleSize, handleSize);
+		if (group->data && group->dataSize > 0)
+			memcpy(record + handleSize, group->data, group->dataSize);
+	}
+	vmaFlushAllocation(vk->allocator, rtPipeline->sbtAllocation, 0, VK_WHOLE_SIZE);
+	free(handles);
+
+	VkBufferDeviceAddressInfo addressInfo = {
+		.sType  = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+		.pNext  = NULL,
+		.buffer = rtPipeline->sbtBuffer
+	};
+	VkDeviceAddress sbtAddress = vkGetBufferDeviceAddress(vk->device, &addressInfo);
+	for (uint32_t i = 0; i < VK_SHADER_GROUP_KIND_COUNT; ++i)
+	{
+		if (counts[i] > 0)
+			rtPipeline->regions[i].deviceAddress = sbtAddress + offsets[i];
+	}
+	return true;
+}
+
+static void VkRayTracingFillGroup(const VkShaderGroup* group, VkRayTracingShaderGroupCreateInfoKHR* groupInfo, VkPipelineShaderStageCreateInfo* stages, VkShaderData** shaders, uint32_t* stageCount, const VkSpecializationInfo* specialization)
+{
+	groupInfo->sType                           = VK_STRUCTURE_TYPE_RAY_TRACING_SHADER_GROUP_CREATE_INFO_KHR;
+	groupInfo->pNext                           = NULL;
+	groupInfo->generalShader                   = VK_SHADER_UNUSED_KHR;
+	groupInfo->closestHitShader                = VK_SHADER_UNUSED_KHR;
+	groupInfo->anyHitShader                    = VK_SHADER_UNUSED_KHR;
+	groupInfo->intersectionShader              = VK_SHADER_UNUSED_KHR;
+	groupInfo->pShaderGroupCaptureReplayHandle = NULL;
+	if (group->kind == VK_SHADER_GROUP_KIND_HIT)
+	{
+		groupInfo->type               = group->intersection ? VK_RAY_TRACING_SHADER_GROUP_TYPE_PROCEDURAL_HIT_GROUP_KHR : VK_RAY_TRACING_SHADER_GROUP_TYPE_TRIANGLES_HIT_GROUP_KHR;
+		groupInfo->closestHitShader   = VkRayTracingAddStage(stages, shaders, stageCount, group->closestHit, specialization);
+		groupInfo->anyHitShader       = VkRayTracingAddStage(stages, shaders, stageCount, group->anyHit, specialization);
+		groupInfo->intersectionShader = VkRayTracingAddStage(stages, shaders, stageCount, group->intersection, specialization);
+	}
+	else
+	{
+		groupInfo->type          = VK_RAY_TRACING_SHADER_GROUP_TYPE_GENERAL_KHR;
+		groupInfo->generalShader = VkRayTracingAddStage(stages, shaders, stageCount, group->general, specialization);
+	}
+}
+
+static bool VkRayTracingGroupUses(const VkShaderGroup* group, const VkShaderData* shader)
+{
+	return !shader ||
+		   group->general == shader ||
+		   group->closestHit == shader ||
+		   group->anyHit == shader ||
+		   group->intersection == shader;
+}
+
+static uint32_t VkRayTracingMaxRecursionDepth(VkData* vk, VkRayTracingPipelineData* rtPipeline)
+{
+	uint32_t maxRecursionDepth = rtPipeline->maxRecursionDepth > 0 ? rtPipeline->maxRecursionDepth : 1;
+	if (maxRecursionDepth > vk->deviceRayTracingPipelineProps.maxRayRecursionDepth)
+		maxRecursionDepth = vk->deviceRayTracingPipelineProps.maxRayRecursionDepth;
+	return maxRecursionDepth;
+}
+
+typedef struct VkDeferredJoinData
+{
+	VkData*                vk;
+	VkDeferredOperationKHR operation;
+	volatile uint32_t      references;
+} VkDeferredJoinData;
+
+static void VkReleaseDeferredJoin(VkDeferredJoinData* join)
+{
+	if (AtomicAdd32(&join->references, ~0U) != 0)
+		return;
+	vkDestroyDeferredOperationKHR(join->vk->device, join->operation, join->vk->allocation);
+	free(join);
+}
+
+static void VkJoinDeferredOperation(VkDeferredJoinData* join)
+{
+	while (vkDeferredOperationJoinKHR(join->vk->device, join->operation) == VK_THREAD_IDLE_KHR)
+		ThreadYield();
+}
+
+static void VkDeferredJoinJob(void* userData, uint32_t threadIndex)
+{
+	(void) threadIndex;
+	VkDeferredJoinData* join = (VkDeferredJoinData*) userData;
+	VkJoinDeferredOperation(join);
+	VkReleaseDeferredJoin(join);
+}
+
+static VkResult VkRayTracingCreateDeferred(VkData* vk, JobSystem* jobs, VkPipelineCache cache, const VkRayTracingPipelineCreateInfoKHR* createInfo, VkPipeline* pipeline)
+{
+	VkDeferredJoinData* join = jobs ? (VkDeferredJoinData*) malloc(sizeof(VkDeferredJoinData)) : NULL;
+	if (!join)
+		return vkCreateRayTracingPipelinesKHR(vk->device, NULL, cache, 1, createInfo, vk->allocation, pipeline);
+
+	join->vk         = vk;
+	join->operation  = NULL;
+	join->references = 1;
+	if (vkCreateDeferredOperationKHR(vk->device, vk->allocation, &join->operation) != VK_SUCCESS)
+	{
+		free(join);
+		return vkCreateRayTracingPipelinesKHR(vk->device, NULL, cache, 1, createInfo, vk->allocation, pipeline);
+	}
+
+	VkResult result = vkCreateRayTracingPipelinesKHR(vk->device, join->operation, cache, 1, createInfo, vk->allocation, pipeline);
+	if (result == VK_OPERATION_DEFERRED_KHR)
+	{
+		uint32_t concurrency = vkGetDeferredOperationMaxConcurrencyKHR(vk->device, join->operation);
+		uint32_t helpers     = concurrency > 1 ? concurrency - 1 : 0;
+		if (helpers > jobs->workerCount)
+			helpers = jobs->workerCount;
+		for (uint32_t i = 0; i < helpers; ++i)
+		{
+			AtomicAdd32(&join->references, 1);
+			if (!JobSystemSubmitBackground(jobs, &VkDeferredJoinJob, join, NULL))
+			{
+				AtomicAdd32(&join->references, ~0U);
+				break;
+			}
+		}
+		VkJoinDeferredOperation(join);
+		while ((result = vkGetDeferredOperationResultKHR(vk->device, join->operation)) == VK_NOT_READY)
+			ThreadYield();
+	}
+	else if (result == VK_OPERATION_NOT_DEFERRED_KHR)
+	{
+		result = VK_SUCCESS;
+	}
+	VkReleaseDeferredJoin(join);
+	return result;
+}
+
+static bool VkRayTracingCreatePipeline(VkData* vk, VkRayTracingPipelineData* rtPipeline, uint32_t firstGroup, uint32_t groupCount, uint32_t libraryCount, const VkPipeline* libraries, bool library, VkPipeline* pipeline)
+{
+	uint32_t                              maxStageCount  = groupCount * 3;
+	uint32_t                              stageCount     = 0;
+	VkPipelineShaderStageCreateInfo*      stages         = NULL;
+	VkShaderData**                        shaders        = NULL;
+	VkRayTracingShaderGroupCreateInfoKHR* groups         = NULL;
+	VkPipelineCreationFeedback*           stageFeedbacks = NULL;
+	if (groupCount > 0)
+	{
+		stages         = (VkPipelineShaderStageCreateInfo*) malloc(maxStageCount * sizeof(VkPipelineShaderStageCreateInfo));
+		shaders        = (VkShaderData**) malloc(maxStageCount * sizeof(VkShaderData*));
+		groups         = (VkRayTracingShaderGroupCreateInfoKHR*) malloc(groupCount * sizeof(VkRayTracingShaderGroupCreateInfoKHR));
+		stageFeedbacks = (VkPipelineCreationFeedback*) calloc(maxStageCount, sizeof(VkPipelineCreationFeedback));
+		if (!stages || !shaders || !groups || !stageFeedbacks)
+		{
+			free(stages);
+			free(shaders);
+			free(groups);
+			free(stageFeedbacks);
+			VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate ray tracing pipeline stages");
+			return false;
+		}
+		for (uint32_t i = 0; i < groupCount; ++i)
+			VkRayTracingFillGroup(rtPipeline->groups + rtPipeline->order[firstGroup + i], groups + i, stages, shaders, &stageCount, rtPipeline->specialization);
+	}
+
+	VkRayTracingPipelineInterfaceCreateInfoKHR interfaceInfo = {
+		.sType                          = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_INTERFACE_CREATE_INFO_KHR,
+		.pNext                          = NULL,
+		.maxPipelineRayPayloadSize      = rtPipeline->maxPayloadSize,
+		.maxPipelineRayHitAttributeSize = rtPipeline->maxHitAttributeSize
+	};
+	VkPipelineLibraryCreateInfoKHR libraryInfo = {
+		.sType        = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+		.pNext        = NULL,
+		.libraryCount = libraryCount,
+		.pLibraries   = libraries
+	};
+	VkDynamicState                   dynamicStates[] = { VK_DYNAMIC_STATE_RAY_TRACING_PIPELINE_STACK_SIZE_KHR };
+	VkPipelineDynamicStateCreateInfo dynamicState    = {
+		   .sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		   .pNext             = NULL,
+		   .flags             = 0,
+		   .dynamicStateCount = sizeof(dynamicStates) / sizeof(*dynamicStates),
+		   .pDynamicStates    = dynamicStates
+	};
+	VkPipelineCreationFeedback           feedback     = { .flags = 0, .duration = 0 };
+	VkPipelineCreationFeedbackCreateInfo feedbackInfo = {
+		.sType                              = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+		.pNext                              = NULL,
+		.pPipelineCreationFeedback          = &feedback,
+		.pipelineStageCreationFeedbackCount = stageCount,
+		.pPipelineStageCreationFeedbacks    = stageFeedbacks
+	};
+
+	bool                              usesLibraries = library || libraryCount > 0;
+	VkRayTracingPipelineCreateInfoKHR createInfo    = {
+		   .sType                        = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_CREATE_INFO_KHR,
+		   .pNext                        = &feedbackInfo,
+		   .flags                        = library ? VK_PIPELINE_CREATE_LIBRARY_BIT_KHR : 0,
+		   .stageCount                   = stageCount,
+		   .pStages                      = stages,
+		   .groupCount                   = groupCount,
+		   .pGroups                      = groups,
+		   .maxPipelineRayRecursionDepth = VkRayTracingMaxRecursionDepth(vk, rtPipeline),
+		   .pLibraryInfo                 = libraryCount > 0 ? &libraryInfo : NULL,
+		   .pLibraryInterface            = usesLibraries ? &interfaceInfo : NULL,
+		   .pDynamicState                = library ? NULL : &dynamicState,
+		   .layout                       = rtPipeline->layout,
+		   .basePipelineHandle           = NULL,
+		   .basePipelineIndex            = 0
+	};
+	VkResult result = VkRayTracingCreateDeferred(vk, rtPipeline->jobs, rtPipeline->pipelineCache ? rtPipeline->pipelineCache : vk->pipelineCache, &createInfo, pipeline);
+	if (result == VK_SUCCESS)
+		VkRecordPipelineFeedback(vk, &feedback, stageCount, stageFeedbacks);
+	free(stages);
+	free(shaders);
+	free(groups);
+	free(stageFeedbacks);
+	return VkValidate(vk, result);
+}
+
+static bool VkRayTracingBuild(VkData* vk, VkRayTracingPipelineData* rtPipeline, const VkShaderData* changed)
+{
+	rtPipeline->handle            = NULL;
+	rtPipeline->sbtBuffer         = NULL;
+	rtPipeline->sbtAllocation     = NULL;
+	rtPipeline->relinkedLibraries = 0;
+	if (rtPipeline->libraries)
+	{
+		for (uint32_t i = 0; i < rtPipeline->groupCount; ++i)
+		{
+			if (rtPipeline->libraries[i] && !VkRayTracingGroupUses(rtPipeline->groups + rtPipeline->order[i], changed))
+				continue;
+			rtPipeline->libraries[i] = NULL;
+			if (!VkRayTracingCreatePipeline(vk, rtPipeline, i, 1, 0, NULL, true, rtPipeline->libraries + i))
+				return false;
+			++rtPipeline->relinkedLibraries;
+		}
+		if (!VkRayTracingCreatePipeline(vk, rtPipeline, 0, 0, rtPipeline->groupCount, rtPipeline->libraries, false, &rtPipeline->handle))
+			return false;
+	}
+	else if (!VkRayTracingCreatePipeline(vk, rtPipeline, 0, rtPipeline->groupCount, 0, NULL, false, &rtPipeline->handle))
+	{
+		return false;
+	}
+
+	rtPipeline->stackSize = VkRayTracingComputeStackSize(vk, rtPipeline, rtPipeline->order, VkRayTracingMaxRecursionDepth(vk, rtPipeline));
+	return true;
+}
+
+static void VkRayTracingDestroyBuilt(VkData* vk, VkRayTracingPipelineData* rtPipeline, const VkRayTracingPipelineData* keep)
+{
+	if (rtPipeline->libraries)
+	{
+		for (uint32_t i = 0; i < rtPipeline->groupCount; ++i)
+		{
+			if (!keep || keep->libraries[i] != rtPipeline->libraries[i])
+				vkDestroyPipeline(vk->device, rtPipeline->libraries[i], vk->allocation);
+		}
+	}
+	vmaDestroyBuffer(vk->allocator, rtPipeline->sbtBuffer, rtPipeline->sbtAllocation);
+	vkDestroyPipeline(vk->device, rtPipeline->handle, vk->allocation);
+}
+
+static void VkDestroyRetiredRayTracingPipeline(VkData* vk, VkRetiredRayTracingPipelineData* retired)
+{
+	for (uint32_t i = 0; i < retired->pipelineCount; ++i)
+		vkDestroyPipeline(vk->device, retired->pipelines[i], vk->allocation);
+	vmaDestroyBuffer(vk->allocator, retired->sbtBuffer, retired->sbtAllocation);
+	free(retired->frameValues);
+	free(retired->pipelines);
+	memset(retired, 0, sizeof(VkRetiredRayTracingPipelineData));
+}
+
+static bool VkRetiredRayTracingPipelineCompleted(VkData* vk, const VkRetiredRayTracingPipelineData* retired)
+{
+	if (retired->framesGeneration != vk->framesGeneration)
+		return true;
+
+	for (uint32_t i = 0; i < retired->frameCount; ++i)
+	{
+		uint64_t value = 0;
+		if (!VkValidate(vk, vkGetSemaphoreCounterValue(vk->device, vk->frames[i].semaphore, &value)) ||
+			value < retired->frameValues[i])
+			return false;
+	}
+	return true;
+}
+
+static void VkCollectRetiredRayTracingPipelines(VkRayTracingPipelineData* rtPipeline, bool force)
+{
+	VkData* vk = rtPipeline->vk;
+
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < rtPipeline->retiredCount; ++i)
+	{
+		VkRetiredRayTracingPipelineData* retired = rtPipeline->retired + i;
+		if (force || VkRetiredRayTracingPipelineCompleted(vk, retired))
+			VkDestroyRetiredRayTracingPipeline(vk, retired);
+		else
+			rtPipeline->retired[kept++] = *retired;
+	}
+	rtPipeline->retiredCount = kept;
+}
+
+static bool VkRetireRayTracingPipeline(VkRayTracingPipelineData* rtPipeline, const VkRayTracingPipelineData* keep)
+{
+	VkData* vk = rtPipeline->vk;
+
+	if (!rtPipeline->handle && !rtPipeline->sbtBuffer && !rtPipeline->libraries)
+		return true;
+
+	if (rtPipeline->retiredCount >= rtPipeline->retiredCapacity)
+	{
+		uint32_t                         newCapacity = rtPipeline->retiredCapacity ? rtPipeline->retiredCapacity << 1 : 4;
+		VkRetiredRayTracingPipelineData* newRetired  = (VkRetiredRayTracingPipelineData*) malloc(newCapacity * sizeof(VkRetiredRayTracingPipelineData));
+		if (!newRetired)
+		{
+			VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate retired ray tracing pipelines");
+			return false;
+		}
+		if (rtPipeline->retired)
+			memcpy(newRetired, rtPipeline->retired, rtPipeline->retiredCount * sizeof(VkRetiredRayTracingPipelineData));
+		free(rtPipeline->retired);
+		rtPipeline->retiredCapacity = newCapacity;
+		rtPipeline->retired         = newRetired;
+	}
+
+	uint64_t*   frameValues = (uint64_t*) malloc(vk->framesCapacity * sizeof(uint64_t));
+	VkPipeline* pipelines   = (VkPipeline*) malloc((rtPipeline->groupCount + 1) * sizeof(VkPipeline));
+	if ((vk->framesCapacity > 0 && !frameValues) || !pipelines)
+	{
+		free(frameValues);
+		free(pipelines);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate retired ray tracing pipeline");
+		return false;
+	}
+	for (uint32_t i = 0; i < vk->framesCapacity; ++i)
+		frameValues[i] = vk->frames[i].value;
+
+	uint32_t pipelineCount = 0;
+	if (rtPipeline->handle)
+		pipelines[pipelineCount++] = rtPipeline->handle;
+	for (uint32_t i = 0; rtPipeline->libraries && i < rtPipeline->groupCount; ++i)
+	{
+		if (rtPipeline->libraries[i] && keep->libraries[i] != rtPipeline->libraries[i])
+			pipelines[pipelineCount++] = rtPipeline->libraries[i];
+	}
+
+	if (pipelineCount == 0 && !rtPipeline->sbtBuffer)
+	{
+		free(frameValues);
+		free(pipelines);
+		return true;
+	}
+
+	VkRetiredRayTracingPipelineData* retired = rtPipeline->retired + rtPipeline->retiredCount;
+	++rtPipeline->retiredCount;
+	retired->framesGeneration = vk->framesGeneration;
+	retired->frameCount       = vk->framesCapacity;
+	retired->frameValues      = frameValues;
+	retired->pipelineCount    = pipelineCount;
+	retired->pipelines        = pipelines;
+	retired->sbtBuffer        = rtPipeline->sbtBuffer;
+	retired->sbtAllocation    = rtPipeline->sbtAllocation;
+
+	rtPipeline->handle        = NULL;
+	rtPipeline->sbtBuffer     = NULL;
+	rtPipeline->sbtAllocation = NULL;
+	return true;
+}
+
+static bool VkRayTracingCopyBuilt(const VkRayTracingPipelineData* rtPipeline, VkRayTracingPipelineData* next)
+{
+	*next                 = *rtPipeline;
+	next->pending         = NULL;
+	next->retiredCount    = 0;
+	next->retiredCapacity = 0;
+	next->retired         = NULL;
+	if (!rtPipeline->libraries)
+		return true;
+
+	next->libraries = (VkPipeline*) malloc(rtPipeline->groupCount * sizeof(VkPipeline));
+	if (!next->libraries)
+	{
+		VkReportError(rtPipeline->vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate ray tracing pipeline libraries");
+		return false;
+	}
+	memcpy(next->libraries, rtPipeline->libraries, rtPipeline->groupCount * sizeof(VkPipeline));
+	return true;
+}
+
+static bool VkRayTracingFinishBuild(VkRayTracingPipelineData* rtPipeline, VkRayTracingPipelineData* next, bool built, double elapsed, const VkShaderData* changed)
+{
+	VkData* vk = rtPipeline->vk;
+
+	if (next->pipelineCache)
+	{
+		VkMergeLocalPipelineCache(vk, next->pipelineCache);
+		next->pipelineCache = NULL;
+	}
+
+	if (!built ||
+		!VkRayTracingSetupSBT(vk, next, next->order) ||
+		!VkRetireRayTracingPipeline(rtPipeline, next))
+	{
+		VkRayTracingDestroyBuilt(vk, next, rtPipeline);
+		free(next->libraries);
+		return false;
+	}
+
+	free(rtPipeline->libraries);
+	rtPipeline->handle            = next->handle;
+	rtPipeline->stackSize         = next->stackSize;
+	rtPipeline->libraries         = next->libraries;
+	rtPipeline->relinkedLibraries = next->relinkedLibraries;
+	rtPipeline->sbtBuffer         = next->sbtBuffer;
+	rtPipeline->sbtAllocation     = next->sbtAllocation;
+	memcpy(rtPipeline->regions, next->regions, sizeof(rtPipeline->regions));
+	if (rtPipeline->libraries && changed)
+		rtPipeline->relinkTime = elapsed;
+	else
+		rtPipeline->fullBuildTime = elapsed;
+	return true;
+}
+
+static void VkRayTracingBuildJob(void* userData, uint32_t threadIndex)
+{
+	(void) threadIndex;
+	VkRayTracingPipelineData* rtPipeline = (VkRayTracingPipelineData*) userData;
+
+	double start             = glfwGetTime();
+	rtPipeline->pendingBuilt = VkRayTracingBuild(rtPipeline->vk, rtPipeline->pending, rtPipeline->pendingChanged);
+	rtPipeline->pendingTime  = glfwGetTime() - start;
+}
+
+static bool VkRayTracingBeginBuild(VkRayTracingPipelineData* rtPipeline, const VkShaderData* changed)
+{
+	VkData* vk = rtPipeline->vk;
+
+	VkRayTracingPipelineData* next = (VkRayTracingPipelineData*) malloc(sizeof(VkRayTracingPipelineData));
+	if (!next)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate pending ray tracing pipeline");
+		return false;
+	}
+	if (!VkRayTracingCopyBuilt(rtPipeline, next))
+	{
+		free(next);
+		return false;
+	}
+
+	next->pipelineCache        = VkCreateLocalPipelineCache(vk);
+	rtPipeline->pending        = next;
+	rtPipeline->pendingChanged = rtPipeline->libraries ? changed : NULL;
+	rtPipeline->pendingBuilt   = false;
+	rtPipeline->pendingTime    = 0.0;
+	if (!JobSystemSubmitBackground(rtPipeline->jobs, &VkRayTracingBuildJob, rtPipeline, &rtPipeline->pendingCounter))
+	{
+		rtPipeline->pending = NULL;
+		vkDestroyPipelineCache(vk->device, next->pipelineCache, vk->allocation);
+		free(next->libraries);
+		free(next);
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Failed to submit ray tracing pipeline build");
+		return false;
+	}
+	return true;
+}
+
 bool VkSetupRayTracingPipeline(VkRayTracingPipelineData* rtPipeline)
 {
 	if (!rtPipeline || !rtPipeline->vk) return false;
 	VkData* vk = rtPipeline->vk;
 
-	VkRayTracingPipelineCreateInfoKHR createInfo = {
-		.sType                        = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_CREATE_INFO_KHR,
-		.pNext                        = NULL,
-		.flags                        = 0,
-		.stageCount                   = 0,
-		.pStages                      = NULL,
-		.groupCount                   = 0,
-		.pGroups                      = NULL,
-		.maxPipelineRayRecursionDepth = 0,
-		.pLibraryInfo                 = NULL,
-		.pLibraryInterface            = NULL,
-		.pDynamicState                = NULL,
-		.layout                       = NULL,
-		.basePipelineHandle           = NULL,
-		.basePipelineIndex            = 0
-	};
-	if (!VkValidate(vk, vkCreateRayTracingPipelinesKHR(vk->device, NULL, vk->pipelineCache, 1, &createInfo, vk->allocation, &rtPipeline->handle))) return false;
+	rtPipeline->setLayout              = NULL;
+	rtPipeline->layout                 = NULL;
+	rtPipeline->bindingMask            = 0;
+	rtPipeline->bindless               = false;
+	rtPipeline->pushConstantStages     = 0;
+	rtPipeline->pushConstantSize       = 0;
+	rtPipeline->handle                 = NULL;
+	rtPipeline->stackSize              = 0;
+	rtPipeline->order                  = NULL;
+	rtPipeline->libraries              = NULL;
+	rtPipeline->pipelineCache          = NULL;
+	rtPipeline->fullBuildTime          = 0.0;
+	rtPipeline->relinkTime             = 0.0;
+	rtPipeline->relinkedLibraries      = 0;
+	rtPipeline->sbtBuffer              = NULL;
+	rtPipeline->sbtAllocation          = NULL;
+	rtPipeline->pending                = NULL;
+	rtPipeline->pendingChanged         = NULL;
+	rtPipeline->pendingCounter.pending = 0;
+	rtPipeline->pendingBuilt           = false;
+	rtPipeline->pendingTime            = 0.0;
+	rtPipeline->retiredCount           = 0;
+	rtPipeline->retiredCapacity        = 0;
+	rtPipeline->retired                = NULL;
+	memset(rtPipeline->regions, 0, sizeof(rtPipeline->regions));
+	if (rtPipeline->maxPayloadSize == 0)
+		rtPipeline->maxPayloadSize = 32;
+	if (rtPipeline->maxHitAttributeSize == 0)
+		rtPipeline->maxHitAttributeSize = vk->deviceRayTracingPipelineProps.maxRayHitAttributeSize;
+
+	bool hasRaygen = false;
+	for (uint32_t i = 0; i < rtPipeline->groupCount; ++i)
+		hasRaygen |= rtPipeline->groups[i].kind == VK_SHADER_GROUP_KIND_RAYGEN;
+	if (!hasRaygen)
+	{
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Ray tracing pipeline requires a raygen group");
+		return false;
+	}
+
+	if (!VkRayTracingSetupLayout(vk, rtPipeline))
+	{
+		VkCleanupRayTracingPipeline(rtPipeline);
+		return false;
+	}
+
+	rtPipeline->order = (uint32_t*) malloc(rtPipeline->groupCount * sizeof(uint32_t));
+	if (rtPipeline->useLibraries && vk->pipelineLibrarySupported)
+		rtPipeline->libraries = (VkPipeline*) calloc(rtPipeline->groupCount, sizeof(VkPipeline));
+	if (!rtPipeline->order || (rtPipeline->useLibraries && vk->pipelineLibrarySupported && !rtPipeline->libraries))
+	{
+		VkCleanupRayTracingPipeline(rtPipeline);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate ray tracing pipeline groups");
+		return false;
+	}
+	uint32_t groupCount = 0;
+	for (uint32_t kind = 0; kind < VK_SHADER_GROUP_KIND_COUNT; ++kind)
+	{
+		for (uint32_t i = 0; i < rtPipeline->groupCount; ++i)
+		{
+			if (rtPipeline->groups[i].kind == kind)
+				rtPipeline->order[groupCount++] = i;
+		}
+	}
+
+	if (!VkRebuildRayTracingPipeline(rtPipeline, NULL))
+	{
+		VkCleanupRayTracingPipeline(rtPipeline);
+		return false;
+	}
 	return true;
 }
 
@@ -30,5 +789,80 @@ void VkCleanupRayTracingPipeline(VkRayTracingPipelineData* rtPipeline)
 	if (!rtPipeline || !rtPipeline->vk) return;
 	VkData* vk = rtPipeline->vk;
 
-	vkDestroyPipeline(vk->device, rtPipeline->handle, vk->allocation);
+	if (rtPipeline->pending)
+	{
+		if (AtomicLoad32(&rtPipeline->pendingCounter.pending) > 0)
+			JobSystemWait(rtPipeline->jobs, &rtPipeline->pendingCounter);
+		VkRayTracingDestroyBuilt(vk, rtPipeline->pending, rtPipeline);
+		vkDestroyPipelineCache(vk->device, rtPipeline->pending->pipelineCache, vk->allocation);
+		free(rtPipeline->pending->libraries);
+		free(rtPipeline->pending);
+		rtPipeline->pending = NULL;
+	}
+	VkCollectRetiredRayTracingPipelines(rtPipeline, true);
+	VkRayTracingDestroyBuilt(vk, rtPipeline, NULL);
+	VkReleasePipelineLayout(vk, rtPipeline->layout);
+	free(rtPipeline->order);
+	free(rtPipeline->libraries);
+	free(rtPipeline->retired);
+	rtPipeline->sbtBuffer       = NULL;
+	rtPipeline->sbtAllocation   = NULL;
+	rtPipeline->handle          = NULL;
+	rtPipeline->layout          = NULL;
+	rtPipeline->setLayout       = NULL;
+	rtPipeline->order           = NULL;
+	rtPipeline->libraries       = NULL;
+	rtPipeline->retired         = NULL;
+	rtPipeline->retiredCapacity = 0;
+	rtPipeline->stackSize       = 0;
+	memset(rtPipeline->regions, 0, sizeof(rtPipeline->regions));
+}
+
+bool VkRebuildRayTracingPipeline(VkRayTracingPipelineData* rtPipeline, const VkShaderData* changed)
+{
+	if (!rtPipeline || !rtPipeline->vk || !rtPipeline->order || rtPipeline->pending) return false;
+	VkData* vk = rtPipeline->vk;
+
+	if ((changed || rtPipeline->handle) && !VkRayTracingLayoutMatches(vk, rtPipeline))
+		return false;
+	if (rtPipeline->jobs)
+		return VkRayTracingBeginBuild(rtPipeline, changed);
+
+	VkRayTracingPipelineData next;
+	if (!VkRayTracingCopyBuilt(rtPipeline, &next))
+		return false;
+
+	double start   = glfwGetTime();
+	bool   built   = VkRayTracingBuild(vk, &next, rtPipeline->libraries ? changed : NULL);
+	double elapsed = glfwGetTime() - start;
+	return VkRayTracingFinishBuild(rtPipeline, &next, built, elapsed, rtPipeline->libraries ? changed : NULL);
+}
+
+bool VkRayTracingPipelineBuilding(VkRayTracingPipelineData* rtPipeline)
+{
+	return rtPipeline && rtPipeline->pending;
+}
+
+bool VkUpdateRayTracingPipeline(VkRayTracingPipelineData* rtPipeline)
+{
+	if (!rtPipeline || !rtPipeline->vk) return false;
+
+	VkCollectRetiredRayTracingPipelines(rtPipeline, false);
+	if (!rtPipeline->pending || AtomicLoad32(&rtPipeline->pendingCounter.pending) > 0)
+		return false;
+
+	VkRayTracingPipelineData* next    = rtPipeline->pending;
+	bool                      swapped = false;
+	rtPipeline->pending               = NULL;
+	swapped                           = VkRayTracingFinishBuild(rtPipeline, next, rtPipeline->pendingBuilt, rtPipeline->pendingTime, rtPipeline->pendingChanged);
+	free(next);
+	return swapped;
+}
+
+void VkCmdBindRayTracingPipeline(VkCommandBuffer buffer, VkRayTracingPipelineData* rtPipeline)
+{
+	if (!buffer || !rtPipeline || !rtPipeline->handle) return;
+
+	vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rtPipeline->handle);
+	vkCmdSetRayTracingPipelineStackSizeKHR(buffer, rtPipeline->stackSize);
 }
\ No newline at end of file
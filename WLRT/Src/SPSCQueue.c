@@ -0,0 +1,68 @@
+#include "SPSCQueue.h"
+#include "Atomic.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool SPSCQueueSetup(SPSCQueue* queue, size_t elementSize, uint32_t capacity)
+{
+	if (!queue || elementSize == 0 || capacity == 0)
+		return false;
+
+	uint32_t newCapacity = capacity - 1;
+	newCapacity         |= newCapacity >> 1;
+	newCapacity         |= newCapacity >> 2;
+	newCapacity         |= newCapacity >> 4;
+	newCapacity         |= newCapacity >> 8;
+	newCapacity         |= newCapacity >> 16;
+	++newCapacity;
+
+	queue->buffer = (uint8_t*) malloc(newCapacity * elementSize);
+	if (!queue->buffer)
+		return false;
+	queue->elementSize = elementSize;
+	queue->capacity    = newCapacity;
+	queue->mask        = newCapacity - 1;
+	queue->head        = 0;
+	queue->tail        = 0;
+	return true;
+}
+
+void SPSCQueueCleanup(SPSCQueue* queue)
+{
+	if (!queue)
+		return;
+	free(queue->buffer);
+	queue->buffer   = NULL;
+	queue->capacity = 0;
+	queue->mask     = 0;
+	queue->head     = 0;
+	queue->tail     = 0;
+}
+
+bool SPSCQueuePush(SPSCQueue* queue, const void* element)
+{
+	uint32_t tail = queue->tail;
+	uint32_t head = AtomicLoad32(&queue->head);
+	if (tail - head >= queue->capacity)
+		return false;
+	memcpy(queue->buffer + (tail & queue->mask) * queue->elementSize, element, queue->elementSize);
+	AtomicStore32(&queue->tail, tail + 1);
+	return true;
+}
+
+bool SPSCQueuePop(SPSCQueue* queue, void* element)
+{
+	uint32_t head = queue->head;
+	uint32_t tail = AtomicLoad32(&queue->tail);
+	if (head == tail)
+		return false;
+	memcpy(element, queue->buffer + (head & queue->mask) * queue->elementSize, queue->elementSize);
+	AtomicStore32(&queue->head, head + 1);
+	return true;
+}
+
+uint32_t SPSCQueueSize(SPSCQueue* queue)
+{
+	return AtomicLoad32(&queue->tail) - AtomicLoad32(&queue->head);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct SPSCQueue
+{
+	uint8_t* buffer;
+	size_t   elementSize;
+	uint32_t capacity;
+	uint32_t mask;
+
+	uint8_t           pad0[64];
+	volatile uint32_t head;
+	uint8_t           pad1[64];
+	volatile uint32_t tail;
+	uint8_t           pad2[64];
+} SPSCQueue;
+
+bool     SPSCQueueSetup(SPSCQueue* queue, size_t elementSize, uint32_t capacity);
+void     SPSCQueueCleanup(SPSCQueue* queue);
+bool     SPSCQueuePush(SPSCQueue* queue, const void* element);
+bool     SPSCQueuePop(SPSCQueue* queue, void* element);
+uint32_t SPSCQueueSize(SPSCQueue* queue);
@@ -0,0 +1,201 @@
+#include "Scene.h"
+#include "Atomic.h"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include <math.h>
+#include <string.h>
+
+#define SCENE_STATE_FRESH 4U
+#define SCENE_STATE_MASK  3U
+
+static void SceneUpdateCamera(SceneCamera* camera, double deltaTime, const SceneInput* input)
+{
+	camera->yaw   += input->turn[0] * 90.0f * (float) deltaTime;
+	camera->pitch += input->turn[1] * 90.0f * (float) deltaTime;
+	camera->pitch  = camera->pitch > 89.0f ? 89.0f : (camera->pitch < -89.0f ? -89.0f : camera->pitch);
+
+	float yaw        = camera->yaw * 0.017453292f;
+	float pitch      = camera->pitch * 0.017453292f;
+	float forward[3] = { cosf(pitch) * sinf(yaw), sinf(pitch), -cosf(pitch) * cosf(yaw) };
+	float right[3]   = { cosf(yaw), 0.0f, sinf(yaw) };
+	float distance   = (float) deltaTime;
+	for (uint32_t i = 0; i < 3; ++i)
+		camera->position[i] += (right[i] * input->move[0] + forward[i] * input->move[2]) * distance;
+	camera->position[1] += input->move[1] * distance;
+}
+
+static void SceneUpdate(const SceneState* prev, SceneState* next, double deltaTime, const SceneInput* input)
+{
+	next->frame     = prev->frame + 1;
+	next->time      = prev->time + deltaTime;
+	next->deltaTime = deltaTime;
+	next->camera    = prev->camera;
+	memcpy(next->background, prev->background, sizeof(next->background));
+	SceneUpdateCamera(&next->camera, deltaTime, input);
+}
+
+static void SceneCopyState(const SceneState* src, SceneState* dst)
+{
+	dst->frame     = src->frame;
+	dst->time      = src->time;
+	dst->deltaTime = src->deltaTime;
+	dst->camera    = src->camera;
+	memcpy(dst->background, src->background, sizeof(dst->background));
+}
+
+static void ScenePublish(SceneData* scene, double deltaTime, const SceneInput* input)
+{
+	double start = glfwGetTime();
+	SceneUpdate(scene->states + scene->last, scene->states + scene->back, deltaTime, input);
+	scene->updateTime = glfwGetTime() - start;
+
+	scene->last = scene->back;
+	scene->back = AtomicExchange32(&scene->middle, scene->back | SCENE_STATE_FRESH) & SCENE_STATE_MASK;
+}
+
+static void SceneThreadMain(void* userData)
+{
+	SceneData* scene = (SceneData*) userData;
+
+	MutexLock(scene->mutex);
+	while (true)
+	{
+		while (scene->completed == scene->requested && !AtomicLoad32(&scene->stop))
+			CondVarWait(scene->requestCond, scene->mutex);
+		if (AtomicLoad32(&scene->stop))
+			break;
+
+		uint64_t   target    = scene->requested;
+		double     deltaTime = scene->requestedDeltaTime;
+		SceneInput input     = scene->requestedInput;
+		MutexUnlock(scene->mutex);
+
+		ScenePublish(scene, deltaTime, &input);
+
+		MutexLock(scene->mutex);
+		scene->completed = target;
+		CondVarWakeAll(scene->doneCond);
+	}
+	MutexUnlock(scene->mutex);
+}
+
+bool SceneSetup(SceneData* scene)
+{
+	if (!scene) return false;
+
+	scene->thread      = NULL;
+	scene->mutex       = NULL;
+	scene->requestCond = NULL;
+	scene->doneCond    = NULL;
+	memset(scene->states, 0, sizeof(scene->states));
+	memset(&scene->requestedInput, 0, sizeof(scene->requestedInput));
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		SceneState* state         = scene->states + i;
+		state->camera.position[0] = 0.5f;
+		state->camera.position[1] = 0.5f;
+		state->camera.position[2] = 1.5f;
+		state->camera.fov         = 60.0f;
+		state->background[0]      = 186.0f / 255.0f;
+		state->background[1]      = 218.0f / 255.0f;
+		state->background[2]      = 85.0f / 255.0f;
+		state->background[3]      = 1.0f;
+	}
+	SceneUpdate(scene->states + 0, scene->states + 1, 0.0, &scene->requestedInput);
+	scene->states[1].frame = 0;
+	SceneCopyState(scene->states + 1, scene->states + 0);
+	SceneCopyState(scene->states + 1, scene->states + 2);
+
+	scene->front              = 0;
+	scene->middle             = 1;
+	scene->back               = 2;
+	scene->last               = 0;
+	scene->stop               = 0;
+	scene->requested          = 0;
+	scene->completed          = 0;
+	scene->requestedDeltaTime = 0.0;
+	scene->updateTime         = 0.0;
+	scene->stallTime          = 0.0;
+	if (!scene->pipelined)
+		return true;
+
+	scene->mutex       = MutexCreate();
+	scene->requestCond = CondVarCreate();
+	scene->doneCond    = CondVarCreate();
+	if (!scene->mutex || !scene->requestCond || !scene->doneCond)
+	{
+		SceneCleanup(scene);
+		return false;
+	}
+	scene->thread = ThreadCreate(&SceneThreadMain, scene);
+	if (!scene->thread)
+	{
+		SceneCleanup(scene);
+		return false;
+	}
+	return true;
+}
+
+void SceneCleanup(SceneData* scene)
+{
+	if (!scene) return;
+
+	if (scene->thread)
+	{
+		MutexLock(scene->mutex);
+		AtomicStore32(&scene->stop, 1);
+		CondVarWakeAll(scene->requestCond);
+		MutexUnlock(scene->mutex);
+		ThreadJoin(scene->thread);
+		scene->thread = NULL;
+	}
+	CondVarDestroy(scene->doneCond);
+	CondVarDestroy(scene->requestCond);
+	MutexDestroy(scene->mutex);
+	scene->doneCond    = NULL;
+	scene->requestCond = NULL;
+	scene->mutex       = NULL;
+}
+
+void SceneRequestUpdate(SceneData* scene, double deltaTime, const SceneInput* input)
+{
+	if (!scene || !input) return;
+
+	if (!scene->thread)
+	{
+		ScenePublish(scene, deltaTime, input);
+		return;
+	}
+
+	MutexLock(scene->mutex);
+	scene->requestedDeltaTime = deltaTime;
+	scene->requestedInput     = *input;
+	++scene->requested;
+	CondVarWakeOne(scene->requestCond);
+	MutexUnlock(scene->mutex);
+}
+
+const SceneState* SceneAcquireState(SceneData* scene)
+{
+	if (!scene) return NULL;
+
+	scene->stallTime = 0.0;
+	if (scene->thread)
+	{
+		MutexLock(scene->mutex);
+		if (scene->completed != scene->requested)
+		{
+			double start = glfwGetTime();
+			while (scene->completed != scene->requested)
+				CondVarWait(scene->doneCond, scene->mutex);
+			scene->stallTime = glfwGetTime() - start;
+		}
+		MutexUnlock(scene->mutex);
+	}
+
+	if (AtomicLoad32(&scene->middle) & SCENE_STATE_FRESH)
+		scene->front = AtomicExchange32(&scene->middle, scene->front) & SCENE_STATE_MASK;
+	return scene->states + scene->front;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Thread.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct SceneCamera
+{
+	float position[3];
+	float yaw;
+	float pitch;
+	float fov;
+} SceneCamera;
+
+typedef struct SceneInput
+{
+	float move[3];
+	float turn[2];
+} SceneInput;
+
+typedef struct SceneState
+{
+	uint64_t frame;
+	double   time;
+	double   deltaTime;
+
+	SceneCamera camera;
+	float       background[4];
+} SceneState;
+
+typedef struct SceneData
+{
+	bool pipelined;
+
+	SceneState        states[3];
+	volatile uint32_t middle;
+	uint32_t          back;
+	uint32_t          front;
+	uint32_t          last;
+
+	Thread*           thread;
+	Mutex*            mutex;
+	CondVar*          requestCond;
+	CondVar*          doneCond;
+	volatile uint32_t stop;
+	uint64_t          requested;
+	uint64_t          completed;
+	double            requestedDeltaTime;
+	SceneInput        requestedInput;
+
+	double updateTime;
+	double stallTime;
+} SceneData;
+
+bool SceneSetup(SceneData* scene);
+void SceneCleanup(SceneData* scene);
+
+void              SceneRequestUpdate(SceneData* scene, double deltaTime, const SceneInput* input);
+const SceneState* SceneAcquireState(SceneData* scene);
@@ -1,118 +1,248 @@
+#include "Atomic.h"
 #include "Filesystem.h"
 #include "FileWatcher.h"
+#include "ShaderC.h"
 #include "Vk.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-bool ShaderCCompileShader(const char* filepath, const char* shaderSource, size_t shaderSouceLength, uint32_t** code, size_t* codeSize);
-void ShaderCFreeBuffer(uint32_t* code, size_t codeSize);
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
 
-static void VkReadShaderCache(VkShaderData* shader, uint32_t** code, size_t* codeSize)
+#define VK_SHADER_MEASURE_REPEATS 8
+
+typedef struct VkShaderCompileTask
 {
-	FSPath cachePath = FSCreatePath("Cache", ~0ULL);
-	if (!FSPathAppend(&cachePath, &shader->filepath))
-	{
-		*code     = NULL;
-		*codeSize = 0;
-		FSDestroyPath(&cachePath);
-		return;
-	}
+	VkShaderData* shader;
+	bool          succeeded;
+} VkShaderCompileTask;
 
-	uint64_t cacheWt = FSLastWriteTime(&cachePath);
-	uint64_t codeWt  = FSLastWriteTime(&shader->filepath);
-	if (codeWt > cacheWt)
+static char* VkReadShaderSource(VkShaderData* shader, size_t* sourceSize)
+{
+	*sourceSize    = 0;
+	FILE* codeFile = fopen(shader->filepath.buf, "rb");
+	if (!codeFile)
+		return NULL;
+	fseek(codeFile, 0, SEEK_END);
+	long fileSize = ftell(codeFile);
+	fseek(codeFile, 0, SEEK_SET);
+	char* source = fileSize >= 0 ? (char*) malloc(fileSize > 0 ? fileSize : 1) : NULL;
+	if (!source)
 	{
-		*code     = NULL;
-		*codeSize = 0;
-		FSDestroyPath(&cachePath);
-		return;
+		fclose(codeFile);
+		return NULL;
 	}
+	*sourceSize = fread(source, 1, fileSize, codeFile);
+	fclose(codeFile);
+	return source;
+}
+
+static uint64_t VkShaderCacheKey(VkShaderData* shader)
+{
+	const char* identity = ShaderCCompilerIdentity();
+	uint64_t    source   = ShaderPackKey(shader->filepath.buf, shader->stage, shader->defines, shader->defineCount);
+	uint64_t    hash     = VkShaderCacheHash(0xCBF29CE484222325ULL, identity, strlen(identity) + 1);
+	hash                 = VkShaderCacheHash(hash, &shader->vk->shaderCompiler.recipes, sizeof(shader->vk->shaderCompiler.recipes));
+	return VkShaderCacheHash(hash, &source, sizeof(source));
+}
 
-	FILE* cacheFile = fopen(cachePath.buf, "rb");
-	if (!cacheFile)
+static bool VkShaderHashSources(VkShaderData* shader, const char* source, size_t sourceSize, uint64_t* sourceHash)
+{
+	char*  preprocessed     = NULL;
+	size_t preprocessedSize = 0;
+	char*  includes         = NULL;
+	size_t includesSize     = 0;
+	bool   result           = ShaderCPreprocessShader(shader->filepath.buf, shader->stage, source, sourceSize, shader->defines, shader->defineCount, &preprocessed, &preprocessedSize, &includes, &includesSize);
+	free(preprocessed);
+	if (includes)
 	{
-		*code     = NULL;
-		*codeSize = 0;
-		FSDestroyPath(&cachePath);
-		return;
+		free(shader->includes);
+		shader->includes     = includes;
+		shader->includesSize = includesSize;
 	}
-	fseek(cacheFile, 0, SEEK_END);
-	*codeSize = ftell(cacheFile);
-	fseek(cacheFile, 0, SEEK_CUR);
-	*code = (uint32_t*) malloc(*codeSize);
-	if (!*code)
+	return result && ShaderPackHashSources(shader->filepath.buf, shader->includes, shader->includesSize, sourceHash);
+}
+
+static bool VkGetCachedShaderCode(VkShaderData* shader, uint64_t key, uint32_t** code, size_t* codeSize)
+{
+	uint64_t cachedHash   = 0;
+	uint64_t sourceHash   = 0;
+	char*    includes     = NULL;
+	size_t   includesSize = 0;
+	if (!VkShaderCacheFind(shader->vk, key, &cachedHash, code, codeSize, &includes, &includesSize))
+		return false;
+	if (!ShaderPackHashSources(shader->filepath.buf, includes, includesSize, &sourceHash) || sourceHash != cachedHash)
 	{
+		free(*code);
+		free(includes);
 		*code     = NULL;
 		*codeSize = 0;
-		fclose(cacheFile);
-		FSDestroyPath(&cachePath);
-		return;
+		return false;
 	}
-	fread(*code, 1, *codeSize, cacheFile);
-	fclose(cacheFile);
-	FSDestroyPath(&cachePath);
+	free(shader->includes);
+	shader->includes     = includes;
+	shader->includesSize = includesSize;
+	return true;
 }
 
-static bool VkWriteShaderCache(VkShaderData* shader, const uint32_t* code, size_t codeSize, uint64_t codeWt)
+static double VkShaderMeasureCreate(VkData* vk, const uint32_t* code, size_t codeSize)
 {
-	FSPath cachePath = FSCreatePath("Cache", ~0ULL);
-	if (!FSPathAppend(&cachePath, &shader->filepath))
+	VkShaderModuleCreateInfo createInfo = {
+		.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.pNext    = NULL,
+		.flags    = 0,
+		.codeSize = codeSize,
+		.pCode    = code
+	};
+	double elapsed = 0.0;
+	for (uint32_t i = 0; i < VK_SHADER_MEASURE_REPEATS; ++i)
 	{
-		FSDestroyPath(&cachePath);
-		return false;
+		VkShaderModule module = NULL;
+		double         start  = glfwGetTime();
+		if (!VkValidate(vk, vkCreateShaderModule(vk->device, &createInfo, vk->allocation, &module)))
+			return 0.0;
+		elapsed += glfwGetTime() - start;
+		vkDestroyShaderModule(vk->device, module, vk->allocation);
 	}
+	return elapsed / VK_SHADER_MEASURE_REPEATS;
+}
+
+static void VkShaderApplyRecipes(VkShaderData* shader, uint32_t** code, size_t* codeSize)
+{
+	VkData*               vk       = shader->vk;
+	VkShaderCompilerData* compiler = &vk->shaderCompiler;
+	if (!compiler->recipes)
+		return;
 
-	FILE* cacheFile = fopen(cachePath.buf, "wb");
-	if (!cacheFile)
+	double createTime = compiler->report ? VkShaderMeasureCreate(vk, *code, *codeSize) : 0.0;
+	for (uint32_t i = 0; i < SHADERC_RECIPE_COUNT; ++i)
 	{
-		FSDestroyPath(&cachePath);
-		return false;
+		if (!(compiler->recipes & (1U << i)))
+			continue;
+
+		uint32_t* optimized     = NULL;
+		size_t    optimizedSize = 0;
+		double    start         = glfwGetTime();
+		if (!ShaderCOptimize((ShaderCRecipe) i, *code, *codeSize, &optimized, &optimizedSize))
+			continue;
+
+		VkShaderRecipeStats* stats = shader->recipeStats + i;
+		stats->applied             = true;
+		stats->optimizeTime        = glfwGetTime() - start;
+		stats->sizeBefore          = *codeSize;
+		stats->sizeAfter           = optimizedSize;
+		stats->createBefore        = createTime;
+		if (compiler->report)
+			createTime = VkShaderMeasureCreate(vk, optimized, optimizedSize);
+		stats->createAfter = createTime;
+		free(*code);
+		*code     = optimized;
+		*codeSize = optimizedSize;
 	}
-	fwrite(code, 1, codeSize, cacheFile);
-	fclose(cacheFile);
-	FSSetLastWriteTime(&cachePath, codeWt);
-	FSDestroyPath(&cachePath);
-	return true;
 }
 
-static bool VkCompileShaderCode(VkShaderData* shader, uint32_t** code, size_t* codeSize, uint64_t* codeWt)
+static bool VkGetPrecompiledShaderCode(VkShaderData* shader, uint32_t** code, size_t* codeSize)
 {
-	*codeWt        = FSLastWriteTime(&shader->filepath);
-	FILE* codeFile = fopen(shader->filepath.buf, "r");
-	if (!codeFile)
+	VkShaderCompilerData* compiler = &shader->vk->shaderCompiler;
+	if (compiler->pack.recipes != compiler->recipes && ShaderCAvailable())
 		return false;
-	fseek(codeFile, 0, SEEK_END);
-	*codeSize = ftell(codeFile);
-	fseek(codeFile, 0, SEEK_SET);
-	*code = (uint32_t*) malloc(*codeSize);
-	if (!*code)
+
+	const ShaderPackEntry* entry = ShaderPackFind(&compiler->pack, ShaderPackKey(shader->filepath.buf, shader->stage, shader->defines, shader->defineCount));
+	if (!entry)
+		return false;
+
+	const char* packIncludes = compiler->pack.strings + entry->includes;
+	uint64_t    sourceHash   = 0;
+	if (ShaderPackHashSources(shader->filepath.buf, packIncludes, entry->includesSize, &sourceHash) && sourceHash != entry->sourceHash)
 	{
-		fclose(codeFile);
+		AtomicAdd64(&compiler->stale, 1);
+		if (ShaderCAvailable())
+			return false;
+		printf("Shader pack entry for %s is stale and shaderc is not linked into this build, using it anyway\n", shader->filepath.buf);
+	}
+
+	char* includes = (char*) malloc(entry->includesSize > 0 ? entry->includesSize : 1);
+	*code          = (uint32_t*) malloc(entry->size);
+	if (!includes || !*code)
+	{
+		free(includes);
+		free(*code);
+		*code = NULL;
 		return false;
 	}
-	fread(*code, 1, *codeSize, codeFile);
-	fclose(codeFile);
+	memcpy(includes, packIncludes, entry->includesSize);
+	memcpy(*code, compiler->pack.blob + entry->offset, entry->size);
+	*codeSize = entry->size;
+	free(shader->includes);
+	shader->includes     = includes;
+	shader->includesSize = entry->includesSize;
+	AtomicAdd64(&compiler->precompiled, 1);
 	return true;
 }
 
 static bool VkGetShaderCode(VkShaderData* shader, uint32_t** code, size_t* codeSize)
 {
-	if (!shader->handle)
-		VkReadShaderCache(shader, code, codeSize);
+	VkShaderCompilerData* compiler = &shader->vk->shaderCompiler;
+
+	*code            = NULL;
+	*codeSize        = 0;
+	shader->compiled = false;
+	memset(shader->recipeStats, 0, sizeof(shader->recipeStats));
+	if (VkGetPrecompiledShaderCode(shader, code, codeSize))
+		return true;
 
-	if (!*code)
+	uint64_t key = VkShaderCacheKey(shader);
+	if (VkGetCachedShaderCode(shader, key, code, codeSize))
 	{
-		uint64_t wt = 0;
-		if (!VkCompileShaderCode(shader, code, codeSize, &wt) ||
-			!VkWriteShaderCache(shader, *code, *codeSize, wt))
-			return false;
+		AtomicAdd64(&compiler->cached, 1);
+		return true;
 	}
 
+	size_t   sourceSize = 0;
+	uint64_t sourceHash = 0;
+	char*    source     = VkReadShaderSource(shader, &sourceSize);
+	if (!source || !VkShaderHashSources(shader, source, sourceSize, &sourceHash))
+	{
+		free(source);
+		AtomicAdd64(&compiler->failed, 1);
+		return false;
+	}
+
+	double start    = glfwGetTime();
+	bool   compiled = ShaderCCompileShader(shader->filepath.buf, shader->stage, source, sourceSize, shader->defines, shader->defineCount, code, codeSize);
+	AtomicAdd64(&compiler->compileNanoseconds, (uint64_t) ((glfwGetTime() - start) * 1e9));
+	free(source);
+	if (!compiled)
+	{
+		AtomicAdd64(&compiler->failed, 1);
+		return false;
+	}
+	AtomicAdd64(&compiler->compiled, 1);
+	shader->compiled = true;
+	VkShaderApplyRecipes(shader, code, codeSize);
+	VkShaderCacheInsert(shader->vk, key, sourceHash, *code, *codeSize, shader->includes, shader->includesSize);
 	return true;
 }
 
+static VkShaderStageFlagBits VkShaderStageFromPath(const FSPath* filepath)
+{
+	const char* extension = strrchr(filepath->buf, '.');
+	if (!extension)
+		return 0;
+	if (strcmp(extension, ".vert") == 0) return VK_SHADER_STAGE_VERTEX_BIT;
+	if (strcmp(extension, ".frag") == 0) return VK_SHADER_STAGE_FRAGMENT_BIT;
+	if (strcmp(extension, ".comp") == 0) return VK_SHADER_STAGE_COMPUTE_BIT;
+	if (strcmp(extension, ".rgen") == 0) return VK_SHADER_STAGE_RAYGEN_BIT_KHR;
+	if (strcmp(extension, ".rmiss") == 0) return VK_SHADER_STAGE_MISS_BIT_KHR;
+	if (strcmp(extension, ".rchit") == 0) return VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+	if (strcmp(extension, ".rahit") == 0) return VK_SHADER_STAGE_ANY_HIT_BIT_KHR;
+	if (strcmp(extension, ".rint") == 0) return VK_SHADER_STAGE_INTERSECTION_BIT_KHR;
+	if (strcmp(extension, ".rcall") == 0) return VK_SHADER_STAGE_CALLABLE_BIT_KHR;
+	return 0;
+}
+
 static void VkShaderModified(const FSPath* filepath, void* userData)
 {
 	(void) filepath;
@@ -120,19 +250,143 @@ static void VkShaderModified(const FSPath* filepath, void* userData)
 	shader->modified     = true;
 }
 
-bool VkSetupShader(VkShaderData* shader, const char* filepath)
+static void VkShaderDependencyModified(const FSPath* filepath, void* userData)
+{
+	(void) filepath;
+	VkShaderDependency* dependency = (VkShaderDependency*) userData;
+	for (uint32_t i = 0; i < dependency->dependentCount; ++i)
+		dependency->dependents[i]->modified = true;
+}
+
+static void VkShaderRemoveDependencies(VkShaderData* shader)
+{
+	VkShaderDependencyGraph* graph = &shader->vk->shaderDependencies;
+	for (uint32_t i = 0; i < graph->dependencyCount;)
+	{
+		VkShaderDependency* dependency = graph->dependencies[i];
+		for (uint32_t j = 0; j < dependency->dependentCount; ++j)
+		{
+			if (dependency->dependents[j] != shader)
+				continue;
+			dependency->dependents[j] = dependency->dependents[--dependency->dependentCount];
+			break;
+		}
+		if (dependency->dependentCount > 0)
+		{
+			++i;
+			continue;
+		}
+		FWUnwatchFile(dependency->watchID);
+		FSDestroyPath(&dependency->filepath);
+		free(dependency->dependents);
+		free(dependency);
+		graph->dependencies[i] = graph->dependencies[--graph->dependencyCount];
+	}
+	if (graph->dependencyCount == 0)
+	{
+		free(graph->dependencies);
+		graph->dependencies       = NULL;
+		graph->dependencyCapacity = 0;
+	}
+}
+
+static VkShaderDependency* VkShaderGetDependency(VkShaderDependencyGraph* graph, const char* filepath)
+{
+	FSPath path = FSCreatePath(filepath, ~0ULL);
+	if (!path.buf)
+		return NULL;
+	for (uint32_t i = 0; i < graph->dependencyCount; ++i)
+	{
+		if (FSPathEquals(&graph->dependencies[i]->filepath, &path))
+		{
+			FSDestroyPath(&path);
+			return graph->dependencies[i];
+		}
+	}
+
+	if (graph->dependencyCount >= graph->dependencyCapacity)
+	{
+		uint32_t             newCapacity     = graph->dependencyCapacity > 0 ? graph->dependencyCapacity * 2 : 8;
+		VkShaderDependency** newDependencies = (VkShaderDependency**) realloc(graph->dependencies, newCapacity * sizeof(VkShaderDependency*));
+		if (!newDependencies)
+		{
+			FSDestroyPath(&path);
+			return NULL;
+		}
+		graph->dependencies       = newDependencies;
+		graph->dependencyCapacity = newCapacity;
+	}
+	VkShaderDependency* dependency = (VkShaderDependency*) calloc(1, sizeof(VkShaderDependency));
+	if (!dependency)
+	{
+		FSDestroyPath(&path);
+		return NULL;
+	}
+	dependency->filepath                          = path;
+	dependency->watchID                           = FWWatchFile(&dependency->filepath, &VkShaderDependencyModified, dependency);
+	graph->dependencies[graph->dependencyCount++] = dependency;
+	return dependency;
+}
+
+static void VkShaderUpdateDependencies(VkShaderData* shader)
+{
+	if (!ShaderCAvailable())
+		return;
+
+	VkShaderRemoveDependencies(shader);
+	for (size_t offset = 0; offset < shader->includesSize; offset += strlen(shader->includes + offset) + 1)
+	{
+		VkShaderDependency* dependency = VkShaderGetDependency(&shader->vk->shaderDependencies, shader->includes + offset);
+		if (dependency && dependency->dependentCount >= dependency->dependentCapacity)
+		{
+			uint32_t       newCapacity   = dependency->dependentCapacity > 0 ? dependency->dependentCapacity * 2 : 4;
+			VkShaderData** newDependents = (VkShaderData**) realloc(dependency->dependents, newCapacity * sizeof(VkShaderData*));
+			if (newDependents)
+			{
+				dependency->dependents        = newDependents;
+				dependency->dependentCapacity = newCapacity;
+			}
+		}
+		if (!dependency || dependency->dependentCount >= dependency->dependentCapacity)
+		{
+			VkReportError(shader->vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate shader dependency");
+			VkShaderRemoveDependencies(shader);
+			return;
+		}
+		dependency->dependents[dependency->dependentCount++] = shader;
+	}
+}
+
+static void VkShaderInit(VkShaderData* shader, const char* filepath)
+{
+	shader->handle       = NULL;
+	shader->filepath     = FSCreatePath(filepath, ~0ULL);
+	shader->stage        = VkShaderStageFromPath(&shader->filepath);
+	shader->modified     = false;
+	shader->watchID      = 0;
+	shader->includes     = NULL;
+	shader->includesSize = 0;
+	memset(&shader->reflection, 0, sizeof(shader->reflection));
+	memset(&shader->reloadReflection, 0, sizeof(shader->reloadReflection));
+
+	shader->reloadHandle          = NULL;
+	shader->reloadCounter.pending = 0;
+	shader->reloading             = false;
+	shader->reloadSucceeded       = false;
+}
+
+static bool VkShaderCreateModule(VkShaderData* shader)
 {
-	if (!shader || !shader->vk) return false;
 	VkData* vk = shader->vk;
 
 	size_t    codeSize = 0;
 	uint32_t* code     = NULL;
-	shader->filepath   = FSCreatePath(filepath, ~0ULL);
-	shader->modified   = false;
-	shader->watchID    = 0;
 	if (!VkGetShaderCode(shader, &code, &codeSize))
+		return false;
+	if (!VkReflectShader(code, codeSize, &shader->reflection))
 	{
-		VkCleanupShader(shader);
+		free(code);
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Failed to reflect shader");
 		return false;
 	}
 
@@ -143,20 +397,130 @@ bool VkSetupShader(VkShaderData* shader, const char* filepath)
 		.codeSize = codeSize,
 		.pCode    = code
 	};
-	if (!VkValidate(vk, vkCreateShaderModule(vk->device, &createInfo, vk->allocation, &shader->handle)))
+	bool created = VkValidate(vk, vkCreateShaderModule(vk->device, &createInfo, vk->allocation, &shader->handle));
+	free(code);
+	return created;
+}
+
+static void VkShaderCompileJob(void* userData, uint32_t threadIndex)
+{
+	(void) threadIndex;
+	VkShaderCompileTask* task = (VkShaderCompileTask*) userData;
+	task->succeeded           = VkShaderCreateModule(task->shader);
+}
+
+bool VkSetupShaderPack(VkData* vk)
+{
+	if (!vk) return false;
+
+	VkShaderCompilerData* compiler = &vk->shaderCompiler;
+	if (!compiler->packFilepath)
+		compiler->packFilepath = "Shaders/Shaders.spvpack";
+	compiler->precompiled = 0;
+	compiler->stale       = 0;
+
+	double start  = glfwGetTime();
+	bool   loaded = ShaderPackLoad(&compiler->pack, compiler->packFilepath);
+	if (!loaded && !ShaderCAvailable())
+	{
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, compiler->pack.rejected ? "Shader pack is corrupt and shaderc is not linked into this build" : "Shader pack is missing and shaderc is not linked into this build");
+		return false;
+	}
+	compiler->packLoadTime = glfwGetTime() - start;
+	return true;
+}
+
+void VkCleanupShaderPack(VkData* vk)
+{
+	if (!vk) return;
+
+	ShaderPackUnload(&vk->shaderCompiler.pack);
+}
+
+bool VkSetupShader(VkShaderData* shader, const char* filepath)
+{
+	if (!shader || !shader->vk) return false;
+
+	VkShaderInit(shader, filepath);
+	if (!VkShaderCreateModule(shader))
 	{
 		VkCleanupShader(shader);
 		return false;
 	}
-	shader->watchID = FWWatchFile(&shader->filepath, &VkShaderModified, shader);
-	free(code);
+	if (ShaderCAvailable())
+		shader->watchID = FWWatchFile(&shader->filepath, &VkShaderModified, shader);
+	VkShaderUpdateDependencies(shader);
 	return true;
 }
 
+bool VkSetupShaders(VkData* vk, VkShaderData* const* shaders, const char* const* filepaths, uint32_t shaderCount)
+{
+	if (!vk || !shaders || !filepaths) return false;
+
+	VkShaderCompilerData* compiler = &vk->shaderCompiler;
+	VkShaderCompileTask*  tasks    = (VkShaderCompileTask*) calloc(shaderCount, sizeof(VkShaderCompileTask));
+	if (!tasks)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate shader compile tasks");
+		return false;
+	}
+
+	double     start   = glfwGetTime();
+	JobCounter counter = { 0 };
+	for (uint32_t i = 0; i < shaderCount; ++i)
+	{
+		if (!shaders[i] || !filepaths[i])
+			continue;
+		tasks[i].shader = shaders[i];
+		shaders[i]->vk  = vk;
+		VkShaderInit(shaders[i], filepaths[i]);
+		if (!JobSystemSubmit(compiler->jobs, &VkShaderCompileJob, tasks + i, &counter))
+			VkShaderCompileJob(tasks + i, 0);
+	}
+	JobSystemWait(compiler->jobs, &counter);
+	compiler->batchTime += glfwGetTime() - start;
+	VkSaveShaderCache(vk);
+
+	bool succeeded = true;
+	for (uint32_t i = 0; i < shaderCount; ++i)
+		succeeded = succeeded && (!tasks[i].shader || tasks[i].succeeded);
+	for (uint32_t i = 0; i < shaderCount; ++i)
+	{
+		if (!tasks[i].shader)
+			continue;
+		if (succeeded)
+		{
+			if (ShaderCAvailable())
+				tasks[i].shader->watchID = FWWatchFile(&tasks[i].shader->filepath, &VkShaderModified, tasks[i].shader);
+			VkShaderUpdateDependencies(tasks[i].shader);
+		}
+		else
+		{
+			VkCleanupShader(tasks[i].shader);
+		}
+	}
+	free(tasks);
+	return succeeded;
+}
+
 void VkCleanupShader(VkShaderData* shader)
 {
 	if (!shader || !shader->vk) return;
 	VkData* vk = shader->vk;
+	if (shader->reloading)
+	{
+		if (AtomicLoad32(&shader->reloadCounter.pending) > 0)
+			JobSystemWait(vk->shaderCompiler.jobs, &shader->reloadCounter);
+		vkDestroyShaderModule(vk->device, shader->reloadHandle, vk->allocation);
+		VkDestroyShaderReflection(&shader->reloadReflection);
+		shader->reloadHandle = NULL;
+		shader->reloading    = false;
+	}
+	VkShaderRemoveDependencies(shader);
+	VkDestroyShaderReflection(&shader->reflection);
+	free(shader->includes);
+	shader->includes     = NULL;
+	shader->includesSize = 0;
 	vkDestroyShaderModule(vk->device, shader->handle, vk->allocation);
 	shader->handle = NULL;
 	FSDestroyPath(&shader->filepath);
@@ -172,8 +536,19 @@ bool VkShaderRecompile(VkShaderData* shader)
 	size_t    codeSize = 0;
 	uint32_t* code     = NULL;
 	shader->modified   = false;
-	if (!VkGetShaderCode(shader, &code, &codeSize))
+
+	bool compiled = VkGetShaderCode(shader, &code, &codeSize);
+	VkShaderUpdateDependencies(shader);
+	if (!compiled)
+		return false;
+
+	VkShaderReflection reflection;
+	if (!VkReflectShader(code, codeSize, &reflection))
+	{
+		free(code);
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Failed to reflect shader");
 		return false;
+	}
 
 	VkShaderModule           newShaderModule = NULL;
 	VkShaderModuleCreateInfo createInfo      = {
@@ -186,10 +561,82 @@ bool VkShaderRecompile(VkShaderData* shader)
 	if (!VkValidate(vk, vkCreateShaderModule(vk->device, &createInfo, vk->allocation, &newShaderModule)))
 	{
 		free(code);
+		VkDestroyShaderReflection(&reflection);
 		return false;
 	}
 	free(code);
 	vkDestroyShaderModule(vk->device, shader->handle, vk->allocation);
-	shader->handle = newShaderModule;
+	VkDestroyShaderReflection(&shader->reflection);
+	shader->handle     = newShaderModule;
+	shader->reflection = reflection;
+	return true;
+}
+
+static void VkShaderReloadJob(void* userData, uint32_t threadIndex)
+{
+	(void) threadIndex;
+	VkShaderData* shader = (VkShaderData*) userData;
+	VkData*       vk     = shader->vk;
+
+	size_t    codeSize = 0;
+	uint32_t* code     = NULL;
+	if (!VkGetShaderCode(shader, &code, &codeSize) || !VkReflectShader(code, codeSize, &shader->reloadReflection))
+	{
+		free(code);
+		shader->reloadSucceeded = false;
+		return;
+	}
+
+	VkShaderModuleCreateInfo createInfo = {
+		.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.pNext    = NULL,
+		.flags    = 0,
+		.codeSize = codeSize,
+		.pCode    = code
+	};
+	shader->reloadSucceeded = VkValidate(vk, vkCreateShaderModule(vk->device, &createInfo, vk->allocation, &shader->reloadHandle));
+	free(code);
+	if (!shader->reloadSucceeded)
+		VkDestroyShaderReflection(&shader->reloadReflection);
+}
+
+bool VkShaderBeginReload(VkShaderData* shader)
+{
+	if (!shader || !shader->vk || shader->reloading) return false;
+
+	shader->modified        = false;
+	shader->reloading       = true;
+	shader->reloadSucceeded = false;
+	shader->reloadHandle    = NULL;
+	memset(&shader->reloadReflection, 0, sizeof(shader->reloadReflection));
+	if (!JobSystemSubmitBackground(shader->vk->shaderCompiler.jobs, &VkShaderReloadJob, shader, &shader->reloadCounter))
+		VkShaderReloadJob(shader, 0);
+	return true;
+}
+
+bool VkShaderReloadReady(VkShaderData* shader)
+{
+	return shader && shader->reloading && AtomicLoad32(&shader->reloadCounter.pending) == 0;
+}
+
+bool VkShaderFinishReload(VkShaderData* shader)
+{
+	if (!VkShaderReloadReady(shader)) return false;
+	VkData* vk = shader->vk;
+
+	shader->reloading = false;
+	VkShaderUpdateDependencies(shader);
+	if (!shader->reloadSucceeded)
+	{
+		vkDestroyShaderModule(vk->device, shader->reloadHandle, vk->allocation);
+		shader->reloadHandle = NULL;
+		return false;
+	}
+	vkDestroyShaderModule(vk->device, shader->handle, vk->allocation);
+	VkDestroyShaderReflection(&shader->reflection);
+	shader->handle       = shader->reloadHandle;
+	shader->reflection   = shader->reloadReflection;
+	shader->reloadHandle = NULL;
+	memset(&shader->reloadReflection, 0, sizeof(shader->reloadReflection));
 	return true;
 }
\ No newline at end of file
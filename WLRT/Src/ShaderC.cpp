@@ -1,20 +1,263 @@
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
 
-#include <shaderc/shaderc.hpp>
+#include "ShaderC.h"
 
+#if !defined(WLRT_NO_SHADERC)
+	#include <shaderc/shaderc.hpp>
+	#include <spirv-tools/optimizer.hpp>
+#endif
+#include <vulkan/vulkan.h>
+
+#if !defined(WLRT_NO_SHADERC)
 static shaderc::Compiler s_Compiler;
 
+static shaderc_shader_kind ShaderCGetKind(VkShaderStageFlagBits stage)
+{
+	switch (stage)
+	{
+	case VK_SHADER_STAGE_VERTEX_BIT: return shaderc_vertex_shader;
+	case VK_SHADER_STAGE_FRAGMENT_BIT: return shaderc_fragment_shader;
+	case VK_SHADER_STAGE_COMPUTE_BIT: return shaderc_compute_shader;
+	case VK_SHADER_STAGE_RAYGEN_BIT_KHR: return shaderc_raygen_shader;
+	case VK_SHADER_STAGE_MISS_BIT_KHR: return shaderc_miss_shader;
+	case VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR: return shaderc_closesthit_shader;
+	case VK_SHADER_STAGE_ANY_HIT_BIT_KHR: return shaderc_anyhit_shader;
+	case VK_SHADER_STAGE_INTERSECTION_BIT_KHR: return shaderc_intersection_shader;
+	case VK_SHADER_STAGE_CALLABLE_BIT_KHR: return shaderc_callable_shader;
+	default: return shaderc_glsl_infer_from_source;
+	}
+}
+
+static shaderc::CompileOptions ShaderCCreateOptions()
+{
+	shaderc::CompileOptions options {};
+	options.SetOptimizationLevel(shaderc_optimization_level_performance);
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+	options.SetTargetSpirv(shaderc_spirv_version_1_6);
+	return options;
+}
+
+static const shaderc::CompileOptions& ShaderCThreadOptions()
+{
+	static thread_local shaderc::CompileOptions s_Options = ShaderCCreateOptions();
+	return s_Options;
+}
+
+struct ShaderCInclude
+{
+	std::string           name;
+	std::string           content;
+	shaderc_include_result result;
+};
+
+class ShaderCIncluder : public shaderc::CompileOptions::IncluderInterface
+{
+public:
+	explicit ShaderCIncluder(std::vector<std::string>* includes)
+		: m_Includes(includes) {}
+
+	shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type type, const char* requestingSource, size_t includeDepth) override
+	{
+		(void) type;
+		(void) includeDepth;
+		ShaderCInclude* include = new ShaderCInclude();
+		std::string     path    = requestingSource;
+		size_t          slash   = path.find_last_of('/');
+		path                    = slash == std::string::npos ? std::string(requestedSource) : path.substr(0, slash + 1) + requestedSource;
+
+		std::FILE* file = std::fopen(path.c_str(), "rb");
+		if (file)
+		{
+			std::fseek(file, 0, SEEK_END);
+			long fileSize = std::ftell(file);
+			std::fseek(file, 0, SEEK_SET);
+			include->content.resize(fileSize > 0 ? fileSize : 0);
+			include->content.resize(std::fread(include->content.data(), 1, include->content.size(), file));
+			std::fclose(file);
+			include->name = path;
+			if (m_Includes && std::find(m_Includes->begin(), m_Includes->end(), path) == m_Includes->end())
+				m_Includes->push_back(path);
+		}
+		else
+		{
+			include->content = "Failed to open include file '" + path + "'";
+		}
+
+		include->result.source_name        = include->name.c_str();
+		include->result.source_name_length = include->name.size();
+		include->result.content            = include->content.c_str();
+		include->result.content_length     = include->content.size();
+		include->result.user_data          = include;
+		return &include->result;
+	}
+
+	void ReleaseInclude(shaderc_include_result* data) override
+	{
+		delete (ShaderCInclude*) data->user_data;
+	}
+
+private:
+	std::vector<std::string>* m_Includes;
+};
+
+static shaderc::CompileOptions ShaderCOptions(const char* const* defines, uint32_t defineCount, std::vector<std::string>* includes)
+{
+	shaderc::CompileOptions options { ShaderCThreadOptions() };
+	for (uint32_t i = 0; i < defineCount; ++i)
+		options.AddMacroDefinition(defines[i]);
+	options.SetIncluder(std::make_unique<ShaderCIncluder>(includes));
+	return options;
+}
+
+static void ShaderCRegisterRecipe(spvtools::Optimizer& optimizer, ShaderCRecipe recipe)
+{
+	switch (recipe)
+	{
+	case SHADERC_RECIPE_STRIP_DEBUG:
+		optimizer.RegisterPass(spvtools::CreateStripDebugInfoPass());
+		optimizer.RegisterPass(spvtools::CreateStripNonSemanticInfoPass());
+		break;
+	case SHADERC_RECIPE_DEAD_CODE:
+		optimizer.RegisterPass(spvtools::CreateEliminateDeadFunctionsPass());
+		optimizer.RegisterPass(spvtools::CreateDeadBranchElimPass());
+		optimizer.RegisterPass(spvtools::CreateAggressiveDCEPass());
+		optimizer.RegisterPass(spvtools::CreateEliminateDeadConstantPass());
+		optimizer.RegisterPass(spvtools::CreateCompactIdsPass());
+		break;
+	case SHADERC_RECIPE_FOLD_SPEC_CONSTANTS:
+		optimizer.RegisterPass(spvtools::CreateFoldSpecConstantOpAndCompositePass());
+		optimizer.RegisterPass(spvtools::CreateUnifyConstantPass());
+		optimizer.RegisterPass(spvtools::CreateEliminateDeadConstantPass());
+		break;
+	default: break;
+	}
+}
+#endif
+
 extern "C"
 {
-	bool ShaderCCompileShader(const char* filepath, const char* shaderSource, size_t shaderSourceLength, uint32_t** code, size_t* codeSize)
+	bool ShaderCAvailable()
+	{
+#if defined(WLRT_NO_SHADERC)
+		return false;
+#else
+		return true;
+#endif
+	}
+
+	const char* ShaderCRecipeName(ShaderCRecipe recipe)
 	{
-		shaderc::CompileOptions options {};
-		options.SetOptimizationLevel(shaderc_optimization_level_performance);
-		options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
-		options.SetTargetSpirv(shaderc_spirv_version_1_6);
-		auto result = s_Compiler.CompileGlslToSpv(shaderSource, shaderSourceLength, shaderc_glsl_infer_from_source, filepath, options);
+		switch (recipe)
+		{
+		case SHADERC_RECIPE_STRIP_DEBUG: return "strip";
+		case SHADERC_RECIPE_DEAD_CODE: return "dce";
+		case SHADERC_RECIPE_FOLD_SPEC_CONSTANTS: return "fold";
+		default: return "unknown";
+		}
+	}
+
+	void ShaderCFreeBuffer(uint32_t* code, size_t codeSize)
+	{
+		(void) codeSize;
+		std::free(code);
+	}
+
+#if defined(WLRT_NO_SHADERC)
+	const char* ShaderCCompilerIdentity()
+	{
+		return "none";
+	}
+
+	bool ShaderCPreprocessShader(const char* filepath, VkShaderStageFlagBits, const char*, size_t, const char* const*, uint32_t, char** preprocessed, size_t* preprocessedSize, char** includes, size_t* includesSize)
+	{
+		*preprocessed     = nullptr;
+		*preprocessedSize = 0;
+		*includes         = nullptr;
+		*includesSize     = 0;
+		std::printf("ShaderC ERROR: '%s' is not in the shader pack and shaderc is not linked into this build\n", filepath);
+		return false;
+	}
+
+	bool ShaderCCompileShader(const char* filepath, VkShaderStageFlagBits, const char*, size_t, const char* const*, uint32_t, uint32_t** code, size_t* codeSize)
+	{
+		*code     = nullptr;
+		*codeSize = 0;
+		std::printf("ShaderC ERROR: '%s' is not in the shader pack and shaderc is not linked into this build\n", filepath);
+		return false;
+	}
+
+	bool ShaderCOptimize(ShaderCRecipe, const uint32_t*, size_t, uint32_t** optimized, size_t* optimizedSize)
+	{
+		*optimized     = nullptr;
+		*optimizedSize = 0;
+		return false;
+	}
+#else
+	const char* ShaderCCompilerIdentity()
+	{
+		static const std::string s_Identity = []() {
+			unsigned int spirvVersion  = 0;
+			unsigned int spirvRevision = 0;
+			shaderc_get_spv_version(&spirvVersion, &spirvRevision);
+			return "shaderc spv " + std::to_string(spirvVersion) + "." + std::to_string(spirvRevision) +
+				   " sdk " + std::to_string(VK_HEADER_VERSION_COMPLETE) +
+				   " env vulkan1.3 spirv1.6 opt performance";
+		}();
+		return s_Identity.c_str();
+	}
+
+	bool ShaderCPreprocessShader(const char* filepath, VkShaderStageFlagBits stage, const char* shaderSource, size_t shaderSourceLength, const char* const* defines, uint32_t defineCount, char** preprocessed, size_t* preprocessedSize, char** includes, size_t* includesSize)
+	{
+		std::vector<std::string> includeList;
+		shaderc::CompileOptions  options = ShaderCOptions(defines, defineCount, &includeList);
+		auto                     result  = s_Compiler.PreprocessGlsl(shaderSource, shaderSourceLength, ShaderCGetKind(stage), filepath, options);
+
+		*includesSize = 0;
+		for (auto& include : includeList)
+			*includesSize += include.size() + 1;
+		*includes = (char*) std::malloc(*includesSize > 0 ? *includesSize : 1);
+		if (!*includes)
+		{
+			*includesSize = 0;
+			return false;
+		}
+		size_t offset = 0;
+		for (auto& include : includeList)
+		{
+			std::memcpy(*includes + offset, include.c_str(), include.size() + 1);
+			offset += include.size() + 1;
+		}
+
+		if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+		{
+			auto errorMessage = result.GetErrorMessage();
+			std::printf("ShaderC ERROR: %s\n", errorMessage.c_str());
+			return false;
+		}
+
+		*preprocessedSize = result.cend() - result.cbegin();
+		*preprocessed     = (char*) std::malloc(*preprocessedSize > 0 ? *preprocessedSize : 1);
+		if (!*preprocessed)
+		{
+			*preprocessedSize = 0;
+			return false;
+		}
+		std::memcpy(*preprocessed, result.cbegin(), *preprocessedSize);
+		return true;
+	}
+
+	bool ShaderCCompileShader(const char* filepath, VkShaderStageFlagBits stage, const char* shaderSource, size_t shaderSourceLength, const char* const* defines, uint32_t defineCount, uint32_t** code, size_t* codeSize)
+	{
+		shaderc::CompileOptions options = ShaderCOptions(defines, defineCount, nullptr);
+		auto                    result  = s_Compiler.CompileGlslToSpv(shaderSource, shaderSourceLength, ShaderCGetKind(stage), filepath, options);
 		if (result.GetCompilationStatus() != shaderc_compilation_status_success)
 		{
 			auto errorMessage = result.GetErrorMessage();
@@ -22,15 +265,39 @@ extern "C"
 			return false;
 		}
 
-		*codeSize = result.end() - result.begin();
-		*code     = (uint32_t*) malloc(*codeSize * sizeof(uint32_t));
-		memcpy(*code, result.begin(), *codeSize);
+		*codeSize = (result.end() - result.begin()) * sizeof(uint32_t);
+		*code     = (uint32_t*) std::malloc(*codeSize);
+		if (!*code)
+		{
+			*codeSize = 0;
+			return false;
+		}
+		std::memcpy(*code, result.begin(), *codeSize);
 		return true;
 	}
 
-	void ShaderCFreeBuffer(uint32_t* code, size_t codeSize)
+	bool ShaderCOptimize(ShaderCRecipe recipe, const uint32_t* code, size_t codeSize, uint32_t** optimized, size_t* optimizedSize)
 	{
-		(void) codeSize;
-		free(code);
+		spvtools::Optimizer optimizer { SPV_ENV_VULKAN_1_3 };
+		optimizer.SetMessageConsumer([](spv_message_level_t level, const char* source, const spv_position_t& position, const char* message) {
+			if (level <= SPV_MSG_ERROR)
+				std::printf("SPIRV-Tools ERROR: %s:%zu: %s\n", source ? source : "", position.index, message);
+		});
+		ShaderCRegisterRecipe(optimizer, recipe);
+
+		std::vector<uint32_t> result;
+		if (!optimizer.Run(code, codeSize / sizeof(uint32_t), &result))
+			return false;
+
+		*optimizedSize = result.size() * sizeof(uint32_t);
+		*optimized     = (uint32_t*) std::malloc(*optimizedSize);
+		if (!*optimized)
+		{
+			*optimizedSize = 0;
+			return false;
+		}
+		std::memcpy(*optimized, result.data(), *optimizedSize);
+		return true;
 	}
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vulkan/vulkan.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	typedef enum ShaderCRecipe
+	{
+		SHADERC_RECIPE_STRIP_DEBUG         = 0,
+		SHADERC_RECIPE_DEAD_CODE           = 1,
+		SHADERC_RECIPE_FOLD_SPEC_CONSTANTS = 2,
+		SHADERC_RECIPE_COUNT               = 3
+	} ShaderCRecipe;
+
+	bool        ShaderCAvailable();
+	const char* ShaderCCompilerIdentity();
+	const char* ShaderCRecipeName(ShaderCRecipe recipe);
+	bool        ShaderCPreprocessShader(const char* filepath, VkShaderStageFlagBits stage, const char* shaderSource, size_t shaderSourceLength, const char* const* defines, uint32_t defineCount, char** preprocessed, size_t* preprocessedSize, char** includes, size_t* includesSize);
+	bool        ShaderCCompileShader(const char* filepath, VkShaderStageFlagBits stage, const char* shaderSource, size_t shaderSourceLength, const char* const* defines, uint32_t defineCount, uint32_t** code, size_t* codeSize);
+	bool        ShaderCOptimize(ShaderCRecipe recipe, const uint32_t* code, size_t codeSize, uint32_t** optimized, size_t* optimizedSize);
+	void        ShaderCFreeBuffer(uint32_t* code, size_t codeSize);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,520 @@
+#include "Filesystem.h"
+#include "Vk.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VK_SHADER_CACHE_MAGIC   0x43534C57U
+#define VK_SHADER_CACHE_VERSION 2U
+#define VK_SHADER_CACHE_ALIGN   16U
+
+typedef struct VkShaderCacheFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t reserved;
+} VkShaderCacheFileHeader;
+
+static int VkShaderCacheCompareEntries(const void* lhs, const void* rhs)
+{
+	const VkShaderCacheEntry* a = (const VkShaderCacheEntry*) lhs;
+	const VkShaderCacheEntry* b = (const VkShaderCacheEntry*) rhs;
+	if (a->key != b->key)
+		return a->key < b->key ? -1 : 1;
+	return a->offset < b->offset ? -1 : (a->offset > b->offset ? 1 : 0);
+}
+
+static int VkShaderCacheComparePending(const void* lhs, const void* rhs)
+{
+	return VkShaderCacheCompareEntries(&((const VkShaderCachePending*) lhs)->entry, &((const VkShaderCachePending*) rhs)->entry);
+}
+
+static int64_t VkShaderCacheSearch(const void* entries, size_t stride, uint32_t count, uint64_t key)
+{
+	uint32_t first = 0;
+	uint32_t last  = count;
+	while (first < last)
+	{
+		uint32_t                  mid   = first + (last - first) / 2;
+		const VkShaderCacheEntry* entry = (const VkShaderCacheEntry*) ((const uint8_t*) entries + mid * stride);
+		if (entry->key == key)
+			return mid;
+		if (entry->key < key)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+	return -1;
+}
+
+static uint64_t VkShaderCacheRecordSize(const VkShaderCacheEntry* entry)
+{
+	uint64_t size = sizeof(VkShaderCacheEntry) + entry->size + entry->includesSize;
+	return (size + VK_SHADER_CACHE_ALIGN - 1) & ~(uint64_t) (VK_SHADER_CACHE_ALIGN - 1);
+}
+
+static bool VkShaderCacheWriteRecord(FILE* file, const VkShaderCacheEntry* entry, const uint8_t* data)
+{
+	static const uint8_t padding[VK_SHADER_CACHE_ALIGN] = { 0 };
+
+	VkShaderCacheEntry record = *entry;
+	record.offset             = 0;
+	size_t dataSize           = entry->size + entry->includesSize;
+	size_t paddingSize        = VkShaderCacheRecordSize(entry) - sizeof(record) - dataSize;
+	return fwrite(&record, sizeof(record), 1, file) == 1 &&
+		   fwrite(data, sizeof(uint8_t), dataSize, file) == dataSize &&
+		   fwrite(padding, sizeof(uint8_t), paddingSize, file) == paddingSize;
+}
+
+static void VkShaderCacheUnload(VkShaderCacheData* cache)
+{
+	FSUnmapFile(&cache->pack);
+	free(cache->entries);
+	free(cache->touched);
+	cache->entryCount = 0;
+	cache->entries    = NULL;
+	cache->blob       = NULL;
+	cache->touched    = NULL;
+	cache->liveSize   = 0;
+	cache->compact    = false;
+}
+
+static bool VkShaderCacheLoad(VkShaderCacheData* cache)
+{
+	FSPath packPath = FSCreatePath(cache->filepath, ~0ULL);
+	if (!packPath.buf)
+		return false;
+	bool mapped = FSMapFile(&packPath, &cache->pack);
+	FSDestroyPath(&packPath);
+	if (!mapped)
+		return true;
+
+	VkShaderCacheFileHeader header;
+	const uint8_t*          data = (const uint8_t*) cache->pack.data;
+	if (cache->pack.size < sizeof(header))
+	{
+		VkShaderCacheUnload(cache);
+		cache->rejected = true;
+		return true;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != VK_SHADER_CACHE_MAGIC || header.version != VK_SHADER_CACHE_VERSION)
+	{
+		VkShaderCacheUnload(cache);
+		cache->rejected = true;
+		return true;
+	}
+
+	uint32_t            entryCount    = 0;
+	uint32_t            entryCapacity = 0;
+	VkShaderCacheEntry* entries       = NULL;
+	uint64_t            offset        = sizeof(header);
+	while (cache->pack.size - offset >= sizeof(VkShaderCacheEntry))
+	{
+		VkShaderCacheEntry entry;
+		memcpy(&entry, data + offset, sizeof(entry));
+		uint64_t available = cache->pack.size - offset - sizeof(entry);
+		if (entry.size == 0 ||
+			entry.size % sizeof(uint32_t) != 0 ||
+			entry.size > available ||
+			entry.includesSize > available - entry.size)
+			break;
+		if (entryCount >= entryCapacity)
+		{
+			uint32_t            newCapacity = entryCapacity > 0 ? entryCapacity * 2 : 16;
+			VkShaderCacheEntry* newEntries  = (VkShaderCacheEntry*) realloc(entries, newCapacity * sizeof(VkShaderCacheEntry));
+			if (!newEntries)
+			{
+				free(entries);
+				VkShaderCacheUnload(cache);
+				return false;
+			}
+			entries       = newEntries;
+			entryCapacity = newCapacity;
+		}
+		entry.offset          = offset + sizeof(entry);
+		entries[entryCount++] = entry;
+		uint64_t recordSize   = VkShaderCacheRecordSize(&entry);
+		offset                = recordSize < cache->pack.size - offset ? offset + recordSize : cache->pack.size;
+	}
+	cache->compact = offset != cache->pack.size;
+
+	qsort(entries, entryCount, sizeof(VkShaderCacheEntry), &VkShaderCacheCompareEntries);
+	uint32_t liveCount = 0;
+	for (uint32_t i = 0; i < entryCount; ++i)
+	{
+		if (i + 1 < entryCount && entries[i + 1].key == entries[i].key)
+			continue;
+		entries[liveCount++] = entries[i];
+		cache->liveSize     += VkShaderCacheRecordSize(entries + i);
+	}
+
+	cache->touched = (bool*) calloc(liveCount > 0 ? liveCount : 1, sizeof(bool));
+	if (!cache->touched)
+	{
+		free(entries);
+		VkShaderCacheUnload(cache);
+		return false;
+	}
+	cache->entryCount = liveCount;
+	cache->entries    = entries;
+	cache->blob       = data;
+	return true;
+}
+
+static bool VkShaderCacheRewrite(VkShaderCacheData* cache, const FSPath* packPath)
+{
+	FSPath tempPath = FSCreatePath(packPath->buf, packPath->len);
+	if (!tempPath.buf || !FSPathConcat(&tempPath, ".tmp"))
+	{
+		FSDestroyPath(&tempPath);
+		return false;
+	}
+
+	VkShaderCacheFileHeader header = {
+		.magic    = VK_SHADER_CACHE_MAGIC,
+		.version  = VK_SHADER_CACHE_VERSION,
+		.reserved = 0
+	};
+	uint64_t size     = sizeof(header);
+	FILE*    packFile = fopen(tempPath.buf, "wb");
+	bool     written  = packFile && fwrite(&header, sizeof(header), 1, packFile) == 1;
+	for (uint32_t pass = 0; written && pass < 3; ++pass)
+	{
+		uint32_t count = pass == 0 ? cache->pendingCount : cache->entryCount;
+		for (uint32_t i = 0; written && i < count; ++i)
+		{
+			const VkShaderCacheEntry* entry  = pass == 0 ? &cache->pending[i].entry : cache->entries + i;
+			const uint8_t*            source = pass == 0 ? cache->pending[i].data : cache->blob + entry->offset;
+			if (pass > 0 &&
+				((pass == 1) != cache->touched[i] ||
+				 VkShaderCacheSearch(cache->pending, sizeof(VkShaderCachePending), cache->pendingCount, entry->key) >= 0))
+				continue;
+			uint64_t recordSize = VkShaderCacheRecordSize(entry);
+			if (pass == 2 && size + recordSize > cache->maxSize)
+				continue;
+			written = VkShaderCacheWriteRecord(packFile, entry, source);
+			size   += recordSize;
+		}
+	}
+	if (packFile)
+		written = fclose(packFile) == 0 && written;
+
+	VkShaderCacheUnload(cache);
+	bool replaced = written && FSReplaceFile(&tempPath, packPath);
+	FSDestroyPath(&tempPath);
+	if (replaced)
+	{
+		cache->savedSize += size;
+		++cache->compactions;
+	}
+	return replaced;
+}
+
+static bool VkShaderCacheAppend(VkShaderCacheData* cache, const FSPath* packPath)
+{
+	FILE* packFile = fopen(packPath->buf, "ab");
+	if (!packFile)
+		return false;
+
+	bool     written = true;
+	uint64_t offset  = cache->pack.size;
+	for (uint32_t i = 0; written && i < cache->pendingCount; ++i)
+	{
+		VkShaderCachePending* pending = cache->pending + i;
+		written                       = VkShaderCacheWriteRecord(packFile, &pending->entry, pending->data);
+		pending->entry.offset         = offset + sizeof(VkShaderCacheEntry);
+		offset                       += VkShaderCacheRecordSize(&pending->entry);
+	}
+	written = fclose(packFile) == 0 && written;
+	if (written)
+		cache->savedSize += offset - cache->pack.size;
+	else
+		cache->compact = true;
+	return written;
+}
+
+static bool VkShaderCacheMerge(VkShaderCacheData* cache, const FSPath* packPath)
+{
+	FSUnmapFile(&cache->pack);
+	bool mapped = FSMapFile(packPath, &cache->pack);
+	for (uint32_t i = 0; mapped && i < cache->pendingCount; ++i)
+	{
+		const VkShaderCacheEntry* entry = &cache->pending[i].entry;
+		mapped                          = entry->offset + entry->size + entry->includesSize <= cache->pack.size;
+	}
+	if (!mapped)
+	{
+		VkShaderCacheUnload(cache);
+		return VkShaderCacheLoad(cache);
+	}
+
+	uint32_t            capacity = cache->entryCount + cache->pendingCount;
+	VkShaderCacheEntry* entries  = (VkShaderCacheEntry*) malloc(capacity * sizeof(VkShaderCacheEntry));
+	bool*               touched  = (bool*) malloc(capacity * sizeof(bool));
+	if (!entries || !touched)
+	{
+		free(entries);
+		free(touched);
+		VkShaderCacheUnload(cache);
+		return false;
+	}
+
+	uint32_t count   = 0;
+	uint32_t current = 0;
+	uint32_t pending = 0;
+	while (current < cache->entryCount || pending < cache->pendingCount)
+	{
+		const VkShaderCacheEntry* existing = current < cache->entryCount ? cache->entries + current : NULL;
+		const VkShaderCacheEntry* written  = pending < cache->pendingCount ? &cache->pending[pending].entry : NULL;
+		if (!written || (existing && existing->key < written->key))
+		{
+			entries[count]   = *existing;
+			touched[count++] = cache->touched[current++];
+			continue;
+		}
+		if (existing && existing->key == written->key)
+		{
+			cache->liveSize -= VkShaderCacheRecordSize(existing);
+			++current;
+		}
+		cache->liveSize  += VkShaderCacheRecordSize(written);
+		entries[count]    = *written;
+		touched[count++]  = true;
+		++pending;
+	}
+	free(cache->entries);
+	free(cache->touched);
+	cache->entryCount = count;
+	cache->entries    = entries;
+	cache->touched    = touched;
+	cache->blob       = (const uint8_t*) cache->pack.data;
+	return true;
+}
+
+uint64_t VkShaderCacheHash(uint64_t hash, const void* data, size_t dataSize)
+{
+	const uint8_t* bytes = (const uint8_t*) data;
+	for (size_t i = 0; i < dataSize; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+bool VkSetupShaderCache(VkData* vk)
+{
+	if (!vk) return false;
+
+	VkShaderCacheData* cache = &vk->shaderCache;
+	if (!cache->filepath)
+		cache->filepath = "Cache/Shaders.pack";
+	if (cache->maxSize == 0)
+		cache->maxSize = 64ULL << 20;
+	cache->entryCount      = 0;
+	cache->entries         = NULL;
+	cache->blob            = NULL;
+	cache->touched         = NULL;
+	cache->liveSize        = 0;
+	cache->compact         = false;
+	cache->pendingCount    = 0;
+	cache->pendingCapacity = 0;
+	cache->pending         = NULL;
+	cache->rejected        = false;
+	cache->corruptEntries  = 0;
+	cache->compactions     = 0;
+	cache->loadedSize      = 0;
+	cache->savedSize       = 0;
+
+	cache->mutex = MutexCreate();
+	if (!cache->mutex)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate shader cache mutex");
+		return false;
+	}
+	if (!VkShaderCacheLoad(cache))
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate shader cache index");
+		return false;
+	}
+	cache->loadedSize = cache->pack.size;
+	return true;
+}
+
+void VkCleanupShaderCache(VkData* vk)
+{
+	if (!vk || !vk->shaderCache.mutex) return;
+
+	VkShaderCacheData* cache = &vk->shaderCache;
+	VkSaveShaderCache(vk);
+	VkShaderCacheUnload(cache);
+	for (uint32_t i = 0; i < cache->pendingCount; ++i)
+		free(cache->pending[i].data);
+	free(cache->pending);
+	cache->pending         = NULL;
+	cache->pendingCount    = 0;
+	cache->pendingCapacity = 0;
+	MutexDestroy(cache->mutex);
+	cache->mutex = NULL;
+}
+
+bool VkShaderCacheFind(VkData* vk, uint64_t key, uint64_t* sourceHash, uint32_t** code, size_t* codeSize, char** includes, size_t* includesSize)
+{
+	*sourceHash   = 0;
+	*code         = NULL;
+	*codeSize     = 0;
+	*includes     = NULL;
+	*includesSize = 0;
+	if (!vk || !vk->shaderCache.mutex) return false;
+
+	VkShaderCacheData*        cache  = &vk->shaderCache;
+	const VkShaderCacheEntry* entry  = NULL;
+	const uint8_t*            source = NULL;
+	MutexLock(cache->mutex);
+	int64_t index = VkShaderCacheSearch(cache->pending, sizeof(VkShaderCachePending), cache->pendingCount, key);
+	if (index >= 0)
+	{
+		entry  = &cache->pending[index].entry;
+		source = cache->pending[index].data;
+	}
+	else if ((index = VkShaderCacheSearch(cache->entries, sizeof(VkShaderCacheEntry), cache->entryCount, key)) >= 0)
+	{
+		entry = cache->entries + index;
+		if (VkShaderCacheHash(0xCBF29CE484222325ULL, cache->blob + entry->offset, entry->size + entry->includesSize) == entry->checksum)
+		{
+			source                = cache->blob + entry->offset;
+			cache->touched[index] = true;
+		}
+		else
+		{
+			++cache->corruptEntries;
+		}
+	}
+	if (source)
+	{
+		*code     = (uint32_t*) malloc(entry->size);
+		*includes = (char*) malloc(entry->includesSize > 0 ? entry->includesSize : 1);
+		if (*code && *includes)
+		{
+			memcpy(*code, source, entry->size);
+			memcpy(*includes, source + entry->size, entry->includesSize);
+			*sourceHash   = entry->sourceHash;
+			*codeSize     = entry->size;
+			*includesSize = entry->includesSize;
+		}
+		else
+		{
+			free(*code);
+			free(*includes);
+			*code     = NULL;
+			*includes = NULL;
+		}
+	}
+	MutexUnlock(cache->mutex);
+	return *code != NULL;
+}
+
+bool VkShaderCacheInsert(VkData* vk, uint64_t key, uint64_t sourceHash, const uint32_t* code, size_t codeSize, const char* includes, size_t includesSize)
+{
+	if (!vk || !vk->shaderCache.mutex || !code || codeSize == 0) return false;
+
+	VkShaderCacheData* cache = &vk->shaderCache;
+	uint8_t*           copy  = (uint8_t*) malloc(codeSize + includesSize);
+	if (!copy)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate shader cache entry");
+		return false;
+	}
+	memcpy(copy, code, codeSize);
+	if (includesSize > 0)
+		memcpy(copy + codeSize, includes, includesSize);
+
+	MutexLock(cache->mutex);
+	int64_t index = VkShaderCacheSearch(cache->pending, sizeof(VkShaderCachePending), cache->pendingCount, key);
+	if (index < 0)
+	{
+		if (cache->pendingCount >= cache->pendingCapacity)
+		{
+			uint32_t              newCapacity = cache->pendingCapacity > 0 ? cache->pendingCapacity * 2 : 16;
+			VkShaderCachePending* newPending  = (VkShaderCachePending*) realloc(cache->pending, newCapacity * sizeof(VkShaderCachePending));
+			if (!newPending)
+			{
+				MutexUnlock(cache->mutex);
+				free(copy);
+				VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate shader cache entry");
+				return false;
+			}
+			cache->pending         = newPending;
+			cache->pendingCapacity = newCapacity;
+		}
+		index = cache->pendingCount++;
+	}
+	else
+	{
+		free(cache->pending[index].data);
+	}
+	cache->pending[index].entry.key          = key;
+	cache->pending[index].entry.sourceHash   = sourceHash;
+	cache->pending[index].entry.offset       = 0;
+	cache->pending[index].entry.size         = codeSize;
+	cache->pending[index].entry.includesSize = includesSize;
+	cache->pending[index].entry.checksum     = VkShaderCacheHash(0xCBF29CE484222325ULL, copy, codeSize + includesSize);
+	cache->pending[index].data               = copy;
+	qsort(cache->pending, cache->pendingCount, sizeof(VkShaderCachePending), &VkShaderCacheComparePending);
+	MutexUnlock(cache->mutex);
+	return true;
+}
+
+bool VkSaveShaderCache(VkData* vk)
+{
+	if (!vk || !vk->shaderCache.mutex) return false;
+
+	VkShaderCacheData* cache = &vk->shaderCache;
+	MutexLock(cache->mutex);
+	if (cache->pendingCount == 0)
+	{
+		MutexUnlock(cache->mutex);
+		return true;
+	}
+
+	FSPath packPath = FSCreatePath(cache->filepath, ~0ULL);
+	if (!packPath.buf)
+	{
+		MutexUnlock(cache->mutex);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate shader cache path");
+		return false;
+	}
+	FSCreateDirectories(&packPath);
+
+	uint64_t pendingSize = 0;
+	for (uint32_t i = 0; i < cache->pendingCount; ++i)
+		pendingSize += VkShaderCacheRecordSize(&cache->pending[i].entry);
+	uint64_t deadSize = cache->pack.size > sizeof(VkShaderCacheFileHeader) + cache->liveSize ? cache->pack.size - sizeof(VkShaderCacheFileHeader) - cache->liveSize : 0;
+	bool     rewrite  = !cache->pack.data ||
+						cache->compact ||
+						cache->pack.size + pendingSize > cache->maxSize ||
+						deadSize > cache->liveSize;
+	bool     saved    = rewrite ? VkShaderCacheRewrite(cache, &packPath) : VkShaderCacheAppend(cache, &packPath);
+	bool     loaded   = rewrite ? VkShaderCacheLoad(cache) : !saved || VkShaderCacheMerge(cache, &packPath);
+	FSDestroyPath(&packPath);
+	if (saved)
+	{
+		for (uint32_t i = 0; i < cache->pendingCount; ++i)
+			free(cache->pending[i].data);
+		cache->pendingCount = 0;
+	}
+	MutexUnlock(cache->mutex);
+	if (!saved)
+	{
+		VkReportError(vk, VK_ERROR_CODE_CALL_FAILURE, "Failed to write shader cache");
+		return false;
+	}
+	if (!loaded)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate shader cache index");
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include "ShaderPack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHADER_PACK_MAGIC   0x50534C57U
+#define SHADER_PACK_VERSION 1U
+#define SHADER_PACK_ALIGN   16U
+#define SHADER_PACK_SEED    0xCBF29CE484222325ULL
+
+typedef struct ShaderPackFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t recipes;
+	uint64_t stringsSize;
+	uint64_t dataSize;
+	uint64_t checksum;
+} ShaderPackFileHeader;
+
+static int ShaderPackCompareEntries(const void* lhs, const void* rhs)
+{
+	uint64_t a = ((const ShaderPackEntry*) lhs)->key;
+	uint64_t b = ((const ShaderPackEntry*) rhs)->key;
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static bool ShaderPackHashFile(uint64_t* hash, const char* filepath)
+{
+	FILE* file = fopen(filepath, "rb");
+	if (!file)
+		return false;
+	uint8_t buffer[4096];
+	size_t  read = 0;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		*hash = ShaderPackHash(*hash, buffer, read);
+	bool failed = ferror(file) != 0;
+	fclose(file);
+	*hash = ShaderPackHash(*hash, filepath, strlen(filepath) + 1);
+	return !failed;
+}
+
+static bool ShaderPackEnsure(void** buffer, size_t* capacity, size_t required, size_t initial)
+{
+	if (required <= *capacity)
+		return true;
+	size_t newCapacity = *capacity > 0 ? *capacity : initial;
+	while (newCapacity < required)
+		newCapacity *= 2;
+	void* newBuffer = realloc(*buffer, newCapacity);
+	if (!newBuffer)
+		return false;
+	*buffer   = newBuffer;
+	*capacity = newCapacity;
+	return true;
+}
+
+static bool ShaderPackAddString(ShaderPackBuilder* builder, const char* string, size_t size, uint32_t* offset)
+{
+	if (builder->stringsSize + size > UINT32_MAX ||
+		!ShaderPackEnsure((void**) &builder->strings, &builder->stringsCapacity, builder->stringsSize + size + 1, 256))
+		return false;
+	*offset = (uint32_t) builder->stringsSize;
+	if (size > 0)
+		memcpy(builder->strings + builder->stringsSize, string, size);
+	builder->strings[builder->stringsSize + size] = '\0';
+	builder->stringsSize                          += size + 1;
+	return true;
+}
+
+uint64_t ShaderPackHash(uint64_t hash, const void* data, size_t dataSize)
+{
+	const uint8_t* bytes = (const uint8_t*) data;
+	for (size_t i = 0; i < dataSize; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+uint64_t ShaderPackKey(const char* filepath, uint32_t stage, const char* const* defines, uint32_t defineCount)
+{
+	uint64_t hash = ShaderPackHash(SHADER_PACK_SEED, filepath, strlen(filepath) + 1);
+	hash          = ShaderPackHash(hash, &stage, sizeof(stage));
+	for (uint32_t i = 0; i < defineCount; ++i)
+		hash = ShaderPackHash(hash, defines[i], strlen(defines[i]) + 1);
+	return hash;
+}
+
+bool ShaderPackHashSources(const char* filepath, const char* includes, size_t includesSize, uint64_t* hash)
+{
+	*hash = SHADER_PACK_SEED;
+	if (!ShaderPackHashFile(hash, filepath))
+		return false;
+	for (size_t offset = 0; offset < includesSize; offset += strlen(includes + offset) + 1)
+	{
+		if (!ShaderPackHashFile(hash, includes + offset))
+			return false;
+	}
+	return true;
+}
+
+bool ShaderPackLoad(ShaderPackData* pack, const char* filepath)
+{
+	if (!pack || !filepath) return false;
+
+	pack->entryCount = 0;
+	pack->recipes    = 0;
+	pack->entries    = NULL;
+	pack->strings    = NULL;
+	pack->blob       = NULL;
+	pack->rejected   = false;
+
+	FSPath packPath = FSCreatePath(filepath, ~0ULL);
+	if (!packPath.buf)
+		return false;
+	bool mapped = FSMapFile(&packPath, &pack->file);
+	FSDestroyPath(&packPath);
+	if (!mapped)
+		return false;
+
+	ShaderPackFileHeader header;
+	const uint8_t*       data = (const uint8_t*) pack->file.data;
+	if (pack->file.size < sizeof(header))
+	{
+		ShaderPackUnload(pack);
+		pack->rejected = true;
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	size_t indexSize = (size_t) header.entryCount * sizeof(ShaderPackEntry);
+	if (header.magic != SHADER_PACK_MAGIC ||
+		header.version != SHADER_PACK_VERSION ||
+		pack->file.size != sizeof(header) + indexSize + header.stringsSize + header.dataSize ||
+		(header.stringsSize > 0 && data[sizeof(header) + indexSize + header.stringsSize - 1] != '\0') ||
+		ShaderPackHash(SHADER_PACK_SEED, data + sizeof(header), indexSize + header.stringsSize) != header.checksum)
+	{
+		ShaderPackUnload(pack);
+		pack->rejected = true;
+		return false;
+	}
+
+	const ShaderPackEntry* entries = (const ShaderPackEntry*) (data + sizeof(header));
+	for (uint32_t i = 0; i < header.entryCount; ++i)
+	{
+		if (entries[i].offset > header.dataSize ||
+			entries[i].size > header.dataSize - entries[i].offset ||
+			entries[i].name >= header.stringsSize ||
+			entries[i].includes > header.stringsSize ||
+			entries[i].includesSize > header.stringsSize - entries[i].includes ||
+			(i > 0 && entries[i - 1].key >= entries[i].key))
+		{
+			ShaderPackUnload(pack);
+			pack->rejected = true;
+			return false;
+		}
+	}
+
+	pack->entryCount = header.entryCount;
+	pack->recipes    = header.recipes;
+	pack->entries    = entries;
+	pack->strings    = (const char*) (data + sizeof(header) + indexSize);
+	pack->blob       = data + sizeof(header) + indexSize + header.stringsSize;
+	return true;
+}
+
+void ShaderPackUnload(ShaderPackData* pack)
+{
+	if (!pack) return;
+
+	FSUnmapFile(&pack->file);
+	pack->entryCount = 0;
+	pack->recipes    = 0;
+	pack->entries    = NULL;
+	pack->strings    = NULL;
+	pack->blob       = NULL;
+}
+
+const ShaderPackEntry* ShaderPackFind(const ShaderPackData* pack, uint64_t key)
+{
+	if (!pack || !pack->entries) return NULL;
+
+	uint32_t first = 0;
+	uint32_t last  = pack->entryCount;
+	while (first < last)
+	{
+		uint32_t               mid   = first + (last - first) / 2;
+		const ShaderPackEntry* entry = pack->entries + mid;
+		if (entry->key == key)
+			return ShaderPackHash(SHADER_PACK_SEED, pack->blob + entry->offset, entry->size) == entry->checksum ? entry : NULL;
+		if (entry->key < key)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+	return NULL;
+}
+
+bool ShaderPackAdd(ShaderPackBuilder* builder, uint64_t key, uint64_t sourceHash, uint32_t stage, const char* filepath, const char* includes, size_t includesSize, const uint32_t* code, size_t codeSize)
+{
+	if (!builder || !filepath || !code) return false;
+
+	for (uint32_t i = 0; i < builder->entryCount; ++i)
+	{
+		if (builder->entries[i].key == key)
+			return false;
+	}
+
+	size_t alignedSize = (codeSize + SHADER_PACK_ALIGN - 1) & ~(size_t) (SHADER_PACK_ALIGN - 1);
+	if (builder->entryCount >= builder->entryCapacity)
+	{
+		uint32_t         newCapacity = builder->entryCapacity > 0 ? builder->entryCapacity * 2 : 16;
+		ShaderPackEntry* newEntries  = (ShaderPackEntry*) realloc(builder->entries, newCapacity * sizeof(ShaderPackEntry));
+		if (!newEntries)
+			return false;
+		builder->entries       = newEntries;
+		builder->entryCapacity = newCapacity;
+	}
+	if (!ShaderPackEnsure((void**) &builder->data, &builder->dataCapacity, builder->dataSize + alignedSize, 64 << 10))
+		return false;
+
+	ShaderPackEntry entry = {
+		.key          = key,
+		.sourceHash   = sourceHash,
+		.checksum     = ShaderPackHash(SHADER_PACK_SEED, code, codeSize),
+		.offset       = builder->dataSize,
+		.size         = codeSize,
+		.stage        = stage,
+		.name         = 0,
+		.includes     = 0,
+		.includesSize = includes ? (uint32_t) includesSize : 0
+	};
+	if (!ShaderPackAddString(builder, filepath, strlen(filepath), &entry.name) ||
+		!ShaderPackAddString(builder, includes, includes ? includesSize : 0, &entry.includes))
+		return false;
+
+	memcpy(builder->data + builder->dataSize, code, codeSize);
+	memset(builder->data + builder->dataSize + codeSize, 0, alignedSize - codeSize);
+	builder->dataSize                       += alignedSize;
+	builder->entries[builder->entryCount++] = entry;
+	return true;
+}
+
+bool ShaderPackWrite(ShaderPackBuilder* builder, const char* filepath, uint32_t recipes)
+{
+	if (!builder || !filepath) return false;
+
+	qsort(builder->entries, builder->entryCount, sizeof(ShaderPackEntry), &ShaderPackCompareEntries);
+	size_t   indexSize = builder->entryCount * sizeof(ShaderPackEntry);
+	uint64_t checksum  = ShaderPackHash(SHADER_PACK_SEED, builder->entries, indexSize);
+	checksum           = ShaderPackHash(checksum, builder->strings, builder->stringsSize);
+
+	ShaderPackFileHeader header = {
+		.magic       = SHADER_PACK_MAGIC,
+		.version     = SHADER_PACK_VERSION,
+		.entryCount  = builder->entryCount,
+		.recipes     = recipes,
+		.stringsSize = builder->stringsSize,
+		.dataSize    = builder->dataSize,
+		.checksum    = checksum
+	};
+
+	FSPath tempPath = FSCreatePath(filepath, ~0ULL);
+	FSPath packPath = FSCreatePath(filepath, ~0ULL);
+	if (!tempPath.buf || !packPath.buf || !FSPathConcat(&tempPath, ".tmp"))
+	{
+		FSDestroyPath(&tempPath);
+		FSDestroyPath(&packPath);
+		return false;
+	}
+	FSCreateDirectories(&packPath);
+
+	bool  written  = false;
+	FILE* packFile = fopen(tempPath.buf, "wb");
+	if (packFile)
+	{
+		written = fwrite(&header, sizeof(header), 1, packFile) == 1 &&
+				  fwrite(builder->entries, sizeof(ShaderPackEntry), builder->entryCount, packFile) == builder->entryCount &&
+				  fwrite(builder->strings, sizeof(char), builder->stringsSize, packFile) == builder->stringsSize &&
+				  fwrite(builder->data, sizeof(uint8_t), builder->dataSize, packFile) == builder->dataSize;
+		written = fclose(packFile) == 0 && written;
+	}
+	bool replaced = written && FSReplaceFile(&tempPath, &packPath);
+	FSDestroyPath(&tempPath);
+	FSDestroyPath(&packPath);
+	return replaced;
+}
+
+void ShaderPackDestroyBuilder(ShaderPackBuilder* builder)
+{
+	if (!builder) return;
+
+	free(builder->entries);
+	free(builder->strings);
+	free(builder->data);
+	builder->entries         = NULL;
+	builder->entryCount      = 0;
+	builder->entryCapacity   = 0;
+	builder->strings         = NULL;
+	builder->stringsSize     = 0;
+	builder->stringsCapacity = 0;
+	builder->data            = NULL;
+	builder->dataSize        = 0;
+	builder->dataCapacity    = 0;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Filesystem.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ShaderPackEntry
+{
+	uint64_t key;
+	uint64_t sourceHash;
+	uint64_t checksum;
+	uint64_t offset;
+	uint64_t size;
+	uint32_t stage;
+	uint32_t name;
+	uint32_t includes;
+	uint32_t includesSize;
+} ShaderPackEntry;
+
+typedef struct ShaderPackData
+{
+	FSMappedFile           file;
+	uint32_t               entryCount;
+	uint32_t               recipes;
+	const ShaderPackEntry* entries;
+	const char*            strings;
+	const uint8_t*         blob;
+	bool                   rejected;
+} ShaderPackData;
+
+typedef struct ShaderPackBuilder
+{
+	uint32_t         entryCount;
+	uint32_t         entryCapacity;
+	ShaderPackEntry* entries;
+
+	size_t stringsSize;
+	size_t stringsCapacity;
+	char*  strings;
+
+	size_t   dataSize;
+	size_t   dataCapacity;
+	uint8_t* data;
+} ShaderPackBuilder;
+
+uint64_t ShaderPackHash(uint64_t hash, const void* data, size_t dataSize);
+uint64_t ShaderPackKey(const char* filepath, uint32_t stage, const char* const* defines, uint32_t defineCount);
+bool     ShaderPackHashSources(const char* filepath, const char* includes, size_t includesSize, uint64_t* hash);
+
+bool                   ShaderPackLoad(ShaderPackData* pack, const char* filepath);
+void                   ShaderPackUnload(ShaderPackData* pack);
+const ShaderPackEntry* ShaderPackFind(const ShaderPackData* pack, uint64_t key);
+
+bool ShaderPackAdd(ShaderPackBuilder* builder, uint64_t key, uint64_t sourceHash, uint32_t stage, const char* filepath, const char* includes, size_t includesSize, const uint32_t* code, size_t codeSize);
+bool ShaderPackWrite(ShaderPackBuilder* builder, const char* filepath, uint32_t recipes);
+void ShaderPackDestroyBuilder(ShaderPackBuilder* builder);
\ No newline at end of file
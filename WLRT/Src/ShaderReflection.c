@@ -0,0 +1,345 @@
+#include "Vk.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SPIRV_MAGIC 0x07230203U
+
+#define SPIRV_OP_TYPE_INT                    21
+#define SPIRV_OP_TYPE_FLOAT                  22
+#define SPIRV_OP_TYPE_VECTOR                 23
+#define SPIRV_OP_TYPE_MATRIX                 24
+#define SPIRV_OP_TYPE_IMAGE                  25
+#define SPIRV_OP_TYPE_SAMPLER                26
+#define SPIRV_OP_TYPE_SAMPLED_IMAGE          27
+#define SPIRV_OP_TYPE_ARRAY                  28
+#define SPIRV_OP_TYPE_RUNTIME_ARRAY          29
+#define SPIRV_OP_TYPE_STRUCT                 30
+#define SPIRV_OP_TYPE_POINTER                32
+#define SPIRV_OP_CONSTANT                    43
+#define SPIRV_OP_VARIABLE                    59
+#define SPIRV_OP_DECORATE                    71
+#define SPIRV_OP_MEMBER_DECORATE             72
+#define SPIRV_OP_TYPE_ACCELERATION_STRUCTURE 5341
+
+#define SPIRV_DECORATION_BUFFER_BLOCK   3
+#define SPIRV_DECORATION_ARRAY_STRIDE   6
+#define SPIRV_DECORATION_MATRIX_STRIDE  7
+#define SPIRV_DECORATION_BINDING        33
+#define SPIRV_DECORATION_DESCRIPTOR_SET 34
+#define SPIRV_DECORATION_OFFSET         35
+
+#define SPIRV_STORAGE_UNIFORM_CONSTANT 0
+#define SPIRV_STORAGE_UNIFORM          2
+#define SPIRV_STORAGE_PUSH_CONSTANT    9
+#define SPIRV_STORAGE_STORAGE_BUFFER   12
+
+#define SPIRV_DIM_BUFFER       5
+#define SPIRV_DIM_SUBPASS_DATA 6
+
+typedef enum VkReflectIdFlags
+{
+	VK_REFLECT_ID_HAS_SET      = 1,
+	VK_REFLECT_ID_HAS_BINDING  = 2,
+	VK_REFLECT_ID_BUFFER_BLOCK = 4
+} VkReflectIdFlags;
+
+typedef struct VkReflectId
+{
+	uint32_t opcode;
+	uint32_t offset;
+	uint32_t flags;
+	uint32_t set;
+	uint32_t binding;
+	uint32_t arrayStride;
+} VkReflectId;
+
+typedef struct VkReflectModule
+{
+	const uint32_t* code;
+	size_t          wordCount;
+	uint32_t        bound;
+	VkReflectId*    ids;
+} VkReflectModule;
+
+static const VkReflectId* VkReflectGetId(const VkReflectModule* module, uint32_t id)
+{
+	return id < module->bound ? module->ids + id : NULL;
+}
+
+static const uint32_t* VkReflectGetOperands(const VkReflectModule* module, uint32_t id)
+{
+	const VkReflectId* entry = VkReflectGetId(module, id);
+	return entry && entry->opcode ? module->code + entry->offset + 1 : NULL;
+}
+
+static uint32_t VkReflectConstant(const VkReflectModule* module, uint32_t id)
+{
+	const VkReflectId* entry = VkReflectGetId(module, id);
+	if (!entry || entry->opcode != SPIRV_OP_CONSTANT)
+		return 1;
+	return module->code[entry->offset + 3];
+}
+
+static uint32_t VkReflectMemberDecoration(const VkReflectModule* module, uint32_t structId, uint32_t member, uint32_t decoration)
+{
+	for (size_t offset = 5; offset < module->wordCount;)
+	{
+		uint32_t wordCount = module->code[offset] >> 16;
+		uint32_t opcode    = module->code[offset] & 0xFFFF;
+		if (opcode == SPIRV_OP_MEMBER_DECORATE && wordCount >= 5 && module->code[offset + 1] == structId && module->code[offset + 2] == member && module->code[offset + 3] == decoration)
+			return module->code[offset + 4];
+		offset += wordCount;
+	}
+	return ~0U;
+}
+
+static uint32_t VkReflectTypeSize(const VkReflectModule* module, uint32_t typeId, uint32_t matrixStride, uint32_t depth)
+{
+	const VkReflectId* type     = VkReflectGetId(module, typeId);
+	const uint32_t*    operands = VkReflectGetOperands(module, typeId);
+	if (!type || !operands || depth > 16)
+		return 0;
+
+	switch (type->opcode)
+	{
+	case SPIRV_OP_TYPE_INT:
+	case SPIRV_OP_TYPE_FLOAT:
+		return operands[1] / 8;
+	case SPIRV_OP_TYPE_VECTOR:
+		return VkReflectTypeSize(module, operands[1], 0, depth + 1) * operands[2];
+	case SPIRV_OP_TYPE_MATRIX:
+		if (matrixStride != ~0U)
+			return matrixStride * operands[2];
+		return VkReflectTypeSize(module, operands[1], 0, depth + 1) * operands[2];
+	case SPIRV_OP_TYPE_ARRAY:
+	{
+		uint32_t length = VkReflectConstant(module, operands[2]);
+		if (type->arrayStride)
+			return type->arrayStride * length;
+		return VkReflectTypeSize(module, operands[1], matrixStride, depth + 1) * length;
+	}
+	case SPIRV_OP_TYPE_POINTER:
+		return 8;
+	case SPIRV_OP_TYPE_STRUCT:
+	{
+		uint32_t memberCount = (module->code[type->offset] >> 16) - 2;
+		uint32_t size        = 0;
+		for (uint32_t i = 0; i < memberCount; ++i)
+		{
+			uint32_t offset = VkReflectMemberDecoration(module, typeId, i, SPIRV_DECORATION_OFFSET);
+			uint32_t stride = VkReflectMemberDecoration(module, typeId, i, SPIRV_DECORATION_MATRIX_STRIDE);
+			uint32_t end    = (offset != ~0U ? offset : size) + VkReflectTypeSize(module, operands[1 + i], stride, depth + 1);
+			size            = end > size ? end : size;
+		}
+		return size;
+	}
+	default: return 0;
+	}
+}
+
+static bool VkReflectDescriptorType(const VkReflectModule* module, uint32_t storageClass, uint32_t typeId, VkDescriptorType* descriptorType, uint32_t* count)
+{
+	*count = 1;
+	for (uint32_t depth = 0; depth < 16; ++depth)
+	{
+		const VkReflectId* type     = VkReflectGetId(module, typeId);
+		const uint32_t*    operands = VkReflectGetOperands(module, typeId);
+		if (!type || !operands)
+			return false;
+
+		switch (type->opcode)
+		{
+		case SPIRV_OP_TYPE_ARRAY:
+			*count *= VkReflectConstant(module, operands[2]);
+			typeId = operands[1];
+			continue;
+		case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+			typeId = operands[1];
+			continue;
+		case SPIRV_OP_TYPE_STRUCT:
+			if (storageClass == SPIRV_STORAGE_STORAGE_BUFFER || (type->flags & VK_REFLECT_ID_BUFFER_BLOCK))
+				*descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			else if (storageClass == SPIRV_STORAGE_UNIFORM)
+				*descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			else
+				return false;
+			return true;
+		case SPIRV_OP_TYPE_IMAGE:
+			if (operands[2] == SPIRV_DIM_SUBPASS_DATA)
+				*descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			else if (operands[2] == SPIRV_DIM_BUFFER)
+				*descriptorType = operands[6] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			else
+				*descriptorType = operands[6] == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			return true;
+		case SPIRV_OP_TYPE_SAMPLER:
+			*descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			return true;
+		case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+			*descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			return true;
+		case SPIRV_OP_TYPE_ACCELERATION_STRUCTURE:
+			*descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+			return true;
+		default: return false;
+		}
+	}
+	return false;
+}
+
+static bool VkReflectIndex(VkReflectModule* module)
+{
+	for (size_t offset = 5; offset < module->wordCount;)
+	{
+		uint32_t wordCount = module->code[offset] >> 16;
+		uint32_t opcode    = module->code[offset] & 0xFFFF;
+		if (wordCount == 0 || offset + wordCount > module->wordCount)
+			return false;
+
+		const uint32_t* operands = module->code + offset + 1;
+		switch (opcode)
+		{
+		case SPIRV_OP_DECORATE:
+		{
+			if (wordCount < 3 || operands[0] >= module->bound)
+				break;
+			VkReflectId* target = module->ids + operands[0];
+			if (operands[1] == SPIRV_DECORATION_BUFFER_BLOCK)
+				target->flags |= VK_REFLECT_ID_BUFFER_BLOCK;
+			else if (wordCount >= 4 && operands[1] == SPIRV_DECORATION_DESCRIPTOR_SET)
+			{
+				target->flags |= VK_REFLECT_ID_HAS_SET;
+				target->set   = operands[2];
+			}
+			else if (wordCount >= 4 && operands[1] == SPIRV_DECORATION_BINDING)
+			{
+				target->flags  |= VK_REFLECT_ID_HAS_BINDING;
+				target->binding = operands[2];
+			}
+			else if (wordCount >= 4 && operands[1] == SPIRV_DECORATION_ARRAY_STRIDE)
+			{
+				target->arrayStride = operands[2];
+			}
+			break;
+		}
+		case SPIRV_OP_TYPE_INT:
+		case SPIRV_OP_TYPE_FLOAT:
+		case SPIRV_OP_TYPE_VECTOR:
+		case SPIRV_OP_TYPE_MATRIX:
+		case SPIRV_OP_TYPE_IMAGE:
+		case SPIRV_OP_TYPE_SAMPLER:
+		case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+		case SPIRV_OP_TYPE_ARRAY:
+		case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+		case SPIRV_OP_TYPE_STRUCT:
+		case SPIRV_OP_TYPE_POINTER:
+		case SPIRV_OP_TYPE_ACCELERATION_STRUCTURE:
+			if (wordCount >= 2 && operands[0] < module->bound)
+			{
+				module->ids[operands[0]].opcode = opcode;
+				module->ids[operands[0]].offset = (uint32_t) offset;
+			}
+			break;
+		case SPIRV_OP_CONSTANT:
+		case SPIRV_OP_VARIABLE:
+			if (wordCount >= 4 && operands[1] < module->bound)
+			{
+				module->ids[operands[1]].opcode = opcode;
+				module->ids[operands[1]].offset = (uint32_t) offset;
+			}
+			break;
+		default: break;
+		}
+		offset += wordCount;
+	}
+	return true;
+}
+
+bool VkReflectShader(const uint32_t* code, size_t codeSize, VkShaderReflection* reflection)
+{
+	if (!code || !reflection) return false;
+
+	reflection->bindingCount     = 0;
+	reflection->bindings         = NULL;
+	reflection->pushConstantSize = 0;
+
+	VkReflectModule module = {
+		.code      = code,
+		.wordCount = codeSize / sizeof(uint32_t),
+		.bound     = 0,
+		.ids       = NULL
+	};
+	if (module.wordCount < 5 || code[0] != SPIRV_MAGIC)
+		return false;
+	module.bound = code[3];
+	module.ids   = (VkReflectId*) calloc(module.bound > 0 ? module.bound : 1, sizeof(VkReflectId));
+	if (!module.ids)
+		return false;
+	if (!VkReflectIndex(&module))
+	{
+		free(module.ids);
+		return false;
+	}
+
+	uint32_t capacity = 0;
+	for (uint32_t id = 0; id < module.bound; ++id)
+	{
+		const VkReflectId* variable = module.ids + id;
+		if (variable->opcode != SPIRV_OP_VARIABLE)
+			continue;
+
+		const uint32_t*    operands     = module.code + variable->offset + 1;
+		uint32_t           storageClass = operands[2];
+		const VkReflectId* pointer      = VkReflectGetId(&module, operands[0]);
+		if (!pointer || pointer->opcode != SPIRV_OP_TYPE_POINTER)
+			continue;
+		uint32_t pointee = module.code[pointer->offset + 3];
+
+		if (storageClass == SPIRV_STORAGE_PUSH_CONSTANT)
+		{
+			uint32_t size                = VkReflectTypeSize(&module, pointee, ~0U, 0);
+			reflection->pushConstantSize = size > reflection->pushConstantSize ? size : reflection->pushConstantSize;
+			continue;
+		}
+		if ((storageClass != SPIRV_STORAGE_UNIFORM_CONSTANT && storageClass != SPIRV_STORAGE_UNIFORM && storageClass != SPIRV_STORAGE_STORAGE_BUFFER) ||
+			!(variable->flags & VK_REFLECT_ID_HAS_BINDING))
+			continue;
+
+		VkShaderBinding binding = {
+			.set     = variable->flags & VK_REFLECT_ID_HAS_SET ? variable->set : 0,
+			.binding = variable->binding,
+			.type    = VK_DESCRIPTOR_TYPE_MAX_ENUM,
+			.count   = 1
+		};
+		if (!VkReflectDescriptorType(&module, storageClass, pointee, &binding.type, &binding.count))
+			continue;
+
+		if (reflection->bindingCount >= capacity)
+		{
+			uint32_t         newCapacity = capacity > 0 ? capacity * 2 : 8;
+			VkShaderBinding* newBindings = (VkShaderBinding*) realloc(reflection->bindings, newCapacity * sizeof(VkShaderBinding));
+			if (!newBindings)
+			{
+				free(module.ids);
+				VkDestroyShaderReflection(reflection);
+				return false;
+			}
+			reflection->bindings = newBindings;
+			capacity             = newCapacity;
+		}
+		reflection->bindings[reflection->bindingCount++] = binding;
+	}
+	free(module.ids);
+	return true;
+}
+
+void VkDestroyShaderReflection(VkShaderReflection* reflection)
+{
+	if (!reflection) return;
+
+	free(reflection->bindings);
+	reflection->bindingCount     = 0;
+	reflection->bindings         = NULL;
+	reflection->pushConstantSize = 0;
+}
\ No newline at end of file
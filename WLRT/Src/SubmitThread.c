@@ -0,0 +1,120 @@
+#include "Atomic.h"
+#include "Vk.h"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+static void VkSubmitThreadMain(void* userData)
+{
+	VkSubmitThreadData* submitThread = (VkSubmitThreadData*) userData;
+	VkData*             vk           = submitThread->vk;
+
+	while (true)
+	{
+		VkFrameData* frame = NULL;
+		if (!SPSCQueuePop(&submitThread->queue, &frame))
+		{
+			MutexLock(submitThread->mutex);
+			while (SPSCQueueSize(&submitThread->queue) == 0 && !AtomicLoad32(&submitThread->stop))
+				CondVarWait(submitThread->wakeCond, submitThread->mutex);
+			bool stop = SPSCQueueSize(&submitThread->queue) == 0;
+			MutexUnlock(submitThread->mutex);
+			if (stop)
+				break;
+			continue;
+		}
+
+		double start = glfwGetTime();
+		VkSubmitFrame(vk, frame);
+		AtomicAdd64(&submitThread->blockedNanoseconds, (uint64_t) ((glfwGetTime() - start) * 1e9));
+
+		MutexLock(submitThread->mutex);
+		CondVarWakeAll(submitThread->doneCond);
+		MutexUnlock(submitThread->mutex);
+	}
+}
+
+bool VkSetupSubmitThread(VkSubmitThreadData* submitThread)
+{
+	if (!submitThread || !submitThread->vk) return false;
+	VkData* vk = submitThread->vk;
+
+	submitThread->stop               = 0;
+	submitThread->blockedNanoseconds = 0;
+	submitThread->mutex              = MutexCreate();
+	submitThread->wakeCond           = CondVarCreate();
+	submitThread->doneCond           = CondVarCreate();
+	if (!submitThread->mutex ||
+		!submitThread->wakeCond ||
+		!submitThread->doneCond ||
+		!SPSCQueueSetup(&submitThread->queue, sizeof(VkFrameData*), 8))
+	{
+		VkCleanupSubmitThread(submitThread);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate submit thread data");
+		return false;
+	}
+
+	submitThread->thread = ThreadCreate(&VkSubmitThreadMain, submitThread);
+	if (!submitThread->thread)
+	{
+		VkCleanupSubmitThread(submitThread);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to create submit thread");
+		return false;
+	}
+	vk->submitThread = submitThread;
+	return true;
+}
+
+void VkCleanupSubmitThread(VkSubmitThreadData* submitThread)
+{
+	if (!submitThread || !submitThread->vk) return;
+	VkData* vk = submitThread->vk;
+
+	if (submitThread->thread)
+	{
+		MutexLock(submitThread->mutex);
+		AtomicStore32(&submitThread->stop, 1);
+		CondVarWakeAll(submitThread->wakeCond);
+		MutexUnlock(submitThread->mutex);
+		ThreadJoin(submitThread->thread);
+		submitThread->thread = NULL;
+	}
+	if (vk->submitThread == submitThread)
+		vk->submitThread = NULL;
+
+	SPSCQueueCleanup(&submitThread->queue);
+	CondVarDestroy(submitThread->doneCond);
+	CondVarDestroy(submitThread->wakeCond);
+	MutexDestroy(submitThread->mutex);
+	submitThread->doneCond = NULL;
+	submitThread->wakeCond = NULL;
+	submitThread->mutex    = NULL;
+}
+
+bool VkSubmitThreadPush(VkSubmitThreadData* submitThread, VkFrameData* frame)
+{
+	if (!submitThread || !submitThread->thread) return false;
+	VkData* vk = submitThread->vk;
+
+	while (!SPSCQueuePush(&submitThread->queue, &frame))
+		VkSubmitThreadWait(submitThread, AtomicLoad64(&vk->framesPresented) + 1);
+
+	MutexLock(submitThread->mutex);
+	CondVarWakeOne(submitThread->wakeCond);
+	MutexUnlock(submitThread->mutex);
+	return true;
+}
+
+void VkSubmitThreadWait(VkSubmitThreadData* submitThread, uint64_t sequence)
+{
+	if (!submitThread || !submitThread->thread) return;
+	VkData* vk = submitThread->vk;
+
+	if (AtomicLoad64(&vk->framesPresented) >= sequence)
+		return;
+
+	MutexLock(submitThread->mutex);
+	while (AtomicLoad64(&vk->framesPresented) < sequence)
+		CondVarWait(submitThread->doneCond, submitThread->mutex);
+	MutexUnlock(submitThread->mutex);
+}
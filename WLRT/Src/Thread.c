@@ -0,0 +1,238 @@
+#if !defined(_WIN32)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "Thread.h"
+
+#include <stdlib.h>
+
+#if defined(_WIN32)
+	#include <Windows.h>
+#else
+	#include <pthread.h>
+	#include <sched.h>
+	#include <time.h>
+	#include <unistd.h>
+#endif
+
+struct Thread
+{
+#if defined(_WIN32)
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+	ThreadFn callback;
+	void*    userData;
+};
+
+struct Mutex
+{
+#if defined(_WIN32)
+	SRWLOCK lock;
+#else
+	pthread_mutex_t lock;
+#endif
+};
+
+struct CondVar
+{
+#if defined(_WIN32)
+	CONDITION_VARIABLE cond;
+#else
+	pthread_cond_t cond;
+#endif
+};
+
+#if defined(_WIN32)
+static DWORD WINAPI ThreadEntry(LPVOID param)
+{
+	Thread* thread = (Thread*) param;
+	thread->callback(thread->userData);
+	return 0;
+}
+#else
+static void* ThreadEntry(void* param)
+{
+	Thread* thread = (Thread*) param;
+	thread->callback(thread->userData);
+	return NULL;
+}
+#endif
+
+Thread* ThreadCreate(ThreadFn callback, void* userData)
+{
+	if (!callback)
+		return NULL;
+
+	Thread* thread = (Thread*) malloc(sizeof(Thread));
+	if (!thread)
+		return NULL;
+	thread->callback = callback;
+	thread->userData = userData;
+#if defined(_WIN32)
+	thread->handle = CreateThread(NULL, 0, &ThreadEntry, thread, 0, NULL);
+	if (!thread->handle)
+	{
+		free(thread);
+		return NULL;
+	}
+#else
+	if (pthread_create(&thread->handle, NULL, &ThreadEntry, thread) != 0)
+	{
+		free(thread);
+		return NULL;
+	}
+#endif
+	return thread;
+}
+
+void ThreadJoin(Thread* thread)
+{
+	if (!thread)
+		return;
+
+#if defined(_WIN32)
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, NULL);
+#endif
+	free(thread);
+}
+
+uint32_t ThreadHardwareConcurrency()
+{
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (uint32_t) info.dwNumberOfProcessors : 1;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (uint32_t) count : 1;
+#endif
+}
+
+void ThreadSleep(double seconds)
+{
+	if (seconds <= 0.0)
+		return;
+
+#if defined(_WIN32)
+	Sleep((DWORD) (seconds * 1000.0));
+#else
+	struct timespec duration = {
+		.tv_sec  = (time_t) seconds,
+		.tv_nsec = (long) ((seconds - (double) (time_t) seconds) * 1e9)
+	};
+	nanosleep(&duration, NULL);
+#endif
+}
+
+void ThreadYield()
+{
+#if defined(_WIN32)
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+Mutex* MutexCreate()
+{
+	Mutex* mutex = (Mutex*) malloc(sizeof(Mutex));
+	if (!mutex)
+		return NULL;
+#if defined(_WIN32)
+	InitializeSRWLock(&mutex->lock);
+#else
+	if (pthread_mutex_init(&mutex->lock, NULL) != 0)
+	{
+		free(mutex);
+		return NULL;
+	}
+#endif
+	return mutex;
+}
+
+void MutexDestroy(Mutex* mutex)
+{
+	if (!mutex)
+		return;
+#if !defined(_WIN32)
+	pthread_mutex_destroy(&mutex->lock);
+#endif
+	free(mutex);
+}
+
+void MutexLock(Mutex* mutex)
+{
+#if defined(_WIN32)
+	AcquireSRWLockExclusive(&mutex->lock);
+#else
+	pthread_mutex_lock(&mutex->lock);
+#endif
+}
+
+void MutexUnlock(Mutex* mutex)
+{
+#if defined(_WIN32)
+	ReleaseSRWLockExclusive(&mutex->lock);
+#else
+	pthread_mutex_unlock(&mutex->lock);
+#endif
+}
+
+CondVar* CondVarCreate()
+{
+	CondVar* condVar = (CondVar*) malloc(sizeof(CondVar));
+	if (!condVar)
+		return NULL;
+#if defined(_WIN32)
+	InitializeConditionVariable(&condVar->cond);
+#else
+	if (pthread_cond_init(&condVar->cond, NULL) != 0)
+	{
+		free(condVar);
+		return NULL;
+	}
+#endif
+	return condVar;
+}
+
+void CondVarDestroy(CondVar* condVar)
+{
+	if (!condVar)
+		return;
+#if !defined(_WIN32)
+	pthread_cond_destroy(&condVar->cond);
+#endif
+	free(condVar);
+}
+
+void CondVarWait(CondVar* condVar, Mutex* mutex)
+{
+#if defined(_WIN32)
+	SleepConditionVariableSRW(&condVar->cond, &mutex->lock, INFINITE, 0);
+#else
+	pthread_cond_wait(&condVar->cond, &mutex->lock);
+#endif
+}
+
+void CondVarWakeOne(CondVar* condVar)
+{
+#if defined(_WIN32)
+	WakeConditionVariable(&condVar->cond);
+#else
+	pthread_cond_signal(&condVar->cond);
+#endif
+}
+
+void CondVarWakeAll(CondVar* condVar)
+{
+#if defined(_WIN32)
+	WakeAllConditionVariable(&condVar->cond);
+#else
+	pthread_cond_broadcast(&condVar->cond);
+#endif
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef void (*ThreadFn)(void* userData);
+
+typedef struct Thread  Thread;
+typedef struct Mutex   Mutex;
+typedef struct CondVar CondVar;
+
+Thread*  ThreadCreate(ThreadFn callback, void* userData);
+void     ThreadJoin(Thread* thread);
+uint32_t ThreadHardwareConcurrency();
+void     ThreadSleep(double seconds);
+void     ThreadYield();
+
+Mutex* MutexCreate();
+void   MutexDestroy(Mutex* mutex);
+void   MutexLock(Mutex* mutex);
+void   MutexUnlock(Mutex* mutex);
+
+CondVar* CondVarCreate();
+void     CondVarDestroy(CondVar* condVar);
+void     CondVarWait(CondVar* condVar, Mutex* mutex);
+void     CondVarWakeOne(CondVar* condVar);
+void     CondVarWakeAll(CondVar* condVar);
@@ -1,7 +1,10 @@
 #include "Vk.h"
+#include "Atomic.h"
+#include "Thread.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <GLFW/glfw3.h>
 
@@ -88,7 +91,6 @@ bool VkValidateAllowed(VkData* vk, VkResult result, VkResult* allowed, uint32_t
 	if (!vk)
 		return false;
 
-	vk->lastResult = result;
 	if (result >= VK_SUCCESS)
 		return true;
 
@@ -112,6 +114,16 @@ bool VkValidateAllowed(VkData* vk, VkResult result, VkResult* allowed, uint32_t
 	return false;
 }
 
+void VkLockQueue(VkData* vk)
+{
+	if (vk->queueMutex) MutexLock(vk->queueMutex);
+}
+
+void VkUnlockQueue(VkData* vk)
+{
+	if (vk->queueMutex) MutexUnlock(vk->queueMutex);
+}
+
 VkFrameData* VkGetFrame(VkData* vk, uint32_t frame)
 {
 	if (!vk || frame >= vk->framesCapacity) return NULL;
@@ -190,14 +202,29 @@ bool VkEndCmdBuffer(VkData* vk)
 		.signalSemaphoreInfoCount = 1,
 		.pSignalSemaphoreInfos    = &sigInfo
 	};
-	if (!VkValidate(vk, vkQueueSubmit2(vk->queue, 1, &submit, NULL))) return false;
+	frame->waited = false;
+	VkLockQueue(vk);
+	VkResult result = vkQueueSubmit2(vk->queue, 1, &submit, NULL);
+	VkUnlockQueue(vk);
+	if (!VkValidate(vk, result)) return false;
 	return true;
 }
 
 bool VkEndCmdBufferWait(VkData* vk)
 {
 	if (!VkEndCmdBuffer(vk)) return false;
-	vkQueueWaitIdle(vk->queue);
+	if (vk->inFrame) return true;
+
+	VkFrameData*        frame    = VkGetCurrentFrame(vk);
+	VkSemaphoreWaitInfo waitInfo = {
+		.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.pNext          = NULL,
+		.flags          = 0,
+		.semaphoreCount = 1,
+		.pSemaphores    = &frame->semaphore,
+		.pValues        = &frame->value
+	};
+	if (!VkValidate(vk, vkWaitSemaphores(vk->device, &waitInfo, ~0ULL))) return false;
 	return true;
 }
 
@@ -212,6 +239,8 @@ static void VkCleanupFrame(VkData* vk, VkFrameData* frame)
 	free(frame->renderSigs);
 	free(frame->renderWaits);
 	free(frame->results);
+	free(frame->presentIds);
+	frame->swapchainCount = 0;
 	frame->swapchainDatas = NULL;
 	frame->swapchains     = NULL;
 	frame->imageIndices   = NULL;
@@ -220,11 +249,82 @@ static void VkCleanupFrame(VkData* vk, VkFrameData* frame)
 	frame->renderSigs     = NULL;
 	frame->renderWaits    = NULL;
 	frame->results        = NULL;
+	frame->presentIds     = NULL;
+	frame->passCount      = 0;
 }
 
-bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCount)
+static bool VkCheckFrameResults(VkData* vk, VkFrameData* frame)
 {
-	if (!vk || !swapchains || swapchainCount == 0 || !VkSetupFrames(vk))
+	frame->pendingResults = false;
+	if (!VkValidate(vk, frame->submitResult))
+	{
+		VkCleanupFrame(vk, frame);
+		return false;
+	}
+
+	VkResult allowedQP[] = { VK_ERROR_OUT_OF_DATE_KHR };
+	if (!VkValidateAllowed(vk, frame->presentResult, allowedQP, sizeof(allowedQP) / sizeof(*allowedQP)))
+	{
+		VkCleanupFrame(vk, frame);
+		return false;
+	}
+	for (uint32_t i = 0; i < frame->swapchainCount; ++i)
+	{
+		if (!VkValidateAllowed(vk, frame->results[i], allowedQP, sizeof(allowedQP) / sizeof(*allowedQP)))
+		{
+			VkCleanupFrame(vk, frame);
+			return false;
+		}
+
+		switch (frame->results[i])
+		{
+		case VK_ERROR_OUT_OF_DATE_KHR:
+			frame->swapchainDatas[i]->invalid = true;
+			break;
+		case VK_SUBOPTIMAL_KHR:
+			frame->swapchainDatas[i]->suboptimal = true;
+			break;
+		}
+	}
+	return true;
+}
+
+static void VkWaitFrameTarget(VkData* vk)
+{
+	if (vk->pacing.targetFrameTime <= 0.0 || vk->pacing.frameStartTime <= 0.0)
+		return;
+
+	double deadline = vk->pacing.frameStartTime + vk->pacing.targetFrameTime;
+	double now      = glfwGetTime();
+	if (deadline - now > 0.002)
+		ThreadSleep(deadline - now - 0.002);
+	while (glfwGetTime() < deadline)
+		ThreadYield();
+}
+
+static VkResult VkAcquireImage(VkData* vk, VkSwapchainData* swapchain)
+{
+	VkSemaphore semaphore = swapchain->imageAvailable[vk->currentFrame];
+	if (!vk->submitThread)
+		return vkAcquireNextImageKHR(vk->device, swapchain->swapchain, ~0ULL, semaphore, NULL, &swapchain->imageIndex);
+
+	while (true)
+	{
+		uint64_t presented = AtomicLoad64(&vk->framesPresented);
+		bool     idle      = presented >= vk->framesSubmitted;
+		VkLockSwapchain(swapchain);
+		VkResult result = vkAcquireNextImageKHR(vk->device, swapchain->swapchain, idle ? vk->pacing.presentWaitTimeout : 0, semaphore, NULL, &swapchain->imageIndex);
+		VkUnlockSwapchain(swapchain);
+		if (result != VK_NOT_READY && result != VK_TIMEOUT)
+			return result;
+		if (!idle)
+			VkSubmitThreadWait(vk->submitThread, presented + 1);
+	}
+}
+
+bool VkWaitFrame(VkData* vk)
+{
+	if (!vk || !VkSetupFrames(vk))
 		return false;
 
 	VkFrameData* frame = VkGetCurrentFrame(vk);
@@ -233,6 +333,30 @@ bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCo
 		VkReportError(vk, VK_ERROR_CODE_INVALID_FRAME, "Current frame does not exist");
 		return false;
 	}
+	if (frame->waited)
+		return true;
+
+	double waitStart = glfwGetTime();
+	if (vk->submitThread)
+		VkSubmitThreadWait(vk->submitThread, frame->sequence);
+	if (frame->pendingResults && !VkCheckFrameResults(vk, frame))
+		return false;
+
+	bool     presentWaited = vk->presentWaitSupported && frame->swapchainCount > 0;
+	VkResult allowedWFP[]  = { VK_ERROR_OUT_OF_DATE_KHR, VK_ERROR_SURFACE_LOST_KHR };
+	for (uint32_t i = 0; presentWaited && i < frame->swapchainCount; ++i)
+	{
+		if (frame->swapchainDatas[i]->swapchain != frame->swapchains[i] || frame->results[i] < VK_SUCCESS)
+		{
+			presentWaited = false;
+			break;
+		}
+		VkResult waitResult = vkWaitForPresentKHR(vk->device, frame->swapchains[i], frame->presentIds[i], vk->pacing.presentWaitTimeout);
+		if (!VkValidateAllowed(vk, waitResult, allowedWFP, sizeof(allowedWFP) / sizeof(*allowedWFP)))
+			return false;
+		if (waitResult != VK_SUCCESS)
+			presentWaited = false;
+	}
 
 	VkSemaphoreWaitInfo waitInfo = {
 		.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
@@ -245,6 +369,40 @@ bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCo
 	if (!VkValidate(vk, vkWaitSemaphores(vk->device, &waitInfo, ~0ULL)))
 		return false;
 
+	if (frame->submitTime > 0.0)
+	{
+		vk->pacing.latency          = glfwGetTime() - frame->submitTime;
+		vk->pacing.latencyToPresent = presentWaited;
+		vk->pacing.latencySum      += vk->pacing.latency;
+		++vk->pacing.latencyCount;
+		frame->submitTime = 0.0;
+	}
+
+	VkWaitFrameTarget(vk);
+
+	double now                = glfwGetTime();
+	vk->pacing.waitTime       = now - waitStart;
+	vk->pacing.frameStartTime = now;
+	frame->waited             = true;
+	return true;
+}
+
+bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCount)
+{
+	if (!vk || !swapchains || swapchainCount == 0 || !VkSetupFrames(vk))
+		return false;
+
+	VkFrameData* frame = VkGetCurrentFrame(vk);
+	if (!frame)
+	{
+		VkReportError(vk, VK_ERROR_CODE_INVALID_FRAME, "Current frame does not exist");
+		return false;
+	}
+
+	if (!VkWaitFrame(vk))
+		return false;
+	VkCleanupFrame(vk, frame);
+
 	VkImageMemoryBarrier2* imageBarriers = (VkImageMemoryBarrier2*) malloc(swapchainCount * sizeof(VkImageMemoryBarrier2));
 
 	frame->swapchainCount = swapchainCount;
@@ -256,7 +414,8 @@ bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCo
 	frame->renderSigs     = (VkSemaphoreSubmitInfo*) malloc(swapchainCount * sizeof(VkSemaphoreSubmitInfo));
 	frame->renderWaits    = (VkSemaphore*) malloc(swapchainCount * sizeof(VkSemaphore));
 	frame->results        = (VkResult*) malloc(swapchainCount * sizeof(VkResult));
-	if (!imageBarriers || !frame->swapchainDatas || !frame->swapchains || !frame->imageIndices || !frame->imageBarriers || !frame->imageWaits || !frame->renderSigs || !frame->renderWaits || !frame->results)
+	frame->presentIds     = (uint64_t*) malloc(swapchainCount * sizeof(uint64_t));
+	if (!imageBarriers || !frame->swapchainDatas || !frame->swapchains || !frame->imageIndices || !frame->imageBarriers || !frame->imageWaits || !frame->renderSigs || !frame->renderWaits || !frame->results || !frame->presentIds)
 	{
 		free(imageBarriers);
 		VkCleanupFrame(vk, frame);
@@ -264,45 +423,61 @@ bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCo
 		return false;
 	}
 	VkResult allowedANIResults[] = { VK_ERROR_OUT_OF_DATE_KHR };
-	for (uint32_t i = 0; i < swapchainCount; ++i)
+	uint32_t acquiredCount       = 0;
+	for (uint32_t j = 0; j < swapchainCount; ++j)
 	{
-		VkSwapchainData* swapchain = swapchains[i];
-		frame->swapchainDatas[i]   = swapchain;
+		VkSwapchainData* swapchain = swapchains[j];
 
-		if (swapchain->invalid && !VkSetupSwapchain(swapchain))
+		if (!VkUpdateSwapchain(swapchain))
 		{
 			free(imageBarriers);
 			VkCleanupFrame(vk, frame);
 			return false;
 		}
+		if (swapchain->invalid)
+			continue;
 
-		if (!VkValidateAllowed(vk, vkAcquireNextImageKHR(vk->device, swapchain->swapchain, ~0ULL, swapchain->imageAvailable[vk->currentFrame], NULL, &swapchain->imageIndex), allowedANIResults, sizeof(allowedANIResults) / sizeof(*allowedANIResults)))
+		VkResult acquireResult = VkAcquireImage(vk, swapchain);
+		if (!VkValidateAllowed(vk, acquireResult, allowedANIResults, sizeof(allowedANIResults) / sizeof(*allowedANIResults)))
 		{
 			free(imageBarriers);
 			VkCleanupFrame(vk, frame);
 			return false;
 		}
-		switch (vk->lastResult)
+		switch (acquireResult)
 		{
 		case VK_ERROR_OUT_OF_DATE_KHR:
-			if (!VkSetupSwapchain(swapchain) ||
-				!VkValidate(vk, vkAcquireNextImageKHR(vk->device, swapchain->swapchain, ~0ULL, swapchain->imageAvailable[vk->currentFrame], NULL, &swapchain->imageIndex)))
+			swapchain->invalid = true;
+			if (!VkUpdateSwapchain(swapchain))
 			{
 				free(imageBarriers);
 				VkCleanupFrame(vk, frame);
 				return false;
 			}
+			if (swapchain->invalid)
+				continue;
+			if (!VkValidate(vk, VkAcquireImage(vk, swapchain)))
+			{
+				free(imageBarriers);
+				VkCleanupFrame(vk, frame);
+				return false;
+			}
+			break;
+		case VK_SUBOPTIMAL_KHR:
+			swapchain->suboptimal = true;
 			break;
 		}
+		uint32_t i               = acquiredCount++;
+		frame->swapchainDatas[i] = swapchain;
 		frame->swapchains[i]                          = swapchain->swapchain;
 		frame->imageIndices[i]                        = swapchain->imageIndex;
 		VkImageMemoryBarrier2* beginBarrier           = imageBarriers + i;
 		beginBarrier->sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
 		beginBarrier->pNext                           = NULL;
-		beginBarrier->srcStageMask                    = VK_PIPELINE_STAGE_2_NONE;
+		beginBarrier->srcStageMask                    = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
 		beginBarrier->srcAccessMask                   = VK_ACCESS_2_NONE;
-		beginBarrier->dstStageMask                    = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT;
-		beginBarrier->dstAccessMask                   = VK_ACCESS_2_NONE;
+		beginBarrier->dstStageMask                    = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		beginBarrier->dstAccessMask                   = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
 		beginBarrier->oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
 		beginBarrier->newLayout                       = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 		beginBarrier->srcQueueFamilyIndex             = 0;
@@ -317,8 +492,8 @@ bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCo
 		VkImageMemoryBarrier2* endBarrier           = frame->imageBarriers + i;
 		endBarrier->sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
 		endBarrier->pNext                           = NULL;
-		endBarrier->srcStageMask                    = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
-		endBarrier->srcAccessMask                   = VK_ACCESS_2_NONE;
+		endBarrier->srcStageMask                    = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		endBarrier->srcAccessMask                   = VK_ACCESS_2_MEMORY_WRITE_BIT;
 		endBarrier->dstStageMask                    = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
 		endBarrier->dstAccessMask                   = VK_ACCESS_2_NONE;
 		endBarrier->oldLayout                       = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -337,7 +512,7 @@ bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCo
 		imageWait->pNext                 = NULL;
 		imageWait->semaphore             = swapchain->imageAvailable[vk->currentFrame];
 		imageWait->value                 = 0;
-		imageWait->stageMask             = VK_PIPELINE_STAGE_2_NONE;
+		imageWait->stageMask             = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
 		imageWait->deviceIndex           = 0;
 
 		VkSemaphoreSubmitInfo* renderSig = frame->renderSigs + i;
@@ -345,12 +520,14 @@ bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCo
 		renderSig->pNext                 = NULL;
 		renderSig->semaphore             = swapchain->renderFinished[vk->currentFrame];
 		renderSig->value                 = 0;
-		renderSig->stageMask             = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
+		renderSig->stageMask             = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
 		renderSig->deviceIndex           = 0;
 
 		frame->renderWaits[i] = swapchain->renderFinished[vk->currentFrame];
 		frame->results[i]     = VK_SUCCESS;
+		frame->presentIds[i]  = ++swapchain->presentId;
 	}
+	frame->swapchainCount = acquiredCount;
 
 	if (!VkValidate(vk, vkResetCommandPool(vk->device, frame->pool, 0)))
 	{
@@ -358,6 +535,19 @@ bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCo
 		VkCleanupFrame(vk, frame);
 		return false;
 	}
+	for (uint32_t i = 0; i < frame->threadCount; ++i)
+	{
+		VkFrameThreadData* thread = frame->threads + i;
+		if (thread->bufferCount == 0)
+			continue;
+		if (!VkValidate(vk, vkResetCommandPool(vk->device, thread->pool, 0)))
+		{
+			free(imageBarriers);
+			VkCleanupFrame(vk, frame);
+			return false;
+		}
+		thread->bufferCount = 0;
+	}
 	VkCommandBufferBeginInfo beginInfo = {
 		.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 		.pNext            = NULL,
@@ -388,36 +578,8 @@ bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCo
 	return true;
 }
 
-bool VkEndFrame(VkData* vk)
+void VkSubmitFrame(VkData* vk, VkFrameData* frame)
 {
-	if (!vk) return false;
-
-	VkFrameData* frame = VkGetCurrentFrame(vk);
-	if (!frame)
-	{
-		VkReportError(vk, VK_ERROR_CODE_INVALID_FRAME, "Current frame does not exist");
-		return false;
-	}
-
-	VkDependencyInfo transitions = {
-		.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-		.pNext                    = NULL,
-		.dependencyFlags          = 0,
-		.memoryBarrierCount       = 0,
-		.pMemoryBarriers          = NULL,
-		.bufferMemoryBarrierCount = 0,
-		.pBufferMemoryBarriers    = NULL,
-		.imageMemoryBarrierCount  = frame->swapchainCount,
-		.pImageMemoryBarriers     = frame->imageBarriers
-	};
-	vkCmdPipelineBarrier2(frame->buffer, &transitions);
-
-	if (!VkValidate(vk, vkEndCommandBuffer(frame->buffer)))
-	{
-		VkCleanupFrame(vk, frame);
-		return false;
-	}
-
 	VkCommandBufferSubmitInfo cmdBufInfo = {
 		.sType         = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
 		.pNext         = NULL,
@@ -428,7 +590,7 @@ bool VkEndFrame(VkData* vk)
 		.sType       = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
 		.pNext       = NULL,
 		.semaphore   = frame->semaphore,
-		.value       = ++frame->value,
+		.value       = frame->value,
 		.stageMask   = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
 		.deviceIndex = 0
 	};
@@ -460,42 +622,210 @@ bool VkEndFrame(VkData* vk)
          .signalSemaphoreInfoCount = frame->swapchainCount,
          .pSignalSemaphoreInfos    = frame->renderSigs}
 	};
-	if (!VkValidate(vk, vkQueueSubmit2(vk->queue, sizeof(submits) / sizeof(*submits), submits, NULL)))
+	VkLockQueue(vk);
+	frame->submitResult  = vkQueueSubmit2(vk->queue, sizeof(submits) / sizeof(*submits), submits, NULL);
+	frame->presentResult = VK_SUCCESS;
+	VkUnlockQueue(vk);
+
+	if (frame->submitResult >= VK_SUCCESS && frame->swapchainCount > 0)
+	{
+		VkPresentIdKHR presentId = {
+			.sType          = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+			.pNext          = NULL,
+			.swapchainCount = frame->swapchainCount,
+			.pPresentIds    = frame->presentIds
+		};
+		VkPresentInfoKHR presentInfo = {
+			.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+			.pNext              = vk->presentWaitSupported ? &presentId : NULL,
+			.waitSemaphoreCount = frame->swapchainCount,
+			.pWaitSemaphores    = frame->renderWaits,
+			.swapchainCount     = frame->swapchainCount,
+			.pSwapchains        = frame->swapchains,
+			.pImageIndices      = frame->imageIndices,
+			.pResults           = frame->results
+		};
+		for (uint32_t i = 0; i < frame->swapchainCount; ++i)
+			VkLockSwapchain(frame->swapchainDatas[i]);
+		VkLockQueue(vk);
+		frame->presentResult = vkQueuePresentKHR(vk->queue, &presentInfo);
+		VkUnlockQueue(vk);
+		if (frame->swapchainCount == 1)
+			frame->results[0] = frame->presentResult;
+		for (uint32_t i = 0; i < frame->swapchainCount; ++i)
+			VkUnlockSwapchain(frame->swapchainDatas[i]);
+	}
+	AtomicStore64(&vk->framesPresented, frame->sequence);
+}
+
+bool VkEndFrame(VkData* vk)
+{
+	if (!vk) return false;
+
+	VkFrameData* frame = VkGetCurrentFrame(vk);
+	if (!frame)
+	{
+		VkReportError(vk, VK_ERROR_CODE_INVALID_FRAME, "Current frame does not exist");
+		return false;
+	}
+
+	uint32_t recordedPasses = 0;
+	for (uint32_t i = 0; i < frame->passCount; ++i)
+	{
+		if (frame->passes[i])
+			frame->passes[recordedPasses++] = frame->passes[i];
+	}
+	if (recordedPasses > 0)
+		vkCmdExecuteCommands(frame->buffer, recordedPasses, frame->passes);
+
+	VkDependencyInfo transitions = {
+		.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.pNext                    = NULL,
+		.dependencyFlags          = 0,
+		.memoryBarrierCount       = 0,
+		.pMemoryBarriers          = NULL,
+		.bufferMemoryBarrierCount = 0,
+		.pBufferMemoryBarriers    = NULL,
+		.imageMemoryBarrierCount  = frame->swapchainCount,
+		.pImageMemoryBarriers     = frame->imageBarriers
+	};
+	vkCmdPipelineBarrier2(frame->buffer, &transitions);
+
+	if (!VkValidate(vk, vkEndCommandBuffer(frame->buffer)))
 	{
 		VkCleanupFrame(vk, frame);
 		return false;
 	}
 
-	VkResult         allowedQP[] = { VK_ERROR_OUT_OF_DATE_KHR };
-	VkPresentInfoKHR presentInfo = {
-		.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-		.pNext              = NULL,
-		.waitSemaphoreCount = frame->swapchainCount,
-		.pWaitSemaphores    = frame->renderWaits,
-		.swapchainCount     = frame->swapchainCount,
-		.pSwapchains        = frame->swapchains,
-		.pImageIndices      = frame->imageIndices,
-		.pResults           = frame->results
-	};
-	vkQueuePresentKHR(vk->queue, &presentInfo);
-	for (uint32_t i = 0; i < frame->swapchainCount; ++i)
+	++frame->value;
+	frame->sequence   = ++vk->framesSubmitted;
+	frame->submitTime = glfwGetTime();
+	frame->waited     = false;
+	vk->inFrame       = false;
+	vk->currentFrame  = (vk->currentFrame + 1) % vk->framesCapacity;
+	if (vk->submitThread)
 	{
-		if (!VkValidateAllowed(vk, frame->results[i], allowedQP, sizeof(allowedQP) / sizeof(*allowedQP)))
+		frame->pendingResults = true;
+		return VkSubmitThreadPush(vk->submitThread, frame);
+	}
+
+	VkSubmitFrame(vk, frame);
+	return VkCheckFrameResults(vk, frame);
+}
+
+bool VkWaitIdle(VkData* vk)
+{
+	if (!vk) return false;
+
+	if (vk->submitThread)
+		VkSubmitThreadWait(vk->submitThread, vk->framesSubmitted);
+	VkLockQueue(vk);
+	VkResult result = vkQueueWaitIdle(vk->queue);
+	VkUnlockQueue(vk);
+	return VkValidate(vk, result);
+}
+
+bool VkReserveFramePasses(VkData* vk, uint32_t passCount)
+{
+	if (!vk) return false;
+
+	VkFrameData* frame = VkGetCurrentFrame(vk);
+	if (!frame || !vk->inFrame)
+	{
+		VkReportError(vk, VK_ERROR_CODE_INVALID_FRAME, "Current frame does not exist");
+		return false;
+	}
+
+	if (passCount > frame->passCapacity)
+	{
+		VkCommandBuffer* newPasses = (VkCommandBuffer*) realloc(frame->passes, passCount * sizeof(VkCommandBuffer));
+		if (!newPasses)
 		{
-			VkCleanupFrame(vk, frame);
+			VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate frame passes");
 			return false;
 		}
+		frame->passes       = newPasses;
+		frame->passCapacity = passCount;
+	}
+	for (uint32_t i = 0; i < passCount; ++i)
+		frame->passes[i] = NULL;
+	frame->passCount = passCount;
+	return true;
+}
 
-		switch (frame->results[i])
+VkCommandBuffer VkBeginFramePass(VkData* vk, uint32_t threadIndex, uint32_t passIndex)
+{
+	if (!vk) return NULL;
+
+	VkFrameData* frame = VkGetCurrentFrame(vk);
+	if (!frame || threadIndex >= frame->threadCount || passIndex >= frame->passCount)
+	{
+		VkReportError(vk, VK_ERROR_CODE_INVALID_FRAME, "Frame pass does not exist");
+		return NULL;
+	}
+
+	VkFrameThreadData* thread = frame->threads + threadIndex;
+	if (thread->bufferCount == thread->bufferCapacity)
+	{
+		uint32_t         newCapacity = thread->bufferCapacity > 0 ? thread->bufferCapacity * 2 : 4;
+		VkCommandBuffer* newBuffers  = (VkCommandBuffer*) realloc(thread->buffers, newCapacity * sizeof(VkCommandBuffer));
+		if (!newBuffers)
 		{
-		case VK_ERROR_OUT_OF_DATE_KHR:
-			frame->swapchainDatas[i]->invalid = true;
-			break;
+			VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate frame pass buffers");
+			return NULL;
 		}
+		thread->buffers = newBuffers;
+
+		VkCommandBufferAllocateInfo allocInfo = {
+			.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.pNext              = NULL,
+			.commandPool        = thread->pool,
+			.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = newCapacity - thread->bufferCapacity
+		};
+		if (!VkValidate(vk, vkAllocateCommandBuffers(vk->device, &allocInfo, thread->buffers + thread->bufferCapacity)))
+			return NULL;
+		thread->bufferCapacity = newCapacity;
 	}
 
-	vk->currentFrame = (vk->currentFrame + 1) % vk->framesCapacity;
-	VkCleanupFrame(vk, frame);
+	VkCommandBuffer buffer = thread->buffers[thread->bufferCount];
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = {
+		.sType                = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.pNext                = NULL,
+		.renderPass           = NULL,
+		.subpass              = 0,
+		.framebuffer          = NULL,
+		.occlusionQueryEnable = VK_FALSE,
+		.queryFlags           = 0,
+		.pipelineStatistics   = 0
+	};
+	VkCommandBufferBeginInfo beginInfo = {
+		.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext            = NULL,
+		.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = &inheritanceInfo
+	};
+	if (!VkValidate(vk, vkBeginCommandBuffer(buffer, &beginInfo)))
+		return NULL;
+	++thread->bufferCount;
+	return buffer;
+}
+
+bool VkEndFramePass(VkData* vk, uint32_t passIndex, VkCommandBuffer buffer)
+{
+	if (!vk || !buffer) return false;
+
+	VkFrameData* frame = VkGetCurrentFrame(vk);
+	if (!frame || passIndex >= frame->passCount)
+	{
+		VkReportError(vk, VK_ERROR_CODE_INVALID_FRAME, "Frame pass does not exist");
+		return false;
+	}
+
+	if (!VkValidate(vk, vkEndCommandBuffer(buffer)))
+		return false;
+	frame->passes[passIndex] = buffer;
 	return true;
 }
 
@@ -567,36 +897,180 @@ static bool VkSelectPhysicalDevice(VkData* vk)
 	return true;
 }
 
+static bool VkDeviceHasExtension(const VkExtensionProperties* extensions, uint32_t extensionCount, const char* name)
+{
+	for (uint32_t i = 0; i < extensionCount; ++i)
+		if (strcmp(extensions[i].extensionName, name) == 0)
+			return true;
+	return false;
+}
+
 static bool VkSetupDevice(VkData* vk)
 {
-	const char* exts[] = {
-		"VK_KHR_swapchain",
-		"VK_KHR_deferred_host_operations",
-		"VK_KHR_acceleration_structure",
-		"VK_KHR_ray_tracing_pipeline"
+	uint32_t availableExtCount = 0;
+	if (!VkValidate(vk, vkEnumerateDeviceExtensionProperties(vk->physicalDevice, NULL, &availableExtCount, NULL))) return false;
+	VkExtensionProperties* availableExts = (VkExtensionProperties*) malloc(availableExtCount * sizeof(VkExtensionProperties));
+	if (!availableExts)
+	{
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate device extension properties");
+		return false;
+	}
+	if (!VkValidate(vk, vkEnumerateDeviceExtensionProperties(vk->physicalDevice, NULL, &availableExtCount, availableExts)))
+	{
+		free(availableExts);
+		return false;
+	}
+
+	VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait = {
+		.sType       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+		.pNext       = NULL,
+		.presentWait = VK_FALSE
+	};
+	VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId = {
+		.sType     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+		.pNext     = &supportedPresentWait,
+		.presentId = VK_FALSE
+	};
+	VkPhysicalDeviceRayTracingInvocationReorderFeaturesNV supportedReorder = {
+		.sType                       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_INVOCATION_REORDER_FEATURES_NV,
+		.pNext                       = &supportedPresentId,
+		.rayTracingInvocationReorder = VK_FALSE
+	};
+	VkPhysicalDeviceRayQueryFeaturesKHR supportedRayQuery = {
+		.sType    = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR,
+		.pNext    = &supportedReorder,
+		.rayQuery = VK_FALSE
+	};
+	VkPhysicalDeviceRayTracingPipelineFeaturesKHR supportedRtp = {
+		.sType                               = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR,
+		.pNext                               = &supportedRayQuery,
+		.rayTracingPipeline                  = VK_FALSE,
+		.rayTracingPipelineTraceRaysIndirect = VK_FALSE
 	};
+	VkPhysicalDeviceAccelerationStructureFeaturesKHR supportedAcc = {
+		.sType                 = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR,
+		.pNext                 = &supportedRtp,
+		.accelerationStructure = VK_FALSE
+	};
+	VkPhysicalDeviceVulkan12Features supported12 = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+		.pNext = &supportedAcc
+	};
+	VkPhysicalDeviceFeatures2 supportedFeatures = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &supported12
+	};
+	vkGetPhysicalDeviceFeatures2(vk->physicalDevice, &supportedFeatures);
+
+	vk->presentWaitSupported = VkDeviceHasExtension(availableExts, availableExtCount, "VK_KHR_present_id") &&
+							   VkDeviceHasExtension(availableExts, availableExtCount, "VK_KHR_present_wait") &&
+							   supportedPresentId.presentId &&
+							   supportedPresentWait.presentWait;
+	vk->bindlessSupported = supported12.runtimeDescriptorArray &&
+							supported12.descriptorBindingPartiallyBound &&
+							supported12.descriptorBindingUpdateUnusedWhilePending &&
+							supported12.descriptorBindingStorageBufferUpdateAfterBind &&
+							supported12.descriptorBindingSampledImageUpdateAfterBind &&
+							supported12.shaderStorageBufferArrayNonUniformIndexing &&
+							supported12.shaderSampledImageArrayNonUniformIndexing;
+	vk->rayTracingSupported = !vk->forceSoftwareTracing &&
+							  VkDeviceHasExtension(availableExts, availableExtCount, "VK_KHR_deferred_host_operations") &&
+							  VkDeviceHasExtension(availableExts, availableExtCount, "VK_KHR_acceleration_structure") &&
+							  VkDeviceHasExtension(availableExts, availableExtCount, "VK_KHR_ray_tracing_pipeline") &&
+							  supportedAcc.accelerationStructure &&
+							  supportedRtp.rayTracingPipeline;
+	vk->traceRaysIndirectSupported = vk->rayTracingSupported &&
+									 supportedRtp.rayTracingPipelineTraceRaysIndirect;
+	vk->bindlessAccStructSupported = vk->rayTracingSupported &&
+									 vk->bindlessSupported &&
+									 supportedAcc.descriptorBindingAccelerationStructureUpdateAfterBind;
+	vk->pipelineLibrarySupported   = vk->rayTracingSupported &&
+									 VkDeviceHasExtension(availableExts, availableExtCount, "VK_KHR_pipeline_library");
+	vk->invocationReorderSupported = vk->rayTracingSupported &&
+									 VkDeviceHasExtension(availableExts, availableExtCount, "VK_NV_ray_tracing_invocation_reorder") &&
+									 supportedReorder.rayTracingInvocationReorder;
+	vk->rayQuerySupported          = vk->rayTracingSupported &&
+									 VkDeviceHasExtension(availableExts, availableExtCount, "VK_KHR_ray_query") &&
+									 supportedRayQuery.rayQuery;
+	free(availableExts);
+
+	const char* exts[10] = { "VK_KHR_swapchain" };
+	uint32_t    extCount = 1;
+	if (vk->rayTracingSupported)
+	{
+		exts[extCount++] = "VK_KHR_deferred_host_operations";
+		exts[extCount++] = "VK_KHR_acceleration_structure";
+		exts[extCount++] = "VK_KHR_ray_tracing_pipeline";
+	}
 
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {
+		.sType       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+		.pNext       = NULL,
+		.presentWait = VK_TRUE
+	};
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {
+		.sType     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+		.pNext     = &presentWaitFeatures,
+		.presentId = VK_TRUE
+	};
 	VkPhysicalDeviceRayTracingPipelineFeaturesKHR rtpFeatures = {
-		.sType              = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR,
-		.pNext              = NULL,
-		.rayTracingPipeline = VK_TRUE
+		.sType                               = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR,
+		.pNext                               = NULL,
+		.rayTracingPipeline                  = VK_TRUE,
+		.rayTracingPipelineTraceRaysIndirect = vk->traceRaysIndirectSupported
 	};
+	if (vk->presentWaitSupported)
+	{
+		exts[extCount++]  = "VK_KHR_present_id";
+		exts[extCount++]  = "VK_KHR_present_wait";
+		rtpFeatures.pNext = &presentIdFeatures;
+	}
+	if (vk->pipelineLibrarySupported)
+		exts[extCount++] = "VK_KHR_pipeline_library";
+	VkPhysicalDeviceRayTracingInvocationReorderFeaturesNV reorderFeatures = {
+		.sType                       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_INVOCATION_REORDER_FEATURES_NV,
+		.pNext                       = rtpFeatures.pNext,
+		.rayTracingInvocationReorder = VK_TRUE
+	};
+	if (vk->invocationReorderSupported)
+	{
+		exts[extCount++]  = "VK_NV_ray_tracing_invocation_reorder";
+		rtpFeatures.pNext = &reorderFeatures;
+	}
+	VkPhysicalDeviceRayQueryFeaturesKHR rayQueryFeatures = {
+		.sType    = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR,
+		.pNext    = rtpFeatures.pNext,
+		.rayQuery = VK_TRUE
+	};
+	if (vk->rayQuerySupported)
+	{
+		exts[extCount++]  = "VK_KHR_ray_query";
+		rtpFeatures.pNext = &rayQueryFeatures;
+	}
 	VkPhysicalDeviceAccelerationStructureFeaturesKHR accFeatures = {
-		.sType                 = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR,
-		.pNext                 = &rtpFeatures,
-		.accelerationStructure = VK_TRUE
+		.sType                                                 = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR,
+		.pNext                                                 = &rtpFeatures,
+		.accelerationStructure                                 = VK_TRUE,
+		.descriptorBindingAccelerationStructureUpdateAfterBind = vk->bindlessAccStructSupported
 	};
 	VkPhysicalDeviceVulkan13Features features13 = {
 		.sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
-		.pNext            = &accFeatures,
+		.pNext            = vk->rayTracingSupported ? (void*) &accFeatures : rtpFeatures.pNext,
 		.synchronization2 = VK_TRUE,
 		.dynamicRendering = VK_TRUE
 	};
 	VkPhysicalDeviceVulkan12Features features12 = {
-		.sType               = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
-		.pNext               = &features13,
-		.timelineSemaphore   = VK_TRUE,
-		.bufferDeviceAddress = VK_TRUE
+		.sType                                         = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+		.pNext                                         = &features13,
+		.shaderSampledImageArrayNonUniformIndexing     = vk->bindlessSupported,
+		.shaderStorageBufferArrayNonUniformIndexing    = vk->bindlessSupported,
+		.descriptorBindingSampledImageUpdateAfterBind  = vk->bindlessSupported,
+		.descriptorBindingStorageBufferUpdateAfterBind = vk->bindlessSupported,
+		.descriptorBindingUpdateUnusedWhilePending     = vk->bindlessSupported,
+		.descriptorBindingPartiallyBound               = vk->bindlessSupported,
+		.runtimeDescriptorArray                        = vk->bindlessSupported,
+		.timelineSemaphore                             = VK_TRUE,
+		.bufferDeviceAddress                           = VK_TRUE
 	};
 	VkPhysicalDeviceVulkan11Features features11 = {
 		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
@@ -624,7 +1098,7 @@ static bool VkSetupDevice(VkData* vk)
 		.pQueueCreateInfos       = &queueCreateInfo,
 		.enabledLayerCount       = 0,
 		.ppEnabledLayerNames     = NULL,
-		.enabledExtensionCount   = sizeof(exts) / sizeof(*exts),
+		.enabledExtensionCount   = extCount,
 		.ppEnabledExtensionNames = exts,
 		.pEnabledFeatures        = NULL
 	};
@@ -651,53 +1125,29 @@ static bool VkSetupVMA(VkData* vk)
 	return true;
 }
 
-static bool VkSetupPipelineCache(VkData* vk)
+bool VkSetup(VkData* vk)
 {
-	size_t   dataSize = 0;
-	uint8_t* data     = NULL;
+	if (!vk) return false;
 
-	FILE* cacheFile = fopen("pipelines.cache", "rb");
-	if (cacheFile)
-	{
-		fseek(cacheFile, 0, SEEK_END);
-		dataSize = ftell(cacheFile);
-		data     = (uint8_t*) malloc(dataSize * sizeof(uint8_t));
-		if (!data)
-		{
-			fclose(cacheFile);
-			VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate pipeline cache data");
-			return false;
-		}
-		fseek(cacheFile, 0, SEEK_SET);
-		dataSize = fread(data, sizeof(uint8_t), dataSize, cacheFile);
-		fclose(cacheFile);
-	}
+	if (vk->pacing.presentWaitTimeout == 0)
+		vk->pacing.presentWaitTimeout = 100000000ULL;
 
-	VkPipelineCacheCreateInfo createInfo = {
-		.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
-		.pNext           = NULL,
-		.flags           = 0,
-		.initialDataSize = dataSize,
-		.pInitialData    = data
-	};
-	if (!VkValidate(vk, vkCreatePipelineCache(vk->device, &createInfo, vk->allocation, &vk->pipelineCache)))
+	vk->queueMutex = MutexCreate();
+	if (!vk->queueMutex)
 	{
-		free(data);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate queue mutex");
 		return false;
 	}
-	free(data);
-	return true;
-}
-
-bool VkSetup(VkData* vk)
-{
-	if (!vk) return false;
 
 	if (!VkSetupInstance(vk) ||
 		!VkSelectPhysicalDevice(vk) ||
 		!VkSetupDevice(vk) ||
 		!VkSetupVMA(vk) ||
 		!VkSetupPipelineCache(vk) ||
+		!VkSetupShaderCache(vk) ||
+		!VkSetupShaderPack(vk) ||
+		!VkSetupLayoutCache(vk) ||
+		!VkSetupBindless(vk) ||
 		!VkSetupFrames(vk))
 	{
 		VkCleanup(vk);
@@ -707,45 +1157,21 @@ bool VkSetup(VkData* vk)
 	return true;
 }
 
-static void VkCleanupPipelineCache(VkData* vk)
-{
-	FILE* cacheFile = fopen("pipelines.cache", "wb");
-	if (cacheFile)
-	{
-		do {
-			size_t dataSize = 0;
-			if (!VkValidate(vk, vkGetPipelineCacheData(vk->device, vk->pipelineCache, &dataSize, NULL))) break;
-			uint8_t* data = (uint8_t*) malloc(dataSize * sizeof(uint8_t));
-			if (!data)
-			{
-				VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate pipeline cache data");
-				break;
-			}
-			if (!VkValidate(vk, vkGetPipelineCacheData(vk->device, vk->pipelineCache, &dataSize, data)))
-			{
-				free(data);
-				break;
-			}
-			fwrite(data, sizeof(uint8_t), dataSize, cacheFile);
-			free(data);
-		}
-		while (false);
-		fclose(cacheFile);
-	}
-
-	vkDestroyPipelineCache(vk->device, vk->pipelineCache, vk->allocation);
-	vk->pipelineCache = NULL;
-}
-
 void VkCleanup(VkData* vk)
 {
 	if (!vk) return;
 
 	VkCleanupFrames(vk);
+	VkCleanupBindless(vk);
+	VkCleanupLayoutCache(vk);
+	VkCleanupShaderPack(vk);
+	VkCleanupShaderCache(vk);
 	VkCleanupPipelineCache(vk);
 	vmaDestroyAllocator(vk->allocator);
 	vkDestroyDevice(vk->device, vk->allocation);
 	vkDestroyInstance(vk->instance, vk->allocation);
+	MutexDestroy(vk->queueMutex);
+	vk->queueMutex     = NULL;
 	vk->allocator      = NULL;
 	vk->queue          = NULL;
 	vk->device         = NULL;
@@ -769,6 +1195,10 @@ bool VkSetupFrames(VkData* vk)
 		return false;
 	}
 	vk->framesCapacity = vk->framesInFlight;
+	vk->currentFrame   = 0;
+	++vk->framesGeneration;
+	memset(vk->frames, 0, vk->framesCapacity * sizeof(VkFrameData));
+	uint32_t threadCount = vk->recordThreadCount > 0 ? vk->recordThreadCount : 1;
 	for (uint32_t i = 0; i < vk->framesCapacity; ++i)
 	{
 		VkFrameData* frame = vk->frames + i;
@@ -797,6 +1227,32 @@ bool VkSetupFrames(VkData* vk)
 			return false;
 		}
 
+		frame->threadCount  = 0;
+		frame->threads      = (VkFrameThreadData*) calloc(threadCount, sizeof(VkFrameThreadData));
+		frame->passCount    = 0;
+		frame->passCapacity = 0;
+		frame->passes       = NULL;
+		if (!frame->threads)
+		{
+			VkCleanupFrames(vk);
+			VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate frame thread data");
+			return false;
+		}
+		for (; frame->threadCount < threadCount; ++frame->threadCount)
+		{
+			VkCommandPoolCreateInfo tpCreateInfo = {
+				.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+				.pNext            = NULL,
+				.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+				.queueFamilyIndex = 0
+			};
+			if (!VkValidate(vk, vkCreateCommandPool(vk->device, &tpCreateInfo, vk->allocation, &frame->threads[frame->threadCount].pool)))
+			{
+				VkCleanupFrames(vk);
+				return false;
+			}
+		}
+
 		VkSemaphoreTypeCreateInfo stCreateInfo = {
 			.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
 			.pNext         = NULL,
@@ -813,7 +1269,13 @@ bool VkSetupFrames(VkData* vk)
 			VkCleanupFrames(vk);
 			return false;
 		}
-		frame->value = 0;
+		frame->value          = 0;
+		frame->sequence       = 0;
+		frame->submitTime     = 0.0;
+		frame->waited         = false;
+		frame->pendingResults = false;
+		frame->submitResult   = VK_SUCCESS;
+		frame->presentResult  = VK_SUCCESS;
 
 		frame->swapchainCount = 0;
 		frame->swapchainDatas = NULL;
@@ -824,46 +1286,72 @@ bool VkSetupFrames(VkData* vk)
 		frame->renderSigs     = NULL;
 		frame->renderWaits    = NULL;
 		frame->results        = NULL;
+		frame->presentIds     = NULL;
 	}
 	return true;
 }
 
+static void VkWaitFrameSemaphores(VkData* vk)
+{
+	VkSemaphore* semaphores = (VkSemaphore*) malloc(vk->framesCapacity * sizeof(VkSemaphore));
+	uint64_t*    values     = (uint64_t*) malloc(vk->framesCapacity * sizeof(uint64_t));
+	if (!semaphores || !values)
+	{
+		free(semaphores);
+		free(values);
+		return;
+	}
+	VkSemaphoreWaitInfo waitInfo = {
+		.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.pNext          = NULL,
+		.flags          = 0,
+		.semaphoreCount = vk->framesCapacity,
+		.pSemaphores    = semaphores,
+		.pValues        = values
+	};
+	for (uint32_t i = 0; i < vk->framesCapacity; ++i)
+	{
+		VkFrameData* frame = vk->frames + i;
+		semaphores[i]      = frame->semaphore;
+		values[i]          = frame->value;
+	}
+	VkValidate(vk, vkWaitSemaphores(vk->device, &waitInfo, ~0ULL));
+	free(semaphores);
+	free(values);
+}
+
 void VkCleanupFrames(VkData* vk)
 {
 	if (!vk) return;
 
 	if (vk->frames)
 	{
-		do {
-			VkSemaphore* semaphores = (VkSemaphore*) malloc(vk->framesCapacity * sizeof(VkSemaphore));
-			uint64_t*    values     = (uint64_t*) malloc(vk->framesCapacity * sizeof(uint64_t));
-			if (!semaphores || !values)
-			{
-				free(semaphores);
-				free(values);
-				break;
-			}
-			VkSemaphoreWaitInfo waitInfo = {
-				.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
-				.pNext          = NULL,
-				.flags          = 0,
-				.semaphoreCount = vk->framesCapacity,
-				.pSemaphores    = semaphores,
-				.pValues        = values
-			};
-			for (uint32_t i = 0; i < vk->framesCapacity; ++i)
-			{
-				VkFrameData* frame = vk->frames + i;
-				semaphores[i]      = frame->semaphore;
-				values[i]          = frame->value;
-			}
-			VkValidate(vk, vkWaitSemaphores(vk->device, &waitInfo, ~0ULL));
+		if (vk->submitThread)
+			VkSubmitThreadWait(vk->submitThread, vk->framesSubmitted);
+		for (uint32_t i = 0; i < vk->framesCapacity; ++i)
+		{
+			VkFrameData* frame = vk->frames + i;
+			if (frame->pendingResults)
+				VkCheckFrameResults(vk, frame);
 		}
-		while (false);
+
+		VkWaitFrameSemaphores(vk);
 
 		for (uint32_t i = 0; i < vk->framesCapacity; ++i)
 		{
 			VkFrameData* frame = vk->frames + i;
+			for (uint32_t j = 0; j < frame->threadCount; ++j)
+			{
+				VkFrameThreadData* thread = frame->threads + j;
+				vkDestroyCommandPool(vk->device, thread->pool, vk->allocation);
+				free(thread->buffers);
+			}
+			free(frame->threads);
+			free(frame->passes);
+			frame->threadCount  = 0;
+			frame->threads      = NULL;
+			frame->passCapacity = 0;
+			frame->passes       = NULL;
 			vkDestroyCommandPool(vk->device, frame->pool, vk->allocation);
 			vkDestroySemaphore(vk->device, frame->semaphore, vk->allocation);
 			VkCleanupFrame(vk, frame);
@@ -1,6 +1,11 @@
 #pragma once
 
 #include "Filesystem.h"
+#include "JobSystem.h"
+#include "ShaderC.h"
+#include "ShaderPack.h"
+#include "SPSCQueue.h"
+#include "Thread.h"
 
 #include <stdbool.h>
 
@@ -17,13 +22,33 @@ typedef enum VkErrorCode
 	VK_ERROR_CODE_INVALID_FRAME       = -4
 } VkErrorCode;
 
+typedef struct VkFrameThreadData
+{
+	VkCommandPool    pool;
+	uint32_t         bufferCount;
+	uint32_t         bufferCapacity;
+	VkCommandBuffer* buffers;
+} VkFrameThreadData;
+
 typedef struct VkFrameData
 {
 	VkCommandPool   pool;
 	VkCommandBuffer buffer;
 
+	uint32_t           threadCount;
+	VkFrameThreadData* threads;
+	uint32_t           passCount;
+	uint32_t           passCapacity;
+	VkCommandBuffer*   passes;
+
 	VkSemaphore semaphore;
 	uint64_t    value;
+	uint64_t    sequence;
+	double      submitTime;
+	bool        waited;
+	bool        pendingResults;
+	VkResult    submitResult;
+	VkResult    presentResult;
 
 	uint32_t                 swapchainCount;
 	struct VkSwapchainData** swapchainDatas;
@@ -34,8 +59,199 @@ typedef struct VkFrameData
 	VkSemaphoreSubmitInfo*   renderSigs;
 	VkSemaphore*             renderWaits;
 	VkResult*                results;
+	uint64_t*                presentIds;
 } VkFrameData;
 
+typedef struct VkFramePacingData
+{
+	double   targetFrameTime;
+	uint64_t presentWaitTimeout;
+
+	double   frameStartTime;
+	double   waitTime;
+	double   latency;
+	bool     latencyToPresent;
+	double   latencySum;
+	uint32_t latencyCount;
+} VkFramePacingData;
+
+typedef struct VkPipelineCacheStoreData
+{
+	const char* filepath;
+	double      saveInterval;
+
+	double lastSaveTime;
+	size_t loadedSize;
+	size_t savedSize;
+	bool   rejected;
+
+	volatile uint64_t pipelineCount;
+	volatile uint64_t pipelineHits;
+	volatile uint64_t stageCount;
+	volatile uint64_t stageHits;
+	volatile uint64_t creationNanoseconds;
+} VkPipelineCacheStoreData;
+
+typedef struct VkShaderCompilerData
+{
+	JobSystem* jobs;
+
+	volatile uint64_t compiled;
+	volatile uint64_t cached;
+	volatile uint64_t failed;
+	volatile uint64_t precompiled;
+	volatile uint64_t stale;
+	volatile uint64_t compileNanoseconds;
+	double            batchTime;
+
+	uint32_t recipes;
+	bool     report;
+
+	const char*    packFilepath;
+	ShaderPackData pack;
+	double         packLoadTime;
+} VkShaderCompilerData;
+
+typedef struct VkShaderRecipeStats
+{
+	bool   applied;
+	size_t sizeBefore;
+	size_t sizeAfter;
+	double createBefore;
+	double createAfter;
+	double optimizeTime;
+} VkShaderRecipeStats;
+
+typedef struct VkShaderCacheEntry
+{
+	uint64_t key;
+	uint64_t sourceHash;
+	uint64_t offset;
+	uint64_t size;
+	uint64_t includesSize;
+	uint64_t checksum;
+} VkShaderCacheEntry;
+
+typedef struct VkShaderCachePending
+{
+	VkShaderCacheEntry entry;
+	uint8_t*           data;
+} VkShaderCachePending;
+
+typedef struct VkShaderCacheData
+{
+	const char* filepath;
+	size_t      maxSize;
+
+	Mutex*              mutex;
+	FSMappedFile        pack;
+	uint32_t            entryCount;
+	VkShaderCacheEntry* entries;
+	const uint8_t*      blob;
+	bool*               touched;
+	uint64_t            liveSize;
+	bool                compact;
+
+	uint32_t              pendingCount;
+	uint32_t              pendingCapacity;
+	VkShaderCachePending* pending;
+
+	bool     rejected;
+	uint32_t corruptEntries;
+	uint32_t compactions;
+	size_t   loadedSize;
+	size_t   savedSize;
+} VkShaderCacheData;
+
+typedef struct VkShaderDependency
+{
+	FSPath                filepath;
+	uint64_t              watchID;
+	uint32_t              dependentCount;
+	uint32_t              dependentCapacity;
+	struct VkShaderData** dependents;
+} VkShaderDependency;
+
+typedef struct VkShaderDependencyGraph
+{
+	uint32_t             dependencyCount;
+	uint32_t             dependencyCapacity;
+	VkShaderDependency** dependencies;
+} VkShaderDependencyGraph;
+
+#define VK_LAYOUT_MAX_SETS 4
+
+typedef struct VkDescriptorSetLayoutEntry
+{
+	uint64_t                      hash;
+	uint32_t                      bindingCount;
+	VkDescriptorSetLayoutBinding* bindings;
+	VkDescriptorBindingFlags*     bindingFlags;
+	VkDescriptorSetLayout         handle;
+	uint32_t                      refs;
+} VkDescriptorSetLayoutEntry;
+
+typedef struct VkPipelineLayoutEntry
+{
+	uint64_t                    hash;
+	uint32_t                    setLayoutCount;
+	VkDescriptorSetLayoutEntry* setLayouts[VK_LAYOUT_MAX_SETS];
+	VkPushConstantRange         pushConstantRange;
+	VkPipelineLayout            handle;
+	uint32_t                    refs;
+} VkPipelineLayoutEntry;
+
+typedef struct VkLayoutCacheData
+{
+	uint32_t                     setLayoutCount;
+	uint32_t                     setLayoutCapacity;
+	VkDescriptorSetLayoutEntry** setLayouts;
+	uint32_t                     layoutCount;
+	uint32_t                     layoutCapacity;
+	VkPipelineLayoutEntry**      layouts;
+
+	uint64_t hits;
+	uint64_t misses;
+} VkLayoutCacheData;
+
+#define VK_BINDLESS_SET     1
+#define VK_BINDLESS_INVALID 0xFFFFFFFFU
+
+typedef enum VkBindlessKind
+{
+	VK_BINDLESS_KIND_BUFFER     = 0,
+	VK_BINDLESS_KIND_IMAGE      = 1,
+	VK_BINDLESS_KIND_ACC_STRUCT = 2,
+	VK_BINDLESS_KIND_COUNT      = 3
+} VkBindlessKind;
+
+typedef struct VkBindlessRetiredSlot
+{
+	uint64_t sequence;
+	uint32_t index;
+} VkBindlessRetiredSlot;
+
+typedef struct VkBindlessSlots
+{
+	uint32_t  capacity;
+	uint32_t  used;
+	uint32_t  freeCount;
+	uint32_t* freeSlots;
+
+	uint32_t               retiredCount;
+	VkBindlessRetiredSlot* retired;
+} VkBindlessSlots;
+
+typedef struct VkBindlessData
+{
+	uint32_t capacities[VK_BINDLESS_KIND_COUNT];
+
+	VkDescriptorSetLayout setLayout;
+	VkDescriptorPool      pool;
+	VkDescriptorSet       set;
+	VkBindlessSlots       slots[VK_BINDLESS_KIND_COUNT];
+} VkBindlessData;
+
 typedef struct VkData
 {
 	VkAllocationCallbacks* allocation;
@@ -46,6 +262,15 @@ typedef struct VkData
 	VkQueue          queue;
 	VmaAllocator     allocator;
 	VkPipelineCache  pipelineCache;
+	bool             forceSoftwareTracing;
+	bool             rayTracingSupported;
+	bool             traceRaysIndirectSupported;
+	bool             presentWaitSupported;
+	bool             pipelineLibrarySupported;
+	bool             invocationReorderSupported;
+	bool             rayQuerySupported;
+	bool             bindlessSupported;
+	bool             bindlessAccStructSupported;
 
 	VkPhysicalDeviceRayTracingPipelinePropertiesKHR    deviceRayTracingPipelineProps;
 	VkPhysicalDeviceAccelerationStructurePropertiesKHR deviceAccStructureProps;
@@ -53,34 +278,94 @@ typedef struct VkData
 
 	uint32_t     currentFrame;
 	uint32_t     framesInFlight;
+	uint64_t     framesGeneration;
 	uint32_t     framesCapacity;
 	VkFrameData* frames;
 	bool         inFrame;
+	uint32_t     recordThreadCount;
+
+	Mutex*                     queueMutex;
+	struct VkSubmitThreadData* submitThread;
+	uint64_t                   framesSubmitted;
+	volatile uint64_t          framesPresented;
+
+	VkFramePacingData        pacing;
+	VkPipelineCacheStoreData pipelineCacheStore;
+	VkShaderCompilerData     shaderCompiler;
+	VkShaderCacheData        shaderCache;
+	VkShaderDependencyGraph  shaderDependencies;
+	VkLayoutCacheData        layoutCache;
+	VkBindlessData           bindless;
 
-	VkResult          lastResult;
 	VkErrorCallbackFn errorCallback;
 } VkData;
 
+typedef struct VkSubmitThreadData
+{
+	VkData* vk;
+
+	Thread*           thread;
+	Mutex*            mutex;
+	CondVar*          wakeCond;
+	CondVar*          doneCond;
+	SPSCQueue         queue;
+	volatile uint32_t stop;
+
+	volatile uint64_t blockedNanoseconds;
+} VkSubmitThreadData;
+
+typedef struct VkRetiredSwapchainData
+{
+	uint64_t  framesSubmitted;
+	uint64_t  framesGeneration;
+	uint32_t  frameCount;
+	uint64_t* frameValues;
+
+	VkSwapchainKHR swapchain;
+	uint32_t       imageCount;
+	VkImage*       images;
+	VkImageView*   views;
+	uint32_t       semaphoreCount;
+	VkSemaphore*   imageAvailable;
+	VkSemaphore*   renderFinished;
+} VkRetiredSwapchainData;
+
 typedef struct VkSwapchainData
 {
 	VkData*            vk;
 	struct WindowData* window;
+	double             resizeDebounce;
+	Mutex*             mutex;
 
 	VkSurfaceKHR       surface;
 	VkSwapchainKHR     swapchain;
 	VkSurfaceFormatKHR format;
+	VkPresentModeKHR   requestedPresentMode;
 	VkPresentModeKHR   presentMode;
 	VkExtent2D         extent;
 	bool               invalid;
+	bool               suboptimal;
+	uint64_t           presentId;
 
 	uint32_t     imageIndex;
 	uint32_t     imageCount;
 	VkImage*     images;
 	VkImageView* views;
+	uint32_t     semaphoreCount;
 	VkSemaphore* imageAvailable;
 	VkSemaphore* renderFinished;
+
+	uint32_t                retiredCount;
+	uint32_t                retiredCapacity;
+	VkRetiredSwapchainData* retired;
 } VkSwapchainData;
 
+typedef struct VkAccStructHostGeometry
+{
+	const void* vertexData;
+	const void* indexData;
+} VkAccStructHostGeometry;
+
 typedef struct VkAccStructBuilder
 {
 	VkData*     vk;
@@ -104,6 +389,7 @@ typedef struct VkAccStructBuilder
 	VkAccelerationStructureGeometryKHR*       geometries;
 	uint32_t*                                 primitiveCounts;
 	VkAccelerationStructureBuildRangeInfoKHR* ranges;
+	VkAccStructHostGeometry*                  hostGeometries;
 } VkAccStructBuilder;
 
 typedef struct VkAccStruct
@@ -113,27 +399,364 @@ typedef struct VkAccStruct
 	VkAccelerationStructureKHR handle;
 	VkBuffer                   buffer;
 	VmaAllocation              allocation;
+
+	uint32_t     bvhNodeCount;
+	uint32_t     bvhTriangleCount;
+	uint32_t     bvhDepth;
+	VkDeviceSize bvhTriangleOffset;
+	double       bvhBuildTime;
 } VkAccStruct;
 
+typedef struct VkShaderBinding
+{
+	uint32_t         set;
+	uint32_t         binding;
+	VkDescriptorType type;
+	uint32_t         count;
+} VkShaderBinding;
+
+typedef struct VkShaderReflection
+{
+	uint32_t         bindingCount;
+	VkShaderBinding* bindings;
+	uint32_t         pushConstantSize;
+} VkShaderReflection;
+
+typedef struct VkReflectedLayout
+{
+	VkPipelineLayout      layout;
+	uint32_t              setLayoutCount;
+	VkDescriptorSetLayout setLayouts[VK_LAYOUT_MAX_SETS];
+	uint64_t              bindingMasks[VK_LAYOUT_MAX_SETS];
+	VkShaderStageFlags    pushConstantStages;
+	uint32_t              pushConstantSize;
+} VkReflectedLayout;
+
 typedef struct VkShaderData
 {
-	VkData* vk;
+	VkData*            vk;
+	uint32_t           defineCount;
+	const char* const* defines;
 
-	VkShaderModule handle;
+	VkShaderModule        handle;
+	VkShaderStageFlagBits stage;
+	VkShaderReflection    reflection;
 
 	FSPath   filepath;
 	uint64_t watchID;
-
-	bool modified;
+	char*    includes;
+	size_t   includesSize;
+
+	bool                modified;
+	bool                compiled;
+	VkShaderRecipeStats recipeStats[SHADERC_RECIPE_COUNT];
+
+	VkShaderModule     reloadHandle;
+	VkShaderReflection reloadReflection;
+	JobCounter         reloadCounter;
+	bool               reloading;
+	bool               reloadSucceeded;
 } VkShaderData;
 
+typedef enum VkShaderGroupKind
+{
+	VK_SHADER_GROUP_KIND_RAYGEN   = 0,
+	VK_SHADER_GROUP_KIND_MISS     = 1,
+	VK_SHADER_GROUP_KIND_HIT      = 2,
+	VK_SHADER_GROUP_KIND_CALLABLE = 3,
+	VK_SHADER_GROUP_KIND_COUNT    = 4
+} VkShaderGroupKind;
+
+typedef struct VkShaderGroup
+{
+	VkShaderGroupKind kind;
+	VkShaderData*     general;
+	VkShaderData*     closestHit;
+	VkShaderData*     anyHit;
+	VkShaderData*     intersection;
+
+	const void* data;
+	uint32_t    dataSize;
+} VkShaderGroup;
+
+typedef struct VkRetiredRayTracingPipelineData
+{
+	uint64_t  framesGeneration;
+	uint32_t  frameCount;
+	uint64_t* frameValues;
+
+	uint32_t      pipelineCount;
+	VkPipeline*   pipelines;
+	VkBuffer      sbtBuffer;
+	VmaAllocation sbtAllocation;
+} VkRetiredRayTracingPipelineData;
+
 typedef struct VkRayTracingPipelineData
 {
 	VkData* vk;
 
-	VkPipeline handle;
+	uint32_t                    groupCount;
+	const VkShaderGroup*        groups;
+	uint32_t                    layoutShaderCount;
+	VkShaderData* const*        layoutShaders;
+	uint32_t                    maxRecursionDepth;
+	uint32_t                    maxPayloadSize;
+	uint32_t                    maxHitAttributeSize;
+	const VkSpecializationInfo* specialization;
+	bool                        useLibraries;
+	JobSystem*                  jobs;
+
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout      layout;
+	uint64_t              bindingMask;
+	bool                  bindless;
+	VkShaderStageFlags    pushConstantStages;
+	uint32_t              pushConstantSize;
+	VkPipeline            handle;
+	uint32_t              stackSize;
+	uint32_t*             order;
+	VkPipeline*           libraries;
+	VkPipelineCache       pipelineCache;
+
+	double   fullBuildTime;
+	double   relinkTime;
+	uint32_t relinkedLibraries;
+
+	VkBuffer                        sbtBuffer;
+	VmaAllocation                   sbtAllocation;
+	VkStridedDeviceAddressRegionKHR regions[VK_SHADER_GROUP_KIND_COUNT];
+
+	struct VkRayTracingPipelineData* pending;
+	const VkShaderData*              pendingChanged;
+	JobCounter                       pendingCounter;
+	bool                             pendingBuilt;
+	double                           pendingTime;
+
+	uint32_t                         retiredCount;
+	uint32_t                         retiredCapacity;
+	VkRetiredRayTracingPipelineData* retired;
 } VkRayTracingPipelineData;
 
+typedef struct VkPipelineVariant
+{
+	uint64_t                  hash;
+	VkShaderData*             raygen;
+	void*                     data;
+	VkSpecializationInfo      specialization;
+	VkShaderGroup*            groups;
+	VkRayTracingPipelineData* pipeline;
+	uint32_t                  requests;
+} VkPipelineVariant;
+
+typedef struct VkPipelineVariantCacheData
+{
+	VkRayTracingPipelineData        base;
+	uint32_t                        mapEntryCount;
+	const VkSpecializationMapEntry* mapEntries;
+	uint32_t                        dataSize;
+
+	uint32_t            variantCount;
+	uint32_t            variantCapacity;
+	VkPipelineVariant** variants;
+	uint64_t            hits;
+	uint64_t            misses;
+} VkPipelineVariantCacheData;
+
+typedef struct VkPathTracerView
+{
+	float position[3];
+	float yaw;
+	float pitch;
+	float fov;
+	float background[4];
+} VkPathTracerView;
+
+typedef struct VkPathTracerConstants
+{
+	float    origin[4];
+	float    forward[4];
+	float    right[4];
+	float    up[4];
+	float    background[4];
+	uint32_t sampleIndex;
+	uint32_t seed;
+	uint32_t maxBounces;
+	uint32_t counterSlot;
+	uint32_t sortValid;
+} VkPathTracerConstants;
+
+typedef struct VkPathTracerWavefrontConstants
+{
+	VkPathTracerConstants view;
+	uint32_t              pass;
+	uint32_t              material;
+	uint32_t              bounce;
+	uint32_t              queue;
+	uint32_t              pixelCount;
+} VkPathTracerWavefrontConstants;
+
+typedef enum VkPathTracerMode
+{
+	VK_PATH_TRACER_MODE_MEGAKERNEL = 0,
+	VK_PATH_TRACER_MODE_WAVEFRONT  = 1,
+	VK_PATH_TRACER_MODE_COUNT      = 2
+} VkPathTracerMode;
+
+typedef enum VkPathTracerBackend
+{
+	VK_PATH_TRACER_BACKEND_PIPELINE = 0,
+	VK_PATH_TRACER_BACKEND_QUERY    = 1,
+	VK_PATH_TRACER_BACKEND_COUNT    = 2
+} VkPathTracerBackend;
+
+typedef enum VkPathTracerStage
+{
+	VK_PATH_TRACER_STAGE_MEGAKERNEL = 0,
+	VK_PATH_TRACER_STAGE_SORT       = 1,
+	VK_PATH_TRACER_STAGE_GENERATE   = 2,
+	VK_PATH_TRACER_STAGE_EXTEND     = 3,
+	VK_PATH_TRACER_STAGE_SHADE      = 4,
+	VK_PATH_TRACER_STAGE_SHADOW     = 5,
+	VK_PATH_TRACER_STAGE_RESOLVE    = 6,
+	VK_PATH_TRACER_STAGE_BLIT       = 7,
+	VK_PATH_TRACER_STAGE_COUNT      = 8
+} VkPathTracerStage;
+
+typedef enum VkPathTracerQueue
+{
+	VK_PATH_TRACER_QUEUE_RAYS      = 0,
+	VK_PATH_TRACER_QUEUE_HITS      = 1,
+	VK_PATH_TRACER_QUEUE_MATERIALS = 2,
+	VK_PATH_TRACER_QUEUE_SHADOWS   = 3,
+	VK_PATH_TRACER_QUEUE_RADIANCE  = 4,
+	VK_PATH_TRACER_QUEUE_COUNTERS  = 5,
+	VK_PATH_TRACER_QUEUE_ARGS      = 6,
+	VK_PATH_TRACER_QUEUE_COUNT     = 7
+} VkPathTracerQueue;
+
+#define VK_PATH_TRACER_MAX_BOUNCES 15
+#define VK_PATH_TRACER_MATERIALS   4
+#define VK_PATH_TRACER_TIMESTAMPS  64
+#define VK_PATH_TRACER_BUFFERS     (3 + VK_PATH_TRACER_QUEUE_COUNT)
+
+typedef struct VkRetiredPathTracerData
+{
+	uint64_t  framesGeneration;
+	uint32_t  frameCount;
+	uint64_t* frameValues;
+
+	VkImage          images[2];
+	VmaAllocation    imageAllocations[2];
+	VkImageView      views[2];
+	VkBuffer         buffers[VK_PATH_TRACER_BUFFERS];
+	VmaAllocation    bufferAllocations[VK_PATH_TRACER_BUFFERS];
+	VkDescriptorPool descriptorPool;
+} VkRetiredPathTracerData;
+
+typedef struct VkPathTracerData
+{
+	VkData*                   vk;
+	VkRayTracingPipelineData* rtPipeline;
+	VkAccStruct*              tlas;
+	uint32_t                  maxBounces;
+	uint32_t                  maxSamples;
+	uint32_t                  samplesPerFrame;
+	bool                      sortHits;
+	VkRayTracingPipelineData* extendPipeline;
+	VkRayTracingPipelineData* shadowPipeline;
+	VkPathTracerMode          mode;
+	const VkDeviceAddress*    geometry;
+	VkPathTracerBackend       extendBackend;
+	VkPathTracerBackend       shadowBackend;
+
+	VkExtent2D       extent;
+	VkImage          accumImage;
+	VmaAllocation    accumAllocation;
+	VkImageView      accumView;
+	VkImage          outputImage;
+	VmaAllocation    outputAllocation;
+	VkImageView      outputView;
+	bool             imagesInitialized;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet  descriptorSet;
+
+	uint32_t                 retiredCount;
+	uint32_t                 retiredCapacity;
+	VkRetiredPathTracerData* retired;
+
+	VkShaderData          sortShader;
+	VkDescriptorSetLayout sortSetLayout;
+	VkPipelineLayout      sortLayout;
+	VkPipeline            sortPipeline;
+	VkDescriptorSet       sortSet;
+	VkBuffer              keyBuffer;
+	VmaAllocation         keyAllocation;
+	VkBuffer              bucketBuffer;
+	VmaAllocation         bucketAllocation;
+	VkBuffer              orderBuffer;
+	VmaAllocation         orderAllocation;
+	bool                  sortValid;
+	bool                  sort;
+
+	uint64_t      framesGeneration;
+	uint32_t      counterCount;
+	VkBuffer      counterBuffer;
+	VmaAllocation counterAllocation;
+	uint32_t*     counters;
+	uint64_t*     counterSamples;
+
+	VkShaderData          wavefrontShader;
+	VkDescriptorSetLayout wavefrontSetLayout;
+	uint64_t              wavefrontBindingMask;
+	bool                  wavefrontBindless;
+	VkPipelineLayout      wavefrontLayout;
+	VkPipeline            wavefrontPipeline;
+	VkDescriptorSet       wavefrontSet;
+	VkDescriptorSet       wavefrontRaySet;
+	VkBuffer              queueBuffers[VK_PATH_TRACER_QUEUE_COUNT];
+	VmaAllocation         queueAllocations[VK_PATH_TRACER_QUEUE_COUNT];
+	VkShaderData          queryShader;
+	VkPipelineLayout      queryLayout;
+	VkPipeline            queryPipeline;
+
+	VkShaderData          bvhShader;
+	VkDescriptorSetLayout bvhSetLayout;
+	VkPipelineLayout      bvhLayout;
+	VkPipeline            bvhPipeline;
+	bool                  software;
+
+	VkBuffer      statsBuffer;
+	VmaAllocation statsAllocation;
+	uint32_t*     stats;
+	uint32_t*     statsBounces;
+	VkQueryPool   timestampPool;
+	uint32_t*     timestampCounts;
+	uint8_t*      timestampStages;
+	float         timestampPeriod;
+
+	VkPathTracerView      view;
+	VkPipeline            viewPipelines[2];
+	VkPathTracerMode      viewMode;
+	VkPathTracerConstants constants;
+	uint32_t              sampleCount;
+	uint32_t              frameSlot;
+	bool                  active;
+	bool                  initialize;
+	bool                  trace;
+	bool                  wavefront;
+	bool                  queryExtend;
+	bool                  queryShadow;
+
+	uint64_t samplesTraced;
+	uint64_t raysTraced;
+	double   stageTimes[VK_PATH_TRACER_STAGE_COUNT];
+	uint32_t timedFrames;
+	uint64_t queuePixels;
+	uint64_t queueRays[VK_PATH_TRACER_MAX_BOUNCES + 1];
+	uint64_t queueShadows[VK_PATH_TRACER_MAX_BOUNCES + 1];
+	uint64_t queueHits[VK_PATH_TRACER_MATERIALS];
+} VkPathTracerData;
+
 const char* VkGetErrorString(int code);
 const char* VkGetResultString(VkResult result);
 
@@ -144,20 +767,54 @@ bool VkValidateAllowed(VkData* vk, VkResult result, VkResult* allowed, uint32_t
 VkFrameData* VkGetFrame(VkData* vk, uint32_t frame);
 VkFrameData* VkGetCurrentFrame(VkData* vk);
 
+void VkLockQueue(VkData* vk);
+void VkUnlockQueue(VkData* vk);
+
 bool VkBeginCmdBuffer(VkData* vk, VkCommandBuffer* buffer);
 bool VkEndCmdBuffer(VkData* vk);
 bool VkEndCmdBufferWait(VkData* vk);
 
+bool VkWaitFrame(VkData* vk);
 bool VkBeginFrame(VkData* vk, VkSwapchainData** swapchains, uint32_t swapchainCount);
 bool VkEndFrame(VkData* vk);
+void VkSubmitFrame(VkData* vk, VkFrameData* frame);
+bool VkWaitIdle(VkData* vk);
+
+bool            VkReserveFramePasses(VkData* vk, uint32_t passCount);
+VkCommandBuffer VkBeginFramePass(VkData* vk, uint32_t threadIndex, uint32_t passIndex);
+bool            VkEndFramePass(VkData* vk, uint32_t passIndex, VkCommandBuffer buffer);
+
+bool VkSetupSubmitThread(VkSubmitThreadData* submitThread);
+void VkCleanupSubmitThread(VkSubmitThreadData* submitThread);
+bool VkSubmitThreadPush(VkSubmitThreadData* submitThread, VkFrameData* frame);
+void VkSubmitThreadWait(VkSubmitThreadData* submitThread, uint64_t sequence);
 
 bool VkSetup(VkData* vk);
 void VkCleanup(VkData* vk);
 bool VkSetupFrames(VkData* vk);
 void VkCleanupFrames(VkData* vk);
 
+bool            VkSetupPipelineCache(VkData* vk);
+void            VkCleanupPipelineCache(VkData* vk);
+bool            VkSavePipelineCache(VkData* vk);
+void            VkUpdatePipelineCache(VkData* vk);
+VkPipelineCache VkCreateLocalPipelineCache(VkData* vk);
+bool            VkMergeLocalPipelineCache(VkData* vk, VkPipelineCache cache);
+void            VkRecordPipelineFeedback(VkData* vk, const VkPipelineCreationFeedback* feedback, uint32_t stageCount, const VkPipelineCreationFeedback* stageFeedbacks);
+
+bool     VkSetupShaderCache(VkData* vk);
+void     VkCleanupShaderCache(VkData* vk);
+bool     VkSaveShaderCache(VkData* vk);
+uint64_t VkShaderCacheHash(uint64_t hash, const void* data, size_t dataSize);
+bool     VkShaderCacheFind(VkData* vk, uint64_t key, uint64_t* sourceHash, uint32_t** code, size_t* codeSize, char** includes, size_t* includesSize);
+bool     VkShaderCacheInsert(VkData* vk, uint64_t key, uint64_t sourceHash, const uint32_t* code, size_t codeSize, const char* includes, size_t includesSize);
+
 bool VkSetupSwapchain(VkSwapchainData* swapchain);
 void VkCleanupSwapchain(VkSwapchainData* swapchain);
+bool VkUpdateSwapchain(VkSwapchainData* swapchain);
+void VkLockSwapchain(VkSwapchainData* swapchain);
+void VkUnlockSwapchain(VkSwapchainData* swapchain);
+void VkSetSwapchainPresentMode(VkSwapchainData* swapchain, VkPresentModeKHR presentMode);
 
 void VkWriteTLASInstance(void* buffer, VkAccStruct* accStruct, uint32_t index, const VkTransformMatrixKHR* transform, uint32_t customIndex, uint8_t mask, uint32_t sbtOffset, VkGeometryInstanceFlagsKHR flags);
 
@@ -166,13 +823,59 @@ void VkCleanupAccStructBuilder(VkAccStructBuilder* builder);
 void VkCleanupAccStruct(VkAccStruct* accStruct);
 bool VkAccStructBuilderSetInstances(VkAccStructBuilder* builder, uint32_t geometryIndex, VkDeviceAddress deviceAddress, uint32_t count);
 bool VkAccStructBuilderSetTriangles(VkAccStructBuilder* builder, uint32_t geometryIndex, VkDeviceAddress vertexAddress, VkFormat vertexFormat, uint32_t vertexStride, uint32_t maxVertex, VkDeviceAddress indexAddress, VkIndexType indexType, uint32_t triangleCount);
+bool VkAccStructBuilderSetHostTriangles(VkAccStructBuilder* builder, uint32_t geometryIndex, const void* vertexData, const void* indexData);
 bool VkAccStructBuilderPrepare(VkAccStructBuilder* builder, VkAccelerationStructureTypeKHR type, VkBuildAccelerationStructureFlagsKHR flags, uint32_t geometryCount, uint32_t firstGeometry);
 bool VkAccStructBuilderBuild(VkAccStructBuilder* builder, VkAccStruct* accStruct);
 bool VkAccStructBuilderCompact(VkAccStructBuilder* builder, VkAccStruct* accStruct, VkAccStruct* compactAccStruct);
-
+bool VkAccStructBuilderBuildBvh(VkAccStructBuilder* builder, VkAccStruct* accStruct);
+
+bool VkSetupLayoutCache(VkData* vk);
+void VkCleanupLayoutCache(VkData* vk);
+bool VkAcquireReflectedLayout(VkData* vk, VkShaderData* const* shaders, uint32_t shaderCount, VkReflectedLayout* layout);
+void VkReleasePipelineLayout(VkData* vk, VkPipelineLayout layout);
+
+VkDescriptorSetLayout VkAcquireDescriptorSetLayout(VkData* vk, const VkDescriptorSetLayoutBinding* bindings, const VkDescriptorBindingFlags* bindingFlags, uint32_t bindingCount);
+void                  VkReleaseDescriptorSetLayout(VkData* vk, VkDescriptorSetLayout setLayout);
+
+bool     VkSetupBindless(VkData* vk);
+void     VkCleanupBindless(VkData* vk);
+void     VkUpdateBindless(VkData* vk);
+uint32_t VkBindlessRegisterBuffer(VkData* vk, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+uint32_t VkBindlessRegisterImage(VkData* vk, VkImageView view, VkImageLayout layout);
+uint32_t VkBindlessRegisterAccStruct(VkData* vk, VkAccelerationStructureKHR accStruct);
+void     VkBindlessRelease(VkData* vk, VkBindlessKind kind, uint32_t index);
+void     VkCmdBindBindless(VkCommandBuffer buffer, VkData* vk, VkPipelineBindPoint bindPoint, VkPipelineLayout layout);
+
+bool VkReflectShader(const uint32_t* code, size_t codeSize, VkShaderReflection* reflection);
+void VkDestroyShaderReflection(VkShaderReflection* reflection);
+
+bool VkSetupShaderPack(VkData* vk);
+void VkCleanupShaderPack(VkData* vk);
 bool VkSetupShader(VkShaderData* shader, const char* filepath);
+bool VkSetupShaders(VkData* vk, VkShaderData* const* shaders, const char* const* filepaths, uint32_t shaderCount);
 void VkCleanupShader(VkShaderData* shader);
 bool VkShaderRecompile(VkShaderData* shader);
+bool VkShaderBeginReload(VkShaderData* shader);
+bool VkShaderReloadReady(VkShaderData* shader);
+bool VkShaderFinishReload(VkShaderData* shader);
 
 bool VkSetupRayTracingPipeline(VkRayTracingPipelineData* rtPipeline);
-void VkCleanupRayTracingPipeline(VkRayTracingPipelineData* rtPipeline);
\ No newline at end of file
+void VkCleanupRayTracingPipeline(VkRayTracingPipelineData* rtPipeline);
+bool VkRebuildRayTracingPipeline(VkRayTracingPipelineData* rtPipeline, const VkShaderData* changed);
+bool VkRayTracingPipelineBuilding(VkRayTracingPipelineData* rtPipeline);
+bool VkUpdateRayTracingPipeline(VkRayTracingPipelineData* rtPipeline);
+void VkCmdBindRayTracingPipeline(VkCommandBuffer buffer, VkRayTracingPipelineData* rtPipeline);
+
+bool               VkSetupPipelineVariants(VkPipelineVariantCacheData* variants);
+void               VkCleanupPipelineVariants(VkPipelineVariantCacheData* variants);
+VkPipelineVariant* VkGetPipelineVariant(VkPipelineVariantCacheData* variants, VkShaderData* raygen, const void* data);
+bool               VkPipelineVariantsBuilding(VkPipelineVariantCacheData* variants);
+
+bool     VkSetupPathTracer(VkPathTracerData* pathTracer);
+void     VkCleanupPathTracer(VkPathTracerData* pathTracer);
+bool     VkPreparePathTracer(VkPathTracerData* pathTracer, VkSwapchainData* swapchain, const VkPathTracerView* view);
+void     VkResetPathTracer(VkPathTracerData* pathTracer);
+void     VkResetPathTracerStats(VkPathTracerData* pathTracer);
+uint32_t VkPathTracerPassCount(VkPathTracerData* pathTracer);
+void     VkCmdPathTracePass(VkCommandBuffer buffer, VkPathTracerData* pathTracer, VkSwapchainData* swapchain, uint32_t pass);
+void     VkCmdPathTrace(VkCommandBuffer buffer, VkPathTracerData* pathTracer, VkSwapchainData* swapchain);
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include <vulkan/vulkan.h>
+
+static PFN_vkCreateDeferredOperationKHR            pfnVkCreateDeferredOperationKHR            = NULL;
+static PFN_vkDestroyDeferredOperationKHR           pfnVkDestroyDeferredOperationKHR           = NULL;
+static PFN_vkGetDeferredOperationMaxConcurrencyKHR pfnVkGetDeferredOperationMaxConcurrencyKHR = NULL;
+static PFN_vkGetDeferredOperationResultKHR         pfnVkGetDeferredOperationResultKHR         = NULL;
+static PFN_vkDeferredOperationJoinKHR              pfnVkDeferredOperationJoinKHR              = NULL;
+
+void VkLoadDeferredHostOperationsFuncs(VkInstance instance, VkDevice device)
+{
+	(void) instance;
+	if (device)
+	{
+		pfnVkCreateDeferredOperationKHR            = (PFN_vkCreateDeferredOperationKHR) vkGetDeviceProcAddr(device, "vkCreateDeferredOperationKHR");
+		pfnVkDestroyDeferredOperationKHR           = (PFN_vkDestroyDeferredOperationKHR) vkGetDeviceProcAddr(device, "vkDestroyDeferredOperationKHR");
+		pfnVkGetDeferredOperationMaxConcurrencyKHR = (PFN_vkGetDeferredOperationMaxConcurrencyKHR) vkGetDeviceProcAddr(device, "vkGetDeferredOperationMaxConcurrencyKHR");
+		pfnVkGetDeferredOperationResultKHR         = (PFN_vkGetDeferredOperationResultKHR) vkGetDeviceProcAddr(device, "vkGetDeferredOperationResultKHR");
+		pfnVkDeferredOperationJoinKHR              = (PFN_vkDeferredOperationJoinKHR) vkGetDeviceProcAddr(device, "vkDeferredOperationJoinKHR");
+	}
+}
+
+VkResult vkCreateDeferredOperationKHR(VkDevice device, const VkAllocationCallbacks* pAllocator, VkDeferredOperationKHR* pDeferredOperation)
+{
+	if (!pfnVkCreateDeferredOperationKHR) return VK_ERROR_EXTENSION_NOT_PRESENT;
+	return pfnVkCreateDeferredOperationKHR(device, pAllocator, pDeferredOperation);
+}
+
+void vkDestroyDeferredOperationKHR(VkDevice device, VkDeferredOperationKHR operation, const VkAllocationCallbacks* pAllocator)
+{
+	if (pfnVkDestroyDeferredOperationKHR)
+		pfnVkDestroyDeferredOperationKHR(device, operation, pAllocator);
+}
+
+uint32_t vkGetDeferredOperationMaxConcurrencyKHR(VkDevice device, VkDeferredOperationKHR operation)
+{
+	if (!pfnVkGetDeferredOperationMaxConcurrencyKHR) return 0;
+	return pfnVkGetDeferredOperationMaxConcurrencyKHR(device, operation);
+}
+
+VkResult vkGetDeferredOperationResultKHR(VkDevice device, VkDeferredOperationKHR operation)
+{
+	if (!pfnVkGetDeferredOperationResultKHR) return VK_ERROR_EXTENSION_NOT_PRESENT;
+	return pfnVkGetDeferredOperationResultKHR(device, operation);
+}
+
+VkResult vkDeferredOperationJoinKHR(VkDevice device, VkDeferredOperationKHR operation)
+{
+	if (!pfnVkDeferredOperationJoinKHR) return VK_ERROR_EXTENSION_NOT_PRESENT;
+	return pfnVkDeferredOperationJoinKHR(device, operation);
+}
\ No newline at end of file
@@ -4,4 +4,6 @@ void VkLoadFuncs(VkInstance instance, VkDevice device)
 {
 	VkLoadAccelerationStructureFuncs(instance, device);
 	VkLoadRayTracingFuncs(instance, device);
+	VkLoadPresentWaitFuncs(instance, device);
+	VkLoadDeferredHostOperationsFuncs(instance, device);
 }
\ No newline at end of file
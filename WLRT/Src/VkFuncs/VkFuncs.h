@@ -4,5 +4,7 @@
 
 void VkLoadAccelerationStructureFuncs(VkInstance instance, VkDevice device);
 void VkLoadRayTracingFuncs(VkInstance instance, VkDevice device);
+void VkLoadPresentWaitFuncs(VkInstance instance, VkDevice device);
+void VkLoadDeferredHostOperationsFuncs(VkInstance instance, VkDevice device);
 
 void VkLoadFuncs(VkInstance instance, VkDevice device);
\ No newline at end of file
@@ -0,0 +1,16 @@
+#include <vulkan/vulkan.h>
+
+static PFN_vkWaitForPresentKHR pfnVkWaitForPresentKHR = NULL;
+
+void VkLoadPresentWaitFuncs(VkInstance instance, VkDevice device)
+{
+	(void) instance;
+	if (device)
+		pfnVkWaitForPresentKHR = (PFN_vkWaitForPresentKHR) vkGetDeviceProcAddr(device, "vkWaitForPresentKHR");
+}
+
+VkResult vkWaitForPresentKHR(VkDevice device, VkSwapchainKHR swapchain, uint64_t presentId, uint64_t timeout)
+{
+	if (!pfnVkWaitForPresentKHR) return VK_ERROR_EXTENSION_NOT_PRESENT;
+	return pfnVkWaitForPresentKHR(device, swapchain, presentId, timeout);
+}
@@ -1,15 +1,58 @@
 #include <vulkan/vulkan.h>
 
-static PFN_vkCreateRayTracingPipelinesKHR pfnVkCreateRayTracingPipelinesKHR = NULL;
+static PFN_vkCreateRayTracingPipelinesKHR         pfnVkCreateRayTracingPipelinesKHR         = NULL;
+static PFN_vkGetRayTracingShaderGroupHandlesKHR   pfnVkGetRayTracingShaderGroupHandlesKHR   = NULL;
+static PFN_vkGetRayTracingShaderGroupStackSizeKHR pfnVkGetRayTracingShaderGroupStackSizeKHR = NULL;
+static PFN_vkCmdSetRayTracingPipelineStackSizeKHR pfnVkCmdSetRayTracingPipelineStackSizeKHR = NULL;
+static PFN_vkCmdTraceRaysKHR                      pfnVkCmdTraceRaysKHR                      = NULL;
+static PFN_vkCmdTraceRaysIndirectKHR              pfnVkCmdTraceRaysIndirectKHR              = NULL;
 
 void VkLoadRayTracingFuncs(VkInstance instance, VkDevice device)
 {
 	(void) instance;
-	pfnVkCreateRayTracingPipelinesKHR = (PFN_vkCreateRayTracingPipelinesKHR) vkGetDeviceProcAddr(device, "vkCreateRayTracingPipelinesKHR");
+	if (device)
+	{
+		pfnVkCreateRayTracingPipelinesKHR         = (PFN_vkCreateRayTracingPipelinesKHR) vkGetDeviceProcAddr(device, "vkCreateRayTracingPipelinesKHR");
+		pfnVkGetRayTracingShaderGroupHandlesKHR   = (PFN_vkGetRayTracingShaderGroupHandlesKHR) vkGetDeviceProcAddr(device, "vkGetRayTracingShaderGroupHandlesKHR");
+		pfnVkGetRayTracingShaderGroupStackSizeKHR = (PFN_vkGetRayTracingShaderGroupStackSizeKHR) vkGetDeviceProcAddr(device, "vkGetRayTracingShaderGroupStackSizeKHR");
+		pfnVkCmdSetRayTracingPipelineStackSizeKHR = (PFN_vkCmdSetRayTracingPipelineStackSizeKHR) vkGetDeviceProcAddr(device, "vkCmdSetRayTracingPipelineStackSizeKHR");
+		pfnVkCmdTraceRaysKHR                      = (PFN_vkCmdTraceRaysKHR) vkGetDeviceProcAddr(device, "vkCmdTraceRaysKHR");
+		pfnVkCmdTraceRaysIndirectKHR              = (PFN_vkCmdTraceRaysIndirectKHR) vkGetDeviceProcAddr(device, "vkCmdTraceRaysIndirectKHR");
+	}
 }
 
 VkResult vkCreateRayTracingPipelinesKHR(VkDevice device, VkDeferredOperationKHR deferredOperation, VkPipelineCache pipelineCache, uint32_t createInfoCount, const VkRayTracingPipelineCreateInfoKHR* pCreateInfos, const VkAllocationCallbacks* pAllocator, VkPipeline* pPipelines)
 {
 	if (!pfnVkCreateRayTracingPipelinesKHR) return VK_ERROR_EXTENSION_NOT_PRESENT;
 	return pfnVkCreateRayTracingPipelinesKHR(device, deferredOperation, pipelineCache, createInfoCount, pCreateInfos, pAllocator, pPipelines);
+}
+
+VkResult vkGetRayTracingShaderGroupHandlesKHR(VkDevice device, VkPipeline pipeline, uint32_t firstGroup, uint32_t groupCount, size_t dataSize, void* pData)
+{
+	if (!pfnVkGetRayTracingShaderGroupHandlesKHR) return VK_ERROR_EXTENSION_NOT_PRESENT;
+	return pfnVkGetRayTracingShaderGroupHandlesKHR(device, pipeline, firstGroup, groupCount, dataSize, pData);
+}
+
+VkDeviceSize vkGetRayTracingShaderGroupStackSizeKHR(VkDevice device, VkPipeline pipeline, uint32_t group, VkShaderGroupShaderKHR groupShader)
+{
+	if (!pfnVkGetRayTracingShaderGroupStackSizeKHR) return 0;
+	return pfnVkGetRayTracingShaderGroupStackSizeKHR(device, pipeline, group, groupShader);
+}
+
+void vkCmdSetRayTracingPipelineStackSizeKHR(VkCommandBuffer commandBuffer, uint32_t pipelineStackSize)
+{
+	if (pfnVkCmdSetRayTracingPipelineStackSizeKHR)
+		pfnVkCmdSetRayTracingPipelineStackSizeKHR(commandBuffer, pipelineStackSize);
+}
+
+void vkCmdTraceRaysKHR(VkCommandBuffer commandBuffer, const VkStridedDeviceAddressRegionKHR* pRaygenShaderBindingTable, const VkStridedDeviceAddressRegionKHR* pMissShaderBindingTable, const VkStridedDeviceAddressRegionKHR* pHitShaderBindingTable, const VkStridedDeviceAddressRegionKHR* pCallableShaderBindingTable, uint32_t width, uint32_t height, uint32_t depth)
+{
+	if (pfnVkCmdTraceRaysKHR)
+		pfnVkCmdTraceRaysKHR(commandBuffer, pRaygenShaderBindingTable, pMissShaderBindingTable, pHitShaderBindingTable, pCallableShaderBindingTable, width, height, depth);
+}
+
+void vkCmdTraceRaysIndirectKHR(VkCommandBuffer commandBuffer, const VkStridedDeviceAddressRegionKHR* pRaygenShaderBindingTable, const VkStridedDeviceAddressRegionKHR* pMissShaderBindingTable, const VkStridedDeviceAddressRegionKHR* pHitShaderBindingTable, const VkStridedDeviceAddressRegionKHR* pCallableShaderBindingTable, VkDeviceAddress indirectDeviceAddress)
+{
+	if (pfnVkCmdTraceRaysIndirectKHR)
+		pfnVkCmdTraceRaysIndirectKHR(commandBuffer, pRaygenShaderBindingTable, pMissShaderBindingTable, pHitShaderBindingTable, pCallableShaderBindingTable, indirectDeviceAddress);
 }
\ No newline at end of file
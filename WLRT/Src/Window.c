@@ -1,8 +1,10 @@
 #include "Window.h"
+#include "Atomic.h"
 #include "Vk.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -19,6 +21,17 @@ static void GLFWWinSizeCB(GLFWwindow* window, int width, int height)
 	WindowData* wd = (WindowData*) glfwGetWindowUserPointer(window);
 	wd->width      = width;
 	wd->height     = height;
+	wd->resized    = true;
+	wd->resizeTime = glfwGetTime();
+}
+
+static void GLFWKeyCB(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	(void) scancode;
+	(void) mods;
+	WindowData* wd = (WindowData*) glfwGetWindowUserPointer(window);
+	if (action == GLFW_PRESS && key >= 0 && key < (int) (sizeof(wd->keysPressed) / sizeof(*wd->keysPressed)))
+		wd->keysPressed[key] = true;
 }
 
 static void GLFWWinCloseCB(GLFWwindow* window)
@@ -40,6 +53,7 @@ bool WLRTCreateWindow(WindowData* wd)
 	glfwSetWindowPosCallback(wd->handle, &GLFWWinPosCB);
 	glfwSetWindowSizeCallback(wd->handle, &GLFWWinSizeCB);
 	glfwSetWindowCloseCallback(wd->handle, &GLFWWinCloseCB);
+	glfwSetKeyCallback(wd->handle, &GLFWKeyCB);
 
 	GLFWmonitor* monitor = glfwGetPrimaryMonitor();
 	int32_t      mx, my, mw, mh;
@@ -73,6 +87,21 @@ void WLRTWindowPollEvents()
 	glfwPollEvents();
 }
 
+bool WLRTWindowKeyPressed(WindowData* wd, int key)
+{
+	if (!wd || key < 0 || key >= (int) (sizeof(wd->keysPressed) / sizeof(*wd->keysPressed)) || !wd->keysPressed[key])
+		return false;
+	wd->keysPressed[key] = false;
+	return true;
+}
+
+bool WLRTWindowKeyDown(WindowData* wd, int key)
+{
+	if (!wd || !wd->handle)
+		return false;
+	return glfwGetKey(wd->handle, key) == GLFW_PRESS;
+}
+
 static VkSurfaceFormatKHR VkSelectSurfaceFormat(VkData* vk, VkSwapchainData* swapchain)
 {
 	VkSurfaceFormatKHR selectedFormat = {
@@ -126,7 +155,7 @@ static VkPresentModeKHR VkSelectPresentMode(VkData* vk, VkSwapchainData* swapcha
 	for (uint32_t i = 0; i < presentCount; ++i)
 	{
 		VkPresentModeKHR presentMode = presentModes[i];
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+		if (presentMode == swapchain->requestedPresentMode)
 		{
 			selectedMode = presentMode;
 			break;
@@ -136,57 +165,200 @@ static VkPresentModeKHR VkSelectPresentMode(VkData* vk, VkSwapchainData* swapcha
 	return selectedMode;
 }
 
-bool VkSetupSwapchain(VkSwapchainData* swapchain)
+static void VkDestroyRetiredSwapchain(VkData* vk, VkRetiredSwapchainData* retired)
 {
-	if (!swapchain || !swapchain->vk || !swapchain->window)
+	for (uint32_t i = 0; i < retired->imageCount; ++i)
+	{
+		if (retired->views) vkDestroyImageView(vk->device, retired->views[i], vk->allocation);
+	}
+	for (uint32_t i = 0; i < retired->semaphoreCount; ++i)
+	{
+		if (retired->imageAvailable) vkDestroySemaphore(vk->device, retired->imageAvailable[i], vk->allocation);
+		if (retired->renderFinished) vkDestroySemaphore(vk->device, retired->renderFinished[i], vk->allocation);
+	}
+	vkDestroySwapchainKHR(vk->device, retired->swapchain, vk->allocation);
+	free(retired->frameValues);
+	free(retired->images);
+	free(retired->views);
+	free(retired->imageAvailable);
+	free(retired->renderFinished);
+	memset(retired, 0, sizeof(VkRetiredSwapchainData));
+}
+
+static bool VkRetiredSwapchainCompleted(VkData* vk, const VkRetiredSwapchainData* retired)
+{
+	if (AtomicLoad64(&vk->framesPresented) < retired->framesSubmitted)
 		return false;
-	VkData* vk = swapchain->vk;
+	if (retired->framesGeneration != vk->framesGeneration)
+		return true;
 
-	if (!swapchain->surface)
+	for (uint32_t i = 0; i < retired->frameCount; ++i)
 	{
-		if (!VkValidate(vk, glfwCreateWindowSurface(vk->instance, swapchain->window->handle, vk->allocation, &swapchain->surface)))
+		uint64_t value = 0;
+		if (!VkValidate(vk, vkGetSemaphoreCounterValue(vk->device, vk->frames[i].semaphore, &value)) ||
+			value < retired->frameValues[i])
 			return false;
 	}
+	return true;
+}
+
+static void VkCollectRetiredSwapchains(VkSwapchainData* swapchain, bool force)
+{
+	VkData* vk = swapchain->vk;
+
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < swapchain->retiredCount; ++i)
+	{
+		VkRetiredSwapchainData* retired = swapchain->retired + i;
+		if (force || VkRetiredSwapchainCompleted(vk, retired))
+			VkDestroyRetiredSwapchain(vk, retired);
+		else
+			swapchain->retired[kept++] = *retired;
+	}
+	swapchain->retiredCount = kept;
+}
 
-	if (swapchain->swapchain)
+static bool VkRetireSwapchain(VkSwapchainData* swapchain)
+{
+	VkData* vk = swapchain->vk;
+
+	if (!swapchain->swapchain && !swapchain->views && !swapchain->imageAvailable && !swapchain->renderFinished)
+		return true;
+
+	if (swapchain->retiredCount >= swapchain->retiredCapacity)
 	{
-		for (uint32_t i = 0; i < swapchain->imageCount; ++i)
+		uint32_t                newCapacity = swapchain->retiredCapacity ? swapchain->retiredCapacity << 1 : 4;
+		VkRetiredSwapchainData* newRetired  = (VkRetiredSwapchainData*) malloc(newCapacity * sizeof(VkRetiredSwapchainData));
+		if (!newRetired)
 		{
-			if (swapchain->views) vkDestroyImageView(vk->device, swapchain->views[i], vk->allocation);
+			VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate retired swapchains");
+			return false;
 		}
-		free(swapchain->images);
-		free(swapchain->views);
-		swapchain->images = NULL;
-		swapchain->views  = NULL;
+		if (swapchain->retired)
+			memcpy(newRetired, swapchain->retired, swapchain->retiredCount * sizeof(VkRetiredSwapchainData));
+		free(swapchain->retired);
+		swapchain->retiredCapacity = newCapacity;
+		swapchain->retired         = newRetired;
 	}
 
-	VkSwapchainKHR oldSwapchain = swapchain->swapchain;
-
-	VkSurfaceCapabilitiesKHR caps;
-	if (!VkValidate(vk, vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vk->physicalDevice, swapchain->surface, &caps)))
+	uint64_t* frameValues = (uint64_t*) malloc(vk->framesCapacity * sizeof(uint64_t));
+	if (vk->framesCapacity > 0 && !frameValues)
 	{
-		VkCleanupSwapchain(swapchain);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate retired swapchain frame values");
 		return false;
 	}
-	uint32_t imageCount       = min(caps.minImageCount + 1, caps.maxImageCount);
-	bool     imageCountDiffer = imageCount != swapchain->imageCount;
-	if (imageCountDiffer)
+	for (uint32_t i = 0; i < vk->framesCapacity; ++i)
+		frameValues[i] = vk->frames[i].value;
+
+	VkRetiredSwapchainData* retired = swapchain->retired + swapchain->retiredCount;
+	++swapchain->retiredCount;
+	retired->framesSubmitted  = vk->framesSubmitted;
+	retired->framesGeneration = vk->framesGeneration;
+	retired->frameCount       = vk->framesCapacity;
+	retired->frameValues      = frameValues;
+	retired->swapchain        = swapchain->swapchain;
+	retired->imageCount       = swapchain->imageCount;
+	retired->images           = swapchain->images;
+	retired->views            = swapchain->views;
+	retired->semaphoreCount   = swapchain->semaphoreCount;
+	retired->imageAvailable   = swapchain->imageAvailable;
+	retired->renderFinished   = swapchain->renderFinished;
+
+	swapchain->swapchain      = NULL;
+	swapchain->imageCount     = 0;
+	swapchain->images         = NULL;
+	swapchain->views          = NULL;
+	swapchain->semaphoreCount = 0;
+	swapchain->imageAvailable = NULL;
+	swapchain->renderFinished = NULL;
+	return true;
+}
+
+static void VkDiscardSwapchain(VkSwapchainData* swapchain)
+{
+	VkRetiredSwapchainData discarded = {
+		.framesSubmitted  = 0,
+		.framesGeneration = 0,
+		.frameCount       = 0,
+		.frameValues      = NULL,
+		.swapchain        = swapchain->swapchain,
+		.imageCount       = swapchain->imageCount,
+		.images           = swapchain->images,
+		.views            = swapchain->views,
+		.semaphoreCount   = swapchain->semaphoreCount,
+		.imageAvailable   = swapchain->imageAvailable,
+		.renderFinished   = swapchain->renderFinished
+	};
+	VkDestroyRetiredSwapchain(swapchain->vk, &discarded);
+
+	swapchain->swapchain      = NULL;
+	swapchain->imageCount     = 0;
+	swapchain->images         = NULL;
+	swapchain->views          = NULL;
+	swapchain->semaphoreCount = 0;
+	swapchain->imageAvailable = NULL;
+	swapchain->renderFinished = NULL;
+	swapchain->invalid        = true;
+}
+
+static VkExtent2D VkSelectSwapchainExtent(VkSwapchainData* swapchain, const VkSurfaceCapabilitiesKHR* caps)
+{
+	if (caps->currentExtent.width != ~0U)
+		return caps->currentExtent;
+
+	VkExtent2D extent = {
+		.width  = swapchain->window->width,
+		.height = swapchain->window->height
+	};
+	if (extent.width < caps->minImageExtent.width) extent.width = caps->minImageExtent.width;
+	if (extent.width > caps->maxImageExtent.width) extent.width = caps->maxImageExtent.width;
+	if (extent.height < caps->minImageExtent.height) extent.height = caps->minImageExtent.height;
+	if (extent.height > caps->maxImageExtent.height) extent.height = caps->maxImageExtent.height;
+	return extent;
+}
+
+bool VkSetupSwapchain(VkSwapchainData* swapchain)
+{
+	if (!swapchain || !swapchain->vk || !swapchain->window)
+		return false;
+	VkData* vk = swapchain->vk;
+
+	if (!swapchain->mutex)
 	{
-		vkDeviceWaitIdle(vk->device);
-		for (uint32_t i = 0; i < swapchain->imageCount; ++i)
+		swapchain->mutex = MutexCreate();
+		if (!swapchain->mutex)
 		{
-			if (swapchain->imageAvailable) vkDestroySemaphore(vk->device, swapchain->imageAvailable[i], vk->allocation);
-			if (swapchain->renderFinished) vkDestroySemaphore(vk->device, swapchain->renderFinished[i], vk->allocation);
+			VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate swapchain mutex");
+			return false;
 		}
-		free(swapchain->imageAvailable);
-		free(swapchain->renderFinished);
-		swapchain->imageAvailable = NULL;
-		swapchain->renderFinished = NULL;
 	}
+	if (!swapchain->surface)
+	{
+		if (!VkValidate(vk, glfwCreateWindowSurface(vk->instance, swapchain->window->handle, vk->allocation, &swapchain->surface)))
+			return false;
+	}
+
+	VkSurfaceCapabilitiesKHR caps;
+	if (!VkValidate(vk, vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vk->physicalDevice, swapchain->surface, &caps)))
+		return false;
+	VkExtent2D extent = VkSelectSwapchainExtent(swapchain, &caps);
+	if (extent.width == 0 || extent.height == 0)
+	{
+		swapchain->invalid = true;
+		return true;
+	}
+
+	VkSwapchainKHR oldSwapchain = swapchain->swapchain;
+	if (!VkRetireSwapchain(swapchain))
+		return false;
+
+	uint32_t imageCount = caps.minImageCount + 1;
+	if (caps.maxImageCount > 0 && imageCount > caps.maxImageCount)
+		imageCount = caps.maxImageCount;
 	swapchain->imageCount  = imageCount;
 	swapchain->format      = VkSelectSurfaceFormat(vk, swapchain);
 	swapchain->presentMode = VkSelectPresentMode(vk, swapchain);
-	swapchain->extent      = caps.currentExtent;
+	swapchain->extent      = extent;
 
 	VkSwapchainCreateInfoKHR createInfo = {
 		.sType                 = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
@@ -198,7 +370,7 @@ bool VkSetupSwapchain(VkSwapchainData* swapchain)
 		.imageColorSpace       = swapchain->format.colorSpace,
 		.imageExtent           = swapchain->extent,
 		.imageArrayLayers      = 1,
-		.imageUsage            = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+		.imageUsage            = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
 		.imageSharingMode      = VK_SHARING_MODE_EXCLUSIVE,
 		.queueFamilyIndexCount = 0,
 		.pQueueFamilyIndices   = NULL,
@@ -210,26 +382,27 @@ bool VkSetupSwapchain(VkSwapchainData* swapchain)
 	};
 	if (!VkValidate(vk, vkCreateSwapchainKHR(vk->device, &createInfo, vk->allocation, &swapchain->swapchain)))
 	{
-		VkCleanupSwapchain(swapchain);
+		swapchain->swapchain  = NULL;
+		swapchain->imageCount = 0;
+		swapchain->invalid    = true;
 		return false;
 	}
-	if (oldSwapchain) vkDestroySwapchainKHR(vk->device, oldSwapchain, vk->allocation);
 	if (!VkValidate(vk, vkGetSwapchainImagesKHR(vk->device, swapchain->swapchain, &swapchain->imageCount, NULL)))
 	{
-		VkCleanupSwapchain(swapchain);
+		VkDiscardSwapchain(swapchain);
 		return false;
 	}
 	swapchain->images = (VkImage*) malloc(swapchain->imageCount * sizeof(VkImage));
-	swapchain->views  = (VkImageView*) malloc(swapchain->imageCount * sizeof(VkImageView));
+	swapchain->views  = (VkImageView*) calloc(swapchain->imageCount, sizeof(VkImageView));
 	if (!swapchain->images || !swapchain->views)
 	{
-		VkCleanupSwapchain(swapchain);
+		VkDiscardSwapchain(swapchain);
 		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate swapchain buffers");
 		return false;
 	}
 	if (!VkValidate(vk, vkGetSwapchainImagesKHR(vk->device, swapchain->swapchain, &swapchain->imageCount, swapchain->images)))
 	{
-		VkCleanupSwapchain(swapchain);
+		VkDiscardSwapchain(swapchain);
 		return false;
 	}
 	for (uint32_t i = 0; i < swapchain->imageCount; ++i)
@@ -246,27 +419,32 @@ bool VkSetupSwapchain(VkSwapchainData* swapchain)
 		};
 		if (!VkValidate(vk, vkCreateImageView(vk->device, &ivCreateInfo, vk->allocation, swapchain->views + i)))
 		{
-			VkCleanupSwapchain(swapchain);
+			VkDiscardSwapchain(swapchain);
 			return false;
 		}
 	}
-	if (imageCountDiffer)
+
+	swapchain->semaphoreCount = vk->framesCapacity;
+	swapchain->imageAvailable = (VkSemaphore*) calloc(swapchain->semaphoreCount, sizeof(VkSemaphore));
+	swapchain->renderFinished = (VkSemaphore*) calloc(swapchain->semaphoreCount, sizeof(VkSemaphore));
+	if (!swapchain->imageAvailable || !swapchain->renderFinished)
+	{
+		VkDiscardSwapchain(swapchain);
+		VkReportError(vk, VK_ERROR_CODE_ALLOCATION_FAILURE, "Failed to allocate swapchain semaphores");
+		return false;
+	}
+	for (uint32_t i = 0; i < swapchain->semaphoreCount; ++i)
 	{
-		swapchain->imageAvailable = (VkSemaphore*) malloc(swapchain->imageCount * sizeof(VkSemaphore));
-		swapchain->renderFinished = (VkSemaphore*) malloc(swapchain->imageCount * sizeof(VkSemaphore));
-		for (uint32_t i = 0; i < swapchain->imageCount; ++i)
+		VkSemaphoreCreateInfo sCreateInfo = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			.pNext = NULL,
+			.flags = 0
+		};
+		if (!VkValidate(vk, vkCreateSemaphore(vk->device, &sCreateInfo, vk->allocation, swapchain->imageAvailable + i)) ||
+			!VkValidate(vk, vkCreateSemaphore(vk->device, &sCreateInfo, vk->allocation, swapchain->renderFinished + i)))
 		{
-			VkSemaphoreCreateInfo sCreateInfo = {
-				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-				.pNext = NULL,
-				.flags = 0
-			};
-			if (!VkValidate(vk, vkCreateSemaphore(vk->device, &sCreateInfo, vk->allocation, swapchain->imageAvailable + i)) ||
-				!VkValidate(vk, vkCreateSemaphore(vk->device, &sCreateInfo, vk->allocation, swapchain->renderFinished + i)))
-			{
-				VkCleanupSwapchain(swapchain);
-				return false;
-			}
+			VkDiscardSwapchain(swapchain);
+			return false;
 		}
 	}
 	swapchain->invalid = false;
@@ -279,12 +457,58 @@ void VkCleanupSwapchain(VkSwapchainData* swapchain)
 		return;
 	VkData* vk = swapchain->vk;
 
-	for (uint32_t i = 0; i < swapchain->imageCount; ++i)
+	VkRetireSwapchain(swapchain);
+	VkCollectRetiredSwapchains(swapchain, true);
+	free(swapchain->retired);
+	swapchain->retired         = NULL;
+	swapchain->retiredCount    = 0;
+	swapchain->retiredCapacity = 0;
+	swapchain->invalid         = true;
+	vkDestroySurfaceKHR(vk->instance, swapchain->surface, vk->allocation);
+	MutexDestroy(swapchain->mutex);
+	swapchain->surface = NULL;
+	swapchain->mutex   = NULL;
+}
+
+bool VkUpdateSwapchain(VkSwapchainData* swapchain)
+{
+	if (!swapchain || !swapchain->vk || !swapchain->window)
+		return false;
+	VkData*     vk     = swapchain->vk;
+	WindowData* window = swapchain->window;
+
+	VkLockSwapchain(swapchain);
+	VkCollectRetiredSwapchains(swapchain, false);
+
+	if ((window->resized || swapchain->suboptimal) && glfwGetTime() - window->resizeTime >= swapchain->resizeDebounce)
+		swapchain->invalid = true;
+	bool result = true;
+	if (swapchain->invalid || swapchain->semaphoreCount != vk->framesCapacity)
 	{
-		if (swapchain->views) vkDestroyImageView(vk->device, swapchain->views[i], vk->allocation);
-		if (swapchain->imageAvailable) vkDestroySemaphore(vk->device, swapchain->imageAvailable[i], vk->allocation);
-		if (swapchain->renderFinished) vkDestroySemaphore(vk->device, swapchain->renderFinished[i], vk->allocation);
+		window->resized       = false;
+		swapchain->suboptimal = false;
+		result                = VkSetupSwapchain(swapchain);
 	}
-	vkDestroySwapchainKHR(vk->device, swapchain->swapchain, vk->allocation);
-	vkDestroySurfaceKHR(vk->instance, swapchain->surface, vk->allocation);
-}
\ No newline at end of file
+	VkUnlockSwapchain(swapchain);
+	return result;
+}
+
+void VkLockSwapchain(VkSwapchainData* swapchain)
+{
+	if (swapchain->mutex) MutexLock(swapchain->mutex);
+}
+
+void VkUnlockSwapchain(VkSwapchainData* swapchain)
+{
+	if (swapchain->mutex) MutexUnlock(swapchain->mutex);
+}
+
+void VkSetSwapchainPresentMode(VkSwapchainData* swapchain, VkPresentModeKHR presentMode)
+{
+	if (!swapchain || swapchain->requestedPresentMode == presentMode)
+		return;
+
+	swapchain->requestedPresentMode = presentMode;
+	if (swapchain->presentMode != presentMode)
+		swapchain->invalid = true;
+}
@@ -12,10 +12,17 @@ typedef struct WindowData
 	int32_t  x, y;
 	uint32_t width, height;
 
+	bool   resized;
+	double resizeTime;
+
+	bool keysPressed[512];
+
 	bool wantsClose;
 } WindowData;
 
 bool WLRTCreateWindow(WindowData* wd);
 void WLRTDestroyWindow(WindowData* wd);
 void WLRTMakeWindowVisible(WindowData* wd);
-void WLRTWindowPollEvents();
\ No newline at end of file
+void WLRTWindowPollEvents();
+bool WLRTWindowKeyPressed(WindowData* wd, int key);
+bool WLRTWindowKeyDown(WindowData* wd, int key);
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "Filesystem.h"
+#include "ShaderC.h"
+#include "ShaderPack.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PACK_MAX_VARIANTS 16
+#define PACK_MAX_DEFINES  8
+
+typedef struct PackOptions
+{
+	const char* directory;
+	const char* output;
+	const char* manifest;
+	uint32_t    recipes;
+} PackOptions;
+
+typedef struct PackFileList
+{
+	uint32_t count;
+	uint32_t capacity;
+	FSPath*  files;
+	bool     failed;
+} PackFileList;
+
+typedef struct PackVariant
+{
+	uint32_t    defineCount;
+	const char* defines[PACK_MAX_DEFINES];
+	char        buffer[256];
+} PackVariant;
+
+typedef struct PackStats
+{
+	uint32_t shaders;
+	uint32_t variants;
+	uint32_t failed;
+	size_t   codeSize;
+} PackStats;
+
+static double PackTime()
+{
+	struct timespec time;
+	timespec_get(&time, TIME_UTC);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static const char* MatchOption(const char* arg, const char* name)
+{
+	size_t nameLen = strlen(name);
+	if (strncmp(arg, name, nameLen) != 0 || arg[nameLen] != '=')
+		return NULL;
+	return arg + nameLen + 1;
+}
+
+static bool ParseShaderRecipes(const char* str, uint32_t* recipes)
+{
+	*recipes = 0;
+	if (strcmp(str, "none") == 0)
+		return true;
+	while (*str)
+	{
+		const char* end    = strchr(str, ',');
+		size_t      length = end ? (size_t) (end - str) : strlen(str);
+		uint32_t    recipe = 0;
+		for (; recipe < SHADERC_RECIPE_COUNT; ++recipe)
+		{
+			const char* name = ShaderCRecipeName((ShaderCRecipe) recipe);
+			if (strlen(name) == length && strncmp(str, name, length) == 0)
+				break;
+		}
+		if (recipe == SHADERC_RECIPE_COUNT)
+			return false;
+		*recipes |= 1U << recipe;
+		str      += end ? length + 1 : length;
+	}
+	return true;
+}
+
+static bool ParseOptions(PackOptions* options, int argc, char** argv)
+{
+	options->directory = "Shaders";
+	options->output    = "Shaders/Shaders.spvpack";
+	options->manifest  = "Shaders/Shaders.manifest";
+	options->recipes   = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg   = argv[i];
+		const char* value = NULL;
+		if ((value = MatchOption(arg, "--directory")) != NULL)
+		{
+			options->directory = value;
+		}
+		else if ((value = MatchOption(arg, "--output")) != NULL)
+		{
+			options->output = value;
+		}
+		else if ((value = MatchOption(arg, "--manifest")) != NULL)
+		{
+			options->manifest = value;
+		}
+		else if ((value = MatchOption(arg, "--recipes")) != NULL)
+		{
+			if (!ParseShaderRecipes(value, &options->recipes))
+			{
+				printf("Unknown shader recipe in '%s', expected none or a comma separated list of strip, dce and fold\n", value);
+				return false;
+			}
+		}
+		else
+		{
+			printf("Unknown option '%s'\n", arg);
+			return false;
+		}
+	}
+	return true;
+}
+
+static VkShaderStageFlagBits PackStageFromPath(const FSPath* filepath)
+{
+	const char* extension = strrchr(filepath->buf, '.');
+	if (!extension)
+		return 0;
+	if (strcmp(extension, ".vert") == 0) return VK_SHADER_STAGE_VERTEX_BIT;
+	if (strcmp(extension, ".frag") == 0) return VK_SHADER_STAGE_FRAGMENT_BIT;
+	if (strcmp(extension, ".comp") == 0) return VK_SHADER_STAGE_COMPUTE_BIT;
+	if (strcmp(extension, ".rgen") == 0) return VK_SHADER_STAGE_RAYGEN_BIT_KHR;
+	if (strcmp(extension, ".rmiss") == 0) return VK_SHADER_STAGE_MISS_BIT_KHR;
+	if (strcmp(extension, ".rchit") == 0) return VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+	if (strcmp(extension, ".rahit") == 0) return VK_SHADER_STAGE_ANY_HIT_BIT_KHR;
+	if (strcmp(extension, ".rint") == 0) return VK_SHADER_STAGE_INTERSECTION_BIT_KHR;
+	if (strcmp(extension, ".rcall") == 0) return VK_SHADER_STAGE_CALLABLE_BIT_KHR;
+	return 0;
+}
+
+static void PackCollectFile(const FSPath* filepath, void* userData)
+{
+	PackFileList* list = (PackFileList*) userData;
+	if (list->failed || !PackStageFromPath(filepath))
+		return;
+
+	if (list->count >= list->capacity)
+	{
+		uint32_t newCapacity = list->capacity > 0 ? list->capacity * 2 : 16;
+		FSPath*  newFiles    = (FSPath*) realloc(list->files, newCapacity * sizeof(FSPath));
+		if (!newFiles)
+		{
+			list->failed = true;
+			return;
+		}
+		list->files    = newFiles;
+		list->capacity = newCapacity;
+	}
+	list->files[list->count] = FSCreatePath(filepath->buf, filepath->len);
+	if (!list->files[list->count].buf)
+	{
+		list->failed = true;
+		return;
+	}
+	++list->count;
+}
+
+static int PackCompareFiles(const void* lhs, const void* rhs)
+{
+	return strcmp(((const FSPath*) lhs)->buf, ((const FSPath*) rhs)->buf);
+}
+
+static char* PackReadFile(const char* filepath, size_t* size)
+{
+	*size      = 0;
+	FILE* file = fopen(filepath, "rb");
+	if (!file)
+		return NULL;
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char* source = fileSize >= 0 ? (char*) malloc(fileSize > 0 ? fileSize : 1) : NULL;
+	if (!source)
+	{
+		fclose(file);
+		return NULL;
+	}
+	*size = fread(source, 1, fileSize, file);
+	fclose(file);
+	return source;
+}
+
+static uint32_t PackParseVariants(const char* source, size_t size, PackVariant* variants)
+{
+	static const char s_Pragma[] = "#pragma wlrt_variant(";
+
+	uint32_t variantCount   = 1;
+	variants[0].defineCount = 0;
+	for (size_t offset = 0; offset < size && variantCount < PACK_MAX_VARIANTS;)
+	{
+		size_t lineEnd = offset;
+		while (lineEnd < size && source[lineEnd] != '\n')
+			++lineEnd;
+		size_t start = offset;
+		while (start < lineEnd && (source[start] == ' ' || source[start] == '\t'))
+			++start;
+		offset = lineEnd + 1;
+		if (lineEnd - start < sizeof(s_Pragma) - 1 || strncmp(source + start, s_Pragma, sizeof(s_Pragma) - 1) != 0)
+			continue;
+
+		PackVariant* variant = variants + variantCount;
+		size_t       length  = 0;
+		start               += sizeof(s_Pragma) - 1;
+		while (start + length < lineEnd && source[start + length] != ')' && length < sizeof(variant->buffer) - 1)
+			++length;
+		memcpy(variant->buffer, source + start, length);
+		variant->buffer[length] = '\0';
+		variant->defineCount    = 0;
+		for (char* token = variant->buffer; *token && variant->defineCount < PACK_MAX_DEFINES;)
+		{
+			size_t tokenLength = strcspn(token, ", \t\r");
+			if (tokenLength > 0)
+				variant->defines[variant->defineCount++] = token;
+			token += tokenLength;
+			if (*token)
+				*token++ = '\0';
+		}
+		if (variant->defineCount > 0)
+			++variantCount;
+	}
+	return variantCount;
+}
+
+static bool PackCompileVariant(ShaderPackBuilder* builder, FILE* manifest, const PackOptions* options, const char* filepath, VkShaderStageFlagBits stage, const char* source, size_t sourceSize, const PackVariant* variant, PackStats* stats)
+{
+	char*  preprocessed     = NULL;
+	size_t preprocessedSize = 0;
+	char*  includes         = NULL;
+	size_t includesSize     = 0;
+	bool   result           = ShaderCPreprocessShader(filepath, stage, source, sourceSize, variant->defines, variant->defineCount, &preprocessed, &preprocessedSize, &includes, &includesSize);
+	free(preprocessed);
+	if (!result)
+	{
+		free(includes);
+		return false;
+	}
+
+	uint32_t* code     = NULL;
+	size_t    codeSize = 0;
+	if (!ShaderCCompileShader(filepath, stage, source, sourceSize, variant->defines, variant->defineCount, &code, &codeSize))
+	{
+		free(includes);
+		return false;
+	}
+	size_t compiledSize = codeSize;
+	for (uint32_t i = 0; i < SHADERC_RECIPE_COUNT; ++i)
+	{
+		uint32_t* optimized     = NULL;
+		size_t    optimizedSize = 0;
+		if (!(options->recipes & (1U << i)) || !ShaderCOptimize((ShaderCRecipe) i, code, codeSize, &optimized, &optimizedSize))
+			continue;
+		free(code);
+		code     = optimized;
+		codeSize = optimizedSize;
+	}
+
+	uint64_t sourceHash = 0;
+	uint64_t key        = ShaderPackKey(filepath, stage, variant->defines, variant->defineCount);
+	if (!ShaderPackHashSources(filepath, includes, includesSize, &sourceHash) ||
+		!ShaderPackAdd(builder, key, sourceHash, stage, filepath, includes, includesSize, code, codeSize))
+	{
+		printf("Failed to add %s to the shader pack\n", filepath);
+		free(code);
+		free(includes);
+		return false;
+	}
+	free(code);
+
+	printf("%s", filepath);
+	fprintf(manifest, "%016llx %016llx %7zu %s", (unsigned long long) key, (unsigned long long) sourceHash, codeSize, filepath);
+	for (uint32_t i = 0; i < variant->defineCount; ++i)
+	{
+		printf(" -D%s", variant->defines[i]);
+		fprintf(manifest, " -D%s", variant->defines[i]);
+	}
+	for (size_t offset = 0; offset < includesSize; offset += strlen(includes + offset) + 1)
+		fprintf(manifest, " +%s", includes + offset);
+	printf(": %zu -> %zu bytes\n", compiledSize, codeSize);
+	fprintf(manifest, "\n");
+	free(includes);
+	stats->codeSize += codeSize;
+	++stats->variants;
+	return true;
+}
+
+static void PackShader(ShaderPackBuilder* builder, FILE* manifest, const PackOptions* options, const FSPath* filepath, PackStats* stats)
+{
+	size_t sourceSize = 0;
+	char*  source     = PackReadFile(filepath->buf, &sourceSize);
+	if (!source)
+	{
+		printf("Failed to read %s\n", filepath->buf);
+		++stats->failed;
+		return;
+	}
+
+	PackVariant* variants = (PackVariant*) malloc(PACK_MAX_VARIANTS * sizeof(PackVariant));
+	if (!variants)
+	{
+		free(source);
+		++stats->failed;
+		return;
+	}
+	uint32_t variantCount = PackParseVariants(source, sourceSize, variants);
+	for (uint32_t i = 0; i < variantCount; ++i)
+	{
+		if (!PackCompileVariant(builder, manifest, options, filepath->buf, PackStageFromPath(filepath), source, sourceSize, variants + i, stats))
+			++stats->failed;
+	}
+	++stats->shaders;
+	free(variants);
+	free(source);
+}
+
+int main(int argc, char** argv)
+{
+	PackOptions options;
+	if (!ParseOptions(&options, argc, argv))
+		return 1;
+
+	double       start     = PackTime();
+	FSPath       directory = FSCreatePath(options.directory, ~0ULL);
+	PackFileList list      = { 0 };
+	bool         listed    = directory.buf && FSIterateDirectory(&directory, &PackCollectFile, &list) && !list.failed;
+	FSDestroyPath(&directory);
+	FILE* manifest = listed ? fopen(options.manifest, "w") : NULL;
+	if (!manifest)
+	{
+		printf(listed ? "Failed to open %s\n" : "Failed to list shaders in %s\n", listed ? options.manifest : options.directory);
+		for (uint32_t i = 0; i < list.count; ++i)
+			FSDestroyPath(list.files + i);
+		free(list.files);
+		return 1;
+	}
+	qsort(list.files, list.count, sizeof(FSPath), &PackCompareFiles);
+
+	fprintf(manifest, "# %s\n# recipes", ShaderCCompilerIdentity());
+	for (uint32_t i = 0; i < SHADERC_RECIPE_COUNT; ++i)
+	{
+		if (options.recipes & (1U << i))
+			fprintf(manifest, " %s", ShaderCRecipeName((ShaderCRecipe) i));
+	}
+	fprintf(manifest, "\n# key source-hash size shader defines +includes\n");
+
+	ShaderPackBuilder builder = { 0 };
+	PackStats         stats   = { 0 };
+	for (uint32_t i = 0; i < list.count; ++i)
+	{
+		PackShader(&builder, manifest, &options, list.files + i, &stats);
+		FSDestroyPath(list.files + i);
+	}
+	free(list.files);
+
+	bool written = fclose(manifest) == 0;
+	written      = stats.failed == 0 && ShaderPackWrite(&builder, options.output, options.recipes) && written;
+	ShaderPackDestroyBuilder(&builder);
+	if (!written)
+	{
+		printf("Failed to write %s, %u shader variants failed\n", options.output, stats.failed);
+		return 1;
+	}
+
+	FSPath   output   = FSCreatePath(options.output, ~0ULL);
+	uint64_t packSize = FSFileSize(&output);
+	FSDestroyPath(&output);
+	printf("Packed %u variants of %u shaders into %s, %zu bytes of SPIR-V, %llu byte pack in %8.3f ms\n",
+		   stats.variants,
+		   stats.shaders,
+		   options.output,
+		   stats.codeSize,
+		   (unsigned long long) packSize,
+		   (PackTime() - start) * 1000.0);
+	return 0;
+}
\ No newline at end of file
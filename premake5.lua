@@ -1,3 +1,13 @@
+newoption({
+	trigger     = "avx2",
+	description = "Use 8 wide AVX2 traversal in the CPU reference tracer"
+})
+
+newoption({
+	trigger     = "no-shaderc",
+	description = "Build WLRT without the shaderc runtime, shaders are only loaded from the WLRTShaderPack output"
+})
+
 workspace("WLRT")
 	common:addConfigs()
 	common:addBuildDefines()
@@ -25,6 +35,46 @@ workspace("WLRT")
 		files({ "%{prj.location}/Src/**" })
 		removefiles({ "*.DS_Store" })
 
-		pkgdeps({ "stb", "glfw", "vulkan-sdk:shaderc=true" })
+		if _OPTIONS["no-shaderc"] then
+			pkgdeps({ "stb", "glfw", "vulkan-sdk" })
+			dependson({ "WLRTShaderPack" })
+		else
+			pkgdeps({ "stb", "glfw", "vulkan-sdk:shaderc=true" })
+		end
+
+		filter("options:avx2")
+			vectorextensions("AVX2")
+		filter("options:no-shaderc")
+			defines({ "WLRT_NO_SHADERC" })
+		filter({})
+
+		common:addActions()
+
+	project("WLRTShaderPack")
+		location("WLRTShaderPack/")
+		warnings("Extra")
+		kind("ConsoleApp")
+
+		common:outDirs()
+		debugdir("%{wks.location}/WLRT/Run/")
+
+		includedirs({
+			"%{prj.location}/Src/",
+			"%{wks.location}/WLRT/Src/"
+		})
+		files({
+			"%{prj.location}/Src/**",
+			"%{wks.location}/WLRT/Src/Filesystem.c",
+			"%{wks.location}/WLRT/Src/Filesystem.h",
+			"%{wks.location}/WLRT/Src/ShaderC.cpp",
+			"%{wks.location}/WLRT/Src/ShaderC.h",
+			"%{wks.location}/WLRT/Src/ShaderPack.c",
+			"%{wks.location}/WLRT/Src/ShaderPack.h"
+		})
+		removefiles({ "*.DS_Store" })
+
+		pkgdeps({ "vulkan-sdk:shaderc=true" })
+
+		postbuildcommands({ "{CHDIR} \"%{wks.location}/WLRT/Run/\" && \"%{cfg.buildtarget.abspath}\"" })
 
 		common:addActions()
\ No newline at end of file